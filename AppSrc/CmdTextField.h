@@ -5,6 +5,7 @@
  */
 
 #import <UIKit/UIKit.h>
+#import "GlkTagTable.h"
 
 @class GlkWindowView;
 @class StyleSet;
@@ -15,13 +16,13 @@
 	UIButton *menubutton;
 	BOOL singlechar;
 	
-	NSNumber *wintag;
+	GlkTag wintag;
 }
 
 @property (nonatomic, retain) IBOutlet UIView *rightsideview;
 @property (nonatomic, retain) IBOutlet UIButton *clearbutton;
 @property (nonatomic, retain) IBOutlet UIButton *menubutton;
-@property (nonatomic, retain) NSNumber *wintag;
+@property (nonatomic) GlkTag wintag;
 
 - (void) setUpForWindow:(GlkWindowView *)winv singleChar:(BOOL)singleChar;
 - (void) adjustInputTraits;
@@ -32,7 +32,6 @@
 	self.rightsideview = nil;
 	self.clearbutton = nil;
 	self.menubutton = nil;
-	self.wintag = nil;
 	[super dealloc];
 }
 
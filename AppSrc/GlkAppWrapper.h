@@ -5,6 +5,7 @@
 */
 
 #import <Foundation/Foundation.h>
+#import "GlkTagTable.h"
 #include "glk.h"
 
 @class GlkEventState;
@@ -51,7 +52,7 @@
 - (void) acceptEventRestart;
 - (BOOL) acceptingEvent;
 - (BOOL) acceptingEventFileSelect;
-- (NSString *) editingTextForWindow:(NSNumber *)tag;
+- (NSString *) editingTextForWindow:(GlkTag)tag;
 - (void) setTimerInterval:(NSNumber *)interval;
 - (void) fireTimer:(id)dummy;
 
@@ -64,7 +65,7 @@
 	glui32 genval1;
 	glui32 genval2;
 	NSString *line;
-	NSNumber *tag;
+	GlkTag tag;
 }
 
 @property (nonatomic) glui32 type;
@@ -72,10 +73,10 @@
 @property (nonatomic) glui32 genval1;
 @property (nonatomic) glui32 genval2;
 @property (nonatomic, retain) NSString *line;
-@property (nonatomic, retain) NSNumber *tag;
+@property (nonatomic) GlkTag tag;
 
-+ (GlkEventState *) charEvent:(glui32)ch inWindow:(NSNumber *)tag;
-+ (GlkEventState *) lineEvent:(NSString *)line inWindow:(NSNumber *)tag;
++ (GlkEventState *) charEvent:(glui32)ch inWindow:(GlkTag)tag;
++ (GlkEventState *) lineEvent:(NSString *)line inWindow:(GlkTag)tag;
 + (GlkEventState *) timerEvent;
 
 @end
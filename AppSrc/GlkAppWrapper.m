@@ -23,9 +23,15 @@
 #import "GlkFileTypes.h"
 #import "GlkUtilTypes.h"
 #import "GlkUtilities.h"
+#import "GlkTurnTiming.h"
 #include "glk.h"
 #include "iosglk_startup.h"
 
+#ifdef IOSGLK_TURN_TIMING
+/* When the VM thread last left glk_select() (or began glk_main()). Only touched by the VM thread. */
+static uint64_t vmresumetime = 0;
+#endif // IOSGLK_TURN_TIMING
+
 @implementation GlkAppWrapper
 
 @synthesize iowait;
@@ -100,6 +106,9 @@ static GlkAppWrapper *singleton = nil;
 		@try {
 			lasteventtype = -1; // meaning startup
 			lastwaittime = [NSDate timeIntervalSinceReferenceDate];
+#ifdef IOSGLK_TURN_TIMING
+			vmresumetime = GlkTurnTimeNow();
+#endif // IOSGLK_TURN_TIMING
 			glk_main();
 		} @catch (GlkExitException *ce) {
 			NSLog(@"VM thread caught glk_exit exception");
@@ -127,6 +136,10 @@ static GlkAppWrapper *singleton = nil;
 	This must be called on the VM thread. 
 */
 - (void) selectEvent:(event_t *)event special:(id)special {
+#ifdef IOSGLK_TURN_TIMING
+	GlkTurnTimeRecord(turnphase_VM, vmresumetime);
+#endif // IOSGLK_TURN_TIMING
+	
 	/* This is a good time to drain and recreate the thread's autorelease pool. We'll also do this in glk_tick(). */
 	[looppool drain]; // releases it
 	looppool = [[NSAutoreleasePool alloc] init];
@@ -261,6 +274,9 @@ static GlkAppWrapper *singleton = nil;
 	lastwaittime = [NSDate timeIntervalSinceReferenceDate];
 	//NSLog(@"VM thread glk_select returned (evtype %d)", (event ? event->type : -1));
 	[iowaitcond unlock];
+#ifdef IOSGLK_TURN_TIMING
+	vmresumetime = GlkTurnTimeNow();
+#endif // IOSGLK_TURN_TIMING
 }
 
 /* Check if one of the internal event types has arrived. (That includes timer and resize events, not input events.)
@@ -333,7 +349,7 @@ static GlkAppWrapper *singleton = nil;
 }
 
 /* This is called from the VM thread, while the VM is running. It throws a call into the main thread, where the user is (presumably) busy editing an input field. */
-- (NSString *) editingTextForWindow:(NSNumber *)tag {
+- (NSString *) editingTextForWindow:(GlkTag)tag {
 	GlkFrameView *frameview = [IosGlkViewController singleton].frameview;
 	if (!frameview)
 		return nil;
@@ -459,7 +475,7 @@ static GlkAppWrapper *singleton = nil;
 @synthesize line;
 @synthesize tag;
 
-+ (GlkEventState *) charEvent:(glui32)ch inWindow:(NSNumber *)tag {
++ (GlkEventState *) charEvent:(glui32)ch inWindow:(GlkTag)tag {
 	GlkEventState *event = [[[GlkEventState alloc] init] autorelease];
 	event.type = evtype_CharInput;
 	event.tag = tag;
@@ -467,7 +483,7 @@ static GlkAppWrapper *singleton = nil;
 	return event;
 }
 
-+ (GlkEventState *) lineEvent:(NSString *)line inWindow:(NSNumber *)tag {
++ (GlkEventState *) lineEvent:(NSString *)line inWindow:(GlkTag)tag {
 	GlkEventState *event = [[[GlkEventState alloc] init] autorelease];
 	event.type = evtype_LineInput;
 	event.tag = tag;
@@ -483,7 +499,6 @@ static GlkAppWrapper *singleton = nil;
 
 - (void) dealloc {
 	self.line = nil;
-	self.tag = nil;
 	[super dealloc];
 }
 
@@ -5,6 +5,7 @@
 */
 
 #import <UIKit/UIKit.h>
+#import "GlkTagTable.h"
 #import "InputMenuView.h"
 
 @class GlkLibraryState;
@@ -22,28 +23,28 @@
 	/* True if we should re-layout even when the box hasn't changed. */
 	BOOL cachedGlkBoxInvalid;
 	
-	/* Maps tags (NSNumbers) to GlkWindowViews. (But pair windows are excluded.) */
-	NSMutableDictionary *windowviews;
-	/* Maps tags (NSNumbers) to Geometry objects. (Only for pair windows.) */
-	NSMutableDictionary *wingeometries;
-	NSNumber *rootwintag;
+	/* Maps tags (integer keys) to GlkWindowViews. (But pair windows are excluded.) */
+	NSMapTable *windowviews;
+	/* Maps tags (integer keys) to Geometry objects. (Only for pair windows.) */
+	NSMapTable *wingeometries;
+	GlkTag rootwintag;
 	
 	PopMenuView *menuview;
 	InputMenuMode inputmenumode;
 }
 
 @property (nonatomic, retain) GlkLibraryState *librarystate;
-@property (nonatomic, retain) NSMutableDictionary *windowviews;
-@property (nonatomic, retain) NSMutableDictionary *wingeometries;
-@property (nonatomic, retain) NSNumber *rootwintag;
+@property (nonatomic, retain) NSMapTable *windowviews;
+@property (nonatomic, retain) NSMapTable *wingeometries;
+@property (nonatomic) GlkTag rootwintag;
 @property (nonatomic, retain) PopMenuView *menuview;
 
-- (GlkWindowView *) windowViewForTag:(NSNumber *)tag;
+- (GlkWindowView *) windowViewForTag:(GlkTag)tag;
 - (void) requestLibraryState:(GlkAppWrapper *)glkapp;
 - (void) updateFromLibraryState:(GlkLibraryState *)library;
 - (void) updateWindowStyles;
 - (void) updateInputTraits;
-- (void) windowViewRearrange:(NSNumber *)tag rect:(CGRect)box;
+- (void) windowViewRearrange:(GlkTag)tag rect:(CGRect)box;
 - (void) editingTextForWindow:(GlkTagString *)tagstring;
 - (void) postPopMenu:(PopMenuView *)menuview;
 - (void) removePopMenuAnimated:(BOOL)animated;
@@ -28,6 +28,13 @@
 #import "GlkUtilTypes.h"
 #import "GlkUtilities.h"
 
+/* The windowviews and wingeometries maps are keyed directly by tag (integer-personality keys), so no key objects are created. */
+#define TAGKEY(tag) ((id)(intptr_t)(tag))
+
+static NSMapTable *new_tag_map() {
+	return [NSMapTable mapTableWithKeyOptions:(NSPointerFunctionsOpaqueMemory | NSPointerFunctionsIntegerPersonality) valueOptions:NSPointerFunctionsStrongMemory];
+}
+
 @implementation GlkFrameView
 
 @synthesize librarystate;
@@ -40,9 +47,9 @@
 {
 	self = [super initWithCoder:decoder];
 	if (self) {
-		self.windowviews = [NSMutableDictionary dictionaryWithCapacity:8];
-		self.wingeometries = [NSMutableDictionary dictionaryWithCapacity:8];
-		rootwintag = nil;
+		self.windowviews = new_tag_map();
+		self.wingeometries = new_tag_map();
+		rootwintag = 0;
 		
 		cachedGlkBox = CGRectNull;
 		cachedGlkBoxInvalid = YES;
@@ -56,13 +63,12 @@
 	self.librarystate = nil;
 	self.windowviews = nil;
 	self.wingeometries = nil;
-	self.rootwintag = nil;
 	self.menuview = nil;
 	[super dealloc];
 }
 
-- (GlkWindowView *) windowViewForTag:(NSNumber *)tag {
-	return [windowviews objectForKey:tag];
+- (GlkWindowView *) windowViewForTag:(GlkTag)tag {
+	return [windowviews objectForKey:TAGKEY(tag)];
 }
 
 /* Force all the windows to pick up new stylesets, and force all the windowviews to notice that fact.
@@ -71,8 +77,7 @@
  */
 - (void) updateWindowStyles {
 	[self setNeedsLayout];
-	for (NSNumber *tag in windowviews) {
-		GlkWindowView *winv = [windowviews objectForKey:tag];
+	for (GlkWindowView *winv in [windowviews objectEnumerator]) {
 		StyleSet *styleset = [StyleSet buildForWindowType:winv.winstate.type rock:winv.winstate.rock];
 		winv.winstate.styleset = styleset;
 		winv.styleset = styleset;
@@ -87,8 +92,7 @@
 }
 
 - (void) updateInputTraits {
-	for (NSNumber *tag in windowviews) {
-		GlkWindowView *winv = [windowviews objectForKey:tag];
+	for (GlkWindowView *winv in [windowviews objectEnumerator]) {
 		if (winv.inputfield)
 			[winv.inputfield adjustInputTraits];
 	}
@@ -144,9 +148,9 @@
  
 	Calls setNeedsLayout for any window which changes size.
 */
-- (void) windowViewRearrange:(NSNumber *)tag rect:(CGRect)box {
-	GlkWindowView *winv = [windowviews objectForKey:tag];
-	Geometry *geometry = [wingeometries objectForKey:tag];
+- (void) windowViewRearrange:(GlkTag)tag rect:(CGRect)box {
+	GlkWindowView *winv = [windowviews objectForKey:TAGKEY(tag)];
+	Geometry *geometry = [wingeometries objectForKey:TAGKEY(tag)];
 	
 	/* Exactly one of winv and geom should be set here. (geom for pair windows, winv for all others.) */
 	if (winv && geometry)
@@ -169,7 +173,7 @@
 	else {
 		CGRect box1;
 		CGRect box2;
-		NSNumber *ch1, *ch2;
+		GlkTag ch1, ch2;
 		
 		[geometry computeDivision:box for1:&box1 for2:&box2];
 
@@ -210,25 +214,31 @@
 	// vmexited is cached in the viewc also.
 	
 	/* Build a list of windowviews which need to be closed. */
-	NSMutableDictionary *closed = [NSMutableDictionary dictionaryWithDictionary:windowviews];
+	GlkTagTable livetags;
+	GlkTagTableInit(&livetags);
 	for (GlkWindowState *win in library.windows) {
-		[closed removeObjectForKey:win.tag];
+		GlkTagTableSet(&livetags, win.tag, win);
+	}
+	NSMutableArray *closed = [NSMutableArray arrayWithCapacity:4];
+	for (GlkWindowView *winv in [windowviews objectEnumerator]) {
+		if (!GlkTagTableGet(&livetags, winv.winstate.tag))
+			[closed addObject:winv];
 	}
+	GlkTagTableFree(&livetags);
 
 	/* And close them. */
-	for (NSNumber *tag in closed) {
-		GlkWindowView *winv = [closed objectForKey:tag];
+	for (GlkWindowView *winv in closed) {
 		[winv removeFromSuperview];
 		winv.inputfield = nil; /* detach this now */
 		winv.inputholder = nil;
-		[windowviews removeObjectForKey:tag];
+		[windowviews removeObjectForKey:TAGKEY(winv.winstate.tag)];
 	}
 	
 	closed = nil;
 	
 	/* If there are any new windows, create windowviews for them. */
 	for (GlkWindowState *win in library.windows) {
-		if (win.type != wintype_Pair && ![windowviews objectForKey:win.tag]) {
+		if (win.type != wintype_Pair && ![windowviews objectForKey:TAGKEY(win.tag)]) {
 			IosGlkViewController *glkviewc = [IosGlkViewController singleton];
 			UIEdgeInsets viewmargin = UIEdgeInsetsZero;
 			if (glkviewc.glkdelegate)
@@ -252,7 +262,7 @@
 				default:
 					[NSException raise:@"GlkException" format:@"no windowview class for this window"];
 			}
-			[windowviews setObject:winv forKey:win.tag];
+			[windowviews setObject:winv forKey:TAGKEY(win.tag)];
 			[self addSubview:winv];
 		}
 	}
@@ -265,7 +275,7 @@
 		for (GlkWindowState *win in library.windows) {
 			if (win.type == wintype_Pair) {
 				GlkWindowPairState *pairwin = (GlkWindowPairState *)win;
-				[wingeometries setObject:pairwin.geometry forKey:win.tag];
+				[wingeometries setObject:pairwin.geometry forKey:TAGKEY(win.tag)];
 			}
 		}
 	}
@@ -282,21 +292,19 @@
 	
 	/*
 	NSLog(@"frameview has %d windows:", windowviews.count);
-	for (NSNumber *tag in windowviews) {
-		NSLog(@"... %d: %@", [tag intValue], [windowviews objectForKey:tag]);
-		//GlkWindowView *winv = [windowviews objectForKey:tag];
+	for (GlkWindowView *winv in [windowviews objectEnumerator]) {
+		NSLog(@"... %ld: %@", (long)winv.winstate.tag, winv);
 		//NSLog(@"... win is %@", winv.win);
 	}
 	*/
 
 	/* Now go through all the window views, and tell them to update to match their windows. */
 	for (GlkWindowState *win in library.windows) {
-		GlkWindowView *winv = [windowviews objectForKey:win.tag];
+		GlkWindowView *winv = [windowviews objectForKey:TAGKEY(win.tag)];
 		if (winv)
 			winv.winstate = win;
 	}
-	for (NSNumber *tag in windowviews) {
-		GlkWindowView *winv = [windowviews objectForKey:tag];
+	for (GlkWindowView *winv in [windowviews objectEnumerator]) {
 		[winv updateFromWindowState];
 		[winv updateFromWindowInputs];
 	}
@@ -340,7 +348,7 @@
 	This is invoked in the main thread, by the VM thread, which is waiting on the result. We're safe from deadlock because the VM thread can't be in glk_select(); it can't be holding the iowait lock, and it can't get into the code path that rearranges the view structure.
 */
 - (void) editingTextForWindow:(GlkTagString *)tagstring {
-	GlkWindowView *winv = [windowviews objectForKey:tagstring.tag];
+	GlkWindowView *winv = [windowviews objectForKey:TAGKEY(tagstring.tag)];
 	if (!winv)
 		return;
 	
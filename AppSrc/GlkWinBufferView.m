@@ -101,7 +101,7 @@
 	if (bufwin.linesdirtyfrom >= bufwin.linesdirtyto)
 		return;
 	
-	[textview updateWithLines:bufwin.lines dirtyFrom:bufwin.linesdirtyfrom clearCount:bufwin.clearcount refresh:bufwin.library.everythingchanged];
+	[textview updateWithLines:bufwin.lines linesStart:bufwin.linesstart dirtyFrom:bufwin.linesdirtyfrom clearCount:bufwin.clearcount refresh:bufwin.library.everythingchanged];
 	[textview setNeedsDisplay];
 }
 
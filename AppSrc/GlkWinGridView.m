@@ -86,6 +86,11 @@
 	for (GlkStyledLine *sln in lines) {
 		CGPoint pt;
 		pt.y = marginoffset.y + jx * charbox.height;
+		if (pt.y + charbox.height <= rect.origin.y || pt.y >= rect.origin.y + rect.size.height) {
+			/* Outside the area being redrawn. */
+			jx++;
+			continue;
+		}
 		for (GlkStyledString *str in sln.arr) {
 			UIColor *color = colors[str.style];
 			if (color != lastcolor) {
@@ -99,9 +104,11 @@
 	}
 }
 
+/* The library only sends lines which actually changed, so we only redraw those rows. */
 - (void) updateFromWindowState {
 	GlkWindowGridState *gridwin = (GlkWindowGridState *)winstate;
-	BOOL anychanges = NO;
+	int firstchanged = -1;
+	int lastchanged = -1;
 	
 	for (GlkStyledLine *sln in gridwin.lines) {
 		if (sln.index < lines.count)
@@ -113,19 +120,43 @@
 			}
 			[lines addObject:sln];
 		}
-		anychanges = YES;
+		if (firstchanged < 0 || sln.index < firstchanged)
+			firstchanged = sln.index;
+		if (sln.index > lastchanged)
+			lastchanged = sln.index;
 	}
 	
 	int height = gridwin.height;
 	while (lines.count > height) {
 		[lines removeLastObject];
-		anychanges = YES;
+		if (firstchanged < 0 || lines.count < firstchanged)
+			firstchanged = lines.count;
+		lastchanged = INT_MAX;
 	}
 	
-	if (!anychanges)
+	if (firstchanged < 0)
 		return;
 	
-	[self setNeedsDisplay];
+	if (lastchanged == INT_MAX) {
+		/* Rows went away; the space below them needs repainting too. */
+		[self setNeedsDisplay];
+		return;
+	}
+	
+	CGRect realbounds = RectApplyingEdgeInsets(self.bounds, viewmargin);
+	CGFloat rowheight = styleset.charbox.height;
+	CGFloat topy = styleset.margins.top + viewmargin.top;
+	CGRect box;
+	box.origin.x = realbounds.origin.x;
+	box.size.width = realbounds.size.width;
+	box.origin.y = topy + firstchanged * rowheight;
+	box.size.height = (lastchanged+1 - firstchanged) * rowheight;
+	if (firstchanged == 0) {
+		/* Include the top margin. */
+		box.size.height += (box.origin.y - realbounds.origin.y);
+		box.origin.y = realbounds.origin.y;
+	}
+	[self setNeedsDisplayInRect:box];
 }
 
 - (void) placeInputField:(UITextField *)field holder:(UIScrollView *)holder {
@@ -36,6 +36,11 @@ typedef enum GlkSaveFormat_enum {
 - (UIEdgeInsets) viewMarginForWindow:(GlkWindowState *)win rect:(CGRect)rect framebounds:(CGRect)framebounds;
 - (void) vmHasExited;
 
+@optional
+
+- (void) scrollbackLimitsForWindowRock:(glui32)rock lines:(int *)maxlinesref bytes:(NSUInteger *)maxbytesref spill:(BOOL *)spillref;
+- (BOOL) writeBehindForFileUsage:(glui32)usage;
+
 @end
 
 
@@ -88,6 +88,23 @@ DefaultGlkLibDelegate *_DefaultGlkLibDelegate_singleton = nil; // retained forev
 	}
 }
 
+/* Decide how much scrollback a buffer window keeps. On entry, *maxlinesref and *maxbytesref hold the library defaults (200 lines, no byte limit); change them if you like. Zero means no limit. When a window reaches either limit, the oldest lines the player has already seen are discarded until it's back under half of each. (The window's approximate usage is available as GlkWindowBuffer.linesbytes, if you want to measure before choosing.)
+ 
+	If you set *spillref to YES, the discarded lines are written to disk instead (see GlkScrollbackSpill.h). Each window gets a pair of files in Documents/GlkScrollback_<gameId>: win<tag>.lines holds the line records, and win<tag>.index holds each record's offset. Turning the spill on truncates any files left over from an earlier session. The window's state carries the spill so that the view can page them back in. The spill lasts for the session; it isn't saved with the library state.
+ 
+	This is invoked from the VM thread, when a buffer window is created or restored. It's optional in the protocol; if your delegate doesn't implement it, every buffer window gets the defaults and no spill.
+ */
+- (void) scrollbackLimitsForWindowRock:(glui32)rock lines:(int *)maxlinesref bytes:(NSUInteger *)maxbytesref spill:(BOOL *)spillref {
+}
+
+/* Decide whether a file stream opened for writing uses write-behind. If you return YES, full buffers are written out by a background thread, so the VM doesn't wait on the disk while it writes a big save file or a long transcript. Closing the stream (or reading from it, or seeking to its end) waits for the writes to finish, so the game sees no difference. The usage is the fileref's file type (fileusage_SavedGame, fileusage_Transcript, etc).
+ 
+	This is invoked from the VM thread, when a file stream is opened. It's optional in the protocol; if your delegate doesn't implement it, no stream uses write-behind.
+ */
+- (BOOL) writeBehindForFileUsage:(glui32)usage {
+	return NO;
+}
+
 /* Return whether the app styles are set to a generally dark palette. The app uses this to decide some minor display details, like scroll bar tint.
  */
 - (BOOL) hasDarkTheme {
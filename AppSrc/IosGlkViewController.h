@@ -5,6 +5,7 @@
 */
 
 #import <UIKit/UIKit.h>
+#import "GlkTagTable.h"
 
 @class GlkFrameView;
 @class GlkWindowView;
@@ -20,9 +21,9 @@ typedef void (^questioncallback)(int); // callback block type for displayAdHocQu
 	GlkFrameView *frameview;
 	
 	/* Tag for the window which most recently had input focus */
-	NSNumber *prefinputwintag;
+	GlkTag prefinputwintag;
 	/* Tag for the window which currently has text selected */
-	NSNumber *textselecttag;
+	GlkTag textselecttag;
 	/* As of the most recent update */
 	BOOL vmexited;
 
@@ -38,8 +39,8 @@ typedef void (^questioncallback)(int); // callback block type for displayAdHocQu
 @property (nonatomic, assign) IBOutlet id <IosGlkLibDelegate> glkdelegate; // delegates are nonretained
 @property (nonatomic, retain) IBOutlet GlkFrameView *frameview;
 
-@property (nonatomic, retain) NSNumber *prefinputwintag;
-@property (nonatomic, retain) NSNumber *textselecttag;
+@property (nonatomic) GlkTag prefinputwintag;
+@property (nonatomic) GlkTag textselecttag;
 @property (nonatomic) BOOL vmexited;
 
 @property (nonatomic, retain) NSMutableArray *commandhistory;	
@@ -56,8 +57,8 @@ typedef void (^questioncallback)(int); // callback block type for displayAdHocQu
 - (void) updateFromLibraryState:(GlkLibraryState *)library;
 - (id) filterEvent:(id)data;
 
-- (void) textSelectionWindow:(NSNumber *)tag;
-- (void) preferInputWindow:(NSNumber *)tag;
+- (void) textSelectionWindow:(GlkTag)tag;
+- (void) preferInputWindow:(GlkTag)tag;
 - (GlkWindowView *) preferredInputWindow;
 - (BOOL) keyboardIsShown;
 - (void) hideKeyboard;
@@ -68,7 +69,7 @@ typedef void (^questioncallback)(int); // callback block type for displayAdHocQu
 
 - (IBAction) toggleKeyboard;
 - (BOOL) forceLineInput:(NSString *)text enter:(BOOL)enter;
-- (BOOL) forceCustomEvent:(uint32_t)evtype windowTag:(NSNumber *)tag val1:(uint32_t)val1 val2:(uint32_t)val2;
+- (BOOL) forceCustomEvent:(uint32_t)evtype windowTag:(GlkTag)tag val1:(uint32_t)val1 val2:(uint32_t)val2;
 - (void) addToCommandHistory:(NSString *)str;
 - (void) displayAdHocAlert:(NSString *)msg title:(NSString *)title;
 - (void) displayAdHocQuestion:(NSString *)msg option:(NSString *)opt1 option:(NSString *)opt2 callback:(questioncallback)qcallback;
@@ -19,6 +19,7 @@
 #import "GlkWindowState.h"
 #import "CmdTextField.h"
 #import "GlkUtilities.h"
+#import "GlkTurnTiming.h"
 
 #define MAX_HISTORY_LENGTH (12)
 
@@ -40,8 +41,6 @@
 - (void) dealloc {
 	self.frameview = nil;
 	self.commandhistory = nil;
-	self.prefinputwintag = nil;
-	self.textselecttag = nil;
 	self.currentquestion = nil;
 	[super dealloc];
 }
@@ -112,9 +111,14 @@
 /* Invoked in the UI thread, from the VM thread. See comment on GlkFrameView.updateFromLibraryState.
  */
 - (void) updateFromLibraryState:(GlkLibraryState *)library {
+#ifdef IOSGLK_TURN_TIMING
+	GlkTurnTimeRecord(turnphase_Handoff, library.turnstamp);
+#endif // IOSGLK_TURN_TIMING
+	TURNTIME_MARK(updatestart);
+	
 	/* Remember whether any window has the input focus. */
 	BOOL anyfocus = NO;
-	for (GlkWindowView *winv in [frameview.windowviews allValues]) {
+	for (GlkWindowView *winv in [frameview.windowviews objectEnumerator]) {
 		if (winv.inputfield && [winv.inputfield isFirstResponder]) {
 			anyfocus = YES;
 			break;
@@ -131,8 +135,20 @@
 			[winv.inputfield becomeFirstResponder];
 		}
 	}
+	
+	TURNTIME_RECORD(turnphase_Update, updatestart);
+#ifdef IOSGLK_TURN_TIMING
+	/* Layout and drawing happen when the run loop commits this pass's view changes. A zero-delay perform fires on the next pass, after that. */
+	[self performSelector:@selector(turnTimingRendered:) withObject:[NSNumber numberWithUnsignedLongLong:GlkTurnTimeNow()] afterDelay:0];
+#endif // IOSGLK_TURN_TIMING
 }
 
+#ifdef IOSGLK_TURN_TIMING
+- (void) turnTimingRendered:(NSNumber *)start {
+	GlkTurnTimeRecord(turnphase_Render, start.unsignedLongLongValue);
+}
+#endif // IOSGLK_TURN_TIMING
+
 /* This tests whether the keyboard is visible *and obscuring the screen*. (If the iPad's floating keyboard is up, this returns NO.)
  */
 - (BOOL) keyboardIsShown {
@@ -162,11 +178,11 @@
 		[frameview setNeedsLayout];
 }
 
-- (void) textSelectionWindow:(NSNumber *)tag {
+- (void) textSelectionWindow:(GlkTag)tag {
 	self.textselecttag = tag;
 }
 
-- (void) preferInputWindow:(NSNumber *)tag {
+- (void) preferInputWindow:(GlkTag)tag {
 	self.prefinputwintag = tag;
 }
 
@@ -178,10 +194,7 @@
 	
 	GlkWindowView *prefinputview = nil;
 	GlkWindowView *firstinputview = nil;
-	NSMutableDictionary *windowviews = frameview.windowviews;
-	
-	for (NSNumber *tag in windowviews) {
-		GlkWindowView *winv = [windowviews objectForKey:tag];
+	for (GlkWindowView *winv in [frameview.windowviews objectEnumerator]) {
 		if (winv.inputfield && [winv.inputfield isFirstResponder]) {
 			return winv;
 		}
@@ -189,7 +202,7 @@
 		if (winv.inputfield) {
 			if (!firstinputview)
 				firstinputview = winv;
-			if (NumberMatch(tag, prefinputwintag))
+			if (winv.winstate.tag == prefinputwintag)
 				prefinputview = winv;
 		}
 	}
@@ -203,7 +216,7 @@
 }
 
 - (void) hideKeyboard {
-	for (GlkWindowView *winv in [frameview.windowviews allValues]) {
+	for (GlkWindowView *winv in [frameview.windowviews objectEnumerator]) {
 		if (winv.inputfield && [winv.inputfield isFirstResponder]) {
 			//NSLog(@"Hiding keyboard for %@", winv);
 			[winv.inputfield resignFirstResponder];
@@ -240,8 +253,7 @@
 		return NO;
 	}
 	
-	for (NSNumber *tag in frameview.windowviews) {
-		GlkWindowView *winv = [frameview.windowviews objectForKey:tag];
+	for (GlkWindowView *winv in [frameview.windowviews objectEnumerator]) {
 		if (winv.inputfield && winv.winstate.line_request) {
 			if (!enter) {
 				winv.inputfield.text = text;
@@ -259,9 +271,9 @@
 
 /* Send a custom event directly to the VM. Returns YES if the VM is in glk_select(); if not, does nothing and returns NO.
  
-	The tag argument will be converted to a window ID in the event structure. If tag is nil, the window ID will be zero.
+	The tag argument will be converted to a window ID in the event structure. If tag is zero, the window ID will be zero.
  */
-- (BOOL) forceCustomEvent:(uint32_t)evtype windowTag:(NSNumber *)tag val1:(uint32_t)val1 val2:(uint32_t)val2
+- (BOOL) forceCustomEvent:(uint32_t)evtype windowTag:(GlkTag)tag val1:(uint32_t)val1 val2:(uint32_t)val2
 {
 	if (![[GlkAppWrapper singleton] acceptingEvent]) {
 		/* The VM is not currently awaiting input. */
@@ -61,7 +61,7 @@
 - (CGFloat) totalHeight;
 - (BOOL) moreToSee;
 - (GlkVisualLine *) lineAtPos:(CGFloat)ypos;
-- (void) updateWithLines:(NSArray *)uplines dirtyFrom:(int)linesdirtyfrom clearCount:(int)newclearcount refresh:(BOOL)refresh;
+- (void) updateWithLines:(NSArray *)uplines linesStart:(int)linesstart dirtyFrom:(int)linesdirtyfrom clearCount:(int)newclearcount refresh:(BOOL)refresh;
 - (void) uncacheLayoutAndVLines:(BOOL)andvlines;
 - (NSMutableArray *) layoutFromLine:(int)startline forward:(BOOL)forward yMax:(CGFloat)ymax;
 - (void) sanityCheck;
@@ -190,9 +190,9 @@
 	return box;
 }
 
-/* Import the given lines (as taken from the GlkWindowBuffer).
+/* Import the given lines (as taken from the GlkWindowBuffer). This is a delta: uplines are the lines from linesdirtyfrom on, which replace any we have from that point. Lines before linesstart have been trimmed by the library, so we drop them too. The lines in between we keep.
  */
-- (void) updateWithLines:(NSArray *)uplines dirtyFrom:(int)linesdirtyfrom clearCount:(int)newclearcount refresh:(BOOL)refresh {
+- (void) updateWithLines:(NSArray *)uplines linesStart:(int)linesstart dirtyFrom:(int)linesdirtyfrom clearCount:(int)newclearcount refresh:(BOOL)refresh {
 	//NSLog(@"STV: updating, got %d lines %s", uplines.count, ((clearcount != newclearcount)?"(clear-bump)":""));
 	newcontent = YES;
 	
@@ -201,6 +201,7 @@
 		//NSLog(@"STV: ...I believe this is a refresh, not really a clear-bump.");
 		clearcount = newclearcount;
 		[vlines removeAllObjects];
+		[slines removeAllObjects];
 		endvlineseen = 0;
 		wasrefresh = YES;
 	}
@@ -208,16 +209,36 @@
 		/* The update contains a page-clear. The player has not seen this stuff. */
 		clearcount = newclearcount;
 		[vlines removeAllObjects];
+		[slines removeAllObjects];
 		endvlineseen = 0;
 		wasclear = YES;
 	}
 
-	[slines removeAllObjects];
+	/* Discard the slines which the update replaces, and the ones which have been trimmed. */
+	while (slines.count) {
+		GlkStyledLine *sln = [slines lastObject];
+		if (sln.index < linesdirtyfrom)
+			break;
+		[slines removeLastObject];
+	}
+	int strimcount = 0;
+	for (GlkStyledLine *sln in slines) {
+		if (sln.index >= linesstart)
+			break;
+		strimcount++;
+	}
+	if (strimcount > 0) {
+		NSRange range;
+		range.location = 0;
+		range.length = strimcount;
+		[slines removeObjectsInRange:range];
+	}
+	
+	[slines addObjectsFromArray:uplines];
 	firstsline = 0;
-	if (uplines.count) {
-		GlkStyledLine *firstsln = [uplines objectAtIndex:0];
+	if (slines.count) {
+		GlkStyledLine *firstsln = [slines objectAtIndex:0];
 		firstsline = firstsln.index;
-		[slines addObjectsFromArray:uplines];
 	}
 
 	/* Some lines may have been trimmed from the beginning. If so, throw away vlines at the beginning. */
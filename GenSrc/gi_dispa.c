@@ -14,6 +14,7 @@
 /* This code should be linked into every Glk library, without change. 
     Get the latest version from the URL above. */
 
+#include <string.h>
 #include "glk.h"
 #include "gi_dispa.h"
 
@@ -175,1317 +176,1579 @@ static gidispatch_intconst_t intconstant_table[] = {
     { "wintype_TextGrid", (4) },
 };
 
-/* The functions in this table must be ordered by id. */
-static gidispatch_function_t function_table[] = {
-    { 0x0001, glk_exit, "exit" },
-    { 0x0002, glk_set_interrupt_handler, "set_interrupt_handler" },
-    { 0x0003, glk_tick, "tick" },
-    { 0x0004, glk_gestalt, "gestalt" },
-    { 0x0005, glk_gestalt_ext, "gestalt_ext" },
-    { 0x0020, glk_window_iterate, "window_iterate" },
-    { 0x0021, glk_window_get_rock, "window_get_rock" },
-    { 0x0022, glk_window_get_root, "window_get_root" },
-    { 0x0023, glk_window_open, "window_open" },
-    { 0x0024, glk_window_close, "window_close" },
-    { 0x0025, glk_window_get_size, "window_get_size" },
-    { 0x0026, glk_window_set_arrangement, "window_set_arrangement" },
-    { 0x0027, glk_window_get_arrangement, "window_get_arrangement" },
-    { 0x0028, glk_window_get_type, "window_get_type" },
-    { 0x0029, glk_window_get_parent, "window_get_parent" },
-    { 0x002A, glk_window_clear, "window_clear" },
-    { 0x002B, glk_window_move_cursor, "window_move_cursor" },
-    { 0x002C, glk_window_get_stream, "window_get_stream" },
-    { 0x002D, glk_window_set_echo_stream, "window_set_echo_stream" },
-    { 0x002E, glk_window_get_echo_stream, "window_get_echo_stream" },
-    { 0x002F, glk_set_window, "set_window" },
-    { 0x0030, glk_window_get_sibling, "window_get_sibling" },
-    { 0x0040, glk_stream_iterate, "stream_iterate" },
-    { 0x0041, glk_stream_get_rock, "stream_get_rock" },
-    { 0x0042, glk_stream_open_file, "stream_open_file" },
-    { 0x0043, glk_stream_open_memory, "stream_open_memory" },
-    { 0x0044, glk_stream_close, "stream_close" },
-    { 0x0045, glk_stream_set_position, "stream_set_position" },
-    { 0x0046, glk_stream_get_position, "stream_get_position" },
-    { 0x0047, glk_stream_set_current, "stream_set_current" },
-    { 0x0048, glk_stream_get_current, "stream_get_current" },
-    { 0x0060, glk_fileref_create_temp, "fileref_create_temp" },
-    { 0x0061, glk_fileref_create_by_name, "fileref_create_by_name" },
-    { 0x0062, glk_fileref_create_by_prompt, "fileref_create_by_prompt" },
-    { 0x0063, glk_fileref_destroy, "fileref_destroy" },
-    { 0x0064, glk_fileref_iterate, "fileref_iterate" },
-    { 0x0065, glk_fileref_get_rock, "fileref_get_rock" },
-    { 0x0066, glk_fileref_delete_file, "fileref_delete_file" },
-    { 0x0067, glk_fileref_does_file_exist, "fileref_does_file_exist" },
-    { 0x0068, glk_fileref_create_from_fileref, "fileref_create_from_fileref" },
-    { 0x0080, glk_put_char, "put_char" },
-    { 0x0081, glk_put_char_stream, "put_char_stream" },
-    { 0x0082, glk_put_string, "put_string" },
-    { 0x0083, glk_put_string_stream, "put_string_stream" },
-    { 0x0084, glk_put_buffer, "put_buffer" },
-    { 0x0085, glk_put_buffer_stream, "put_buffer_stream" },
-    { 0x0086, glk_set_style, "set_style" },
-    { 0x0087, glk_set_style_stream, "set_style_stream" },
-    { 0x0090, glk_get_char_stream, "get_char_stream" },
-    { 0x0091, glk_get_line_stream, "get_line_stream" },
-    { 0x0092, glk_get_buffer_stream, "get_buffer_stream" },
-    { 0x00A0, glk_char_to_lower, "char_to_lower" },
-    { 0x00A1, glk_char_to_upper, "char_to_upper" },
-    { 0x00B0, glk_stylehint_set, "stylehint_set" },
-    { 0x00B1, glk_stylehint_clear, "stylehint_clear" },
-    { 0x00B2, glk_style_distinguish, "style_distinguish" },
-    { 0x00B3, glk_style_measure, "style_measure" },
-    { 0x00C0, glk_select, "select" },
-    { 0x00C1, glk_select_poll, "select_poll" },
-    { 0x00D0, glk_request_line_event, "request_line_event" },
-    { 0x00D1, glk_cancel_line_event, "cancel_line_event" },
-    { 0x00D2, glk_request_char_event, "request_char_event" },
-    { 0x00D3, glk_cancel_char_event, "cancel_char_event" },
-    { 0x00D4, glk_request_mouse_event, "request_mouse_event" },
-    { 0x00D5, glk_cancel_mouse_event, "cancel_mouse_event" },
-    { 0x00D6, glk_request_timer_events, "request_timer_events" },
+/* The functions, as F(id, name, prototype). Each optional module has its
+    own list, which is empty if the module is not compiled in. The order
+    of the lists is the order of function_table; it need not be sorted,
+    since lookups by id go through function_index below. */
+
+#define GIDISPATCH_CORE_FUNCTIONS(F)  \
+    F(0x0001, exit, "0:")  \
+    F(0x0002, set_interrupt_handler, NULL) /* cannot be invoked through dispatch layer */  \
+    F(0x0003, tick, "0:")  \
+    F(0x0004, gestalt, "3IuIu:Iu")  \
+    F(0x0005, gestalt_ext, "4IuIu&#Iu:Iu")  \
+    F(0x0020, window_iterate, "3Qa<Iu:Qa")  \
+    F(0x0021, window_get_rock, "2Qa:Iu")  \
+    F(0x0022, window_get_root, "1:Qa")  \
+    F(0x0023, window_open, "6QaIuIuIuIu:Qa")  \
+    F(0x0024, window_close, "2Qa<[2IuIu]:")  \
+    F(0x0025, window_get_size, "3Qa<Iu<Iu:")  \
+    F(0x0026, window_set_arrangement, "4QaIuIuQa:")  \
+    F(0x0027, window_get_arrangement, "4Qa<Iu<Iu<Qa:")  \
+    F(0x0028, window_get_type, "2Qa:Iu")  \
+    F(0x0029, window_get_parent, "2Qa:Qa")  \
+    F(0x002A, window_clear, "1Qa:")  \
+    F(0x002B, window_move_cursor, "3QaIuIu:")  \
+    F(0x002C, window_get_stream, "2Qa:Qb")  \
+    F(0x002D, window_set_echo_stream, "2QaQb:")  \
+    F(0x002E, window_get_echo_stream, "2Qa:Qb")  \
+    F(0x002F, set_window, "1Qa:")  \
+    F(0x0030, window_get_sibling, "2Qa:Qa")  \
+    F(0x0040, stream_iterate, "3Qb<Iu:Qb")  \
+    F(0x0041, stream_get_rock, "2Qb:Iu")  \
+    F(0x0042, stream_open_file, "4QcIuIu:Qb")  \
+    F(0x0043, stream_open_memory, "4&#!CnIuIu:Qb")  \
+    F(0x0044, stream_close, "2Qb<[2IuIu]:")  \
+    F(0x0045, stream_set_position, "3QbIsIu:")  \
+    F(0x0046, stream_get_position, "2Qb:Iu")  \
+    F(0x0047, stream_set_current, "1Qb:")  \
+    F(0x0048, stream_get_current, "1:Qb")  \
+    F(0x0060, fileref_create_temp, "3IuIu:Qc")  \
+    F(0x0061, fileref_create_by_name, "4IuSIu:Qc")  \
+    F(0x0062, fileref_create_by_prompt, "4IuIuIu:Qc")  \
+    F(0x0063, fileref_destroy, "1Qc:")  \
+    F(0x0064, fileref_iterate, "3Qc<Iu:Qc")  \
+    F(0x0065, fileref_get_rock, "2Qc:Iu")  \
+    F(0x0066, fileref_delete_file, "1Qc:")  \
+    F(0x0067, fileref_does_file_exist, "2Qc:Iu")  \
+    F(0x0068, fileref_create_from_fileref, "4IuQcIu:Qc")  \
+    F(0x0080, put_char, "1Cu:")  \
+    F(0x0081, put_char_stream, "2QbCu:")  \
+    F(0x0082, put_string, "1S:")  \
+    F(0x0083, put_string_stream, "2QbS:")  \
+    F(0x0084, put_buffer, "1>+#Cn:")  \
+    F(0x0085, put_buffer_stream, "2Qb>+#Cn:")  \
+    F(0x0086, set_style, "1Iu:")  \
+    F(0x0087, set_style_stream, "2QbIu:")  \
+    F(0x0090, get_char_stream, "2Qb:Is")  \
+    F(0x0091, get_line_stream, "3Qb<+#Cn:Iu")  \
+    F(0x0092, get_buffer_stream, "3Qb<+#Cn:Iu")  \
+    F(0x00A0, char_to_lower, "2Cu:Cu")  \
+    F(0x00A1, char_to_upper, "2Cu:Cu")  \
+    F(0x00B0, stylehint_set, "4IuIuIuIs:")  \
+    F(0x00B1, stylehint_clear, "3IuIuIu:")  \
+    F(0x00B2, style_distinguish, "4QaIuIu:Iu")  \
+    F(0x00B3, style_measure, "5QaIuIu<Iu:Iu")  \
+    F(0x00C0, select, "1<+[4IuQaIuIu]:")  \
+    F(0x00C1, select_poll, "1<+[4IuQaIuIu]:")  \
+    F(0x00D0, request_line_event, "3Qa&+#!CnIu:")  \
+    F(0x00D1, cancel_line_event, "2Qa<[4IuQaIuIu]:")  \
+    F(0x00D2, request_char_event, "1Qa:")  \
+    F(0x00D3, cancel_char_event, "1Qa:")  \
+    F(0x00D4, request_mouse_event, "1Qa:")  \
+    F(0x00D5, cancel_mouse_event, "1Qa:")  \
+    F(0x00D6, request_timer_events, "1Iu:")
+
 #ifdef GLK_MODULE_IMAGE
-    { 0x00E0, glk_image_get_info, "image_get_info" },
-    { 0x00E1, glk_image_draw, "image_draw" },
-    { 0x00E2, glk_image_draw_scaled, "image_draw_scaled" },
-    { 0x00E8, glk_window_flow_break, "window_flow_break" },
-    { 0x00E9, glk_window_erase_rect, "window_erase_rect" },
-    { 0x00EA, glk_window_fill_rect, "window_fill_rect" },
-    { 0x00EB, glk_window_set_background_color, "window_set_background_color" },
+#define GIDISPATCH_IMAGE_FUNCTIONS(F)  \
+    F(0x00E0, image_get_info, "4Iu<Iu<Iu:Iu")  \
+    F(0x00E1, image_draw, "5QaIuIsIs:Iu")  \
+    F(0x00E2, image_draw_scaled, "7QaIuIsIsIuIu:Iu")  \
+    F(0x00E8, window_flow_break, "1Qa:")  \
+    F(0x00E9, window_erase_rect, "5QaIsIsIuIu:")  \
+    F(0x00EA, window_fill_rect, "6QaIuIsIsIuIu:")  \
+    F(0x00EB, window_set_background_color, "2QaIu:")
+#else
+#define GIDISPATCH_IMAGE_FUNCTIONS(F)
 #endif /* GLK_MODULE_IMAGE */
+
 #ifdef GLK_MODULE_SOUND
-    { 0x00F0, glk_schannel_iterate, "schannel_iterate" },
-    { 0x00F1, glk_schannel_get_rock, "schannel_get_rock" },
-    { 0x00F2, glk_schannel_create, "schannel_create" },
-    { 0x00F3, glk_schannel_destroy, "schannel_destroy" },
-    { 0x00F8, glk_schannel_play, "schannel_play" },
-    { 0x00F9, glk_schannel_play_ext, "schannel_play_ext" },
-    { 0x00FA, glk_schannel_stop, "schannel_stop" },
-    { 0x00FB, glk_schannel_set_volume, "schannel_set_volume" },
-    { 0x00FC, glk_sound_load_hint, "sound_load_hint" },
-#ifdef GLK_MODULE_SOUND2
-    { 0x00F4, glk_schannel_create_ext, "schannel_create_ext" },
-    { 0x00F7, glk_schannel_play_multi, "schannel_play_multi" },
-    { 0x00FD, glk_schannel_set_volume_ext, "schannel_set_volume_ext" },
-    { 0x00FE, glk_schannel_pause, "schannel_pause" },
-    { 0x00FF, glk_schannel_unpause, "schannel_unpause" },
-#endif /* GLK_MODULE_SOUND2 */
+#define GIDISPATCH_SOUND_FUNCTIONS(F)  \
+    F(0x00F0, schannel_iterate, "3Qd<Iu:Qd")  \
+    F(0x00F1, schannel_get_rock, "2Qd:Iu")  \
+    F(0x00F2, schannel_create, "2Iu:Qd")  \
+    F(0x00F3, schannel_destroy, "1Qd:")  \
+    F(0x00F8, schannel_play, "3QdIu:Iu")  \
+    F(0x00F9, schannel_play_ext, "5QdIuIuIu:Iu")  \
+    F(0x00FA, schannel_stop, "1Qd:")  \
+    F(0x00FB, schannel_set_volume, "2QdIu:")  \
+    F(0x00FC, sound_load_hint, "2IuIu:")
+#else
+#define GIDISPATCH_SOUND_FUNCTIONS(F)
 #endif /* GLK_MODULE_SOUND */
+
+#if defined(GLK_MODULE_SOUND) && defined(GLK_MODULE_SOUND2)
+#define GIDISPATCH_SOUND2_FUNCTIONS(F)  \
+    F(0x00F4, schannel_create_ext, "3IuIu:Qd")  \
+    F(0x00F7, schannel_play_multi, "4>+#Qd>+#IuIu:Iu")  \
+    F(0x00FD, schannel_set_volume_ext, "4QdIuIuIu:")  \
+    F(0x00FE, schannel_pause, "1Qd:")  \
+    F(0x00FF, schannel_unpause, "1Qd:")
+#else
+#define GIDISPATCH_SOUND2_FUNCTIONS(F)
+#endif /* GLK_MODULE_SOUND && GLK_MODULE_SOUND2 */
+
 #ifdef GLK_MODULE_HYPERLINKS
-    { 0x0100, glk_set_hyperlink, "set_hyperlink" },
-    { 0x0101, glk_set_hyperlink_stream, "set_hyperlink_stream" },
-    { 0x0102, glk_request_hyperlink_event, "request_hyperlink_event" },
-    { 0x0103, glk_cancel_hyperlink_event, "cancel_hyperlink_event" },
+#define GIDISPATCH_HYPERLINKS_FUNCTIONS(F)  \
+    F(0x0100, set_hyperlink, "1Iu:")  \
+    F(0x0101, set_hyperlink_stream, "2QbIu:")  \
+    F(0x0102, request_hyperlink_event, "1Qa:")  \
+    F(0x0103, cancel_hyperlink_event, "1Qa:")
+#else
+#define GIDISPATCH_HYPERLINKS_FUNCTIONS(F)
 #endif /* GLK_MODULE_HYPERLINKS */
+
 #ifdef GLK_MODULE_UNICODE
-    { 0x0120, glk_buffer_to_lower_case_uni, "buffer_to_lower_case_uni" },
-    { 0x0121, glk_buffer_to_upper_case_uni, "buffer_to_upper_case_uni" },
-    { 0x0122, glk_buffer_to_title_case_uni, "buffer_to_title_case_uni" },
-    { 0x0128, glk_put_char_uni, "put_char_uni" },
-    { 0x0129, glk_put_string_uni, "put_string_uni" },
-    { 0x012A, glk_put_buffer_uni, "put_buffer_uni" },
-    { 0x012B, glk_put_char_stream_uni, "put_char_stream_uni" },
-    { 0x012C, glk_put_string_stream_uni, "put_string_stream_uni" },
-    { 0x012D, glk_put_buffer_stream_uni, "put_buffer_stream_uni" },
-    { 0x0130, glk_get_char_stream_uni, "get_char_stream_uni" },
-    { 0x0131, glk_get_buffer_stream_uni, "get_buffer_stream_uni" },
-    { 0x0132, glk_get_line_stream_uni, "get_line_stream_uni" },
-    { 0x0138, glk_stream_open_file_uni, "stream_open_file_uni" },
-    { 0x0139, glk_stream_open_memory_uni, "stream_open_memory_uni" },
-    { 0x0140, glk_request_char_event_uni, "request_char_event_uni" },
-    { 0x0141, glk_request_line_event_uni, "request_line_event_uni" },
+#define GIDISPATCH_UNICODE_FUNCTIONS(F)  \
+    F(0x0120, buffer_to_lower_case_uni, "3&+#IuIu:Iu")  \
+    F(0x0121, buffer_to_upper_case_uni, "3&+#IuIu:Iu")  \
+    F(0x0122, buffer_to_title_case_uni, "4&+#IuIuIu:Iu")  \
+    F(0x0128, put_char_uni, "1Iu:")  \
+    F(0x0129, put_string_uni, "1U:")  \
+    F(0x012A, put_buffer_uni, "1>+#Iu:")  \
+    F(0x012B, put_char_stream_uni, "2QbIu:")  \
+    F(0x012C, put_string_stream_uni, "2QbU:")  \
+    F(0x012D, put_buffer_stream_uni, "2Qb>+#Iu:")  \
+    F(0x0130, get_char_stream_uni, "2Qb:Is")  \
+    F(0x0131, get_buffer_stream_uni, "3Qb<+#Iu:Iu")  \
+    F(0x0132, get_line_stream_uni, "3Qb<+#Iu:Iu")  \
+    F(0x0138, stream_open_file_uni, "4QcIuIu:Qb")  \
+    F(0x0139, stream_open_memory_uni, "4&#!IuIuIu:Qb")  \
+    F(0x0140, request_char_event_uni, "1Qa:")  \
+    F(0x0141, request_line_event_uni, "3Qa&+#!IuIu:")
+#else
+#define GIDISPATCH_UNICODE_FUNCTIONS(F)
 #endif /* GLK_MODULE_UNICODE */
+
 #ifdef GLK_MODULE_UNICODE_NORM
-    { 0x0123, glk_buffer_canon_decompose_uni, "buffer_canon_decompose_uni" },
-    { 0x0124, glk_buffer_canon_normalize_uni, "buffer_canon_normalize_uni" },
+#define GIDISPATCH_UNICODE_NORM_FUNCTIONS(F)  \
+    F(0x0123, buffer_canon_decompose_uni, "3&+#IuIu:Iu")  \
+    F(0x0124, buffer_canon_normalize_uni, "3&+#IuIu:Iu")
+#else
+#define GIDISPATCH_UNICODE_NORM_FUNCTIONS(F)
 #endif /* GLK_MODULE_UNICODE_NORM */
+
 #ifdef GLK_MODULE_LINE_ECHO
-    { 0x0150, glk_set_echo_line_event, "set_echo_line_event" },
+#define GIDISPATCH_LINE_ECHO_FUNCTIONS(F)  \
+    F(0x0150, set_echo_line_event, "2QaIu:")
+#else
+#define GIDISPATCH_LINE_ECHO_FUNCTIONS(F)
 #endif /* GLK_MODULE_LINE_ECHO */
+
 #ifdef GLK_MODULE_LINE_TERMINATORS
-    { 0x0151, glk_set_terminators_line_event, "set_terminators_line_event" },
+#define GIDISPATCH_LINE_TERMINATORS_FUNCTIONS(F)  \
+    F(0x0151, set_terminators_line_event, "2Qa>#Iu:")
+#else
+#define GIDISPATCH_LINE_TERMINATORS_FUNCTIONS(F)
 #endif /* GLK_MODULE_LINE_TERMINATORS */
+
 #ifdef GLK_MODULE_DATETIME
-    { 0x0160, glk_current_time, "current_time" },
-    { 0x0161, glk_current_simple_time, "current_simple_time" },
-    { 0x0168, glk_time_to_date_utc, "time_to_date_utc" },
-    { 0x0169, glk_time_to_date_local, "time_to_date_local" },
-    { 0x016A, glk_simple_time_to_date_utc, "simple_time_to_date_utc" },
-    { 0x016B, glk_simple_time_to_date_local, "simple_time_to_date_local" },
-    { 0x016C, glk_date_to_time_utc, "date_to_time_utc" },
-    { 0x016D, glk_date_to_time_local, "date_to_time_local" },
-    { 0x016E, glk_date_to_simple_time_utc, "date_to_simple_time_utc" },
-    { 0x016F, glk_date_to_simple_time_local, "date_to_simple_time_local" },
+#define GIDISPATCH_DATETIME_FUNCTIONS(F)  \
+    F(0x0160, current_time, "1<+[3IsIuIs]:")  \
+    F(0x0161, current_simple_time, "2Iu:Is")  \
+    F(0x0168, time_to_date_utc, "2>+[3IsIuIs]<+[8IsIsIsIsIsIsIsIs]:")  \
+    F(0x0169, time_to_date_local, "2>+[3IsIuIs]<+[8IsIsIsIsIsIsIsIs]:")  \
+    F(0x016A, simple_time_to_date_utc, "3IsIu<+[8IsIsIsIsIsIsIsIs]:")  \
+    F(0x016B, simple_time_to_date_local, "3IsIu<+[8IsIsIsIsIsIsIsIs]:")  \
+    F(0x016C, date_to_time_utc, "2>+[8IsIsIsIsIsIsIsIs]<+[3IsIuIs]:")  \
+    F(0x016D, date_to_time_local, "2>+[8IsIsIsIsIsIsIsIs]<+[3IsIuIs]:")  \
+    F(0x016E, date_to_simple_time_utc, "3>+[8IsIsIsIsIsIsIsIs]Iu:Is")  \
+    F(0x016F, date_to_simple_time_local, "3>+[8IsIsIsIsIsIsIsIs]Iu:Is")
+#else
+#define GIDISPATCH_DATETIME_FUNCTIONS(F)
 #endif /* GLK_MODULE_DATETIME */
+
+#define GIDISPATCH_FUNCTIONS(F)  \
+    GIDISPATCH_CORE_FUNCTIONS(F)  \
+    GIDISPATCH_IMAGE_FUNCTIONS(F)  \
+    GIDISPATCH_SOUND_FUNCTIONS(F)  \
+    GIDISPATCH_SOUND2_FUNCTIONS(F)  \
+    GIDISPATCH_HYPERLINKS_FUNCTIONS(F)  \
+    GIDISPATCH_UNICODE_FUNCTIONS(F)  \
+    GIDISPATCH_UNICODE_NORM_FUNCTIONS(F)  \
+    GIDISPATCH_LINE_ECHO_FUNCTIONS(F)  \
+    GIDISPATCH_LINE_TERMINATORS_FUNCTIONS(F)  \
+    GIDISPATCH_DATETIME_FUNCTIONS(F)
+
+#define FUNCTION_ENTRY(id, name, proto)  \
+    { id, glk_##name, #name },
+static gidispatch_function_t function_table[] = {
+    GIDISPATCH_FUNCTIONS(FUNCTION_ENTRY)
 };
 
-glui32 gidispatch_count_classes()
+/* The position of each function in function_table. */
+#define FUNCTION_POSITION(id, name, proto)  \
+    funcpos_##name,
+enum {
+    GIDISPATCH_FUNCTIONS(FUNCTION_POSITION)
+    funcpos_Limit
+};
+
+/* One more than the highest function id. (If a function is added past
+    this, the function_index initializer will fail to compile.) */
+#define FUNCTION_ID_LIMIT (0x0170)
+
+/* The thunks. Each one makes a single Glk call, unpacking its arguments
+    from the arglist and packing the results back in. */
+
+static void thunk_exit(gluniversal_t *arglist)
 {
-    return NUMCLASSES;
+    (void)arglist;
+    glk_exit();
 }
 
-gidispatch_intconst_t *gidispatch_get_class(glui32 index)
+static void thunk_set_interrupt_handler(gluniversal_t *arglist)
 {
-    // XCode: removed "index < 0" test to shut up compiler warning
-    if (index >= NUMCLASSES)
-        return NULL;
-    return &(class_table[index]);
+    (void)arglist;
+    /* cannot be invoked through dispatch layer */
 }
 
-glui32 gidispatch_count_intconst()
+static void thunk_tick(gluniversal_t *arglist)
 {
-    return NUMINTCONSTANTS;
+    (void)arglist;
+    glk_tick();
 }
 
-gidispatch_intconst_t *gidispatch_get_intconst(glui32 index)
+static void thunk_gestalt(gluniversal_t *arglist)
 {
-    // XCode: removed "index < 0" test to shut up compiler warning
-    if (index >= NUMINTCONSTANTS)
-        return NULL;
-    return &(intconstant_table[index]);
+    arglist[3].uint = glk_gestalt(arglist[0].uint, arglist[1].uint);
 }
 
-glui32 gidispatch_count_functions()
+static void thunk_gestalt_ext(gluniversal_t *arglist)
 {
-    return NUMFUNCTIONS;
+    if (arglist[2].ptrflag) {
+        arglist[6].uint = glk_gestalt_ext(arglist[0].uint, arglist[1].uint,
+            arglist[3].array, arglist[4].uint);
+    }
+    else {
+        arglist[4].uint = glk_gestalt_ext(arglist[0].uint, arglist[1].uint,
+            NULL, 0);
+    }
 }
 
-gidispatch_function_t *gidispatch_get_function(glui32 index)
+static void thunk_window_iterate(gluniversal_t *arglist)
 {
-    // XCode: removed "index < 0" test to shut up compiler warning
-    if (index >= NUMFUNCTIONS)
-        return NULL;
-    return &(function_table[index]);
+    if (arglist[1].ptrflag) 
+        arglist[4].opaqueref = glk_window_iterate(arglist[0].opaqueref, &arglist[2].uint);
+    else
+        arglist[3].opaqueref = glk_window_iterate(arglist[0].opaqueref, NULL);
 }
 
-gidispatch_function_t *gidispatch_get_function_by_id(glui32 id)
+static void thunk_window_get_rock(gluniversal_t *arglist)
 {
-    int top, bot, val;
-    gidispatch_function_t *func;
-    
-    bot = 0;
-    top = NUMFUNCTIONS;
-    
-    while (1) {
-        val = (top+bot) / 2;
-        func = &(function_table[val]);
-        if (func->id == id)
-            return func;
-        if (bot >= top-1)
-            break;
-        if (func->id < id) {
-            bot = val+1;
+    arglist[2].uint = glk_window_get_rock(arglist[0].opaqueref);
+}
+
+static void thunk_window_get_root(gluniversal_t *arglist)
+{
+    arglist[1].opaqueref = glk_window_get_root();
+}
+
+static void thunk_window_open(gluniversal_t *arglist)
+{
+    arglist[6].opaqueref = glk_window_open(arglist[0].opaqueref, arglist[1].uint, 
+        arglist[2].uint, arglist[3].uint, arglist[4].uint);
+}
+
+static void thunk_window_close(gluniversal_t *arglist)
+{
+    if (arglist[1].ptrflag) {
+        stream_result_t dat;
+        glk_window_close(arglist[0].opaqueref, &dat);
+        arglist[2].uint = dat.readcount;
+        arglist[3].uint = dat.writecount;
+    }
+    else {
+        glk_window_close(arglist[0].opaqueref, NULL);
+    }
+}
+
+static void thunk_window_get_size(gluniversal_t *arglist)
+{
+    {
+        int ix = 1;
+        glui32 *ptr1, *ptr2;
+        if (!arglist[ix].ptrflag) {
+            ptr1 = NULL;
         }
         else {
-            top = val;
+            ix++;
+            ptr1 = &(arglist[ix].uint);
         }
+        ix++;
+        if (!arglist[ix].ptrflag) {
+            ptr2 = NULL;
+        }
+        else {
+            ix++;
+            ptr2 = &(arglist[ix].uint);
+        }
+        ix++;
+        glk_window_get_size(arglist[0].opaqueref, ptr1, ptr2);
     }
-    
-    return NULL;
 }
 
-char *gidispatch_prototype(glui32 funcnum)
+static void thunk_window_set_arrangement(gluniversal_t *arglist)
 {
-    switch (funcnum) {
-        case 0x0001: /* exit */
-            return "0:";
-        case 0x0002: /* set_interrupt_handler */
-            /* cannot be invoked through dispatch layer */
-            return NULL;
-        case 0x0003: /* tick */
-            return "0:";
-        case 0x0004: /* gestalt */
-            return "3IuIu:Iu";
-        case 0x0005: /* gestalt_ext */
-            return "4IuIu&#Iu:Iu";
-        case 0x0020: /* window_iterate */
-            return "3Qa<Iu:Qa";
-        case 0x0021: /* window_get_rock */
-            return "2Qa:Iu";
-        case 0x0022: /* window_get_root */
-            return "1:Qa";
-        case 0x0023: /* window_open */
-            return "6QaIuIuIuIu:Qa";
-        case 0x0024: /* window_close */
-            return "2Qa<[2IuIu]:";
-        case 0x0025: /* window_get_size */
-            return "3Qa<Iu<Iu:";
-        case 0x0026: /* window_set_arrangement */
-            return "4QaIuIuQa:";
-        case 0x0027: /* window_get_arrangement */
-            return "4Qa<Iu<Iu<Qa:";
-        case 0x0028: /* window_get_type */
-            return "2Qa:Iu";
-        case 0x0029: /* window_get_parent */
-            return "2Qa:Qa";
-        case 0x002A: /* window_clear */
-            return "1Qa:";
-        case 0x002B: /* window_move_cursor */
-            return "3QaIuIu:";
-        case 0x002C: /* window_get_stream */
-            return "2Qa:Qb";
-        case 0x002D: /* window_set_echo_stream */
-            return "2QaQb:";
-        case 0x002E: /* window_get_echo_stream */
-            return "2Qa:Qb";
-        case 0x002F: /* set_window */
-            return "1Qa:";
-        case 0x0030: /* window_get_sibling */
-            return "2Qa:Qa";
-        case 0x0040: /* stream_iterate */
-            return "3Qb<Iu:Qb";
-        case 0x0041: /* stream_get_rock */
-            return "2Qb:Iu";
-        case 0x0042: /* stream_open_file */
-            return "4QcIuIu:Qb";
-        case 0x0043: /* stream_open_memory */
-            return "4&#!CnIuIu:Qb";
-        case 0x0044: /* stream_close */
-            return "2Qb<[2IuIu]:";
-        case 0x0045: /* stream_set_position */
-            return "3QbIsIu:";
-        case 0x0046: /* stream_get_position */
-            return "2Qb:Iu";
-        case 0x0047: /* stream_set_current */
-            return "1Qb:";
-        case 0x0048: /* stream_get_current */
-            return "1:Qb";
-        case 0x0060: /* fileref_create_temp */
-            return "3IuIu:Qc";
-        case 0x0061: /* fileref_create_by_name */
-            return "4IuSIu:Qc";
-        case 0x0062: /* fileref_create_by_prompt */
-            return "4IuIuIu:Qc";
-        case 0x0063: /* fileref_destroy */
-            return "1Qc:";
-        case 0x0064: /* fileref_iterate */
-            return "3Qc<Iu:Qc";
-        case 0x0065: /* fileref_get_rock */
-            return "2Qc:Iu";
-        case 0x0066: /* fileref_delete_file */
-            return "1Qc:";
-        case 0x0067: /* fileref_does_file_exist */
-            return "2Qc:Iu";
-        case 0x0068: /* fileref_create_from_fileref */
-            return "4IuQcIu:Qc";
-        case 0x0080: /* put_char */
-            return "1Cu:";
-        case 0x0081: /* put_char_stream */
-            return "2QbCu:";
-        case 0x0082: /* put_string */
-            return "1S:";
-        case 0x0083: /* put_string_stream */
-            return "2QbS:";
-        case 0x0084: /* put_buffer */
-            return "1>+#Cn:";
-        case 0x0085: /* put_buffer_stream */
-            return "2Qb>+#Cn:"; 
-        case 0x0086: /* set_style */
-            return "1Iu:";
-        case 0x0087: /* set_style_stream */
-            return "2QbIu:";
-        case 0x0090: /* get_char_stream */
-            return "2Qb:Is";
-        case 0x0091: /* get_line_stream */
-            return "3Qb<+#Cn:Iu"; 
-        case 0x0092: /* get_buffer_stream */
-            return "3Qb<+#Cn:Iu"; 
-        case 0x00A0: /* char_to_lower */
-            return "2Cu:Cu";
-        case 0x00A1: /* char_to_upper */
-            return "2Cu:Cu";
-        case 0x00B0: /* stylehint_set */
-            return "4IuIuIuIs:";
-        case 0x00B1: /* stylehint_clear */
-            return "3IuIuIu:";
-        case 0x00B2: /* style_distinguish */
-            return "4QaIuIu:Iu";
-        case 0x00B3: /* style_measure */
-            return "5QaIuIu<Iu:Iu";
-        case 0x00C0: /* select */
-            return "1<+[4IuQaIuIu]:";
-        case 0x00C1: /* select_poll */
-            return "1<+[4IuQaIuIu]:";
-        case 0x00D0: /* request_line_event */
-            return "3Qa&+#!CnIu:";
-        case 0x00D1: /* cancel_line_event */
-            return "2Qa<[4IuQaIuIu]:";
-        case 0x00D2: /* request_char_event */
-            return "1Qa:";
-        case 0x00D3: /* cancel_char_event */
-            return "1Qa:";
-        case 0x00D4: /* request_mouse_event */
-            return "1Qa:";
-        case 0x00D5: /* cancel_mouse_event */
-            return "1Qa:";
-        case 0x00D6: /* request_timer_events */
-            return "1Iu:";
+    glk_window_set_arrangement(arglist[0].opaqueref, arglist[1].uint, 
+        arglist[2].uint, arglist[3].opaqueref);
+}
 
-#ifdef GLK_MODULE_IMAGE
-        case 0x00E0: /* image_get_info */
-            return "4Iu<Iu<Iu:Iu";
-        case 0x00E1: /* image_draw */
-            return "5QaIuIsIs:Iu";
-        case 0x00E2: /* image_draw_scaled */
-            return "7QaIuIsIsIuIu:Iu";
-        case 0x00E8: /* window_flow_break */
-            return "1Qa:";
-        case 0x00E9: /* window_erase_rect */
-            return "5QaIsIsIuIu:";
-        case 0x00EA: /* window_fill_rect */
-            return "6QaIuIsIsIuIu:";
-        case 0x00EB: /* window_set_background_color */
-            return "2QaIu:";
-#endif /* GLK_MODULE_IMAGE */
+static void thunk_window_get_arrangement(gluniversal_t *arglist)
+{
+    {
+        int ix = 1;
+        glui32 *ptr1, *ptr2;
+        winid_t *ptr3;
+        if (!arglist[ix].ptrflag) {
+            ptr1 = NULL;
+        }
+        else {
+            ix++;
+            ptr1 = &(arglist[ix].uint);
+        }
+        ix++;
+        if (!arglist[ix].ptrflag) {
+            ptr2 = NULL;
+        }
+        else {
+            ix++;
+            ptr2 = &(arglist[ix].uint);
+        }
+        ix++;
+        if (!arglist[ix].ptrflag) {
+            ptr3 = NULL;
+        }
+        else {
+            ix++;
+            ptr3 = (winid_t *)(&(arglist[ix].opaqueref));
+        }
+        ix++;
+        glk_window_get_arrangement(arglist[0].opaqueref, ptr1, ptr2, ptr3);
+    }
+}
 
-#ifdef GLK_MODULE_SOUND
-        case 0x00F0: /* schannel_iterate */
-            return "3Qd<Iu:Qd";
-        case 0x00F1: /* schannel_get_rock */
-            return "2Qd:Iu";
-        case 0x00F2: /* schannel_create */
-            return "2Iu:Qd";
-        case 0x00F3: /* schannel_destroy */
-            return "1Qd:";
-        case 0x00F8: /* schannel_play */
-            return "3QdIu:Iu";
-        case 0x00F9: /* schannel_play_ext */
-            return "5QdIuIuIu:Iu";
-        case 0x00FA: /* schannel_stop */
-            return "1Qd:";
-        case 0x00FB: /* schannel_set_volume */
-            return "2QdIu:";
-        case 0x00FC: /* sound_load_hint */
-            return "2IuIu:";
+static void thunk_window_get_type(gluniversal_t *arglist)
+{
+    arglist[2].uint = glk_window_get_type(arglist[0].opaqueref);
+}
 
-#ifdef GLK_MODULE_SOUND2
-        case 0x00F4: /* schannel_create_ext */
-            return "3IuIu:Qd";
-        case 0x00F7: /* schannel_play_multi */
-            return "4>+#Qd>+#IuIu:Iu";
-        case 0x00FD: /* schannel_set_volume_ext */
-            return "4QdIuIuIu:";
-        case 0x00FE: /* schannel_pause */
-            return "1Qd:";
-        case 0x00FF: /* schannel_unpause */
-            return "1Qd:";
-#endif /* GLK_MODULE_SOUND2 */
-#endif /* GLK_MODULE_SOUND */
+static void thunk_window_get_parent(gluniversal_t *arglist)
+{
+    arglist[2].opaqueref = glk_window_get_parent(arglist[0].opaqueref);
+}
 
-#ifdef GLK_MODULE_HYPERLINKS
-        case 0x0100: /* set_hyperlink */
-            return "1Iu:";
-        case 0x0101: /* set_hyperlink_stream */
-            return "2QbIu:";
-        case 0x0102: /* request_hyperlink_event */
-            return "1Qa:";
-        case 0x0103: /* cancel_hyperlink_event */
-            return "1Qa:";
-#endif /* GLK_MODULE_HYPERLINKS */
+static void thunk_window_clear(gluniversal_t *arglist)
+{
+    glk_window_clear(arglist[0].opaqueref);
+}
 
-#ifdef GLK_MODULE_UNICODE
-        case 0x0120: /* buffer_to_lower_case_uni */
-            return "3&+#IuIu:Iu";
-        case 0x0121: /* buffer_to_upper_case_uni */
-            return "3&+#IuIu:Iu";
-        case 0x0122: /* buffer_to_title_case_uni */
-            return "4&+#IuIuIu:Iu";
-        case 0x0128: /* put_char_uni */
-            return "1Iu:";
-        case 0x0129: /* put_string_uni */
-            return "1U:";
-        case 0x012A: /* put_buffer_uni */
-            return "1>+#Iu:";
-        case 0x012B: /* put_char_stream_uni */
-            return "2QbIu:";
-        case 0x012C: /* put_string_stream_uni */
-            return "2QbU:";
-        case 0x012D: /* put_buffer_stream_uni */
-            return "2Qb>+#Iu:"; 
-        case 0x0130: /* get_char_stream_uni */
-            return "2Qb:Is";
-        case 0x0131: /* get_buffer_stream_uni */
-            return "3Qb<+#Iu:Iu"; 
-        case 0x0132: /* get_line_stream_uni */
-            return "3Qb<+#Iu:Iu"; 
-        case 0x0138: /* stream_open_file_uni */
-            return "4QcIuIu:Qb";
-        case 0x0139: /* stream_open_memory_uni */
-            return "4&#!IuIuIu:Qb";
-        case 0x0140: /* request_char_event_uni */
-            return "1Qa:";
-        case 0x0141: /* request_line_event_uni */
-            return "3Qa&+#!IuIu:";
-#endif /* GLK_MODULE_UNICODE */
-            
-#ifdef GLK_MODULE_UNICODE_NORM
-        case 0x0123: /* buffer_canon_decompose_uni */
-            return "3&+#IuIu:Iu";
-        case 0x0124: /* buffer_canon_normalize_uni */
-            return "3&+#IuIu:Iu";
-#endif /* GLK_MODULE_UNICODE_NORM */
+static void thunk_window_move_cursor(gluniversal_t *arglist)
+{
+    glk_window_move_cursor(arglist[0].opaqueref, arglist[1].uint, 
+        arglist[2].uint);
+}
 
-#ifdef GLK_MODULE_LINE_ECHO
-        case 0x0150: /* set_echo_line_event */
-            return "2QaIu:";
-#endif /* GLK_MODULE_LINE_ECHO */
+static void thunk_window_get_stream(gluniversal_t *arglist)
+{
+    arglist[2].opaqueref = glk_window_get_stream(arglist[0].opaqueref);
+}
 
-#ifdef GLK_MODULE_LINE_TERMINATORS
-        case 0x0151: /* set_terminators_line_event */
-            return "2Qa>#Iu:";
-#endif /* GLK_MODULE_LINE_TERMINATORS */
-            
-#ifdef GLK_MODULE_DATETIME
-        case 0x0160: /* current_time */
-            return "1<+[3IsIuIs]:";
-        case 0x0161: /* current_simple_time */
-            return "2Iu:Is";
-        case 0x0168: /* time_to_date_utc */
-            return "2>+[3IsIuIs]<+[8IsIsIsIsIsIsIsIs]:";
-        case 0x0169: /* time_to_date_local */
-            return "2>+[3IsIuIs]<+[8IsIsIsIsIsIsIsIs]:";
-        case 0x016A: /* simple_time_to_date_utc */
-            return "3IsIu<+[8IsIsIsIsIsIsIsIs]:";
-        case 0x016B: /* simple_time_to_date_local */
-            return "3IsIu<+[8IsIsIsIsIsIsIsIs]:";
-        case 0x016C: /* date_to_time_utc */
-            return "2>+[8IsIsIsIsIsIsIsIs]<+[3IsIuIs]:";
-        case 0x016D: /* date_to_time_local */
-            return "2>+[8IsIsIsIsIsIsIsIs]<+[3IsIuIs]:";
-        case 0x016E: /* date_to_simple_time_utc */
-            return "3>+[8IsIsIsIsIsIsIsIs]Iu:Is";
-        case 0x016F: /* date_to_simple_time_local */
-            return "3>+[8IsIsIsIsIsIsIsIs]Iu:Is";
-#endif /* GLK_MODULE_DATETIME */
+static void thunk_window_set_echo_stream(gluniversal_t *arglist)
+{
+    glk_window_set_echo_stream(arglist[0].opaqueref, arglist[1].opaqueref);
+}
 
-#ifdef GLK_EXTEND_PROTOTYPE
-        GLK_EXTEND_PROTOTYPE
-#endif /* GLK_EXTEND_PROTOTYPE */
+static void thunk_window_get_echo_stream(gluniversal_t *arglist)
+{
+    arglist[2].opaqueref = glk_window_get_echo_stream(arglist[0].opaqueref);
+}
 
-        default:
-            return NULL;
-    }
+static void thunk_set_window(gluniversal_t *arglist)
+{
+    glk_set_window(arglist[0].opaqueref);
 }
 
-void gidispatch_call(glui32 funcnum, glui32 numargs, gluniversal_t *arglist)
+static void thunk_window_get_sibling(gluniversal_t *arglist)
 {
-    switch (funcnum) {
-        case 0x0001: /* exit */
-            glk_exit();
-            break;
-        case 0x0002: /* set_interrupt_handler */
-            /* cannot be invoked through dispatch layer */
-            break;
-        case 0x0003: /* tick */
-            glk_tick();
-            break;
-        case 0x0004: /* gestalt */
-            arglist[3].uint = glk_gestalt(arglist[0].uint, arglist[1].uint);
-            break;
-        case 0x0005: /* gestalt_ext */
-            if (arglist[2].ptrflag) {
-                arglist[6].uint = glk_gestalt_ext(arglist[0].uint, arglist[1].uint,
-                    arglist[3].array, arglist[4].uint);
-            }
-            else {
-                arglist[4].uint = glk_gestalt_ext(arglist[0].uint, arglist[1].uint,
-                    NULL, 0);
-            }
-            break;
-        case 0x0020: /* window_iterate */
-            if (arglist[1].ptrflag) 
-                arglist[4].opaqueref = glk_window_iterate(arglist[0].opaqueref, &arglist[2].uint);
-            else
-                arglist[3].opaqueref = glk_window_iterate(arglist[0].opaqueref, NULL);
-            break;
-        case 0x0021: /* window_get_rock */
-            arglist[2].uint = glk_window_get_rock(arglist[0].opaqueref);
-            break;
-        case 0x0022: /* window_get_root */
-            arglist[1].opaqueref = glk_window_get_root();
-            break;
-        case 0x0023: /* window_open */
-            arglist[6].opaqueref = glk_window_open(arglist[0].opaqueref, arglist[1].uint, 
-                arglist[2].uint, arglist[3].uint, arglist[4].uint);
-            break;
-        case 0x0024: /* window_close */
-            if (arglist[1].ptrflag) {
-                stream_result_t dat;
-                glk_window_close(arglist[0].opaqueref, &dat);
-                arglist[2].uint = dat.readcount;
-                arglist[3].uint = dat.writecount;
-            }
-            else {
-                glk_window_close(arglist[0].opaqueref, NULL);
-            }
-            break;
-        case 0x0025: /* window_get_size */
-            {
-                int ix = 1;
-                glui32 *ptr1, *ptr2;
-                if (!arglist[ix].ptrflag) {
-                    ptr1 = NULL;
-                }
-                else {
-                    ix++;
-                    ptr1 = &(arglist[ix].uint);
-                }
-                ix++;
-                if (!arglist[ix].ptrflag) {
-                    ptr2 = NULL;
-                }
-                else {
-                    ix++;
-                    ptr2 = &(arglist[ix].uint);
-                }
-                ix++;
-                glk_window_get_size(arglist[0].opaqueref, ptr1, ptr2);
-            }
-            break;
-        case 0x0026: /* window_set_arrangement */
-            glk_window_set_arrangement(arglist[0].opaqueref, arglist[1].uint, 
-                arglist[2].uint, arglist[3].opaqueref);
-            break;
-        case 0x0027: /* window_get_arrangement */
-            {
-                int ix = 1;
-                glui32 *ptr1, *ptr2;
-                winid_t *ptr3;
-                if (!arglist[ix].ptrflag) {
-                    ptr1 = NULL;
-                }
-                else {
-                    ix++;
-                    ptr1 = &(arglist[ix].uint);
-                }
-                ix++;
-                if (!arglist[ix].ptrflag) {
-                    ptr2 = NULL;
-                }
-                else {
-                    ix++;
-                    ptr2 = &(arglist[ix].uint);
-                }
-                ix++;
-                if (!arglist[ix].ptrflag) {
-                    ptr3 = NULL;
-                }
-                else {
-                    ix++;
-                    ptr3 = (winid_t *)(&(arglist[ix].opaqueref));
-                }
-                ix++;
-                glk_window_get_arrangement(arglist[0].opaqueref, ptr1, ptr2, ptr3);
-            }
-            break;
-        case 0x0028: /* window_get_type */
-            arglist[2].uint = glk_window_get_type(arglist[0].opaqueref);
-            break;
-        case 0x0029: /* window_get_parent */
-            arglist[2].opaqueref = glk_window_get_parent(arglist[0].opaqueref);
-            break;
-        case 0x002A: /* window_clear */
-            glk_window_clear(arglist[0].opaqueref);
-            break;
-        case 0x002B: /* window_move_cursor */
-            glk_window_move_cursor(arglist[0].opaqueref, arglist[1].uint, 
-                arglist[2].uint);
-            break;
-        case 0x002C: /* window_get_stream */
-            arglist[2].opaqueref = glk_window_get_stream(arglist[0].opaqueref);
-            break;
-        case 0x002D: /* window_set_echo_stream */
-            glk_window_set_echo_stream(arglist[0].opaqueref, arglist[1].opaqueref);
-            break;
-        case 0x002E: /* window_get_echo_stream */
-            arglist[2].opaqueref = glk_window_get_echo_stream(arglist[0].opaqueref);
-            break;
-        case 0x002F: /* set_window */
-            glk_set_window(arglist[0].opaqueref);
-            break;
-        case 0x0030: /* window_get_sibling */
-            arglist[2].opaqueref = glk_window_get_sibling(arglist[0].opaqueref);
-            break;
-        case 0x0040: /* stream_iterate */
-            if (arglist[1].ptrflag) 
-                arglist[4].opaqueref = glk_stream_iterate(arglist[0].opaqueref, &arglist[2].uint);
-            else
-                arglist[3].opaqueref = glk_stream_iterate(arglist[0].opaqueref, NULL);
-            break;
-        case 0x0041: /* stream_get_rock */
-            arglist[2].uint = glk_stream_get_rock(arglist[0].opaqueref);
-            break;
-        case 0x0042: /* stream_open_file */
-            arglist[4].opaqueref = glk_stream_open_file(arglist[0].opaqueref, arglist[1].uint, 
-                arglist[2].uint);
-            break;
-        case 0x0043: /* stream_open_memory */
-            if (arglist[0].ptrflag) 
-                arglist[6].opaqueref = glk_stream_open_memory(arglist[1].array, 
-                    arglist[2].uint, arglist[3].uint, arglist[4].uint);
-            else
-                arglist[4].opaqueref = glk_stream_open_memory(NULL, 
-                    0, arglist[1].uint, arglist[2].uint);
-            break;
-        case 0x0044: /* stream_close */
-            if (arglist[1].ptrflag) {
-                stream_result_t dat;
-                glk_stream_close(arglist[0].opaqueref, &dat);
-                arglist[2].uint = dat.readcount;
-                arglist[3].uint = dat.writecount;
-            }
-            else {
-                glk_stream_close(arglist[0].opaqueref, NULL);
-            }
-            break;
-        case 0x0045: /* stream_set_position */
-            glk_stream_set_position(arglist[0].opaqueref, arglist[1].sint,
-                arglist[2].uint);
-            break;
-        case 0x0046: /* stream_get_position */
-            arglist[2].uint = glk_stream_get_position(arglist[0].opaqueref);
-            break;
-        case 0x0047: /* stream_set_current */
-            glk_stream_set_current(arglist[0].opaqueref);
-            break;
-        case 0x0048: /* stream_get_current */
-            arglist[1].opaqueref = glk_stream_get_current();
-            break;
-        case 0x0060: /* fileref_create_temp */
-            arglist[3].opaqueref = glk_fileref_create_temp(arglist[0].uint, 
-                arglist[1].uint);
-            break;
-        case 0x0061: /* fileref_create_by_name */
-            arglist[4].opaqueref = glk_fileref_create_by_name(arglist[0].uint, 
-                arglist[1].charstr, arglist[2].uint);
-            break;
-        case 0x0062: /* fileref_create_by_prompt */
-            arglist[4].opaqueref = glk_fileref_create_by_prompt(arglist[0].uint, 
-                arglist[1].uint, arglist[2].uint);
-            break;
-        case 0x0063: /* fileref_destroy */
-            glk_fileref_destroy(arglist[0].opaqueref);
-            break;
-        case 0x0064: /* fileref_iterate */
-            if (arglist[1].ptrflag) 
-                arglist[4].opaqueref = glk_fileref_iterate(arglist[0].opaqueref, &arglist[2].uint);
-            else
-                arglist[3].opaqueref = glk_fileref_iterate(arglist[0].opaqueref, NULL);
-            break;
-        case 0x0065: /* fileref_get_rock */
-            arglist[2].uint = glk_fileref_get_rock(arglist[0].opaqueref);
-            break;
-        case 0x0066: /* fileref_delete_file */
-            glk_fileref_delete_file(arglist[0].opaqueref);
-            break;
-        case 0x0067: /* fileref_does_file_exist */
-            arglist[2].uint = glk_fileref_does_file_exist(arglist[0].opaqueref);
-            break;
-        case 0x0068: /* fileref_create_from_fileref */
-            arglist[4].opaqueref = glk_fileref_create_from_fileref(arglist[0].uint, 
-                arglist[1].opaqueref, arglist[2].uint);
-            break;
-        case 0x0080: /* put_char */
-            glk_put_char(arglist[0].uch);
-            break;
-        case 0x0081: /* put_char_stream */
-            glk_put_char_stream(arglist[0].opaqueref, arglist[1].uch);
-            break;
-        case 0x0082: /* put_string */
-            glk_put_string(arglist[0].charstr);
-            break;
-        case 0x0083: /* put_string_stream */
-            glk_put_string_stream(arglist[0].opaqueref, arglist[1].charstr);
-            break;
-        case 0x0084: /* put_buffer */
-            if (arglist[0].ptrflag) 
-                glk_put_buffer(arglist[1].array, arglist[2].uint);
-            else
-                glk_put_buffer(NULL, 0);
-            break;
-        case 0x0085: /* put_buffer_stream */
-            if (arglist[1].ptrflag) 
-                glk_put_buffer_stream(arglist[0].opaqueref, 
-                    arglist[2].array, arglist[3].uint);
-            else
-                glk_put_buffer_stream(arglist[0].opaqueref, 
-                    NULL, 0);
-            break;
-        case 0x0086: /* set_style */
-            glk_set_style(arglist[0].uint);
-            break;
-        case 0x0087: /* set_style_stream */
-            glk_set_style_stream(arglist[0].opaqueref, arglist[1].uint);
-            break;
-        case 0x0090: /* get_char_stream */
-            arglist[2].sint = glk_get_char_stream(arglist[0].opaqueref);
-            break;
-        case 0x0091: /* get_line_stream */
-            if (arglist[1].ptrflag) 
-                arglist[5].uint = glk_get_line_stream(arglist[0].opaqueref, 
-                    arglist[2].array, arglist[3].uint);
-            else
-                arglist[3].uint = glk_get_line_stream(arglist[0].opaqueref, 
-                    NULL, 0);
-            break;
-        case 0x0092: /* get_buffer_stream */
-            if (arglist[1].ptrflag) 
-                arglist[5].uint = glk_get_buffer_stream(arglist[0].opaqueref, 
-                    arglist[2].array, arglist[3].uint);
-            else
-                arglist[3].uint = glk_get_buffer_stream(arglist[0].opaqueref, 
-                    NULL, 0);
-            break;
-        case 0x00A0: /* char_to_lower */
-            arglist[2].uch = glk_char_to_lower(arglist[0].uch);
-            break;
-        case 0x00A1: /* char_to_upper */
-            arglist[2].uch = glk_char_to_upper(arglist[0].uch);
-            break;
-        case 0x00B0: /* stylehint_set */
-            glk_stylehint_set(arglist[0].uint, arglist[1].uint,
-                arglist[2].uint, arglist[3].sint);
-            break;
-        case 0x00B1: /* stylehint_clear */
-            glk_stylehint_clear(arglist[0].uint, arglist[1].uint,
-                arglist[2].uint);
-            break;
-        case 0x00B2: /* style_distinguish */
-            arglist[4].uint = glk_style_distinguish(arglist[0].opaqueref, arglist[1].uint,
-                arglist[2].uint);
-            break;
-        case 0x00B3: /* style_measure */
-            if (arglist[3].ptrflag)
-                arglist[6].uint = glk_style_measure(arglist[0].opaqueref, arglist[1].uint,
-                    arglist[2].uint, &(arglist[4].uint));
-            else
-                arglist[5].uint = glk_style_measure(arglist[0].opaqueref, arglist[1].uint,
-                    arglist[2].uint, NULL);
-            break;
-        case 0x00C0: /* select */
-            if (arglist[0].ptrflag) {
-                event_t dat;
-                glk_select(&dat);
-                arglist[1].uint = dat.type;
-                arglist[2].opaqueref = dat.win;
-                arglist[3].uint = dat.val1;
-                arglist[4].uint = dat.val2;
-            }
-            else {
-                glk_select(NULL);
-            }
-            break;
-        case 0x00C1: /* select_poll */
-            if (arglist[0].ptrflag) {
-                event_t dat;
-                glk_select_poll(&dat);
-                arglist[1].uint = dat.type;
-                arglist[2].opaqueref = dat.win;
-                arglist[3].uint = dat.val1;
-                arglist[4].uint = dat.val2;
-            }
-            else {
-                glk_select_poll(NULL);
-            }
-            break;
-        case 0x00D0: /* request_line_event */
-            if (arglist[1].ptrflag)
-                glk_request_line_event(arglist[0].opaqueref, arglist[2].array,
-                    arglist[3].uint, arglist[4].uint);
-            else
-                glk_request_line_event(arglist[0].opaqueref, NULL,
-                    0, arglist[2].uint);
-            break;
-        case 0x00D1: /* cancel_line_event */
-            if (arglist[1].ptrflag) {
-                event_t dat;
-                glk_cancel_line_event(arglist[0].opaqueref, &dat);
-                arglist[2].uint = dat.type;
-                arglist[3].opaqueref = dat.win;
-                arglist[4].uint = dat.val1;
-                arglist[5].uint = dat.val2;
-            }
-            else {
-                glk_cancel_line_event(arglist[0].opaqueref, NULL);
-            }
-            break;
-        case 0x00D2: /* request_char_event */
-            glk_request_char_event(arglist[0].opaqueref);
-            break;
-        case 0x00D3: /* cancel_char_event */
-            glk_cancel_char_event(arglist[0].opaqueref);
-            break;
-        case 0x00D4: /* request_mouse_event */
-            glk_request_mouse_event(arglist[0].opaqueref);
-            break;
-        case 0x00D5: /* cancel_mouse_event */
-            glk_cancel_mouse_event(arglist[0].opaqueref);
-            break;
-        case 0x00D6: /* request_timer_events */
-            glk_request_timer_events(arglist[0].uint);
-            break;
+    arglist[2].opaqueref = glk_window_get_sibling(arglist[0].opaqueref);
+}
 
-#ifdef GLK_MODULE_IMAGE
-        case 0x00E0: /* image_get_info */
-            {
-                int ix = 1;
-                glui32 *ptr1, *ptr2;
-                if (!arglist[ix].ptrflag) {
-                    ptr1 = NULL;
-                }
-                else {
-                    ix++;
-                    ptr1 = &(arglist[ix].uint);
-                }
-                ix++;
-                if (!arglist[ix].ptrflag) {
-                    ptr2 = NULL;
-                }
-                else {
-                    ix++;
-                    ptr2 = &(arglist[ix].uint);
-                }
-                ix++;
-                ix++;
-                arglist[ix].uint = glk_image_get_info(arglist[0].uint, ptr1, ptr2);
-            }
-            break;
-        case 0x00E1: /* image_draw */
-            arglist[5].uint = glk_image_draw(arglist[0].opaqueref, 
-                arglist[1].uint,
-                arglist[2].sint, arglist[3].sint);
-            break;
-        case 0x00E2: /* image_draw_scaled */
-            arglist[7].uint = glk_image_draw_scaled(arglist[0].opaqueref, 
-                arglist[1].uint,
-                arglist[2].sint, arglist[3].sint,
-                arglist[4].uint, arglist[5].uint);
-            break;
-        case 0x00E8: /* window_flow_break */
-            glk_window_flow_break(arglist[0].opaqueref);
-            break;
-        case 0x00E9: /* window_erase_rect */
-            glk_window_erase_rect(arglist[0].opaqueref,
-                arglist[1].sint, arglist[2].sint,
-                arglist[3].uint, arglist[4].uint);
-            break;
-        case 0x00EA: /* window_fill_rect */
-            glk_window_fill_rect(arglist[0].opaqueref, arglist[1].uint,
-                arglist[2].sint, arglist[3].sint,
-                arglist[4].uint, arglist[5].uint);
-            break;
-        case 0x00EB: /* window_set_background_color */
-            glk_window_set_background_color(arglist[0].opaqueref, arglist[1].uint);
-            break;
-#endif /* GLK_MODULE_IMAGE */
+static void thunk_stream_iterate(gluniversal_t *arglist)
+{
+    if (arglist[1].ptrflag) 
+        arglist[4].opaqueref = glk_stream_iterate(arglist[0].opaqueref, &arglist[2].uint);
+    else
+        arglist[3].opaqueref = glk_stream_iterate(arglist[0].opaqueref, NULL);
+}
 
-#ifdef GLK_MODULE_SOUND
-        case 0x00F0: /* schannel_iterate */
-            if (arglist[1].ptrflag) 
-                arglist[4].opaqueref = glk_schannel_iterate(arglist[0].opaqueref, &arglist[2].uint);
-            else
-                arglist[3].opaqueref = glk_schannel_iterate(arglist[0].opaqueref, NULL);
-            break;
-        case 0x00F1: /* schannel_get_rock */
-            arglist[2].uint = glk_schannel_get_rock(arglist[0].opaqueref);
-            break;
-        case 0x00F2: /* schannel_create */
-            arglist[2].opaqueref = glk_schannel_create(arglist[0].uint);
-            break;
-        case 0x00F3: /* schannel_destroy */
-            glk_schannel_destroy(arglist[0].opaqueref);
-            break;
-        case 0x00F8: /* schannel_play */
-            arglist[3].uint = glk_schannel_play(arglist[0].opaqueref, arglist[1].uint);
-            break;
-        case 0x00F9: /* schannel_play_ext */
-            arglist[5].uint = glk_schannel_play_ext(arglist[0].opaqueref, 
-                arglist[1].uint, arglist[2].uint, arglist[3].uint);
-            break;
-        case 0x00FA: /* schannel_stop */
-            glk_schannel_stop(arglist[0].opaqueref);
-            break;
-        case 0x00FB: /* schannel_set_volume */
-            glk_schannel_set_volume(arglist[0].opaqueref, arglist[1].uint);
-            break;
-        case 0x00FC: /* sound_load_hint */
-            glk_sound_load_hint(arglist[0].uint, arglist[1].uint);
-            break;
+static void thunk_stream_get_rock(gluniversal_t *arglist)
+{
+    arglist[2].uint = glk_stream_get_rock(arglist[0].opaqueref);
+}
 
-#ifdef GLK_MODULE_SOUND2
-        case 0x00F4: /* schannel_create_ext */
-            arglist[3].opaqueref = glk_schannel_create_ext(arglist[0].uint, arglist[1].uint);
-            break;
-        case 0x00F7: /* schannel_play_multi */
-            if (arglist[0].ptrflag && arglist[3].ptrflag)
-                arglist[8].uint = glk_schannel_play_multi(arglist[1].array, arglist[2].uint, arglist[4].array, arglist[5].uint, arglist[6].uint);
-            else if (arglist[0].ptrflag)
-                arglist[6].uint = glk_schannel_play_multi(arglist[1].array, arglist[2].uint, NULL, 0, arglist[4].uint);
-            else if (arglist[1].ptrflag)
-                arglist[6].uint = glk_schannel_play_multi(NULL, 0, arglist[2].array, arglist[3].uint, arglist[4].uint);
-            else
-                arglist[4].uint = glk_schannel_play_multi(NULL, 0, NULL, 0, arglist[2].uint);
-            break;
-        case 0x00FD: /* schannel_set_volume_ext */
-            glk_schannel_set_volume_ext(arglist[0].opaqueref, arglist[1].uint, arglist[2].uint, arglist[3].uint);
-            break;
-        case 0x00FE: /* schannel_pause */
-            glk_schannel_pause(arglist[0].opaqueref);
-            break;
-        case 0x00FF: /* schannel_unpause */
-            glk_schannel_unpause(arglist[0].opaqueref);
-            break;
-#endif /* GLK_MODULE_SOUND2 */
-#endif /* GLK_MODULE_SOUND */
+static void thunk_stream_open_file(gluniversal_t *arglist)
+{
+    arglist[4].opaqueref = glk_stream_open_file(arglist[0].opaqueref, arglist[1].uint, 
+        arglist[2].uint);
+}
 
-#ifdef GLK_MODULE_HYPERLINKS
-        case 0x0100: /* set_hyperlink */
-            glk_set_hyperlink(arglist[0].uint);
-            break;
-        case 0x0101: /* set_hyperlink_stream */
-            glk_set_hyperlink_stream(arglist[0].opaqueref, arglist[1].uint);
-            break;
-        case 0x0102: /* request_hyperlink_event */
-            glk_request_hyperlink_event(arglist[0].opaqueref);
-            break;
-        case 0x0103: /* cancel_hyperlink_event */
-            glk_cancel_hyperlink_event(arglist[0].opaqueref);
-            break;
-#endif /* GLK_MODULE_HYPERLINKS */
-            
-#ifdef GLK_MODULE_UNICODE
-        case 0x0120: /* buffer_to_lower_case_uni */
-            if (arglist[0].ptrflag) 
-                arglist[5].uint = glk_buffer_to_lower_case_uni(arglist[1].array, arglist[2].uint, arglist[3].uint);
-            else
-                arglist[3].uint = glk_buffer_to_lower_case_uni(NULL, 0, arglist[1].uint);
-            break;
-        case 0x0121: /* buffer_to_upper_case_uni */
-            if (arglist[0].ptrflag) 
-                arglist[5].uint = glk_buffer_to_upper_case_uni(arglist[1].array, arglist[2].uint, arglist[3].uint);
-            else
-                arglist[3].uint = glk_buffer_to_upper_case_uni(NULL, 0, arglist[1].uint);
-            break;
-        case 0x0122: /* buffer_to_title_case_uni */
-            if (arglist[0].ptrflag) 
-                arglist[6].uint = glk_buffer_to_title_case_uni(arglist[1].array, arglist[2].uint, arglist[3].uint, arglist[4].uint);
-            else
-                arglist[4].uint = glk_buffer_to_title_case_uni(NULL, 0, arglist[1].uint, arglist[2].uint);
-            break;
-        case 0x0128: /* put_char_uni */
-            glk_put_char_uni(arglist[0].uint);
-            break;
-        case 0x0129: /* put_string_uni */
-            glk_put_string_uni(arglist[0].unicharstr);
-            break;
-        case 0x012A: /* put_buffer_uni */
-            if (arglist[0].ptrflag) 
-                glk_put_buffer_uni(arglist[1].array, arglist[2].uint);
-            else
-                glk_put_buffer_uni(NULL, 0);
-            break;
-        case 0x012B: /* put_char_stream_uni */
-            glk_put_char_stream_uni(arglist[0].opaqueref, arglist[1].uint);
-            break;
-        case 0x012C: /* put_string_stream_uni */
-            glk_put_string_stream_uni(arglist[0].opaqueref, arglist[1].unicharstr);
-            break;
-        case 0x012D: /* put_buffer_stream_uni */
-            if (arglist[1].ptrflag) 
-                glk_put_buffer_stream_uni(arglist[0].opaqueref, 
-                    arglist[2].array, arglist[3].uint);
-            else
-                glk_put_buffer_stream_uni(arglist[0].opaqueref, 
-                    NULL, 0);
-            break;
-        case 0x0130: /* get_char_stream_uni */
-            arglist[2].sint = glk_get_char_stream_uni(arglist[0].opaqueref);
-            break;
-        case 0x0131: /* get_buffer_stream_uni */
-            if (arglist[1].ptrflag) 
-                arglist[5].uint = glk_get_buffer_stream_uni(arglist[0].opaqueref, 
-                    arglist[2].array, arglist[3].uint);
-            else
-                arglist[3].uint = glk_get_buffer_stream_uni(arglist[0].opaqueref, 
-                    NULL, 0);
-            break;
-        case 0x0132: /* get_line_stream_uni */
-            if (arglist[1].ptrflag) 
-                arglist[5].uint = glk_get_line_stream_uni(arglist[0].opaqueref, 
-                    arglist[2].array, arglist[3].uint);
-            else
-                arglist[3].uint = glk_get_line_stream_uni(arglist[0].opaqueref, 
-                    NULL, 0);
-            break;
-        case 0x0138: /* stream_open_file_uni */
-            arglist[4].opaqueref = glk_stream_open_file_uni(arglist[0].opaqueref, arglist[1].uint, 
-                arglist[2].uint);
-            break;
-        case 0x0139: /* stream_open_memory_uni */
-            if (arglist[0].ptrflag) 
-                arglist[6].opaqueref = glk_stream_open_memory_uni(arglist[1].array, 
-                    arglist[2].uint, arglist[3].uint, arglist[4].uint);
-            else
-                arglist[4].opaqueref = glk_stream_open_memory_uni(NULL, 
-                    0, arglist[1].uint, arglist[2].uint);
-            break;
-        case 0x0140: /* request_char_event_uni */
-            glk_request_char_event_uni(arglist[0].opaqueref);
-            break;
-        case 0x0141: /* request_line_event_uni */
-            if (arglist[1].ptrflag)
-                glk_request_line_event_uni(arglist[0].opaqueref, arglist[2].array,
-                    arglist[3].uint, arglist[4].uint);
-            else
-                glk_request_line_event_uni(arglist[0].opaqueref, NULL,
-                    0, arglist[2].uint);
-            break;
+static void thunk_stream_open_memory(gluniversal_t *arglist)
+{
+    if (arglist[0].ptrflag) 
+        arglist[6].opaqueref = glk_stream_open_memory(arglist[1].array, 
+            arglist[2].uint, arglist[3].uint, arglist[4].uint);
+    else
+        arglist[4].opaqueref = glk_stream_open_memory(NULL, 
+            0, arglist[1].uint, arglist[2].uint);
+}
+
+static void thunk_stream_close(gluniversal_t *arglist)
+{
+    if (arglist[1].ptrflag) {
+        stream_result_t dat;
+        glk_stream_close(arglist[0].opaqueref, &dat);
+        arglist[2].uint = dat.readcount;
+        arglist[3].uint = dat.writecount;
+    }
+    else {
+        glk_stream_close(arglist[0].opaqueref, NULL);
+    }
+}
+
+static void thunk_stream_set_position(gluniversal_t *arglist)
+{
+    glk_stream_set_position(arglist[0].opaqueref, arglist[1].sint,
+        arglist[2].uint);
+}
+
+static void thunk_stream_get_position(gluniversal_t *arglist)
+{
+    arglist[2].uint = glk_stream_get_position(arglist[0].opaqueref);
+}
+
+static void thunk_stream_set_current(gluniversal_t *arglist)
+{
+    glk_stream_set_current(arglist[0].opaqueref);
+}
+
+static void thunk_stream_get_current(gluniversal_t *arglist)
+{
+    arglist[1].opaqueref = glk_stream_get_current();
+}
+
+static void thunk_fileref_create_temp(gluniversal_t *arglist)
+{
+    arglist[3].opaqueref = glk_fileref_create_temp(arglist[0].uint, 
+        arglist[1].uint);
+}
+
+static void thunk_fileref_create_by_name(gluniversal_t *arglist)
+{
+    arglist[4].opaqueref = glk_fileref_create_by_name(arglist[0].uint, 
+        arglist[1].charstr, arglist[2].uint);
+}
+
+static void thunk_fileref_create_by_prompt(gluniversal_t *arglist)
+{
+    arglist[4].opaqueref = glk_fileref_create_by_prompt(arglist[0].uint, 
+        arglist[1].uint, arglist[2].uint);
+}
+
+static void thunk_fileref_destroy(gluniversal_t *arglist)
+{
+    glk_fileref_destroy(arglist[0].opaqueref);
+}
+
+static void thunk_fileref_iterate(gluniversal_t *arglist)
+{
+    if (arglist[1].ptrflag) 
+        arglist[4].opaqueref = glk_fileref_iterate(arglist[0].opaqueref, &arglist[2].uint);
+    else
+        arglist[3].opaqueref = glk_fileref_iterate(arglist[0].opaqueref, NULL);
+}
+
+static void thunk_fileref_get_rock(gluniversal_t *arglist)
+{
+    arglist[2].uint = glk_fileref_get_rock(arglist[0].opaqueref);
+}
+
+static void thunk_fileref_delete_file(gluniversal_t *arglist)
+{
+    glk_fileref_delete_file(arglist[0].opaqueref);
+}
+
+static void thunk_fileref_does_file_exist(gluniversal_t *arglist)
+{
+    arglist[2].uint = glk_fileref_does_file_exist(arglist[0].opaqueref);
+}
+
+static void thunk_fileref_create_from_fileref(gluniversal_t *arglist)
+{
+    arglist[4].opaqueref = glk_fileref_create_from_fileref(arglist[0].uint, 
+        arglist[1].opaqueref, arglist[2].uint);
+}
+
+static void thunk_put_char(gluniversal_t *arglist)
+{
+    glk_put_char(arglist[0].uch);
+}
+
+static void thunk_put_char_stream(gluniversal_t *arglist)
+{
+    glk_put_char_stream(arglist[0].opaqueref, arglist[1].uch);
+}
+
+static void thunk_put_string(gluniversal_t *arglist)
+{
+    glk_put_string(arglist[0].charstr);
+}
+
+static void thunk_put_string_stream(gluniversal_t *arglist)
+{
+    glk_put_string_stream(arglist[0].opaqueref, arglist[1].charstr);
+}
+
+static void thunk_put_buffer(gluniversal_t *arglist)
+{
+    if (arglist[0].ptrflag) 
+        glk_put_buffer(arglist[1].array, arglist[2].uint);
+    else
+        glk_put_buffer(NULL, 0);
+}
+
+static void thunk_put_buffer_stream(gluniversal_t *arglist)
+{
+    if (arglist[1].ptrflag) 
+        glk_put_buffer_stream(arglist[0].opaqueref, 
+            arglist[2].array, arglist[3].uint);
+    else
+        glk_put_buffer_stream(arglist[0].opaqueref, 
+            NULL, 0);
+}
+
+static void thunk_set_style(gluniversal_t *arglist)
+{
+    glk_set_style(arglist[0].uint);
+}
+
+static void thunk_set_style_stream(gluniversal_t *arglist)
+{
+    glk_set_style_stream(arglist[0].opaqueref, arglist[1].uint);
+}
+
+static void thunk_get_char_stream(gluniversal_t *arglist)
+{
+    arglist[2].sint = glk_get_char_stream(arglist[0].opaqueref);
+}
+
+static void thunk_get_line_stream(gluniversal_t *arglist)
+{
+    if (arglist[1].ptrflag) 
+        arglist[5].uint = glk_get_line_stream(arglist[0].opaqueref, 
+            arglist[2].array, arglist[3].uint);
+    else
+        arglist[3].uint = glk_get_line_stream(arglist[0].opaqueref, 
+            NULL, 0);
+}
+
+static void thunk_get_buffer_stream(gluniversal_t *arglist)
+{
+    if (arglist[1].ptrflag) 
+        arglist[5].uint = glk_get_buffer_stream(arglist[0].opaqueref, 
+            arglist[2].array, arglist[3].uint);
+    else
+        arglist[3].uint = glk_get_buffer_stream(arglist[0].opaqueref, 
+            NULL, 0);
+}
+
+static void thunk_char_to_lower(gluniversal_t *arglist)
+{
+    arglist[2].uch = glk_char_to_lower(arglist[0].uch);
+}
+
+static void thunk_char_to_upper(gluniversal_t *arglist)
+{
+    arglist[2].uch = glk_char_to_upper(arglist[0].uch);
+}
+
+static void thunk_stylehint_set(gluniversal_t *arglist)
+{
+    glk_stylehint_set(arglist[0].uint, arglist[1].uint,
+        arglist[2].uint, arglist[3].sint);
+}
+
+static void thunk_stylehint_clear(gluniversal_t *arglist)
+{
+    glk_stylehint_clear(arglist[0].uint, arglist[1].uint,
+        arglist[2].uint);
+}
+
+static void thunk_style_distinguish(gluniversal_t *arglist)
+{
+    arglist[4].uint = glk_style_distinguish(arglist[0].opaqueref, arglist[1].uint,
+        arglist[2].uint);
+}
+
+static void thunk_style_measure(gluniversal_t *arglist)
+{
+    if (arglist[3].ptrflag)
+        arglist[6].uint = glk_style_measure(arglist[0].opaqueref, arglist[1].uint,
+            arglist[2].uint, &(arglist[4].uint));
+    else
+        arglist[5].uint = glk_style_measure(arglist[0].opaqueref, arglist[1].uint,
+            arglist[2].uint, NULL);
+}
+
+static void thunk_select(gluniversal_t *arglist)
+{
+    if (arglist[0].ptrflag) {
+        event_t dat;
+        glk_select(&dat);
+        arglist[1].uint = dat.type;
+        arglist[2].opaqueref = dat.win;
+        arglist[3].uint = dat.val1;
+        arglist[4].uint = dat.val2;
+    }
+    else {
+        glk_select(NULL);
+    }
+}
+
+static void thunk_select_poll(gluniversal_t *arglist)
+{
+    if (arglist[0].ptrflag) {
+        event_t dat;
+        glk_select_poll(&dat);
+        arglist[1].uint = dat.type;
+        arglist[2].opaqueref = dat.win;
+        arglist[3].uint = dat.val1;
+        arglist[4].uint = dat.val2;
+    }
+    else {
+        glk_select_poll(NULL);
+    }
+}
+
+static void thunk_request_line_event(gluniversal_t *arglist)
+{
+    if (arglist[1].ptrflag)
+        glk_request_line_event(arglist[0].opaqueref, arglist[2].array,
+            arglist[3].uint, arglist[4].uint);
+    else
+        glk_request_line_event(arglist[0].opaqueref, NULL,
+            0, arglist[2].uint);
+}
+
+static void thunk_cancel_line_event(gluniversal_t *arglist)
+{
+    if (arglist[1].ptrflag) {
+        event_t dat;
+        glk_cancel_line_event(arglist[0].opaqueref, &dat);
+        arglist[2].uint = dat.type;
+        arglist[3].opaqueref = dat.win;
+        arglist[4].uint = dat.val1;
+        arglist[5].uint = dat.val2;
+    }
+    else {
+        glk_cancel_line_event(arglist[0].opaqueref, NULL);
+    }
+}
+
+static void thunk_request_char_event(gluniversal_t *arglist)
+{
+    glk_request_char_event(arglist[0].opaqueref);
+}
+
+static void thunk_cancel_char_event(gluniversal_t *arglist)
+{
+    glk_cancel_char_event(arglist[0].opaqueref);
+}
+
+static void thunk_request_mouse_event(gluniversal_t *arglist)
+{
+    glk_request_mouse_event(arglist[0].opaqueref);
+}
+
+static void thunk_cancel_mouse_event(gluniversal_t *arglist)
+{
+    glk_cancel_mouse_event(arglist[0].opaqueref);
+}
+
+static void thunk_request_timer_events(gluniversal_t *arglist)
+{
+    glk_request_timer_events(arglist[0].uint);
+}
+
+#ifdef GLK_MODULE_IMAGE
+
+static void thunk_image_get_info(gluniversal_t *arglist)
+{
+    {
+        int ix = 1;
+        glui32 *ptr1, *ptr2;
+        if (!arglist[ix].ptrflag) {
+            ptr1 = NULL;
+        }
+        else {
+            ix++;
+            ptr1 = &(arglist[ix].uint);
+        }
+        ix++;
+        if (!arglist[ix].ptrflag) {
+            ptr2 = NULL;
+        }
+        else {
+            ix++;
+            ptr2 = &(arglist[ix].uint);
+        }
+        ix++;
+        ix++;
+        arglist[ix].uint = glk_image_get_info(arglist[0].uint, ptr1, ptr2);
+    }
+}
+
+static void thunk_image_draw(gluniversal_t *arglist)
+{
+    arglist[5].uint = glk_image_draw(arglist[0].opaqueref, 
+        arglist[1].uint,
+        arglist[2].sint, arglist[3].sint);
+}
+
+static void thunk_image_draw_scaled(gluniversal_t *arglist)
+{
+    arglist[7].uint = glk_image_draw_scaled(arglist[0].opaqueref, 
+        arglist[1].uint,
+        arglist[2].sint, arglist[3].sint,
+        arglist[4].uint, arglist[5].uint);
+}
+
+static void thunk_window_flow_break(gluniversal_t *arglist)
+{
+    glk_window_flow_break(arglist[0].opaqueref);
+}
+
+static void thunk_window_erase_rect(gluniversal_t *arglist)
+{
+    glk_window_erase_rect(arglist[0].opaqueref,
+        arglist[1].sint, arglist[2].sint,
+        arglist[3].uint, arglist[4].uint);
+}
+
+static void thunk_window_fill_rect(gluniversal_t *arglist)
+{
+    glk_window_fill_rect(arglist[0].opaqueref, arglist[1].uint,
+        arglist[2].sint, arglist[3].sint,
+        arglist[4].uint, arglist[5].uint);
+}
+
+static void thunk_window_set_background_color(gluniversal_t *arglist)
+{
+    glk_window_set_background_color(arglist[0].opaqueref, arglist[1].uint);
+}
+#endif /* GLK_MODULE_IMAGE */
+
+#ifdef GLK_MODULE_SOUND
+
+static void thunk_schannel_iterate(gluniversal_t *arglist)
+{
+    if (arglist[1].ptrflag) 
+        arglist[4].opaqueref = glk_schannel_iterate(arglist[0].opaqueref, &arglist[2].uint);
+    else
+        arglist[3].opaqueref = glk_schannel_iterate(arglist[0].opaqueref, NULL);
+}
+
+static void thunk_schannel_get_rock(gluniversal_t *arglist)
+{
+    arglist[2].uint = glk_schannel_get_rock(arglist[0].opaqueref);
+}
+
+static void thunk_schannel_create(gluniversal_t *arglist)
+{
+    arglist[2].opaqueref = glk_schannel_create(arglist[0].uint);
+}
+
+static void thunk_schannel_destroy(gluniversal_t *arglist)
+{
+    glk_schannel_destroy(arglist[0].opaqueref);
+}
+
+static void thunk_schannel_play(gluniversal_t *arglist)
+{
+    arglist[3].uint = glk_schannel_play(arglist[0].opaqueref, arglist[1].uint);
+}
+
+static void thunk_schannel_play_ext(gluniversal_t *arglist)
+{
+    arglist[5].uint = glk_schannel_play_ext(arglist[0].opaqueref, 
+        arglist[1].uint, arglist[2].uint, arglist[3].uint);
+}
+
+static void thunk_schannel_stop(gluniversal_t *arglist)
+{
+    glk_schannel_stop(arglist[0].opaqueref);
+}
+
+static void thunk_schannel_set_volume(gluniversal_t *arglist)
+{
+    glk_schannel_set_volume(arglist[0].opaqueref, arglist[1].uint);
+}
+
+static void thunk_sound_load_hint(gluniversal_t *arglist)
+{
+    glk_sound_load_hint(arglist[0].uint, arglist[1].uint);
+}
+
+#ifdef GLK_MODULE_SOUND2
+
+static void thunk_schannel_create_ext(gluniversal_t *arglist)
+{
+    arglist[3].opaqueref = glk_schannel_create_ext(arglist[0].uint, arglist[1].uint);
+}
+
+static void thunk_schannel_play_multi(gluniversal_t *arglist)
+{
+    if (arglist[0].ptrflag && arglist[3].ptrflag)
+        arglist[8].uint = glk_schannel_play_multi(arglist[1].array, arglist[2].uint, arglist[4].array, arglist[5].uint, arglist[6].uint);
+    else if (arglist[0].ptrflag)
+        arglist[6].uint = glk_schannel_play_multi(arglist[1].array, arglist[2].uint, NULL, 0, arglist[4].uint);
+    else if (arglist[1].ptrflag)
+        arglist[6].uint = glk_schannel_play_multi(NULL, 0, arglist[2].array, arglist[3].uint, arglist[4].uint);
+    else
+        arglist[4].uint = glk_schannel_play_multi(NULL, 0, NULL, 0, arglist[2].uint);
+}
+
+static void thunk_schannel_set_volume_ext(gluniversal_t *arglist)
+{
+    glk_schannel_set_volume_ext(arglist[0].opaqueref, arglist[1].uint, arglist[2].uint, arglist[3].uint);
+}
+
+static void thunk_schannel_pause(gluniversal_t *arglist)
+{
+    glk_schannel_pause(arglist[0].opaqueref);
+}
+
+static void thunk_schannel_unpause(gluniversal_t *arglist)
+{
+    glk_schannel_unpause(arglist[0].opaqueref);
+}
+#endif /* GLK_MODULE_SOUND2 */
+
+#endif /* GLK_MODULE_SOUND */
+
+#ifdef GLK_MODULE_HYPERLINKS
+
+static void thunk_set_hyperlink(gluniversal_t *arglist)
+{
+    glk_set_hyperlink(arglist[0].uint);
+}
+
+static void thunk_set_hyperlink_stream(gluniversal_t *arglist)
+{
+    glk_set_hyperlink_stream(arglist[0].opaqueref, arglist[1].uint);
+}
+
+static void thunk_request_hyperlink_event(gluniversal_t *arglist)
+{
+    glk_request_hyperlink_event(arglist[0].opaqueref);
+}
+
+static void thunk_cancel_hyperlink_event(gluniversal_t *arglist)
+{
+    glk_cancel_hyperlink_event(arglist[0].opaqueref);
+}
+#endif /* GLK_MODULE_HYPERLINKS */
+
+#ifdef GLK_MODULE_UNICODE
+
+static void thunk_buffer_to_lower_case_uni(gluniversal_t *arglist)
+{
+    if (arglist[0].ptrflag) 
+        arglist[5].uint = glk_buffer_to_lower_case_uni(arglist[1].array, arglist[2].uint, arglist[3].uint);
+    else
+        arglist[3].uint = glk_buffer_to_lower_case_uni(NULL, 0, arglist[1].uint);
+}
+
+static void thunk_buffer_to_upper_case_uni(gluniversal_t *arglist)
+{
+    if (arglist[0].ptrflag) 
+        arglist[5].uint = glk_buffer_to_upper_case_uni(arglist[1].array, arglist[2].uint, arglist[3].uint);
+    else
+        arglist[3].uint = glk_buffer_to_upper_case_uni(NULL, 0, arglist[1].uint);
+}
+
+static void thunk_buffer_to_title_case_uni(gluniversal_t *arglist)
+{
+    if (arglist[0].ptrflag) 
+        arglist[6].uint = glk_buffer_to_title_case_uni(arglist[1].array, arglist[2].uint, arglist[3].uint, arglist[4].uint);
+    else
+        arglist[4].uint = glk_buffer_to_title_case_uni(NULL, 0, arglist[1].uint, arglist[2].uint);
+}
+
+static void thunk_put_char_uni(gluniversal_t *arglist)
+{
+    glk_put_char_uni(arglist[0].uint);
+}
+
+static void thunk_put_string_uni(gluniversal_t *arglist)
+{
+    glk_put_string_uni(arglist[0].unicharstr);
+}
+
+static void thunk_put_buffer_uni(gluniversal_t *arglist)
+{
+    if (arglist[0].ptrflag) 
+        glk_put_buffer_uni(arglist[1].array, arglist[2].uint);
+    else
+        glk_put_buffer_uni(NULL, 0);
+}
+
+static void thunk_put_char_stream_uni(gluniversal_t *arglist)
+{
+    glk_put_char_stream_uni(arglist[0].opaqueref, arglist[1].uint);
+}
+
+static void thunk_put_string_stream_uni(gluniversal_t *arglist)
+{
+    glk_put_string_stream_uni(arglist[0].opaqueref, arglist[1].unicharstr);
+}
+
+static void thunk_put_buffer_stream_uni(gluniversal_t *arglist)
+{
+    if (arglist[1].ptrflag) 
+        glk_put_buffer_stream_uni(arglist[0].opaqueref, 
+            arglist[2].array, arglist[3].uint);
+    else
+        glk_put_buffer_stream_uni(arglist[0].opaqueref, 
+            NULL, 0);
+}
+
+static void thunk_get_char_stream_uni(gluniversal_t *arglist)
+{
+    arglist[2].sint = glk_get_char_stream_uni(arglist[0].opaqueref);
+}
+
+static void thunk_get_buffer_stream_uni(gluniversal_t *arglist)
+{
+    if (arglist[1].ptrflag) 
+        arglist[5].uint = glk_get_buffer_stream_uni(arglist[0].opaqueref, 
+            arglist[2].array, arglist[3].uint);
+    else
+        arglist[3].uint = glk_get_buffer_stream_uni(arglist[0].opaqueref, 
+            NULL, 0);
+}
+
+static void thunk_get_line_stream_uni(gluniversal_t *arglist)
+{
+    if (arglist[1].ptrflag) 
+        arglist[5].uint = glk_get_line_stream_uni(arglist[0].opaqueref, 
+            arglist[2].array, arglist[3].uint);
+    else
+        arglist[3].uint = glk_get_line_stream_uni(arglist[0].opaqueref, 
+            NULL, 0);
+}
+
+static void thunk_stream_open_file_uni(gluniversal_t *arglist)
+{
+    arglist[4].opaqueref = glk_stream_open_file_uni(arglist[0].opaqueref, arglist[1].uint, 
+        arglist[2].uint);
+}
+
+static void thunk_stream_open_memory_uni(gluniversal_t *arglist)
+{
+    if (arglist[0].ptrflag) 
+        arglist[6].opaqueref = glk_stream_open_memory_uni(arglist[1].array, 
+            arglist[2].uint, arglist[3].uint, arglist[4].uint);
+    else
+        arglist[4].opaqueref = glk_stream_open_memory_uni(NULL, 
+            0, arglist[1].uint, arglist[2].uint);
+}
+
+static void thunk_request_char_event_uni(gluniversal_t *arglist)
+{
+    glk_request_char_event_uni(arglist[0].opaqueref);
+}
+
+static void thunk_request_line_event_uni(gluniversal_t *arglist)
+{
+    if (arglist[1].ptrflag)
+        glk_request_line_event_uni(arglist[0].opaqueref, arglist[2].array,
+            arglist[3].uint, arglist[4].uint);
+    else
+        glk_request_line_event_uni(arglist[0].opaqueref, NULL,
+            0, arglist[2].uint);
+}
 #endif /* GLK_MODULE_UNICODE */
 
 #ifdef GLK_MODULE_UNICODE_NORM
-        case 0x0123: /* buffer_canon_decompose_uni */
-            if (arglist[0].ptrflag) 
-                arglist[5].uint = glk_buffer_canon_decompose_uni(arglist[1].array, arglist[2].uint, arglist[3].uint);
-            else
-                arglist[3].uint = glk_buffer_canon_decompose_uni(NULL, 0, arglist[1].uint);
-            break;
-        case 0x0124: /* buffer_canon_normalize_uni */
-            if (arglist[0].ptrflag) 
-                arglist[5].uint = glk_buffer_canon_normalize_uni(arglist[1].array, arglist[2].uint, arglist[3].uint);
-            else
-                arglist[3].uint = glk_buffer_canon_normalize_uni(NULL, 0, arglist[1].uint);
-            break;
+
+static void thunk_buffer_canon_decompose_uni(gluniversal_t *arglist)
+{
+    if (arglist[0].ptrflag) 
+        arglist[5].uint = glk_buffer_canon_decompose_uni(arglist[1].array, arglist[2].uint, arglist[3].uint);
+    else
+        arglist[3].uint = glk_buffer_canon_decompose_uni(NULL, 0, arglist[1].uint);
+}
+
+static void thunk_buffer_canon_normalize_uni(gluniversal_t *arglist)
+{
+    if (arglist[0].ptrflag) 
+        arglist[5].uint = glk_buffer_canon_normalize_uni(arglist[1].array, arglist[2].uint, arglist[3].uint);
+    else
+        arglist[3].uint = glk_buffer_canon_normalize_uni(NULL, 0, arglist[1].uint);
+}
 #endif /* GLK_MODULE_UNICODE_NORM */
-            
+
 #ifdef GLK_MODULE_LINE_ECHO
-        case 0x0150: /* set_echo_line_event */
-            glk_set_echo_line_event(arglist[0].opaqueref, arglist[1].uint);
-            break;
+
+static void thunk_set_echo_line_event(gluniversal_t *arglist)
+{
+    glk_set_echo_line_event(arglist[0].opaqueref, arglist[1].uint);
+}
 #endif /* GLK_MODULE_LINE_ECHO */
 
 #ifdef GLK_MODULE_LINE_TERMINATORS
-        case 0x0151: /* set_terminators_line_event */
-            if (arglist[1].ptrflag) 
-                glk_set_terminators_line_event(arglist[0].opaqueref, 
-                    arglist[2].array, arglist[3].uint);
-            else
-                glk_set_terminators_line_event(arglist[0].opaqueref, 
-                    NULL, 0);
-            break;
+
+static void thunk_set_terminators_line_event(gluniversal_t *arglist)
+{
+    if (arglist[1].ptrflag) 
+        glk_set_terminators_line_event(arglist[0].opaqueref, 
+            arglist[2].array, arglist[3].uint);
+    else
+        glk_set_terminators_line_event(arglist[0].opaqueref, 
+            NULL, 0);
+}
 #endif /* GLK_MODULE_LINE_TERMINATORS */
-            
+
 #ifdef GLK_MODULE_DATETIME
-        case 0x0160: /* current_time */
-            if (arglist[0].ptrflag) {
-                glktimeval_t dat;
-                glk_current_time(&dat);
-                arglist[1].sint = dat.high_sec;
-                arglist[2].uint = dat.low_sec;
-                arglist[3].sint = dat.microsec;
-            }
-            else {
-                glk_current_time(NULL);
-            }
-            break;
-        case 0x0161: /* current_simple_time */
-            arglist[2].sint = glk_current_simple_time(arglist[0].uint);
-            break;
-        case 0x0168: /* time_to_date_utc */ {
-            glktimeval_t timeval;
-            glktimeval_t *timeptr = NULL;
-            glkdate_t date;
-            glkdate_t *dateptr = NULL;
-            int ix = 0;
-            if (arglist[ix++].ptrflag) {
-                timeptr = &timeval;
-                timeval.high_sec = arglist[ix++].sint;
-                timeval.low_sec = arglist[ix++].uint;
-                timeval.microsec = arglist[ix++].sint;
-            }
-            if (arglist[ix++].ptrflag) {
-                dateptr = &date;
-            }
-            glk_time_to_date_utc(timeptr, dateptr);
-            if (dateptr) {
-                arglist[ix++].sint = date.year;
-                arglist[ix++].sint = date.month;
-                arglist[ix++].sint = date.day;
-                arglist[ix++].sint = date.weekday;
-                arglist[ix++].sint = date.hour;
-                arglist[ix++].sint = date.minute;
-                arglist[ix++].sint = date.second;
-                arglist[ix++].sint = date.microsec;
-            }
-            }
-            break;
-        case 0x0169: /* time_to_date_local */ {
-            glktimeval_t timeval;
-            glktimeval_t *timeptr = NULL;
-            glkdate_t date;
-            glkdate_t *dateptr = NULL;
-            int ix = 0;
-            if (arglist[ix++].ptrflag) {
-                timeptr = &timeval;
-                timeval.high_sec = arglist[ix++].sint;
-                timeval.low_sec = arglist[ix++].uint;
-                timeval.microsec = arglist[ix++].sint;
-            }
-            if (arglist[ix++].ptrflag) {
-                dateptr = &date;
-            }
-            glk_time_to_date_local(timeptr, dateptr);
-            if (dateptr) {
-                arglist[ix++].sint = date.year;
-                arglist[ix++].sint = date.month;
-                arglist[ix++].sint = date.day;
-                arglist[ix++].sint = date.weekday;
-                arglist[ix++].sint = date.hour;
-                arglist[ix++].sint = date.minute;
-                arglist[ix++].sint = date.second;
-                arglist[ix++].sint = date.microsec;
-            }
-            }
-            break;
-        case 0x016A: /* simple_time_to_date_utc */ {
-            glkdate_t date;
-            glkdate_t *dateptr = NULL;
-            int ix = 2;
-            if (arglist[ix++].ptrflag) {
-                dateptr = &date;
-            }
-            glk_simple_time_to_date_utc(arglist[0].sint, arglist[1].uint, dateptr);
-            if (dateptr) {
-                arglist[ix++].sint = date.year;
-                arglist[ix++].sint = date.month;
-                arglist[ix++].sint = date.day;
-                arglist[ix++].sint = date.weekday;
-                arglist[ix++].sint = date.hour;
-                arglist[ix++].sint = date.minute;
-                arglist[ix++].sint = date.second;
-                arglist[ix++].sint = date.microsec;
-            }
-            }
-            break;
-        case 0x016B: /* simple_time_to_date_local */ {
-            glkdate_t date;
-            glkdate_t *dateptr = NULL;
-            int ix = 2;
-            if (arglist[ix++].ptrflag) {
-                dateptr = &date;
-            }
-            glk_simple_time_to_date_local(arglist[0].sint, arglist[1].uint, dateptr);
-            if (dateptr) {
-                arglist[ix++].sint = date.year;
-                arglist[ix++].sint = date.month;
-                arglist[ix++].sint = date.day;
-                arglist[ix++].sint = date.weekday;
-                arglist[ix++].sint = date.hour;
-                arglist[ix++].sint = date.minute;
-                arglist[ix++].sint = date.second;
-                arglist[ix++].sint = date.microsec;
-            }
-            }
-            break;
-        case 0x016C: /* date_to_time_utc */ {
-            glkdate_t date;
-            glkdate_t *dateptr = NULL;
-            glktimeval_t timeval;
-            glktimeval_t *timeptr = NULL;
-            int ix = 0;
-            if (arglist[ix++].ptrflag) {
-                dateptr = &date;
-                date.year = arglist[ix++].sint;
-                date.month = arglist[ix++].sint;
-                date.day = arglist[ix++].sint;
-                date.weekday = arglist[ix++].sint;
-                date.hour = arglist[ix++].sint;
-                date.minute = arglist[ix++].sint;
-                date.second = arglist[ix++].sint;
-                date.microsec = arglist[ix++].sint;
-            }
-            if (arglist[ix++].ptrflag) {
-                timeptr = &timeval;
-            }
-            glk_date_to_time_utc(dateptr, timeptr);
-            if (timeptr) {
-                arglist[ix++].sint = timeval.high_sec;
-                arglist[ix++].uint = timeval.low_sec;
-                arglist[ix++].sint = timeval.microsec;
-            }
-            }
-            break;
-        case 0x016D: /* date_to_time_local */ {
-            glkdate_t date;
-            glkdate_t *dateptr = NULL;
-            glktimeval_t timeval;
-            glktimeval_t *timeptr = NULL;
-            int ix = 0;
-            if (arglist[ix++].ptrflag) {
-                dateptr = &date;
-                date.year = arglist[ix++].sint;
-                date.month = arglist[ix++].sint;
-                date.day = arglist[ix++].sint;
-                date.weekday = arglist[ix++].sint;
-                date.hour = arglist[ix++].sint;
-                date.minute = arglist[ix++].sint;
-                date.second = arglist[ix++].sint;
-                date.microsec = arglist[ix++].sint;
-            }
-            if (arglist[ix++].ptrflag) {
-                timeptr = &timeval;
-            }
-            glk_date_to_time_local(dateptr, timeptr);
-            if (timeptr) {
-                arglist[ix++].sint = timeval.high_sec;
-                arglist[ix++].uint = timeval.low_sec;
-                arglist[ix++].sint = timeval.microsec;
-            }
-            }
+
+static void thunk_current_time(gluniversal_t *arglist)
+{
+    if (arglist[0].ptrflag) {
+        glktimeval_t dat;
+        glk_current_time(&dat);
+        arglist[1].sint = dat.high_sec;
+        arglist[2].uint = dat.low_sec;
+        arglist[3].sint = dat.microsec;
+    }
+    else {
+        glk_current_time(NULL);
+    }
+}
+
+static void thunk_current_simple_time(gluniversal_t *arglist)
+{
+    arglist[2].sint = glk_current_simple_time(arglist[0].uint);
+}
+
+static void thunk_time_to_date_utc(gluniversal_t *arglist)
+{
+    glktimeval_t timeval;
+    glktimeval_t *timeptr = NULL;
+    glkdate_t date;
+    glkdate_t *dateptr = NULL;
+    int ix = 0;
+    if (arglist[ix++].ptrflag) {
+        timeptr = &timeval;
+        timeval.high_sec = arglist[ix++].sint;
+        timeval.low_sec = arglist[ix++].uint;
+        timeval.microsec = arglist[ix++].sint;
+    }
+    if (arglist[ix++].ptrflag) {
+        dateptr = &date;
+    }
+    glk_time_to_date_utc(timeptr, dateptr);
+    if (dateptr) {
+        arglist[ix++].sint = date.year;
+        arglist[ix++].sint = date.month;
+        arglist[ix++].sint = date.day;
+        arglist[ix++].sint = date.weekday;
+        arglist[ix++].sint = date.hour;
+        arglist[ix++].sint = date.minute;
+        arglist[ix++].sint = date.second;
+        arglist[ix++].sint = date.microsec;
+    }
+}
+
+static void thunk_time_to_date_local(gluniversal_t *arglist)
+{
+    glktimeval_t timeval;
+    glktimeval_t *timeptr = NULL;
+    glkdate_t date;
+    glkdate_t *dateptr = NULL;
+    int ix = 0;
+    if (arglist[ix++].ptrflag) {
+        timeptr = &timeval;
+        timeval.high_sec = arglist[ix++].sint;
+        timeval.low_sec = arglist[ix++].uint;
+        timeval.microsec = arglist[ix++].sint;
+    }
+    if (arglist[ix++].ptrflag) {
+        dateptr = &date;
+    }
+    glk_time_to_date_local(timeptr, dateptr);
+    if (dateptr) {
+        arglist[ix++].sint = date.year;
+        arglist[ix++].sint = date.month;
+        arglist[ix++].sint = date.day;
+        arglist[ix++].sint = date.weekday;
+        arglist[ix++].sint = date.hour;
+        arglist[ix++].sint = date.minute;
+        arglist[ix++].sint = date.second;
+        arglist[ix++].sint = date.microsec;
+    }
+}
+
+static void thunk_simple_time_to_date_utc(gluniversal_t *arglist)
+{
+    glkdate_t date;
+    glkdate_t *dateptr = NULL;
+    int ix = 2;
+    if (arglist[ix++].ptrflag) {
+        dateptr = &date;
+    }
+    glk_simple_time_to_date_utc(arglist[0].sint, arglist[1].uint, dateptr);
+    if (dateptr) {
+        arglist[ix++].sint = date.year;
+        arglist[ix++].sint = date.month;
+        arglist[ix++].sint = date.day;
+        arglist[ix++].sint = date.weekday;
+        arglist[ix++].sint = date.hour;
+        arglist[ix++].sint = date.minute;
+        arglist[ix++].sint = date.second;
+        arglist[ix++].sint = date.microsec;
+    }
+}
+
+static void thunk_simple_time_to_date_local(gluniversal_t *arglist)
+{
+    glkdate_t date;
+    glkdate_t *dateptr = NULL;
+    int ix = 2;
+    if (arglist[ix++].ptrflag) {
+        dateptr = &date;
+    }
+    glk_simple_time_to_date_local(arglist[0].sint, arglist[1].uint, dateptr);
+    if (dateptr) {
+        arglist[ix++].sint = date.year;
+        arglist[ix++].sint = date.month;
+        arglist[ix++].sint = date.day;
+        arglist[ix++].sint = date.weekday;
+        arglist[ix++].sint = date.hour;
+        arglist[ix++].sint = date.minute;
+        arglist[ix++].sint = date.second;
+        arglist[ix++].sint = date.microsec;
+    }
+}
+
+static void thunk_date_to_time_utc(gluniversal_t *arglist)
+{
+    glkdate_t date;
+    glkdate_t *dateptr = NULL;
+    glktimeval_t timeval;
+    glktimeval_t *timeptr = NULL;
+    int ix = 0;
+    if (arglist[ix++].ptrflag) {
+        dateptr = &date;
+        date.year = arglist[ix++].sint;
+        date.month = arglist[ix++].sint;
+        date.day = arglist[ix++].sint;
+        date.weekday = arglist[ix++].sint;
+        date.hour = arglist[ix++].sint;
+        date.minute = arglist[ix++].sint;
+        date.second = arglist[ix++].sint;
+        date.microsec = arglist[ix++].sint;
+    }
+    if (arglist[ix++].ptrflag) {
+        timeptr = &timeval;
+    }
+    glk_date_to_time_utc(dateptr, timeptr);
+    if (timeptr) {
+        arglist[ix++].sint = timeval.high_sec;
+        arglist[ix++].uint = timeval.low_sec;
+        arglist[ix++].sint = timeval.microsec;
+    }
+}
+
+static void thunk_date_to_time_local(gluniversal_t *arglist)
+{
+    glkdate_t date;
+    glkdate_t *dateptr = NULL;
+    glktimeval_t timeval;
+    glktimeval_t *timeptr = NULL;
+    int ix = 0;
+    if (arglist[ix++].ptrflag) {
+        dateptr = &date;
+        date.year = arglist[ix++].sint;
+        date.month = arglist[ix++].sint;
+        date.day = arglist[ix++].sint;
+        date.weekday = arglist[ix++].sint;
+        date.hour = arglist[ix++].sint;
+        date.minute = arglist[ix++].sint;
+        date.second = arglist[ix++].sint;
+        date.microsec = arglist[ix++].sint;
+    }
+    if (arglist[ix++].ptrflag) {
+        timeptr = &timeval;
+    }
+    glk_date_to_time_local(dateptr, timeptr);
+    if (timeptr) {
+        arglist[ix++].sint = timeval.high_sec;
+        arglist[ix++].uint = timeval.low_sec;
+        arglist[ix++].sint = timeval.microsec;
+    }
+}
+
+static void thunk_date_to_simple_time_utc(gluniversal_t *arglist)
+{
+    glkdate_t date;
+    glkdate_t *dateptr = NULL;
+    int ix = 0;
+    if (arglist[ix++].ptrflag) {
+        dateptr = &date;
+        date.year = arglist[ix++].sint;
+        date.month = arglist[ix++].sint;
+        date.day = arglist[ix++].sint;
+        date.weekday = arglist[ix++].sint;
+        date.hour = arglist[ix++].sint;
+        date.minute = arglist[ix++].sint;
+        date.second = arglist[ix++].sint;
+        date.microsec = arglist[ix++].sint;
+    }
+    arglist[ix+2].sint = glk_date_to_simple_time_utc(dateptr, arglist[ix].uint);
+}
+
+static void thunk_date_to_simple_time_local(gluniversal_t *arglist)
+{
+    glkdate_t date;
+    glkdate_t *dateptr = NULL;
+    int ix = 0;
+    if (arglist[ix++].ptrflag) {
+        dateptr = &date;
+        date.year = arglist[ix++].sint;
+        date.month = arglist[ix++].sint;
+        date.day = arglist[ix++].sint;
+        date.weekday = arglist[ix++].sint;
+        date.hour = arglist[ix++].sint;
+        date.minute = arglist[ix++].sint;
+        date.second = arglist[ix++].sint;
+        date.microsec = arglist[ix++].sint;
+    }
+    arglist[ix+2].sint = glk_date_to_simple_time_local(dateptr, arglist[ix].uint);
+}
+#endif /* GLK_MODULE_DATETIME */
+
+typedef struct function_index_struct {
+    gidispatch_function_t *func;
+    char *prototype;
+    gidispatch_thunk_t thunk;
+} function_index_t;
+
+/* A dense table, indexed directly by function id, so that looking up a
+    function, its prototype, or its thunk is a single array load. Ids
+    which aren't in use are all zero. This is filled in at compile time. */
+#define FUNCTION_INDEX_ENTRY(id, name, proto)  \
+    [id] = { &(function_table[funcpos_##name]), proto, thunk_##name },
+static function_index_t function_index[FUNCTION_ID_LIMIT] = {
+    GIDISPATCH_FUNCTIONS(FUNCTION_INDEX_ENTRY)
+};
+
+glui32 gidispatch_count_classes()
+{
+    return NUMCLASSES;
+}
+
+gidispatch_intconst_t *gidispatch_get_class(glui32 index)
+{
+    // XCode: removed "index < 0" test to shut up compiler warning
+    if (index >= NUMCLASSES)
+        return NULL;
+    return &(class_table[index]);
+}
+
+glui32 gidispatch_count_intconst()
+{
+    return NUMINTCONSTANTS;
+}
+
+gidispatch_intconst_t *gidispatch_get_intconst(glui32 index)
+{
+    // XCode: removed "index < 0" test to shut up compiler warning
+    if (index >= NUMINTCONSTANTS)
+        return NULL;
+    return &(intconstant_table[index]);
+}
+
+glui32 gidispatch_count_functions()
+{
+    return NUMFUNCTIONS;
+}
+
+gidispatch_function_t *gidispatch_get_function(glui32 index)
+{
+    // XCode: removed "index < 0" test to shut up compiler warning
+    if (index >= NUMFUNCTIONS)
+        return NULL;
+    return &(function_table[index]);
+}
+
+gidispatch_function_t *gidispatch_get_function_by_id(glui32 id)
+{
+    if (id >= FUNCTION_ID_LIMIT)
+        return NULL;
+    return function_index[id].func;
+}
+
+char *gidispatch_prototype(glui32 funcnum)
+{
+    if (funcnum < FUNCTION_ID_LIMIT && function_index[funcnum].prototype)
+        return function_index[funcnum].prototype;
+
+#ifdef GLK_EXTEND_PROTOTYPE
+    switch (funcnum) {
+        GLK_EXTEND_PROTOTYPE
+        default:
             break;
-        case 0x016E: /* date_to_simple_time_utc */ {
-            glkdate_t date;
-            glkdate_t *dateptr = NULL;
-            int ix = 0;
-            if (arglist[ix++].ptrflag) {
-                dateptr = &date;
-                date.year = arglist[ix++].sint;
-                date.month = arglist[ix++].sint;
-                date.day = arglist[ix++].sint;
-                date.weekday = arglist[ix++].sint;
-                date.hour = arglist[ix++].sint;
-                date.minute = arglist[ix++].sint;
-                date.second = arglist[ix++].sint;
-                date.microsec = arglist[ix++].sint;
-            }
-            arglist[ix+2].sint = glk_date_to_simple_time_utc(dateptr, arglist[ix].uint);
+    }
+#endif /* GLK_EXTEND_PROTOTYPE */
+
+    return NULL;
+}
+
+static char *parse_simple_type(char *cx, char *typeclass, char *subtype)
+{
+    switch (*cx) {
+        case 'I':
+        case 'C':
+        case 'Q':
+            if (!cx[1])
+                return NULL;
+            *typeclass = cx[0];
+            *subtype = cx[1];
+            return cx+2;
+        case 'S':
+        case 'U':
+            *typeclass = cx[0];
+            *subtype = 0;
+            return cx+1;
+        default:
+            return NULL;
+    }
+}
+
+int gidispatch_parse_prototype(char *proto, gidispatch_protodesc_t *desc)
+{
+    char *cx = proto;
+    int count = 0;
+    int inreturn = 0;
+    int simple = 1;
+    int slots = 0;
+
+    memset(desc, 0, sizeof(gidispatch_protodesc_t));
+    desc->prototype = proto;
+
+    while (*cx >= '0' && *cx <= '9')
+        cx++;
+
+    while (*cx) {
+        gidispatch_argdesc_t *arg;
+        char subtype;
+
+        if (*cx == ':') {
+            cx++;
+            inreturn = 1;
+            if (!*cx)
+                break;
+        }
+
+        if (count >= GIDISPATCH_MAX_ARGS)
+            return 0;
+        arg = &desc->args[count];
+
+        if (inreturn)
+            arg->flags |= (gidispatch_arg_Ref | gidispatch_arg_PassOut
+                | gidispatch_arg_Return);
+
+        if (*cx == '&') {
+            arg->flags |= (gidispatch_arg_Ref | gidispatch_arg_PassIn
+                | gidispatch_arg_PassOut);
+            cx++;
+        }
+        else if (*cx == '<') {
+            arg->flags |= (gidispatch_arg_Ref | gidispatch_arg_PassOut);
+            cx++;
+        }
+        else if (*cx == '>') {
+            arg->flags |= (gidispatch_arg_Ref | gidispatch_arg_PassIn);
+            cx++;
+        }
+
+        if (*cx == '+') {
+            arg->flags |= gidispatch_arg_NonNull;
+            cx++;
+        }
+
+        if (*cx == '#') {
+            arg->flags |= gidispatch_arg_Array;
+            cx++;
+            if (*cx == '!') {
+                arg->flags |= gidispatch_arg_Retained;
+                cx++;
             }
-            break;
-        case 0x016F: /* date_to_simple_time_local */ {
-            glkdate_t date;
-            glkdate_t *dateptr = NULL;
-            int ix = 0;
-            if (arglist[ix++].ptrflag) {
-                dateptr = &date;
-                date.year = arglist[ix++].sint;
-                date.month = arglist[ix++].sint;
-                date.day = arglist[ix++].sint;
-                date.weekday = arglist[ix++].sint;
-                date.hour = arglist[ix++].sint;
-                date.minute = arglist[ix++].sint;
-                date.second = arglist[ix++].sint;
-                date.microsec = arglist[ix++].sint;
+        }
+
+        if (*cx == '[') {
+            int ix, numfields = 0;
+            cx++;
+            arg->typeclass = '[';
+            while (*cx >= '0' && *cx <= '9') {
+                numfields = numfields * 10 + (*cx - '0');
+                cx++;
             }
-            arglist[ix+2].sint = glk_date_to_simple_time_local(dateptr, arglist[ix].uint);
+            if (numfields > GIDISPATCH_MAX_FIELDS)
+                return 0;
+            arg->numfields = numfields;
+            for (ix=0; ix<numfields; ix++) {
+                cx = parse_simple_type(cx, &arg->fieldclass[ix], &subtype);
+                if (!cx)
+                    return 0;
             }
-            break;
-#endif /* GLK_MODULE_DATETIME */
+            if (*cx != ']')
+                return 0;
+            cx++;
+        }
+        else {
+            cx = parse_simple_type(cx, &arg->typeclass, &arg->subtype);
+            if (!cx)
+                return 0;
+        }
+
+        if (arg->flags & gidispatch_arg_Ref) {
+            if (arg->flags & gidispatch_arg_Array)
+                arg->refslots = 2;
+            else if (arg->typeclass == '[')
+                arg->refslots = arg->numfields;
+            else
+                arg->refslots = 1;
+            slots += 1 + arg->refslots;
+            if (!(arg->flags & gidispatch_arg_Return))
+                simple = 0;
+        }
+        else {
+            slots += 1;
+            if (arg->typeclass != 'I' && arg->typeclass != 'C'
+                && arg->typeclass != 'Q')
+                simple = 0;
+        }
+        if (arg->flags & gidispatch_arg_Return)
+            desc->hasreturn = 1;
+
+        count++;
+    }
+
+    desc->numargs = count;
+    desc->maxslots = slots;
+    desc->simple = simple;
+    return 1;
+}
+
+/* Descriptors for the functions in function_table, by position. Each is
+    parsed on first use. */
+static gidispatch_protodesc_t protodesc_table[funcpos_Limit];
+static char protodesc_state[funcpos_Limit]; /* 0: unparsed, 1: ok, 2: bad */
+
+gidispatch_protodesc_t *gidispatch_get_protodesc(glui32 id)
+{
+    function_index_t *entry;
+    gidispatch_protodesc_t *desc;
+    int pos;
+
+    if (id >= FUNCTION_ID_LIMIT)
+        return NULL;
+    entry = &(function_index[id]);
+    if (!entry->func || !entry->prototype)
+        return NULL;
+
+    pos = entry->func - function_table;
+    desc = &(protodesc_table[pos]);
+    if (protodesc_state[pos] == 0) {
+        if (gidispatch_parse_prototype(entry->prototype, desc)) {
+            desc->id = id;
+            desc->thunk = entry->thunk;
+            protodesc_state[pos] = 1;
+        }
+        else {
+            protodesc_state[pos] = 2;
+        }
+    }
+    if (protodesc_state[pos] != 1)
+        return NULL;
+    return desc;
+}
+
+#ifdef GIDISPATCH_TRACE
+
+/* The tracer is called twice for each dispatched call: once before the
+    function runs (done is 0), and once after it returns (done is 1). If
+    the function never returns (glk_exit), the second call never happens. */
+static void (*call_tracer)(glui32 funcnum, glui32 numargs,
+    gluniversal_t *arglist, int done) = NULL;
+
+void gidispatch_set_call_tracer(void (*tracefunc)(glui32 funcnum,
+    glui32 numargs, gluniversal_t *arglist, int done))
+{
+    call_tracer = tracefunc;
+}
 
+#endif /* GIDISPATCH_TRACE */
+
+void gidispatch_call(glui32 funcnum, glui32 numargs, gluniversal_t *arglist)
+{
+#ifdef GIDISPATCH_TRACE
+    if (call_tracer)
+        call_tracer(funcnum, numargs, arglist, 0);
+#endif /* GIDISPATCH_TRACE */
+
+    if (funcnum < FUNCTION_ID_LIMIT && function_index[funcnum].thunk) {
+        function_index[funcnum].thunk(arglist);
+    }
 #ifdef GLK_EXTEND_CALL
-        GLK_EXTEND_CALL
+    else {
+        switch (funcnum) {
+            GLK_EXTEND_CALL
+
+            default:
+                /* do nothing */
+                break;
+        }
+    }
 #endif /* GLK_EXTEND_CALL */
 
-        default:
-            /* do nothing */
-            break;
+#ifdef GIDISPATCH_TRACE
+    if (call_tracer)
+        call_tracer(funcnum, numargs, arglist, 1);
+#endif /* GIDISPATCH_TRACE */
+}
+
+void gidispatch_call_desc(gidispatch_protodesc_t *desc, glui32 numargs,
+    gluniversal_t *arglist)
+{
+    if (!desc->thunk) {
+        /* Not a descriptor from gidispatch_get_protodesc(). */
+        gidispatch_call(desc->id, numargs, arglist);
+        return;
     }
+
+#ifdef GIDISPATCH_TRACE
+    if (call_tracer)
+        call_tracer(desc->id, numargs, arglist, 0);
+#endif /* GIDISPATCH_TRACE */
+
+    desc->thunk(arglist);
+
+#ifdef GIDISPATCH_TRACE
+    if (call_tracer)
+        call_tracer(desc->id, numargs, arglist, 1);
+#endif /* GIDISPATCH_TRACE */
 }
 
@@ -49,6 +49,47 @@ typedef struct gidispatch_function_struct {
     char *name;
 } gidispatch_function_t;
 
+/* A prototype string, parsed. (See gidispatch_get_protodesc().) The
+    flags say what kind of argument this is: */
+#define gidispatch_arg_Ref (0x01)      /* &, <, >, or the return value */
+#define gidispatch_arg_PassIn (0x02)   /* & or > */
+#define gidispatch_arg_PassOut (0x04)  /* &, <, or the return value */
+#define gidispatch_arg_NonNull (0x08)  /* + */
+#define gidispatch_arg_Array (0x10)    /* # */
+#define gidispatch_arg_Retained (0x20) /* #! */
+#define gidispatch_arg_Return (0x40)   /* after the colon */
+
+#define GIDISPATCH_MAX_ARGS (12)
+#define GIDISPATCH_MAX_FIELDS (8)
+
+typedef struct gidispatch_argdesc_struct {
+    char typeclass; /* 'I', 'C', 'Q', 'S', 'U', or '[' for a struct */
+    char subtype; /* 'u', 's', 'n'; or the class letter for 'Q' */
+    unsigned char flags;
+    unsigned char refslots; /* slots after the ptrflag, if this is a
+        reference and the ptrflag is set */
+    unsigned char numfields; /* for '[' */
+    char fieldclass[GIDISPATCH_MAX_FIELDS];
+} gidispatch_argdesc_t;
+
+/* A thunk calls one Glk function, taking its arguments from the arglist
+    and storing its results there. It bypasses the call tracer, so it's
+    for the dispatch layer's own use; to make a call with a descriptor,
+    use gidispatch_call_desc(). */
+typedef void (*gidispatch_thunk_t)(gluniversal_t *arglist);
+
+typedef struct gidispatch_protodesc_struct {
+    glui32 id;
+    char *prototype;
+    gidispatch_thunk_t thunk;
+    int numargs; /* including the return value, if any */
+    int maxslots; /* arglist slots used if every ptrflag is set */
+    int hasreturn;
+    int simple; /* every argument but the return value is a plain
+        I, C, or Q value, so arglist[ix] is argument ix */
+    gidispatch_argdesc_t args[GIDISPATCH_MAX_ARGS];
+} gidispatch_protodesc_t;
+
 typedef struct gidispatch_intconst_struct {
     char *name;
     glui32 val;
@@ -99,4 +140,28 @@ extern glui32 gidispatch_count_functions(void);
 extern gidispatch_function_t *gidispatch_get_function(glui32 index);
 extern gidispatch_function_t *gidispatch_get_function_by_id(glui32 id);
 
+/* Rather than parsing gidispatch_prototype() on every call, an
+    interpreter can fetch the parsed descriptor once. Descriptors are
+    built on first use and never freed; this returns NULL if the
+    function is unknown or has no prototype. */
+extern gidispatch_protodesc_t *gidispatch_get_protodesc(glui32 id);
+/* Parse any prototype string into a descriptor. Returns 1 on success,
+    or 0 if the prototype is not understood. The id and thunk are left
+    zero. */
+extern int gidispatch_parse_prototype(char *proto,
+    gidispatch_protodesc_t *desc);
+/* Call the function a descriptor (from gidispatch_get_protodesc()) belongs
+    to. This is gidispatch_call(desc->id, numargs, arglist), including the
+    call tracer, but without looking up the function id. */
+extern void gidispatch_call_desc(gidispatch_protodesc_t *desc,
+    glui32 numargs, gluniversal_t *arglist);
+
+/* This is only available if gi_dispa.c is compiled with GIDISPATCH_TRACE
+    defined. The tracer sees every gidispatch_call(), before (done == 0)
+    and after (done == 1) the Glk function runs. See gi_trace.h. */
+#ifdef GIDISPATCH_TRACE
+extern void gidispatch_set_call_tracer(void (*tracefunc)(glui32 funcnum,
+    glui32 numargs, gluniversal_t *arglist, int done));
+#endif /* GIDISPATCH_TRACE */
+
 #endif /* _GI_DISPA_H */
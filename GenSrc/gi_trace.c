@@ -0,0 +1,811 @@
+/* gi_trace.c: Record and replay of Glk dispatch calls
+    for IosGlk, the iOS implementation of the Glk API.
+    Designed by Andrew Plotkin <erkyrath@eblong.com>
+    http://eblong.com/zarf/glk/
+*/
+
+/* File format: the eight bytes "GlkTrace", then a version number, then
+    a sequence of records. All numbers are unsigned LEB128 varints.
+
+    A call record is 'C', the function id, the argument count, and then
+    the input arguments, walked in prototype order:
+        simple argument (Iu, Cn, ...): its value
+        opaque object (Qa, ...): its ordinal (0 for NULL)
+        string (S, U): length+1 (0 for NULL), then the characters
+        reference (&, <, >): the ptrflag; then if it's set:
+            array: the length, then (if passed in) the contents
+            struct or value: (if passed in) the fields
+        return value: the ptrflag
+
+    A result record is 'R', the function id, and then the output values
+    (passed-out references and the return value, if their ptrflag was
+    set; arrays are skipped). A select result is followed by the line
+    input text, if the event was evtype_LineInput: a unicode flag, the
+    length, and the characters.
+
+    A call that never returned (glk_exit) has no result record.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "glk.h"
+#include "gi_dispa.h"
+#include "gi_trace.h"
+
+#ifdef GIDISPATCH_TRACE
+
+#define TRACE_MAGIC "GlkTrace"
+#define TRACE_VERSION (1)
+
+#define MAXSLOTS (64)
+#define MAXLINEBUFS (16)
+
+/* Find the parsed prototype for a function. Functions in the dispatch
+    table have a cached descriptor; an extension function (see
+    GLK_EXTEND_PROTOTYPE) is parsed into the scratch descriptor. */
+static gidispatch_protodesc_t *get_protodesc(glui32 funcnum,
+    gidispatch_protodesc_t *scratch)
+{
+    gidispatch_protodesc_t *pdesc;
+    char *proto;
+
+    pdesc = gidispatch_get_protodesc(funcnum);
+    if (pdesc)
+        return pdesc;
+    proto = gidispatch_prototype(funcnum);
+    if (!proto || !gidispatch_parse_prototype(proto, scratch))
+        return NULL;
+    return scratch;
+}
+
+static int is_creator(glui32 funcnum)
+{
+    gidispatch_function_t *func = gidispatch_get_function_by_id(funcnum);
+    if (!func || !func->name)
+        return 0;
+    return (strstr(func->name, "open") || strstr(func->name, "create"));
+}
+
+static int is_select(glui32 funcnum)
+{
+    return (funcnum == 0x00C0 || funcnum == 0x00C1);
+}
+
+/* ---- Recording ---- */
+
+typedef struct objentry_struct {
+    void *obj;
+    glui32 ordinal;
+} objentry_t;
+
+typedef struct linebuf_struct {
+    void *win;
+    void *buf;
+    glui32 len;
+    int unicode;
+} linebuf_t;
+
+static FILE *tracefl = NULL;
+static objentry_t *objtable = NULL;
+static glui32 objtable_size = 0; /* always a power of two */
+static glui32 objtable_count = 0;
+static glui32 next_ordinal = 1;
+static linebuf_t linebufs[MAXLINEBUFS];
+
+static void trace_call(glui32 funcnum, glui32 numargs,
+    gluniversal_t *arglist, int done);
+
+static void write_varint(glui32 val)
+{
+    while (val >= 0x80) {
+        putc((int)((val & 0x7F) | 0x80), tracefl);
+        val >>= 7;
+    }
+    putc((int)val, tracefl);
+}
+
+static glui32 hash_obj(void *obj)
+{
+    unsigned long val = (unsigned long)obj;
+    return (glui32)((val >> 4) * 2654435761UL);
+}
+
+static void objtable_grow(void)
+{
+    objentry_t *oldtable = objtable;
+    glui32 oldsize = objtable_size;
+    glui32 ix;
+
+    objtable_size = (oldsize ? oldsize*2 : 64);
+    objtable = (objentry_t *)calloc(objtable_size, sizeof(objentry_t));
+    objtable_count = 0;
+
+    for (ix=0; ix<oldsize; ix++) {
+        if (oldtable[ix].obj) {
+            glui32 pos = hash_obj(oldtable[ix].obj) & (objtable_size-1);
+            while (objtable[pos].obj)
+                pos = (pos+1) & (objtable_size-1);
+            objtable[pos] = oldtable[ix];
+            objtable_count++;
+        }
+    }
+
+    if (oldtable)
+        free(oldtable);
+}
+
+/* Find the ordinal for an object, assigning a new one if the object
+    hasn't been seen -- or if fresh is set, which means the object was
+    just created (and may be reusing a dead object's address). */
+static glui32 obj_ordinal(void *obj, int fresh)
+{
+    glui32 pos;
+
+    if (!obj)
+        return 0;
+
+    if ((objtable_count+1) * 2 > objtable_size)
+        objtable_grow();
+
+    pos = hash_obj(obj) & (objtable_size-1);
+    while (objtable[pos].obj) {
+        if (objtable[pos].obj == obj) {
+            if (fresh)
+                objtable[pos].ordinal = next_ordinal++;
+            return objtable[pos].ordinal;
+        }
+        pos = (pos+1) & (objtable_size-1);
+    }
+
+    objtable[pos].obj = obj;
+    objtable[pos].ordinal = next_ordinal++;
+    objtable_count++;
+    return objtable[pos].ordinal;
+}
+
+static void note_line_buffer(void *win, void *buf, glui32 len, int unicode)
+{
+    int ix;
+    int pos = -1;
+
+    for (ix=0; ix<MAXLINEBUFS; ix++) {
+        if (linebufs[ix].win == win) {
+            pos = ix;
+            break;
+        }
+        if (pos < 0 && !linebufs[ix].win)
+            pos = ix;
+    }
+    if (pos < 0)
+        pos = 0;
+
+    linebufs[pos].win = win;
+    linebufs[pos].buf = buf;
+    linebufs[pos].len = len;
+    linebufs[pos].unicode = unicode;
+}
+
+static linebuf_t *find_line_buffer(void *win)
+{
+    int ix;
+    for (ix=0; ix<MAXLINEBUFS; ix++) {
+        if (linebufs[ix].win == win && linebufs[ix].buf)
+            return &linebufs[ix];
+    }
+    return NULL;
+}
+
+static void write_value(char typeclass, gluniversal_t *arg, int fresh)
+{
+    glui32 len, ix;
+
+    switch (typeclass) {
+        case 'I':
+            write_varint(arg->uint);
+            break;
+        case 'C':
+            write_varint(arg->uch);
+            break;
+        case 'Q':
+            write_varint(obj_ordinal(arg->opaqueref, fresh));
+            break;
+        case 'S':
+            if (!arg->charstr) {
+                write_varint(0);
+                break;
+            }
+            len = strlen(arg->charstr);
+            write_varint(len+1);
+            fwrite(arg->charstr, 1, len, tracefl);
+            break;
+        case 'U':
+            if (!arg->unicharstr) {
+                write_varint(0);
+                break;
+            }
+            for (len=0; arg->unicharstr[len]; len++) { };
+            write_varint(len+1);
+            for (ix=0; ix<len; ix++)
+                write_varint(arg->unicharstr[ix]);
+            break;
+    }
+}
+
+static void write_array(gidispatch_argdesc_t *desc, void *array, glui32 len)
+{
+    glui32 ix;
+
+    if (desc->typeclass == 'C') {
+        fwrite(array, 1, len, tracefl);
+    }
+    else {
+        glui32 *arr = (glui32 *)array;
+        for (ix=0; ix<len; ix++)
+            write_varint(arr[ix]);
+    }
+}
+
+static void trace_inputs(glui32 funcnum, glui32 numargs,
+    gluniversal_t *arglist, gidispatch_protodesc_t *pdesc)
+{
+    int ax, fx;
+    glui32 ix = 0;
+
+    putc('C', tracefl);
+    write_varint(funcnum);
+    write_varint(numargs);
+
+    for (ax=0; ax<pdesc->numargs && ix<numargs; ax++) {
+        gidispatch_argdesc_t *desc = &pdesc->args[ax];
+
+        if (!(desc->flags & gidispatch_arg_Ref)) {
+            write_value(desc->typeclass, &arglist[ix], 0);
+            ix++;
+            continue;
+        }
+
+        if (!arglist[ix].ptrflag) {
+            write_varint(0);
+            ix++;
+            continue;
+        }
+        write_varint(1);
+        ix++;
+
+        if ((desc->flags & gidispatch_arg_Return)) {
+            ix++;
+            continue;
+        }
+
+        if ((desc->flags & gidispatch_arg_Array)) {
+            glui32 len = arglist[ix+1].uint;
+            write_varint(len);
+            if ((desc->flags & gidispatch_arg_PassIn))
+                write_array(desc, arglist[ix].array, len);
+        }
+        else if (desc->typeclass == '[') {
+            if ((desc->flags & gidispatch_arg_PassIn)) {
+                for (fx=0; fx<desc->numfields; fx++)
+                    write_value(desc->fieldclass[fx], &arglist[ix+fx], 0);
+            }
+        }
+        else {
+            if ((desc->flags & gidispatch_arg_PassIn))
+                write_value(desc->typeclass, &arglist[ix], 0);
+        }
+        ix += desc->refslots;
+    }
+
+    /* Remember where line input goes, so that we can record the text
+        when the event arrives. */
+    if ((funcnum == 0x00D0 || funcnum == 0x0141) && numargs >= 4
+        && arglist[1].ptrflag) {
+        note_line_buffer(arglist[0].opaqueref, arglist[2].array,
+            arglist[3].uint, (funcnum == 0x0141));
+    }
+}
+
+static void trace_outputs(glui32 funcnum, glui32 numargs,
+    gluniversal_t *arglist, gidispatch_protodesc_t *pdesc)
+{
+    int ax, fx;
+    glui32 ix = 0;
+    int creator = is_creator(funcnum);
+
+    putc('R', tracefl);
+    write_varint(funcnum);
+
+    for (ax=0; ax<pdesc->numargs && ix<numargs; ax++) {
+        gidispatch_argdesc_t *desc = &pdesc->args[ax];
+
+        if (!(desc->flags & gidispatch_arg_Ref)) {
+            ix++;
+            continue;
+        }
+        if (!arglist[ix].ptrflag) {
+            ix++;
+            continue;
+        }
+        ix++;
+
+        if ((desc->flags & gidispatch_arg_PassOut) && !(desc->flags & gidispatch_arg_Array)) {
+            if (desc->typeclass == '[') {
+                for (fx=0; fx<desc->numfields; fx++)
+                    write_value(desc->fieldclass[fx], &arglist[ix+fx], 0);
+            }
+            else {
+                write_value(desc->typeclass, &arglist[ix],
+                    ((desc->flags & gidispatch_arg_Return) && creator));
+            }
+        }
+        ix += desc->refslots;
+    }
+
+    if (is_select(funcnum) && numargs >= 5 && arglist[0].ptrflag
+        && arglist[1].uint == evtype_LineInput) {
+        linebuf_t *lbuf = find_line_buffer(arglist[2].opaqueref);
+        glui32 len = arglist[3].uint;
+        if (!lbuf || len > lbuf->len) {
+            write_varint(0);
+            write_varint(0);
+        }
+        else {
+            write_varint(lbuf->unicode);
+            write_varint(len);
+            if (lbuf->unicode) {
+                glui32 lx;
+                for (lx=0; lx<len; lx++)
+                    write_varint(((glui32 *)lbuf->buf)[lx]);
+            }
+            else {
+                fwrite(lbuf->buf, 1, len, tracefl);
+            }
+        }
+    }
+}
+
+static void trace_call(glui32 funcnum, glui32 numargs,
+    gluniversal_t *arglist, int done)
+{
+    gidispatch_protodesc_t scratch;
+    gidispatch_protodesc_t *pdesc;
+
+    if (!tracefl)
+        return;
+
+    pdesc = get_protodesc(funcnum, &scratch);
+    if (!pdesc)
+        return;
+
+    if (!done) {
+        trace_inputs(funcnum, numargs, arglist, pdesc);
+        /* A select is a turn boundary, and glk_exit never comes back.
+            Either way, get the log onto disk now. */
+        if (is_select(funcnum) || funcnum == 0x0001)
+            fflush(tracefl);
+    }
+    else {
+        trace_outputs(funcnum, numargs, arglist, pdesc);
+    }
+}
+
+int gitrace_start(FILE *fl)
+{
+    if (!fl)
+        return 0;
+
+    tracefl = fl;
+    objtable_count = 0;
+    next_ordinal = 1;
+    if (objtable)
+        memset(objtable, 0, objtable_size * sizeof(objentry_t));
+    memset(linebufs, 0, sizeof(linebufs));
+
+    fwrite(TRACE_MAGIC, 1, 8, tracefl);
+    write_varint(TRACE_VERSION);
+
+    gidispatch_set_call_tracer(&trace_call);
+    return 1;
+}
+
+void gitrace_stop()
+{
+    gidispatch_set_call_tracer(NULL);
+    if (tracefl)
+        fflush(tracefl);
+    tracefl = NULL;
+
+    if (objtable)
+        free(objtable);
+    objtable = NULL;
+    objtable_size = 0;
+    objtable_count = 0;
+}
+
+/* ---- Replay ---- */
+
+static FILE *replayfl = NULL;
+static int replay_error = 0;
+static void **replayobjs = NULL; /* indexed by ordinal */
+static glui32 replayobjs_size = 0;
+static void **retainedbufs = NULL;
+static glui32 retainedbufs_count = 0;
+static glui32 retainedbufs_size = 0;
+
+static glui32 read_varint(void)
+{
+    glui32 val = 0;
+    int shift = 0;
+    int ch;
+
+    while (1) {
+        ch = getc(replayfl);
+        if (ch == EOF) {
+            replay_error = 1;
+            return 0;
+        }
+        if (shift < 32)
+            val |= ((glui32)(ch & 0x7F)) << shift;
+        if (!(ch & 0x80))
+            break;
+        shift += 7;
+    }
+    return val;
+}
+
+static void *replay_obj(glui32 ordinal)
+{
+    if (ordinal == 0 || ordinal >= replayobjs_size)
+        return NULL;
+    return replayobjs[ordinal];
+}
+
+static void replay_bind(glui32 ordinal, void *obj)
+{
+    if (ordinal == 0)
+        return;
+    if (ordinal >= replayobjs_size) {
+        glui32 newsize = (replayobjs_size ? replayobjs_size : 64);
+        while (newsize <= ordinal)
+            newsize *= 2;
+        replayobjs = (void **)realloc(replayobjs, newsize * sizeof(void *));
+        memset(replayobjs+replayobjs_size, 0,
+            (newsize-replayobjs_size) * sizeof(void *));
+        replayobjs_size = newsize;
+    }
+    replayobjs[ordinal] = obj;
+}
+
+static void note_retained(void *buf)
+{
+    if (retainedbufs_count >= retainedbufs_size) {
+        retainedbufs_size = (retainedbufs_size ? retainedbufs_size*2 : 16);
+        retainedbufs = (void **)realloc(retainedbufs,
+            retainedbufs_size * sizeof(void *));
+    }
+    retainedbufs[retainedbufs_count++] = buf;
+}
+
+/* Read one value into arg. Strings are malloced; they're added to the
+    temps list, to be freed after the call. */
+static void read_value(char typeclass, gluniversal_t *arg, void **temps,
+    int *numtemps)
+{
+    glui32 len, ix;
+
+    switch (typeclass) {
+        case 'I':
+            arg->uint = read_varint();
+            break;
+        case 'C':
+            arg->uch = (unsigned char)read_varint();
+            break;
+        case 'Q':
+            arg->opaqueref = replay_obj(read_varint());
+            break;
+        case 'S':
+            len = read_varint();
+            if (!len) {
+                arg->charstr = NULL;
+                break;
+            }
+            len--;
+            arg->charstr = (char *)malloc(len+1);
+            if (fread(arg->charstr, 1, len, replayfl) != len)
+                replay_error = 1;
+            arg->charstr[len] = '\0';
+            temps[(*numtemps)++] = arg->charstr;
+            break;
+        case 'U':
+            len = read_varint();
+            if (!len) {
+                arg->unicharstr = NULL;
+                break;
+            }
+            len--;
+            arg->unicharstr = (glui32 *)malloc((len+1) * sizeof(glui32));
+            for (ix=0; ix<len; ix++)
+                arg->unicharstr[ix] = read_varint();
+            arg->unicharstr[len] = 0;
+            temps[(*numtemps)++] = arg->unicharstr;
+            break;
+    }
+}
+
+static void *read_array(gidispatch_argdesc_t *desc, glui32 len, int passin)
+{
+    glui32 ix;
+    int elemsize = (desc->typeclass == 'C') ? 1 : sizeof(glui32);
+    void *array = calloc((len ? len : 1), elemsize);
+
+    if (!passin)
+        return array;
+
+    if (desc->typeclass == 'C') {
+        if (fread(array, 1, len, replayfl) != len)
+            replay_error = 1;
+    }
+    else {
+        glui32 *arr = (glui32 *)array;
+        for (ix=0; ix<len; ix++)
+            arr[ix] = read_varint();
+    }
+    return array;
+}
+
+int gitrace_replay(FILE *fl, gitrace_event_func eventfunc,
+    glui32 *callcountref)
+{
+    char magic[8];
+    glui32 callcount = 0;
+
+    replayfl = fl;
+    replay_error = 0;
+    if (callcountref)
+        *callcountref = 0;
+
+    if (fread(magic, 1, 8, replayfl) != 8 || memcmp(magic, TRACE_MAGIC, 8))
+        return 0;
+    if (read_varint() != TRACE_VERSION)
+        return 0;
+
+    while (!replay_error) {
+        gluniversal_t arglist[MAXSLOTS];
+        gluniversal_t expect[MAXSLOTS];
+        gidispatch_protodesc_t scratch;
+        gidispatch_protodesc_t *pdesc;
+        void *temps[MAXSLOTS];
+        int numtemps = 0;
+        int ax, fx;
+        int hasresult = 0;
+        int skipcall = 0;
+        glui32 funcnum, numargs, ix;
+        int ch;
+
+        ch = getc(replayfl);
+        if (ch == EOF)
+            break;
+        if (ch != 'C')
+            return 0;
+
+        funcnum = read_varint();
+        numargs = read_varint();
+        if (replay_error || numargs > MAXSLOTS)
+            return 0;
+        pdesc = get_protodesc(funcnum, &scratch);
+        if (!pdesc)
+            return 0;
+
+        memset(arglist, 0, sizeof(arglist));
+        memset(expect, 0, sizeof(expect));
+
+        /* Inputs. This mirrors trace_inputs(). */
+        ix = 0;
+        for (ax=0; ax<pdesc->numargs && ix<numargs; ax++) {
+            gidispatch_argdesc_t *desc = &pdesc->args[ax];
+
+            if (!(desc->flags & gidispatch_arg_Ref)) {
+                read_value(desc->typeclass, &arglist[ix], temps, &numtemps);
+                ix++;
+                continue;
+            }
+
+            arglist[ix].ptrflag = read_varint();
+            if (!arglist[ix].ptrflag) {
+                ix++;
+                continue;
+            }
+            ix++;
+
+            if ((desc->flags & gidispatch_arg_Return)) {
+                ix++;
+                continue;
+            }
+
+            if ((desc->flags & gidispatch_arg_Array)) {
+                glui32 len = read_varint();
+                arglist[ix].array = read_array(desc, len, (desc->flags & gidispatch_arg_PassIn));
+                arglist[ix+1].uint = len;
+                if ((desc->flags & gidispatch_arg_Retained))
+                    note_retained(arglist[ix].array);
+                else
+                    temps[numtemps++] = arglist[ix].array;
+            }
+            else if (desc->typeclass == '[') {
+                if ((desc->flags & gidispatch_arg_PassIn)) {
+                    for (fx=0; fx<desc->numfields; fx++)
+                        read_value(desc->fieldclass[fx], &arglist[ix+fx],
+                            temps, &numtemps);
+                }
+            }
+            else {
+                if ((desc->flags & gidispatch_arg_PassIn))
+                    read_value(desc->typeclass, &arglist[ix], temps,
+                        &numtemps);
+            }
+            ix += desc->refslots;
+        }
+
+        /* Outputs, if the call returned. This mirrors trace_outputs(),
+            except that opaque objects are kept as ordinals (in .uint). */
+        ch = getc(replayfl);
+        if (ch == 'R') {
+            hasresult = 1;
+            if (read_varint() != funcnum)
+                return 0;
+            ix = 0;
+            for (ax=0; ax<pdesc->numargs && ix<numargs; ax++) {
+                gidispatch_argdesc_t *desc = &pdesc->args[ax];
+
+                if (!(desc->flags & gidispatch_arg_Ref) || !arglist[ix].ptrflag) {
+                    ix++;
+                    continue;
+                }
+                ix++;
+
+                if ((desc->flags & gidispatch_arg_PassOut) && !(desc->flags & gidispatch_arg_Array)) {
+                    if (desc->typeclass == '[') {
+                        for (fx=0; fx<desc->numfields; fx++) {
+                            if (desc->fieldclass[fx] == 'Q')
+                                expect[ix+fx].uint = read_varint();
+                            else
+                                read_value(desc->fieldclass[fx],
+                                    &expect[ix+fx], temps, &numtemps);
+                        }
+                    }
+                    else {
+                        if (desc->typeclass == 'Q')
+                            expect[ix].uint = read_varint();
+                        else
+                            read_value(desc->typeclass, &expect[ix], temps,
+                                &numtemps);
+                    }
+                }
+                ix += desc->refslots;
+            }
+        }
+        else if (ch != EOF) {
+            ungetc(ch, replayfl);
+        }
+
+        if (replay_error)
+            return 0;
+
+        if (funcnum == 0x0001) {
+            /* glk_exit. The replay is over. */
+            break;
+        }
+
+        if (funcnum == 0x00C0) {
+            /* glk_select. Hand the recorded event to the caller to queue
+                up; if we can't, skip the select. */
+            skipcall = 1;
+            if (hasresult && arglist[0].ptrflag && numargs >= 5) {
+                event_t ev;
+                void *linebuf = NULL;
+                glui32 linelen = 0;
+                int unicode = 0;
+
+                ev.type = expect[1].uint;
+                ev.win = replay_obj(expect[2].uint);
+                ev.val1 = expect[3].uint;
+                ev.val2 = expect[4].uint;
+
+                if (ev.type == evtype_LineInput) {
+                    unicode = read_varint();
+                    linelen = read_varint();
+                    linebuf = malloc(((linelen ? linelen : 1)
+                        * (unicode ? sizeof(glui32) : 1)));
+                    temps[numtemps++] = linebuf;
+                    if (unicode) {
+                        glui32 lx;
+                        for (lx=0; lx<linelen; lx++)
+                            ((glui32 *)linebuf)[lx] = read_varint();
+                    }
+                    else {
+                        if (fread(linebuf, 1, linelen, replayfl) != linelen)
+                            replay_error = 1;
+                    }
+                    if (replay_error)
+                        return 0;
+                }
+
+                if (eventfunc && eventfunc(&ev, linebuf, linelen, unicode))
+                    skipcall = 0;
+            }
+        }
+        else if (funcnum == 0x00C1 && hasresult && arglist[0].ptrflag
+            && numargs >= 5 && expect[1].uint == evtype_LineInput) {
+            /* select_poll never returns line input, but stay in sync
+                with the writer anyway. */
+            glui32 lx, linelen;
+            int unicode = read_varint();
+            linelen = read_varint();
+            for (lx=0; lx<linelen; lx++) {
+                if (unicode)
+                    read_varint();
+                else
+                    getc(replayfl);
+            }
+        }
+
+        if (!skipcall) {
+            gidispatch_call(funcnum, numargs, arglist);
+            callcount++;
+
+            /* Bind any objects the call returned to their recorded
+                ordinals. */
+            if (hasresult) {
+                ix = 0;
+                for (ax=0; ax<pdesc->numargs && ix<numargs; ax++) {
+                    gidispatch_argdesc_t *desc = &pdesc->args[ax];
+
+                    if (!(desc->flags & gidispatch_arg_Ref) || !arglist[ix].ptrflag) {
+                        ix++;
+                        continue;
+                    }
+                    ix++;
+
+                    if ((desc->flags & gidispatch_arg_PassOut) && !(desc->flags & gidispatch_arg_Array)) {
+                        if (desc->typeclass == '[') {
+                            for (fx=0; fx<desc->numfields; fx++) {
+                                if (desc->fieldclass[fx] == 'Q')
+                                    replay_bind(expect[ix+fx].uint,
+                                        arglist[ix+fx].opaqueref);
+                            }
+                        }
+                        else if (desc->typeclass == 'Q') {
+                            replay_bind(expect[ix].uint, arglist[ix].opaqueref);
+                        }
+                    }
+                    ix += desc->refslots;
+                }
+            }
+        }
+
+        while (numtemps > 0) {
+            numtemps--;
+            free(temps[numtemps]);
+        }
+    }
+
+    if (callcountref)
+        *callcountref = callcount;
+    replayfl = NULL;
+    return (replay_error ? 0 : 1);
+}
+
+void gitrace_replay_free()
+{
+    while (retainedbufs_count > 0) {
+        retainedbufs_count--;
+        free(retainedbufs[retainedbufs_count]);
+    }
+
+    if (replayobjs)
+        free(replayobjs);
+    replayobjs = NULL;
+    replayobjs_size = 0;
+}
+
+#endif /* GIDISPATCH_TRACE */
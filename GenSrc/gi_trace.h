@@ -0,0 +1,53 @@
+#ifndef _GI_TRACE_H
+#define _GI_TRACE_H
+
+/* gi_trace.h: Record and replay of Glk dispatch calls
+    for IosGlk, the iOS implementation of the Glk API.
+    Designed by Andrew Plotkin <erkyrath@eblong.com>
+    http://eblong.com/zarf/glk/
+
+    This requires gi_dispa.c to be compiled with GIDISPATCH_TRACE defined.
+
+    A trace is a compact binary log of every call that went through
+    gidispatch_call(): the function id, and every argument the function
+    reads. Opaque objects are recorded as small ordinals (in order of
+    creation), not pointers. After each call, the values the function
+    wrote back are recorded too -- including the event_t returned from
+    glk_select(), and the text of line input events.
+
+    Replaying a trace makes the same calls, in the same order, against
+    a fresh library. It's meant for performance work: capture a real
+    session once, then replay it as many times as you like.
+*/
+
+#include <stdio.h>
+
+/* Begin recording to fl, which must be open for binary writing. The
+    caller keeps ownership of fl; close it after gitrace_stop(). Returns
+    1 on success. */
+extern int gitrace_start(FILE *fl);
+extern void gitrace_stop(void);
+
+/* The replayer does not call glk_select() blind. Before each select,
+    it calls the event function with the event that was recorded; the
+    function should arrange for the library to deliver that event (for
+    example, by queueing it as UI input), and return 1. If it returns 0,
+    the select is skipped. For line input events, linebuf contains the
+    text entered (linelen characters; glui32 if unicode, else char). */
+typedef int (*gitrace_event_func)(event_t *ev, void *linebuf,
+    glui32 linelen, int unicode);
+
+/* Replay a trace from fl (open for binary reading), up to the end of
+    the file or a recorded glk_exit(). Returns 1 on success, 0 if the
+    trace was malformed. If callcountref is not NULL, it is set to the
+    number of calls made. */
+extern int gitrace_replay(FILE *fl, gitrace_event_func eventfunc,
+    glui32 *callcountref);
+
+/* Retained arrays (memory stream buffers, line input buffers) that the
+    replay allocated stay alive after gitrace_replay() returns, because
+    open objects may still refer to them. Close those objects first,
+    then call this. */
+extern void gitrace_replay_free(void);
+
+#endif /* _GI_TRACE_H */
@@ -0,0 +1,36 @@
+/* HeadlessAccessTypes.m: VoiceOver accessibility classes -- headless stand-ins
+	for IosGlk, the iOS implementation of the Glk API.
+	Designed by Andrew Plotkin <erkyrath@eblong.com>
+	http://eblong.com/zarf/glk/
+*/
+
+/*	GlkUtilTypes.m refers to the accessibility classes, but the real implementations (LibSrc/GlkAccessTypes.m) need the UI view classes. In the headless build there are no views and nobody asks for accessibility elements, so these just return nil.
+*/
+
+#import "GlkAccessTypes.h"
+#import "GlkUtilTypes.h"
+
+@implementation GlkAccVisualLine
+
+@synthesize line;
+
++ (NSString *) lineForSpeaking:(NSString *)val {
+	return val;
+}
+
++ (GlkAccVisualLine *) buildForLine:(GlkVisualLine *)vln container:(StyledTextView *)container {
+	return nil;
+}
+
+@end
+
+
+@implementation GlkAccStyledLine
+
+@synthesize line;
+
++ (GlkAccStyledLine *) buildForLine:(GlkStyledLine *)vln container:(GlkWinGridView *)container {
+	return nil;
+}
+
+@end
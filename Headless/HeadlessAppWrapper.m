@@ -0,0 +1,392 @@
+/* HeadlessAppWrapper.m: Class which manages the program (VM) thread -- headless version
+	for IosGlk, the iOS implementation of the Glk API.
+	Designed by Andrew Plotkin <erkyrath@eblong.com>
+	http://eblong.com/zarf/glk/
+*/
+
+/*	This is a replacement for AppSrc/GlkAppWrapper.m, for the headless build. It implements the same GlkAppWrapper interface, but there is no UI thread. The VM runs on whatever thread calls appThreadMain: (normally the process's main thread), and glk_main() is run exactly once.
+
+	When the VM calls glk_select(), we first clone the library state (exactly as the real wrapper does, so that the cost of cloneState shows up in measurements) and throw it away. Then, if anybody has called acceptEvent: (the trace replayer does this), we deliver the queued events in order, subject to the same acceptability checks as the real wrapper. Otherwise, input comes from stdin, one line per event. We read a line and hand it to whichever window has requested input: line input gets the whole line, char input gets its first character (or Return, for an empty line). If no window is waiting for input, but the timer is running, we return a timer event. If nothing at all can happen, or stdin hits EOF, we treat it as glk_exit().
+
+	File prompts (glk_fileref_create_by_prompt) are always cancelled.
+*/
+
+#import "GlkAppWrapper.h"
+#import "GlkLibrary.h"
+#import "GlkLibraryState.h"
+#import "GlkWindow.h"
+#import "GlkFileTypes.h"
+#import "GlkUtilTypes.h"
+#import "GlkUtilities.h"
+#import "GlkTurnTiming.h"
+#include "glk.h"
+#include "iosglk_startup.h"
+
+@interface GlkAppWrapper (Headless)
+- (NSString *) readInputLine;
+- (void) nextEvent:(event_t *)event;
+- (BOOL) acceptQueuedEvent:(GlkEventState *)gotevent into:(event_t *)event;
+@end
+
+/* Events passed to acceptEvent:, waiting for glk_select(). (Not an ivar, because the ivars are declared in the shared GlkAppWrapper.h.) Only touched by the VM thread. */
+static NSMutableArray *queuedevents = nil;
+
+#ifdef IOSGLK_TURN_TIMING
+/* When the VM last left glk_select() (or began glk_main()). */
+static uint64_t vmresumetime = 0;
+#endif // IOSGLK_TURN_TIMING
+
+@implementation GlkAppWrapper
+
+@synthesize iowait;
+@synthesize iowaitcond;
+@synthesize eventfromui;
+@synthesize lasteventtype;
+@synthesize timerinterval;
+
+static GlkAppWrapper *singleton = nil;
+
++ (GlkAppWrapper *) singleton {
+	return singleton;
+}
+
+- (id) init {
+	self = [super init];
+
+	if (self) {
+		if (singleton)
+			[NSException raise:@"GlkException" format:@"cannot create two GlkAppWrapper objects"];
+		singleton = self;
+
+		iowait = NO;
+		eventfromui = nil;
+		iowait_evptr = nil;
+		iowait_special = nil;
+		pendingtimerevent = NO;
+		self.iowaitcond = [[[NSCondition alloc] init] autorelease];
+
+		pendingmetricchange = NO;
+		pendingsizechange = NO;
+		timerinterval = nil;
+	}
+
+	return self;
+}
+
+- (void) dealloc {
+	if (singleton == self)
+		singleton = nil;
+	self.timerinterval = nil;
+	self.eventfromui = nil;
+	self.iowaitcond = nil;
+	[super dealloc];
+}
+
+/* There is no separate VM thread in the headless build. Call appThreadMain: directly. */
+- (void) launchAppThread {
+	[NSException raise:@"GlkException" format:@"launchAppThread is not available in the headless build"];
+}
+
+/* Run glk_main() once, on the calling thread, and return when it exits. */
+- (void) appThreadMain:(id)rock {
+	looppool = [[NSAutoreleasePool alloc] init];
+
+	iowait = NO;
+	self.eventfromui = nil;
+	pendingmetricchange = NO;
+	pendingsizechange = NO;
+	pendingtimerevent = NO;
+
+	iosglk_startup_code();
+
+	@try {
+		lasteventtype = -1; // meaning startup
+		lastwaittime = [NSDate timeIntervalSinceReferenceDate];
+#ifdef IOSGLK_TURN_TIMING
+		vmresumetime = GlkTurnTimeNow();
+#endif // IOSGLK_TURN_TIMING
+		glk_main();
+	} @catch (GlkExitException *ce) {
+		NSLog(@"VM thread caught glk_exit exception");
+	}
+
+	GlkLibrary *library = [GlkLibrary singleton];
+	[library setVMExited];
+
+	[looppool drain]; // releases it
+	looppool = nil;
+}
+
+/* Read one line from stdin, without the trailing newline. Returns nil at EOF. */
+- (NSString *) readInputLine {
+	char *buf = NULL;
+	size_t bufsize = 0;
+	ssize_t len = getline(&buf, &bufsize, stdin);
+	if (len < 0) {
+		free(buf);
+		return nil;
+	}
+	while (len > 0 && (buf[len-1] == '\n' || buf[len-1] == '\r'))
+		len--;
+	NSString *str = [[[NSString alloc] initWithBytes:buf length:len encoding:NSUTF8StringEncoding] autorelease];
+	free(buf);
+	if (!str)
+		str = @"";
+	return str;
+}
+
+/* Produce the next event, as described at the top of this file.
+
+	This must be called on the VM thread.
+*/
+- (void) selectEvent:(event_t *)event special:(id)special {
+#ifdef IOSGLK_TURN_TIMING
+	GlkTurnTimeRecord(turnphase_VM, vmresumetime);
+#endif // IOSGLK_TURN_TIMING
+	
+	[looppool drain]; // releases it
+	looppool = [[NSAutoreleasePool alloc] init];
+
+	GlkLibrary *library = [GlkLibrary singleton];
+
+	if (event && special)
+		[NSException raise:@"GlkException" format:@"selectEvent called with both event and special arguments"];
+	if (special != library.specialrequest)
+		[NSException raise:@"GlkException" format:@"selectEvent called with wrong special value"];
+
+	/* The real wrapper hands this to the UI thread. We just want to pay for it. */
+	if (pendingupdatefromtop) {
+		pendingupdatefromtop = NO;
+		[library dirtyAllData];
+	}
+	[library cloneState];
+
+	if (!event) {
+		/* A file prompt (cancelled) or the post-exit wait. Either way, return immediately. */
+		lasteventtype = evtype_None;
+	}
+	else {
+		[self nextEvent:event];
+		lasteventtype = event->type;
+	}
+	lastwaittime = [NSDate timeIntervalSinceReferenceDate];
+	
+#ifdef IOSGLK_TURN_TIMING
+	vmresumetime = GlkTurnTimeNow();
+#endif // IOSGLK_TURN_TIMING
+}
+
+/* Fill in the event structure: an arrange event, a queued event, a timer event, or a line of stdin. If none of those is possible, this calls glk_exit(). */
+- (void) nextEvent:(event_t *)event {
+	GlkLibrary *library = [GlkLibrary singleton];
+	
+	bzero(event, sizeof(event_t));
+
+	if (pendingsizechange || pendingmetricchange) {
+		BOOL metricschanged = pendingmetricchange;
+		CGRect *boxref = nil;
+		if (pendingsizechange)
+			boxref = &pendingsize;
+		pendingsizechange = NO;
+		pendingmetricchange = NO;
+
+		if ([library setMetricsChanged:metricschanged bounds:boxref]) {
+			event->type = evtype_Arrange;
+			return;
+		}
+	}
+
+	while (queuedevents.count) {
+		GlkEventState *gotevent = [[[queuedevents objectAtIndex:0] retain] autorelease];
+		[queuedevents removeObjectAtIndex:0];
+		if ([self acceptQueuedEvent:gotevent into:event])
+			return;
+	}
+
+	GlkWindow *linewin = nil;
+	GlkWindow *charwin = nil;
+	for (GlkWindow *win in library.windows) {
+		if (win.line_request && !linewin)
+			linewin = win;
+		if (win.char_request && !charwin)
+			charwin = win;
+	}
+
+	if (!linewin && !charwin) {
+		if (library.timerinterval) {
+			event->type = evtype_Timer;
+			return;
+		}
+		NSLog(@"headless: no input requests and no timer; exiting");
+		glk_exit();
+	}
+
+	NSString *line = [self readInputLine];
+	if (!line) {
+		NSLog(@"headless: end of input; exiting");
+		glk_exit();
+	}
+
+	if (linewin) {
+		int len = [linewin acceptLineInput:line];
+		if (len >= 0) {
+			event->type = evtype_LineInput;
+			event->win = linewin;
+			event->val1 = len;
+		}
+	}
+	else {
+		glui32 ch = (line.length ? [line characterAtIndex:0] : keycode_Return);
+		if ([charwin acceptCharInput:&ch]) {
+			event->type = evtype_CharInput;
+			event->win = charwin;
+			event->val1 = ch;
+		}
+	}
+}
+
+/* Check a queued event and, if it's acceptable, fill in the event structure. This is the same logic as the event switch in the real wrapper's selectEvent loop. */
+- (BOOL) acceptQueuedEvent:(GlkEventState *)gotevent into:(event_t *)event {
+	GlkLibrary *library = [GlkLibrary singleton];
+	GlkWindow *win = [library windowForTag:gotevent.tag]; // will be nil if there's no tag
+	glui32 ch;
+	int len;
+	
+	switch (gotevent.type) {
+		case evtype_CharInput:
+			ch = gotevent.ch;
+			if (win && [win acceptCharInput:&ch]) {
+				event->type = evtype_CharInput;
+				event->win = win;
+				event->val1 = ch;
+				event->val2 = 0;
+				return YES;
+			}
+			break;
+		case evtype_LineInput:
+			if (win) {
+				len = [win acceptLineInput:gotevent.line];
+				if (len >= 0) {
+					event->type = evtype_LineInput;
+					event->win = win;
+					event->val1 = len;
+					event->val2 = 0;
+					return YES;
+				}
+			}
+			break;
+		case evtype_Timer:
+			if (library.timerinterval) {
+				event->type = evtype_Timer;
+				event->win = 0;
+				event->val1 = 0;
+				event->val2 = 0;
+				return YES;
+			}
+			break;
+		default:
+			if (gotevent.type >= 0x8000000) {
+				event->type = gotevent.type;
+				event->win = win;
+				event->val1 = gotevent.genval1;
+				event->val2 = gotevent.genval2;
+				return YES;
+			}
+			break;
+	}
+	
+	return NO;
+}
+
+/* Timer and resize events are delivered by selectEvent, so there is never anything to poll. */
+- (void) selectPollEvent:(event_t *)event {
+	bzero(event, sizeof(event_t));
+}
+
+- (void) requestViewUpdate {
+	pendingupdaterequest = YES;
+	pendingupdatefromtop = YES;
+}
+
+/* The frame size change is applied at the next glk_select(), as an evtype_Arrange. */
+- (void) setFrameSize:(CGRect)box {
+	pendingsizechange = YES;
+	pendingsize = box;
+}
+
+- (void) noteMetricsChanged {
+	pendingmetricchange = YES;
+}
+
+- (BOOL) acceptingEvent {
+	return NO;
+}
+
+- (BOOL) acceptingEventFileSelect {
+	return NO;
+}
+
+/* There's no input field being edited. */
+- (NSString *) editingTextForWindow:(GlkTag)tag {
+	return nil;
+}
+
+/* Queue an event for the next glk_select(). There's no UI thread, so this is called on the VM thread (between calls into the library). */
+- (void) acceptEvent:(GlkEventState *)event {
+	if (!queuedevents)
+		queuedevents = [[NSMutableArray alloc] initWithCapacity:4]; // retained forever
+	[queuedevents addObject:event];
+}
+
+- (void) acceptEventFileSelect:(GlkFileRefPrompt *)prompt {
+}
+
+- (void) acceptEventRestart {
+}
+
+- (void) setTimerInterval:(NSNumber *)interval {
+	self.timerinterval = interval;
+}
+
+- (void) fireTimer:(id)dummy {
+}
+
+@end
+
+@implementation GlkEventState
+
+@synthesize type;
+@synthesize ch;
+@synthesize genval1;
+@synthesize genval2;
+@synthesize line;
+@synthesize tag;
+
++ (GlkEventState *) charEvent:(glui32)ch inWindow:(GlkTag)tag {
+	GlkEventState *event = [[[GlkEventState alloc] init] autorelease];
+	event.type = evtype_CharInput;
+	event.tag = tag;
+	event.ch = ch;
+	return event;
+}
+
++ (GlkEventState *) lineEvent:(NSString *)line inWindow:(GlkTag)tag {
+	GlkEventState *event = [[[GlkEventState alloc] init] autorelease];
+	event.type = evtype_LineInput;
+	event.tag = tag;
+	event.line = line;
+	return event;
+}
+
++ (GlkEventState *) timerEvent {
+	GlkEventState *event = [[[GlkEventState alloc] init] autorelease];
+	event.type = evtype_Timer;
+	return event;
+}
+
+- (void) dealloc {
+	self.line = nil;
+	[super dealloc];
+}
+
+@end
@@ -0,0 +1,15 @@
+/* HeadlessLibDelegate.h: Library delegate protocol -- null implementation for the headless build
+	for IosGlk, the iOS implementation of the Glk API.
+	Designed by Andrew Plotkin <erkyrath@eblong.com>
+	http://eblong.com/zarf/glk/
+*/
+
+#import <Foundation/Foundation.h>
+#import "IosGlkLibDelegate.h"
+
+@interface HeadlessGlkLibDelegate : NSObject <IosGlkLibDelegate> {
+}
+
++ (HeadlessGlkLibDelegate *) singleton;
+
+@end
@@ -0,0 +1,91 @@
+/* HeadlessLibDelegate.m: Library delegate protocol -- null implementation for the headless build
+	for IosGlk, the iOS implementation of the Glk API.
+	Designed by Andrew Plotkin <erkyrath@eblong.com>
+	http://eblong.com/zarf/glk/
+*/
+
+/*	This delegate never creates views and never shows UI. It supplies fixed styles (with the fixed-cell fonts from the UIKit shim) so that window layout is deterministic from run to run, which is what you want when you're timing things.
+*/
+
+#import "HeadlessLibDelegate.h"
+#import "StyleSet.h"
+
+@implementation HeadlessGlkLibDelegate
+
+HeadlessGlkLibDelegate *_HeadlessGlkLibDelegate_singleton = nil; // retained forever
+
++ (HeadlessGlkLibDelegate *) singleton {
+	if (!_HeadlessGlkLibDelegate_singleton)
+		_HeadlessGlkLibDelegate_singleton = [[HeadlessGlkLibDelegate alloc] init]; // retained
+	return _HeadlessGlkLibDelegate_singleton;
+}
+
+- (NSString *) gameId {
+	return nil;
+}
+
+- (GlkSaveFormat) checkGlkSaveFileFormat:(NSString *)path {
+	return saveformat_UnknownFormat;
+}
+
+- (void) displayGlkFileUsage:(int)usage name:(NSString *)filename {
+}
+
+- (GlkWinBufferView *) viewForBufferWindow:(GlkWindowState *)win frame:(CGRect)box margin:(UIEdgeInsets)margin {
+	return nil;
+}
+
+- (GlkWinGridView *) viewForGridWindow:(GlkWindowState *)win frame:(CGRect)box margin:(UIEdgeInsets)margin {
+	return nil;
+}
+
+- (BOOL) shouldTapSetKeyboard:(BOOL)toopen {
+	return NO;
+}
+
+/* Same margins as the default delegate, but every style gets the same fixed-cell font. */
+- (void) prepareStyles:(StyleSet *)styles forWindowType:(glui32)wintype rock:(glui32)rock {
+	styles.margins = UIEdgeInsetsMake(4, 6, 4, 6);
+	
+	UIFont *font = [UIFont fontWithName:@"Courier" size:14];
+	for (int ix=0; ix<style_NUMSTYLES; ix++)
+		styles.fonts[ix] = font;
+}
+
+/* The library defaults, unless GLKHEADLESS_SCROLLBACK_LINES, GLKHEADLESS_SCROLLBACK_BYTES, or GLKHEADLESS_SCROLLBACK_SPILL is set in the environment. */
+- (void) scrollbackLimitsForWindowRock:(glui32)rock lines:(int *)maxlinesref bytes:(NSUInteger *)maxbytesref spill:(BOOL *)spillref {
+	char *val = getenv("GLKHEADLESS_SCROLLBACK_LINES");
+	if (val)
+		*maxlinesref = atoi(val);
+	val = getenv("GLKHEADLESS_SCROLLBACK_BYTES");
+	if (val)
+		*maxbytesref = strtoul(val, NULL, 10);
+	if (getenv("GLKHEADLESS_SCROLLBACK_SPILL"))
+		*spillref = YES;
+}
+
+/* No write-behind, unless GLKHEADLESS_WRITE_BEHIND is set in the environment. */
+- (BOOL) writeBehindForFileUsage:(glui32)usage {
+	return (getenv("GLKHEADLESS_WRITE_BEHIND") != NULL);
+}
+
+- (BOOL) hasDarkTheme {
+	return NO;
+}
+
+- (CGSize) interWindowSpacing {
+	return CGSizeMake(4, 4);
+}
+
+- (CGRect) adjustFrame:(CGRect)rect {
+	return rect;
+}
+
+- (UIEdgeInsets) viewMarginForWindow:(GlkWindowState *)win rect:(CGRect)rect framebounds:(CGRect)framebounds {
+	return UIEdgeInsetsZero;
+}
+
+- (void) vmHasExited {
+}
+
+@end
@@ -0,0 +1,114 @@
+/* HeadlessUIKit.m: Minimal UIKit/CoreGraphics stand-in for the headless build
+	for IosGlk, the iOS implementation of the Glk API.
+	Designed by Andrew Plotkin <erkyrath@eblong.com>
+	http://eblong.com/zarf/glk/
+*/
+
+#import <UIKit/UIKit.h>
+
+const CGPoint CGPointZero = { 0, 0 };
+const CGSize CGSizeZero = { 0, 0 };
+const CGRect CGRectZero = { { 0, 0 }, { 0, 0 } };
+const CGRect CGRectNull = { { INFINITY, INFINITY }, { 0, 0 } };
+const UIEdgeInsets UIEdgeInsetsZero = { 0, 0, 0, 0 };
+
+/* A rough fixed-width cell, as a fraction of the point size. These only have to be plausible; nothing is rendered. */
+#define HEADLESS_CHAR_WIDTH (0.6)
+#define HEADLESS_LINE_HEIGHT (1.2)
+
+@implementation UIFont
+
+@synthesize fontName;
+@synthesize pointSize;
+
++ (UIFont *) fontWithName:(NSString *)name size:(CGFloat)size {
+	return [[[UIFont alloc] initWithName:name size:size] autorelease];
+}
+
++ (UIFont *) systemFontOfSize:(CGFloat)size {
+	return [UIFont fontWithName:@"System" size:size];
+}
+
++ (UIFont *) boldSystemFontOfSize:(CGFloat)size {
+	return [UIFont fontWithName:@"System-Bold" size:size];
+}
+
++ (UIFont *) italicSystemFontOfSize:(CGFloat)size {
+	return [UIFont fontWithName:@"System-Italic" size:size];
+}
+
+- (id) initWithName:(NSString *)name size:(CGFloat)size {
+	self = [super init];
+
+	if (self) {
+		self.fontName = name;
+		pointSize = size;
+	}
+
+	return self;
+}
+
+- (void) dealloc {
+	self.fontName = nil;
+	[super dealloc];
+}
+
+@end
+
+
+@implementation UIColor
+
+static UIColor *_UIColor_black = nil; // retained forever
+static UIColor *_UIColor_white = nil; // retained forever
+
++ (UIColor *) blackColor {
+	if (!_UIColor_black)
+		_UIColor_black = [[UIColor alloc] init]; // retained
+	return _UIColor_black;
+}
+
++ (UIColor *) whiteColor {
+	if (!_UIColor_white)
+		_UIColor_white = [[UIColor alloc] init]; // retained
+	return _UIColor_white;
+}
+
+@end
+
+
+@implementation UIAccessibilityElement
+@end
+
+
+@implementation NSString (HeadlessFontMetrics)
+
+/* Every character is one fixed-width cell. */
+- (CGSize) sizeWithFont:(UIFont *)font {
+	CGFloat size = (font ? font.pointSize : 12);
+	return CGSizeMake(ceil(self.length * size * HEADLESS_CHAR_WIDTH), ceil(size * HEADLESS_LINE_HEIGHT));
+}
+
+@end
+
+
+@implementation NSCoder (HeadlessGeometry)
+
+/* Archived as four doubles. This is not compatible with the UIKit archive format, but headless autosaves are never loaded on a device. */
+- (void) encodeCGRect:(CGRect)rect forKey:(NSString *)key {
+	double vals[4];
+	vals[0] = rect.origin.x;
+	vals[1] = rect.origin.y;
+	vals[2] = rect.size.width;
+	vals[3] = rect.size.height;
+	[self encodeBytes:(const uint8_t *)vals length:sizeof(vals) forKey:key];
+}
+
+- (CGRect) decodeCGRectForKey:(NSString *)key {
+	NSUInteger len = 0;
+	const double *vals = (const double *)[self decodeBytesForKey:key returnedLength:&len];
+	if (!vals || len != 4*sizeof(double))
+		return CGRectZero;
+	return CGRectMake(vals[0], vals[1], vals[2], vals[3]);
+}
+
+@end
@@ -0,0 +1,139 @@
+/* UIKit.h: Minimal UIKit/CoreGraphics stand-in for the headless build
+	for IosGlk, the iOS implementation of the Glk API.
+	Designed by Andrew Plotkin <erkyrath@eblong.com>
+	http://eblong.com/zarf/glk/
+*/
+
+/*	The headless build (see Headless/GNUmakefile) compiles the library core against GNUstep Foundation, with no UIKit in sight. The core doesn't draw anything, but it does pass around geometry structs, and StyleSet measures text with UIFont. This header supplies just enough of those types that LibSrc and LayerSrc compile unchanged. Since Headless/ is first in the include path, every #import <UIKit/UIKit.h> lands here.
+
+	Fonts have no real metrics. A UIFont is just a point size, and sizeWithFont: treats every character as a fixed-width cell of that size. That's sufficient to lay out windows and count grid rows and columns, which is all the core needs.
+*/
+
+#ifndef _IOSGLK_HEADLESS_UIKIT_H
+#define _IOSGLK_HEADLESS_UIKIT_H
+
+#import <Foundation/Foundation.h>
+#include <stdlib.h>
+#include <math.h>
+
+#ifndef CGFLOAT_DEFINED
+typedef double CGFloat;
+#define CGFLOAT_DEFINED 1
+#endif // CGFLOAT_DEFINED
+
+typedef struct CGPoint {
+	CGFloat x;
+	CGFloat y;
+} CGPoint;
+
+typedef struct CGSize {
+	CGFloat width;
+	CGFloat height;
+} CGSize;
+
+typedef struct CGRect {
+	CGPoint origin;
+	CGSize size;
+} CGRect;
+
+typedef struct UIEdgeInsets {
+	CGFloat top, left, bottom, right;
+} UIEdgeInsets;
+
+extern const CGPoint CGPointZero;
+extern const CGSize CGSizeZero;
+extern const CGRect CGRectZero;
+extern const CGRect CGRectNull;
+extern const UIEdgeInsets UIEdgeInsetsZero;
+
+static inline CGPoint CGPointMake(CGFloat x, CGFloat y) {
+	CGPoint pt;
+	pt.x = x;
+	pt.y = y;
+	return pt;
+}
+
+static inline CGSize CGSizeMake(CGFloat width, CGFloat height) {
+	CGSize size;
+	size.width = width;
+	size.height = height;
+	return size;
+}
+
+static inline CGRect CGRectMake(CGFloat x, CGFloat y, CGFloat width, CGFloat height) {
+	CGRect rect;
+	rect.origin.x = x;
+	rect.origin.y = y;
+	rect.size.width = width;
+	rect.size.height = height;
+	return rect;
+}
+
+static inline BOOL CGRectEqualToRect(CGRect rect1, CGRect rect2) {
+	return (rect1.origin.x == rect2.origin.x && rect1.origin.y == rect2.origin.y
+		&& rect1.size.width == rect2.size.width && rect1.size.height == rect2.size.height);
+}
+
+static inline BOOL CGSizeEqualToSize(CGSize size1, CGSize size2) {
+	return (size1.width == size2.width && size1.height == size2.height);
+}
+
+static inline UIEdgeInsets UIEdgeInsetsMake(CGFloat top, CGFloat left, CGFloat bottom, CGFloat right) {
+	UIEdgeInsets insets;
+	insets.top = top;
+	insets.left = left;
+	insets.bottom = bottom;
+	insets.right = right;
+	return insets;
+}
+
+/* reallocf() is a BSD-ism; glibc doesn't have it. */
+#ifndef __APPLE__
+static inline void *reallocf(void *ptr, size_t size) {
+	void *res = realloc(ptr, size);
+	if (!res && ptr && size)
+		free(ptr);
+	return res;
+}
+#endif // __APPLE__
+
+@interface UIFont : NSObject {
+	NSString *fontName;
+	CGFloat pointSize;
+}
+
+@property (nonatomic, retain) NSString *fontName;
+@property (nonatomic, readonly) CGFloat pointSize;
+
++ (UIFont *) fontWithName:(NSString *)name size:(CGFloat)size;
++ (UIFont *) systemFontOfSize:(CGFloat)size;
++ (UIFont *) boldSystemFontOfSize:(CGFloat)size;
++ (UIFont *) italicSystemFontOfSize:(CGFloat)size;
+
+- (id) initWithName:(NSString *)name size:(CGFloat)size;
+
+@end
+
+@interface UIColor : NSObject {
+}
+
++ (UIColor *) blackColor;
++ (UIColor *) whiteColor;
+
+@end
+
+/* The accessibility classes in GlkAccessTypes.h subclass this. In the headless build they are never instantiated. */
+@interface UIAccessibilityElement : NSObject {
+}
+@end
+
+@interface NSString (HeadlessFontMetrics)
+- (CGSize) sizeWithFont:(UIFont *)font;
+@end
+
+@interface NSCoder (HeadlessGeometry)
+- (void) encodeCGRect:(CGRect)rect forKey:(NSString *)key;
+- (CGRect) decodeCGRectForKey:(NSString *)key;
+@end
+
+#endif // _IOSGLK_HEADLESS_UIKIT_H
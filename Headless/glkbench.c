@@ -0,0 +1,1156 @@
+/* glkbench.c: Microbenchmarks for the Glk API hot paths
+	for IosGlk, the iOS implementation of the Glk API.
+	Designed by Andrew Plotkin <erkyrath@eblong.com>
+	http://eblong.com/zarf/glk/
+*/
+
+/*	This is a Glk program, like glkmain.c. It's linked into the headless build as the iosglk-bench tool. Rather than playing a game, glk_main() runs each benchmark case in a tight loop against the public C API and writes a JSON report to stdout. (Glk window output goes nowhere, and NSLog goes to stderr, so stdout contains only the report.)
+
+	For each case we report the best and median ns/op over several repetitions, the throughput in bytes/sec (for cases that move text), and the number of malloc/calloc/realloc calls per op (on glibc, where we can interpose on the allocator; null elsewhere).
+
+	These environment variables adjust the run:
+		GLKBENCH_SCALE: multiply every case's op count (default 1.0)
+		GLKBENCH_REPS: repetitions per case (default 5)
+		GLKBENCH_FILTER: only run cases whose name contains this substring
+
+	Cases with a population open that many extra (empty) memory streams before they start, and close them afterwards.
+
+	Some cases also check their results. If one finds something wrong (as opposed to slow), it says so on stderr, its entry in the report gets "ok": false, and the tool exits with status 1 after writing the report. The file stream cases which count buffer activity add "flushcount" and "refillcount" to their entries (from the last repetition).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "glk.h"
+#include "gi_dispa.h"
+#include "iosglk_startup.h"
+
+/* Allocation counting. On glibc we can wrap the allocator entry points, which catches the ObjC runtime's object allocations as well as everything else. */
+#if defined(__GLIBC__)
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static unsigned long long alloc_count = 0;
+
+void *malloc(size_t size) {
+	__sync_fetch_and_add(&alloc_count, 1);
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size) {
+	__sync_fetch_and_add(&alloc_count, 1);
+	return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+	__sync_fetch_and_add(&alloc_count, 1);
+	return __libc_realloc(ptr, size);
+}
+
+#define HAS_ALLOC_COUNT (1)
+#define ALLOC_COUNT() (alloc_count)
+
+#else /* __GLIBC__ */
+
+#define HAS_ALLOC_COUNT (0)
+#define ALLOC_COUNT() (0)
+
+#endif /* __GLIBC__ */
+
+typedef struct bench_struct {
+	char *name;
+	void (*func)(glui32 count);
+	glui32 count; /* ops per repetition, before scaling */
+	glui32 bytesperop; /* text moved per op, or zero if not meaningful */
+	glui32 population; /* extra memory streams held open during the case */
+} bench_t;
+
+static winid_t mainwin = NULL;
+static strid_t memstr = NULL;
+
+/* Set by bench_fail() during a case; reset before each case. */
+static int bench_ok = 1;
+/* Set by the cases which report a file stream's flush and refill counts; -1 if the case doesn't. */
+static long long bench_flushcount = -1;
+static long long bench_refillcount = -1;
+
+/* Report a wrong result from the current case. */
+static void bench_fail(char *msg) {
+	fprintf(stderr, "glkbench: %s\n", msg);
+	bench_ok = 0;
+}
+
+#define MEMBUF_LEN (65536)
+static char membuf[MEMBUF_LEN];
+static char linebuf[MEMBUF_LEN];
+static glui32 linebuf_used = 0;
+static glui32 ulinebuf[MEMBUF_LEN/4];
+static glui32 ulinebuf_used = 0;
+
+static char *sample_string = "The quick brown fox jumps over the lazy dog.\n";
+#define SAMPLE_STRING_LEN (45)
+
+#define SAMPLE_UNI_LEN (64)
+static glui32 sample_uni[SAMPLE_UNI_LEN];
+
+static char *sample_line = "You are standing in an open field west of a white house.\n";
+#define SAMPLE_LINE_LEN (57)
+
+static double monotonic_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1.0e9 + (double)ts.tv_nsec;
+}
+
+static int compare_doubles(const void *p1, const void *p2) {
+	double v1 = *(const double *)p1;
+	double v2 = *(const double *)p2;
+	if (v1 < v2)
+		return -1;
+	if (v1 > v2)
+		return 1;
+	return 0;
+}
+
+/* Between repetitions, clear the buffer window so that scrollback growth from one rep doesn't distort the next. */
+static void reset_state(void) {
+	glk_window_clear(mainwin);
+	glk_stream_set_position(memstr, 0, seekmode_Start);
+	glk_stream_set_current(glk_window_get_stream(mainwin));
+}
+
+static void bench_put_char_window(glui32 count) {
+	glui32 ix;
+	for (ix=0; ix<count; ix++) {
+		if ((ix & 63) == 63)
+			glk_put_char('\n');
+		else
+			glk_put_char('a' + (ix % 26));
+	}
+}
+
+static void bench_put_string_window(glui32 count) {
+	glui32 ix;
+	for (ix=0; ix<count; ix++)
+		glk_put_string(sample_string);
+}
+
+/* A room heading and description: two style changes and one line per op. */
+static void bench_put_styled_window(glui32 count) {
+	glui32 ix;
+	for (ix=0; ix<count; ix++) {
+		glk_set_style(style_Subheader);
+		glk_put_string("West of House");
+		glk_set_style(style_Normal);
+		glk_put_char('\n');
+		glk_put_string(sample_line);
+	}
+}
+
+static void bench_put_buffer_uni_window(glui32 count) {
+	glui32 ix;
+	for (ix=0; ix<count; ix++)
+		glk_put_buffer_uni(sample_uni, SAMPLE_UNI_LEN);
+}
+
+/* Fill a 25-row grid window from a buffer of 80-column rows, as a full-screen status display or menu would. (If the grid is narrower than 80 columns, the rows wrap and the bottom is cut off; the writes cost the same either way.) */
+#define GRID_ROWS (25)
+#define GRID_COLS (80)
+static char grid_screen[GRID_ROWS*(GRID_COLS+1)];
+
+static void bench_put_buffer_grid(glui32 count) {
+	glui32 ix, jx;
+	winid_t gridwin = glk_window_open(mainwin, winmethod_Above+winmethod_Fixed, GRID_ROWS, wintype_TextGrid, 0);
+	if (!gridwin) {
+		bench_fail("unable to open grid window");
+		return;
+	}
+	for (ix=0; ix<GRID_ROWS; ix++) {
+		for (jx=0; jx<GRID_COLS; jx++)
+			grid_screen[ix*(GRID_COLS+1)+jx] = 'a' + ((ix+jx) % 26);
+		grid_screen[ix*(GRID_COLS+1)+GRID_COLS] = '\n';
+	}
+	for (ix=0; ix<count; ix++) {
+		glk_window_move_cursor(gridwin, 0, 0);
+		glk_put_buffer_stream(glk_window_get_stream(gridwin), grid_screen, sizeof(grid_screen));
+	}
+	glk_window_close(gridwin, NULL);
+}
+
+static void bench_put_char_memory(glui32 count) {
+	glui32 ix;
+	for (ix=0; ix<count; ix++) {
+		if ((ix % MEMBUF_LEN) == 0)
+			glk_stream_set_position(memstr, 0, seekmode_Start);
+		glk_put_char_stream(memstr, 'a' + (ix % 26));
+	}
+}
+
+static void bench_put_string_memory(glui32 count) {
+	glui32 ix;
+	glui32 perbuf = MEMBUF_LEN / SAMPLE_STRING_LEN;
+	for (ix=0; ix<count; ix++) {
+		if ((ix % perbuf) == 0)
+			glk_stream_set_position(memstr, 0, seekmode_Start);
+		glk_put_string_stream(memstr, sample_string);
+	}
+}
+
+static void bench_stream_open_close_memory(glui32 count) {
+	glui32 ix;
+	for (ix=0; ix<count; ix++) {
+		strid_t str = glk_stream_open_memory(membuf, 256, filemode_ReadWrite, 0);
+		glk_stream_close(str, NULL);
+	}
+}
+
+static void bench_get_line_stream(glui32 count) {
+	char buf[128];
+	glui32 ix;
+	strid_t str = glk_stream_open_memory(linebuf, linebuf_used, filemode_Read, 0);
+	for (ix=0; ix<count; ix++) {
+		if (glk_get_line_stream(str, buf, sizeof(buf)) == 0) {
+			glk_stream_set_position(str, 0, seekmode_Start);
+			glk_get_line_stream(str, buf, sizeof(buf));
+		}
+	}
+	glk_stream_close(str, NULL);
+}
+
+static void bench_get_line_stream_uni(glui32 count) {
+	glui32 buf[128];
+	glui32 ix;
+	strid_t str = glk_stream_open_memory_uni(ulinebuf, ulinebuf_used, filemode_Read, 0);
+	for (ix=0; ix<count; ix++) {
+		if (glk_get_line_stream_uni(str, buf, 128) == 0) {
+			glk_stream_set_position(str, 0, seekmode_Start);
+			glk_get_line_stream_uni(str, buf, 128);
+		}
+	}
+	glk_stream_close(str, NULL);
+}
+
+/* File streams (GlkStreamFile), on a scratch file in the library's data directory. The write cases put one line per op; the read case reads one line's worth per op from a file of sample lines, rewinding at the end. (Running these under strace -c shows the syscalls per KB.) */
+#define FILE_READ_LINES (1000)
+
+static strid_t open_bench_file_usage(glui32 usage, glui32 fmode, int unicode) {
+	frefid_t fref = glk_fileref_create_by_name(usage, "glkbench-file", 0);
+	if (!fref)
+		return NULL;
+	strid_t str;
+	if (unicode)
+		str = glk_stream_open_file_uni(fref, fmode, 0);
+	else
+		str = glk_stream_open_file(fref, fmode, 0);
+	glk_fileref_destroy(fref);
+	return str;
+}
+
+static strid_t open_bench_file(glui32 fmode, int unicode) {
+	return open_bench_file_usage(fileusage_Data|fileusage_BinaryMode, fmode, unicode);
+}
+
+static void delete_bench_file(void) {
+	frefid_t fref = glk_fileref_create_by_name(fileusage_Data|fileusage_BinaryMode, "glkbench-file", 0);
+	if (fref) {
+		glk_fileref_delete_file(fref);
+		glk_fileref_destroy(fref);
+	}
+}
+
+static void bench_file_write_binary(glui32 count) {
+	glui32 ix;
+	strid_t str = open_bench_file(filemode_Write, 0);
+	if (!str) {
+		bench_fail("unable to open file");
+		return;
+	}
+	for (ix=0; ix<count; ix++)
+		glk_put_buffer_stream(str, sample_line, SAMPLE_LINE_LEN);
+	glk_stream_close(str, NULL);
+	delete_bench_file();
+}
+
+/* The same, with write-behind turned on (so that full buffers are written by a background thread). This is in glkbench_objc.m, because the mode is normally chosen by the library delegate. */
+extern void glkbench_set_write_behind(strid_t str);
+
+static void bench_file_write_behind(glui32 count) {
+	glui32 ix;
+	strid_t str = open_bench_file(filemode_Write, 0);
+	if (!str) {
+		bench_fail("unable to open file");
+		return;
+	}
+	glkbench_set_write_behind(str);
+	for (ix=0; ix<count; ix++)
+		glk_put_buffer_stream(str, sample_line, SAMPLE_LINE_LEN);
+	glk_stream_close(str, NULL);
+	delete_bench_file();
+}
+
+/* A write-behind stream, opened for reading and writing, taking a random mix of writes (mostly short, some longer than a buffer), seeks, and reads. Every read is checked against a copy kept in memory, and so is the whole file after closing. This is a correctness check as much as a timing. */
+#define MIXED_FILE_LEN (400000)
+#define MIXED_BIG_WRITE (70000)
+static unsigned char mixed_ref[MIXED_FILE_LEN];
+static char mixed_buf[MIXED_BIG_WRITE];
+
+static void bench_file_write_behind_mixed(glui32 count) {
+	glui32 ix, jx, len;
+	glui32 filelen = 0;
+	glui32 pos = 0;
+	glui32 seed = 1;
+	int ok = 1;
+	
+	strid_t str = open_bench_file(filemode_Write, 0);
+	if (!str) {
+		bench_fail("unable to open file");
+		return;
+	}
+	glk_stream_close(str, NULL);
+	str = open_bench_file(filemode_ReadWrite, 0);
+	if (!str) {
+		bench_fail("unable to reopen file");
+		delete_bench_file();
+		return;
+	}
+	glkbench_set_write_behind(str);
+	
+	for (ix=0; ix<count; ix++) {
+		seed = seed * 1103515245 + 12345;
+		glui32 rnd = seed >> 8;
+		switch (rnd % 8) {
+			case 0: case 1: case 2: case 3: case 4:
+				len = 1 + (rnd >> 3) % 200;
+				if ((rnd % 8) == 4)
+					len = MIXED_BIG_WRITE - (rnd >> 3) % 100;
+				if (pos + len > MIXED_FILE_LEN) {
+					glk_stream_set_position(str, 0, seekmode_Start);
+					pos = 0;
+				}
+				for (jx=0; jx<len; jx++)
+					mixed_buf[jx] = (char)(ix + jx);
+				glk_put_buffer_stream(str, mixed_buf, len);
+				memcpy(mixed_ref+pos, mixed_buf, len);
+				pos += len;
+				if (pos > filelen)
+					filelen = pos;
+				break;
+			case 5:
+				pos = (rnd >> 3) % (filelen+1);
+				glk_stream_set_position(str, pos, seekmode_Start);
+				break;
+			case 6:
+				glk_stream_set_position(str, 0, seekmode_End);
+				pos = filelen;
+				break;
+			case 7:
+				len = 1 + (rnd >> 3) % 100;
+				if (len > filelen - pos)
+					len = filelen - pos;
+				if (glk_get_buffer_stream(str, mixed_buf, len) != len || memcmp(mixed_buf, mixed_ref+pos, len) != 0)
+					ok = 0;
+				pos += len;
+				break;
+		}
+		if (glk_stream_get_position(str) != pos)
+			ok = 0;
+	}
+	glk_stream_close(str, NULL);
+	
+	str = open_bench_file(filemode_Read, 0);
+	if (!str) {
+		bench_fail("unable to reopen file");
+		delete_bench_file();
+		return;
+	}
+	for (pos=0; pos<filelen; pos+=len) {
+		len = filelen - pos;
+		if (len > MIXED_BIG_WRITE)
+			len = MIXED_BIG_WRITE;
+		if (glk_get_buffer_stream(str, mixed_buf, len) != len || memcmp(mixed_buf, mixed_ref+pos, len) != 0) {
+			ok = 0;
+			break;
+		}
+	}
+	if (glk_get_char_stream(str) != -1)
+		ok = 0;
+	glk_stream_close(str, NULL);
+	delete_bench_file();
+	
+	if (!ok)
+		bench_fail("write-behind file contents are wrong");
+}
+
+static void bench_file_write_uni(glui32 count) {
+	glui32 ix;
+	strid_t str = open_bench_file(filemode_Write, 1);
+	if (!str) {
+		bench_fail("unable to open file");
+		return;
+	}
+	for (ix=0; ix<count; ix++)
+		glk_put_buffer_stream_uni(str, sample_uni, SAMPLE_UNI_LEN);
+	glk_stream_close(str, NULL);
+	delete_bench_file();
+}
+
+static void bench_file_read_binary(glui32 count) {
+	char buf[SAMPLE_LINE_LEN];
+	glui32 ix;
+	strid_t str = open_bench_file(filemode_Write, 0);
+	if (!str) {
+		bench_fail("unable to open file");
+		return;
+	}
+	for (ix=0; ix<FILE_READ_LINES; ix++)
+		glk_put_buffer_stream(str, sample_line, SAMPLE_LINE_LEN);
+	glk_stream_close(str, NULL);
+
+	str = open_bench_file(filemode_Read, 0);
+	for (ix=0; ix<count; ix++) {
+		if (glk_get_buffer_stream(str, buf, SAMPLE_LINE_LEN) < SAMPLE_LINE_LEN)
+			glk_stream_set_position(str, 0, seekmode_Start);
+	}
+	glk_stream_close(str, NULL);
+	delete_bench_file();
+}
+
+/* Unicode binary files (big-endian words), in bigger blocks: a transcript or save file written and read back 1024 characters at a time. The bytes_per_sec column is the throughput of the big-endian conversion plus the buffering. */
+#define FILE_UNI_BLOCK (1024)
+static glui32 uni_block[FILE_UNI_BLOCK];
+
+static void fill_uni_block(void) {
+	glui32 ix;
+	for (ix=0; ix<FILE_UNI_BLOCK; ix++)
+		uni_block[ix] = sample_uni[ix % SAMPLE_UNI_LEN];
+}
+
+static void bench_file_write_uni_block(glui32 count) {
+	glui32 ix;
+	fill_uni_block();
+	strid_t str = open_bench_file(filemode_Write, 1);
+	if (!str) {
+		bench_fail("unable to open file");
+		return;
+	}
+	for (ix=0; ix<count; ix++)
+		glk_put_buffer_stream_uni(str, uni_block, FILE_UNI_BLOCK);
+	glk_stream_close(str, NULL);
+	delete_bench_file();
+}
+
+static void bench_file_read_uni_block(glui32 count) {
+	glui32 ix;
+	fill_uni_block();
+	strid_t str = open_bench_file(filemode_Write, 1);
+	if (!str) {
+		bench_fail("unable to open file");
+		return;
+	}
+	for (ix=0; ix<64; ix++)
+		glk_put_buffer_stream_uni(str, uni_block, FILE_UNI_BLOCK);
+	glk_stream_close(str, NULL);
+
+	str = open_bench_file(filemode_Read, 1);
+	for (ix=0; ix<count; ix++) {
+		if (glk_get_buffer_stream_uni(str, uni_block, FILE_UNI_BLOCK) < FILE_UNI_BLOCK)
+			glk_stream_set_position(str, 0, seekmode_Start);
+	}
+	glk_stream_close(str, NULL);
+	delete_bench_file();
+}
+
+/* Text-mode (UTF-8) files, as transcripts and command scripts are. The write case puts a line of mostly-ASCII text per op, through the Unicode call as an interpreter's transcript does; the read case reads it back a line at a time. */
+static void bench_file_write_text(glui32 count) {
+	glui32 ix;
+	strid_t str = open_bench_file_usage(fileusage_Data|fileusage_TextMode, filemode_Write, 1);
+	if (!str) {
+		bench_fail("unable to open file");
+		return;
+	}
+	for (ix=0; ix<count; ix++) {
+		glk_put_string_stream(str, sample_line);
+		if ((ix & 15) == 15)
+			glk_put_buffer_stream_uni(str, sample_uni, SAMPLE_UNI_LEN);
+	}
+	glk_stream_close(str, NULL);
+	delete_bench_file();
+}
+
+static void bench_file_get_line_text(glui32 count) {
+	glui32 buf[128];
+	glui32 ix;
+	strid_t str = open_bench_file_usage(fileusage_Data|fileusage_TextMode, filemode_Write, 1);
+	if (!str) {
+		bench_fail("unable to open file");
+		return;
+	}
+	for (ix=0; ix<FILE_READ_LINES; ix++) {
+		glk_put_string_stream(str, sample_line);
+		if ((ix & 15) == 15)
+			glk_put_buffer_stream_uni(str, sample_uni, SAMPLE_UNI_LEN);
+	}
+	glk_stream_close(str, NULL);
+
+	str = open_bench_file_usage(fileusage_Data|fileusage_TextMode, filemode_Read, 1);
+	for (ix=0; ix<count; ix++) {
+		if (glk_get_line_stream_uni(str, buf, 128) == 0) {
+			glk_stream_set_position(str, 0, seekmode_Start);
+			glk_get_line_stream_uni(str, buf, 128);
+		}
+	}
+	glk_stream_close(str, NULL);
+	delete_bench_file();
+}
+
+/* Random access, as gi_blorb or an interpreter loading a story file does: seek to a scattered spot in a file of about a megabyte, and read 64 bytes. (Files opened for reading are memory-mapped, so this shouldn't touch the file at all.) */
+#define FILE_SEEK_LINES (20000)
+
+static void bench_file_seek_read(glui32 count) {
+	char buf[64];
+	glui32 ix;
+	glui32 filelen = FILE_SEEK_LINES * SAMPLE_LINE_LEN;
+	strid_t str = open_bench_file(filemode_Write, 0);
+	if (!str) {
+		bench_fail("unable to open file");
+		return;
+	}
+	for (ix=0; ix<FILE_SEEK_LINES; ix++)
+		glk_put_buffer_stream(str, sample_line, SAMPLE_LINE_LEN);
+	glk_stream_close(str, NULL);
+
+	str = open_bench_file(filemode_Read, 0);
+	for (ix=0; ix<count; ix++) {
+		glk_stream_set_position(str, (glsi32)(((unsigned long long)ix * 7919 * 61) % (filelen - sizeof(buf))), seekmode_Start);
+		glk_get_buffer_stream(str, buf, sizeof(buf));
+	}
+	glk_stream_close(str, NULL);
+	delete_bench_file();
+}
+
+/* Small seeks near the mark, which should land in the stream's buffer and cost nothing. The patch case writes records the way a Quetzal save does: a placeholder length, the body, then back to fill in the length and forward to the end again. The local case reads 16 bytes at a time, hopping back and forth within a window that creeps forward through the file (on a read/write stream, so that it isn't memory-mapped). Both check the stream's flush and refill counts (through glkbench_objc.m), which should come to a few per buffer's worth of data, not one per seek. (A patch that reaches back into the previous buffer costs two extra flushes.) */
+extern void glkbench_file_stream_counts(strid_t str, glui32 *flushesref, glui32 *refillsref);
+
+static void bench_file_seek_patch(glui32 count) {
+	glui32 ix;
+	glui32 flushes, refills;
+	unsigned char lenbuf[4];
+	strid_t str = open_bench_file(filemode_Write, 0);
+	if (!str) {
+		bench_fail("unable to open file");
+		return;
+	}
+	for (ix=0; ix<count; ix++) {
+		glui32 recpos = glk_stream_get_position(str);
+		memset(lenbuf, 0, 4);
+		glk_put_buffer_stream(str, (char *)lenbuf, 4);
+		glk_put_buffer_stream(str, sample_line, SAMPLE_LINE_LEN);
+		glui32 endpos = glk_stream_get_position(str);
+		lenbuf[3] = SAMPLE_LINE_LEN;
+		glk_stream_set_position(str, recpos, seekmode_Start);
+		glk_put_buffer_stream(str, (char *)lenbuf, 4);
+		glk_stream_set_position(str, endpos, seekmode_Start);
+	}
+	glkbench_file_stream_counts(str, &flushes, &refills);
+	glk_stream_close(str, NULL);
+	delete_bench_file();
+	
+	bench_flushcount = flushes;
+	bench_refillcount = refills;
+	if (flushes > 3 * ((count * (4+SAMPLE_LINE_LEN)) / 4096 + 1))
+		bench_fail("seek patch flushed about once per seek");
+}
+
+static void bench_file_seek_local(glui32 count) {
+	char buf[16];
+	glui32 ix;
+	glui32 flushes, refills;
+	glui32 filelen = FILE_SEEK_LINES * SAMPLE_LINE_LEN;
+	strid_t str = open_bench_file(filemode_Write, 0);
+	if (!str) {
+		bench_fail("unable to open file");
+		return;
+	}
+	for (ix=0; ix<FILE_SEEK_LINES; ix++)
+		glk_put_buffer_stream(str, sample_line, SAMPLE_LINE_LEN);
+	glk_stream_close(str, NULL);
+
+	str = open_bench_file(filemode_ReadWrite, 0);
+	for (ix=0; ix<count; ix++) {
+		glui32 pos = ((ix / 16) * 64 + (ix * 37) % 512) % (filelen - sizeof(buf));
+		glk_stream_set_position(str, pos, seekmode_Start);
+		glk_get_buffer_stream(str, buf, sizeof(buf));
+	}
+	glkbench_file_stream_counts(str, &flushes, &refills);
+	glk_stream_close(str, NULL);
+	delete_bench_file();
+	
+	bench_flushcount = flushes;
+	bench_refillcount = refills;
+	if (count >= 64 && refills > count / 4)
+		bench_fail("local seeks refilled about once per seek");
+}
+
+/* Line-by-line reading of a file, rewinding at the end. */
+static void bench_file_get_line(glui32 count) {
+	char buf[128];
+	glui32 ix;
+	strid_t str = open_bench_file(filemode_Write, 0);
+	if (!str) {
+		bench_fail("unable to open file");
+		return;
+	}
+	for (ix=0; ix<FILE_READ_LINES; ix++)
+		glk_put_buffer_stream(str, sample_line, SAMPLE_LINE_LEN);
+	glk_stream_close(str, NULL);
+
+	str = open_bench_file(filemode_Read, 0);
+	for (ix=0; ix<count; ix++) {
+		if (glk_get_line_stream(str, buf, sizeof(buf)) == 0) {
+			glk_stream_set_position(str, 0, seekmode_Start);
+			glk_get_line_stream(str, buf, sizeof(buf));
+		}
+	}
+	glk_stream_close(str, NULL);
+	delete_bench_file();
+}
+
+/* The same, over a 10 MB file, so that the reads go well past any one buffer. One op is one line, and one repetition reads the whole file. The file is written the first time the case runs (so the first repetition pays for that, and the median leaves it out) and deleted when the run ends. */
+#define BIGFILE_LEN (10*1024*1024)
+static int bigfile_ready = 0;
+
+static strid_t open_bench_bigfile(glui32 fmode) {
+	frefid_t fref = glk_fileref_create_by_name(fileusage_Data|fileusage_BinaryMode, "glkbench-bigfile", 0);
+	if (!fref)
+		return NULL;
+	strid_t str = glk_stream_open_file(fref, fmode, 0);
+	glk_fileref_destroy(fref);
+	return str;
+}
+
+static void delete_bench_bigfile(void) {
+	if (!bigfile_ready)
+		return;
+	frefid_t fref = glk_fileref_create_by_name(fileusage_Data|fileusage_BinaryMode, "glkbench-bigfile", 0);
+	if (fref) {
+		glk_fileref_delete_file(fref);
+		glk_fileref_destroy(fref);
+	}
+	bigfile_ready = 0;
+}
+
+static void bench_file_get_line_10mb(glui32 count) {
+	char buf[128];
+	glui32 ix;
+	strid_t str;
+	if (!bigfile_ready) {
+		str = open_bench_bigfile(filemode_Write);
+		if (!str) {
+			bench_fail("unable to open file");
+			return;
+		}
+		for (ix=0; ix<BIGFILE_LEN/SAMPLE_LINE_LEN; ix++)
+			glk_put_buffer_stream(str, sample_line, SAMPLE_LINE_LEN);
+		glk_stream_close(str, NULL);
+		bigfile_ready = 1;
+	}
+
+	str = open_bench_bigfile(filemode_Read);
+	for (ix=0; ix<count; ix++) {
+		if (glk_get_line_stream(str, buf, sizeof(buf)) == 0) {
+			glk_stream_set_position(str, 0, seekmode_Start);
+			glk_get_line_stream(str, buf, sizeof(buf));
+		}
+	}
+	glk_stream_close(str, NULL);
+}
+
+static void bench_window_open_close(glui32 count) {
+	glui32 ix;
+	for (ix=0; ix<count; ix++) {
+		winid_t win = glk_window_open(mainwin, winmethod_Above+winmethod_Fixed, 1, wintype_TextGrid, 0);
+		glk_window_close(win, NULL);
+	}
+}
+
+static void bench_dispatch_put_char(glui32 count) {
+	gluniversal_t arglist[1];
+	glui32 ix;
+	glk_stream_set_current(memstr);
+	for (ix=0; ix<count; ix++) {
+		if ((ix % MEMBUF_LEN) == 0)
+			glk_stream_set_position(memstr, 0, seekmode_Start);
+		arglist[0].uch = 'a' + (ix % 26);
+		gidispatch_call(0x0080, 1, arglist); /* put_char */
+	}
+	glk_stream_set_current(glk_window_get_stream(mainwin));
+}
+
+static void bench_dispatch_gestalt(glui32 count) {
+	gluniversal_t arglist[4];
+	glui32 ix;
+	for (ix=0; ix<count; ix++) {
+		arglist[0].uint = gestalt_CharOutput;
+		arglist[1].uint = 'a' + (ix % 26);
+		arglist[2].ptrflag = 1; /* we want the return value, in arglist[3] */
+		gidispatch_call(0x0004, 3, arglist); /* gestalt */
+	}
+}
+
+/* The lookup a VM does before every dispatched call: find the function entry, then its prototype. */
+static void bench_dispatch_lookup(glui32 count) {
+	static glui32 ids[8] = { 0x0004, 0x0080, 0x0082, 0x0084, 0x0086, 0x00C0, 0x0128, 0x0139 };
+	glui32 ix;
+	for (ix=0; ix<count; ix++) {
+		glui32 id = ids[ix & 7];
+		gidispatch_function_t *func = gidispatch_get_function_by_id(id);
+		char *proto = gidispatch_prototype(id);
+		if (!func || !proto)
+			break;
+	}
+}
+
+/* A Glulx-style call mix. For each call, look up the function and its prototype by id, as the VM does when it executes a glk opcode, then fill in the arguments and dispatch it. The mix is weighted toward character output, like a typical turn. (Calls per second is 1e9 / ns_per_op.) */
+static void bench_dispatch_glulx_mix(glui32 count) {
+	static glui32 ids[16] = {
+		0x0080, 0x0080, 0x0080, 0x0080, 0x0080, 0x0080, 0x0080, 0x0128,
+		0x0128, 0x0086, 0x0086, 0x0004, 0x00A0, 0x0046, 0x0048, 0x0028
+	};
+	gluniversal_t arglist[4];
+	glui32 ix, numargs;
+	glk_stream_set_current(memstr);
+	for (ix=0; ix<count; ix++) {
+		glui32 id = ids[ix & 15];
+		gidispatch_function_t *func = gidispatch_get_function_by_id(id);
+		char *proto = gidispatch_prototype(id);
+		if (!func || !proto)
+			break;
+		if ((ix % MEMBUF_LEN) == 0)
+			glk_stream_set_position(memstr, 0, seekmode_Start);
+		switch (id) {
+			case 0x0080: /* put_char */
+				arglist[0].uch = 'a' + (ix % 26);
+				numargs = 1;
+				break;
+			case 0x0128: /* put_char_uni */
+				arglist[0].uint = 0x3B1 + (ix % 24);
+				numargs = 1;
+				break;
+			case 0x0086: /* set_style */
+				arglist[0].uint = ((ix & 16) ? style_Emphasized : style_Normal);
+				numargs = 1;
+				break;
+			case 0x0004: /* gestalt */
+				arglist[0].uint = gestalt_CharOutput;
+				arglist[1].uint = 'a' + (ix % 26);
+				arglist[2].ptrflag = 1;
+				numargs = 3;
+				break;
+			case 0x00A0: /* char_to_lower */
+				arglist[0].uch = 'A' + (ix % 26);
+				arglist[1].ptrflag = 1;
+				numargs = 2;
+				break;
+			case 0x0046: /* stream_get_position */
+				arglist[0].opaqueref = memstr;
+				arglist[1].ptrflag = 1;
+				numargs = 2;
+				break;
+			case 0x0048: /* stream_get_current */
+				arglist[0].ptrflag = 1;
+				numargs = 1;
+				break;
+			default: /* window_get_type */
+				arglist[0].opaqueref = mainwin;
+				arglist[1].ptrflag = 1;
+				numargs = 2;
+				break;
+		}
+		gidispatch_call(id, numargs, arglist);
+	}
+	glk_stream_set_current(glk_window_get_stream(mainwin));
+}
+
+/* The twenty calls a Glulx game makes most often, weighted roughly as a turn of output would weight them. The operands are what the VM would pass: a Q operand indexes vm_objects, an S operand is nonzero for sample_string, an array operand is its length (the array is linebuf), and any other reference operand is nonzero for a non-NULL reference. */
+typedef struct vm_call_struct {
+	glui32 id;
+	glui32 operands[3];
+} vm_call_t;
+
+#define VM_CALL_COUNT (32)
+static vm_call_t vm_calls[VM_CALL_COUNT] = {
+	{ 0x0080, { 'T' } }, /* put_char */
+	{ 0x0080, { 'h' } },
+	{ 0x0080, { 'e' } },
+	{ 0x0080, { ' ' } },
+	{ 0x0080, { 'o' } },
+	{ 0x0080, { 'w' } },
+	{ 0x0080, { 'l' } },
+	{ 0x0080, { '.' } },
+	{ 0x0128, { 0x3B1 } }, /* put_char_uni */
+	{ 0x0128, { 0x3B2 } },
+	{ 0x0086, { style_Emphasized } }, /* set_style */
+	{ 0x0086, { style_Normal } },
+	{ 0x0082, { 1 } }, /* put_string */
+	{ 0x0084, { 16 } }, /* put_buffer */
+	{ 0x0004, { gestalt_CharOutput, 'a' } }, /* gestalt */
+	{ 0x0004, { gestalt_Unicode, 0 } },
+	{ 0x00A0, { 'Q' } }, /* char_to_lower */
+	{ 0x00A1, { 'q' } }, /* char_to_upper */
+	{ 0x0048, { 0 } }, /* stream_get_current */
+	{ 0x0047, { 2 } }, /* stream_set_current */
+	{ 0x002C, { 1 } }, /* window_get_stream */
+	{ 0x0028, { 1 } }, /* window_get_type */
+	{ 0x0022, { 0 } }, /* window_get_root */
+	{ 0x0029, { 1 } }, /* window_get_parent */
+	{ 0x0025, { 1, 1, 1 } }, /* window_get_size */
+	{ 0x0021, { 1 } }, /* window_get_rock */
+	{ 0x0020, { 0, 1 } }, /* window_iterate */
+	{ 0x0040, { 0, 1 } }, /* stream_iterate */
+	{ 0x0046, { 2 } }, /* stream_get_position */
+	{ 0x00C1, { 1 } }, /* select_poll */
+	{ 0x0080, { '\n' } },
+	{ 0x0080, { '>' } },
+};
+
+static void *vm_objects[3]; /* NULL, mainwin, memstr */
+
+/* Fill in an arglist from VM operands, walking the parsed prototype the way an interpreter does. Returns the number of slots used. */
+static glui32 marshal_vm_call(gidispatch_protodesc_t *desc, glui32 *operands, gluniversal_t *arglist) {
+	int ax, fx;
+	glui32 ox = 0, ix = 0;
+	for (ax=0; ax<desc->numargs; ax++) {
+		gidispatch_argdesc_t *arg = &desc->args[ax];
+		glui32 val;
+		if (arg->flags & gidispatch_arg_Return) {
+			arglist[ix++].ptrflag = 1;
+			ix++;
+			continue;
+		}
+		val = operands[ox++];
+		if (!(arg->flags & gidispatch_arg_Ref)) {
+			switch (arg->typeclass) {
+				case 'Q':
+					arglist[ix].opaqueref = vm_objects[val];
+					break;
+				case 'S':
+					arglist[ix].charstr = (val ? sample_string : NULL);
+					break;
+				case 'C':
+					arglist[ix].uch = val;
+					break;
+				default:
+					arglist[ix].uint = val;
+					break;
+			}
+			ix++;
+			continue;
+		}
+		arglist[ix++].ptrflag = (val != 0);
+		if (!val)
+			continue;
+		if (arg->flags & gidispatch_arg_Array) {
+			arglist[ix].array = linebuf;
+			arglist[ix+1].uint = val;
+		}
+		else if (arg->flags & gidispatch_arg_PassIn) {
+			for (fx=0; fx<arg->refslots; fx++)
+				arglist[ix+fx].uint = 0;
+		}
+		ix += arg->refslots;
+	}
+	return ix;
+}
+
+static void begin_vm_calls(void) {
+	vm_objects[0] = NULL;
+	vm_objects[1] = mainwin;
+	vm_objects[2] = memstr;
+	glk_stream_set_current(memstr);
+}
+
+/* The VM's glk opcode as interpreters do it today: fetch the prototype string and parse it on every call, then marshal and dispatch. */
+static void bench_dispatch_proto_string(glui32 count) {
+	gluniversal_t arglist[32];
+	gidispatch_protodesc_t desc;
+	glui32 ix;
+	begin_vm_calls();
+	for (ix=0; ix<count; ix++) {
+		vm_call_t *call = &vm_calls[ix % VM_CALL_COUNT];
+		if ((ix % VM_CALL_COUNT) == 0)
+			glk_stream_set_position(memstr, 0, seekmode_Start);
+		char *proto = gidispatch_prototype(call->id);
+		if (!proto || !gidispatch_parse_prototype(proto, &desc))
+			break;
+		glui32 numargs = marshal_vm_call(&desc, call->operands, arglist);
+		gidispatch_call(call->id, numargs, arglist);
+	}
+	glk_stream_set_current(glk_window_get_stream(mainwin));
+}
+
+/* The same calls through the cached descriptor (gidispatch_call_desc): no string parsing, and no lookup of the function id. */
+static void bench_dispatch_proto_desc(glui32 count) {
+	gluniversal_t arglist[32];
+	glui32 ix;
+	begin_vm_calls();
+	for (ix=0; ix<count; ix++) {
+		vm_call_t *call = &vm_calls[ix % VM_CALL_COUNT];
+		if ((ix % VM_CALL_COUNT) == 0)
+			glk_stream_set_position(memstr, 0, seekmode_Start);
+		gidispatch_protodesc_t *desc = gidispatch_get_protodesc(call->id);
+		if (!desc)
+			break;
+		glui32 numargs = marshal_vm_call(desc, call->operands, arglist);
+		gidispatch_call_desc(desc, numargs, arglist);
+	}
+	glk_stream_set_current(glk_window_get_stream(mainwin));
+}
+
+/* One turn of output to the main window, followed by the state clone that glk_select() does. This is in glkbench_objc.m. The scrollback is the number of lines already in the window; the clone should only pay for the new line, however long the scrollback. (The library trims the window back to 100 lines once it reaches 200, so the long case runs with between 100 and 200 lines of scrollback.) */
+extern int glkbench_buffer_clone_turns(winid_t win, glui32 count, glui32 scrollback);
+
+static void bench_buffer_clone_turn_10(glui32 count) {
+	if (!glkbench_buffer_clone_turns(mainwin, count, 10))
+		bench_fail("buffer clone failed");
+}
+
+static void bench_buffer_clone_turn_190(glui32 count) {
+	if (!glkbench_buffer_clone_turns(mainwin, count, 190))
+		bench_fail("buffer clone failed");
+}
+
+/* A status window redrawn every turn, followed by the state clone. In the unchanged case the same text is drawn each time, so nothing should be sent to the view; in the changing case the move count ticks up. The busy case is a three-row window whose rows have several style runs each; its allocs/op is the per-turn cost of snapshotting a status window. This is in glkbench_objc.m. */
+extern int glkbench_grid_status_turns(winid_t win, glui32 count, glui32 rows, int changing);
+
+static void bench_grid_status_unchanged(glui32 count) {
+	if (!glkbench_grid_status_turns(mainwin, count, 1, 0))
+		bench_fail("grid status failed (or sent unchanged lines)");
+}
+
+static void bench_grid_status_changing(glui32 count) {
+	if (!glkbench_grid_status_turns(mainwin, count, 1, 1))
+		bench_fail("grid status failed");
+}
+
+static void bench_grid_status_busy(glui32 count) {
+	if (!glkbench_grid_status_turns(mainwin, count, 3, 1))
+		bench_fail("grid status failed");
+}
+
+/* Scrollback spilled to disk (GlkScrollbackSpill). The write cases spill one line per op, flushing every 100 lines (the default trim) or every 4 (a byte budget trimming a few lines per turn). The page-in cases read one line, or a 50-line screenful, from a scattered spot in a 100000-line history. These are in glkbench_objc.m. */
+extern int glkbench_spill_writes(glui32 count, glui32 perflush);
+extern int glkbench_spill_pageins(glui32 count, glui32 history, glui32 pagelen);
+extern void glkbench_spill_cleanup(void);
+
+static void bench_spill_write_100(glui32 count) {
+	if (!glkbench_spill_writes(count, 100))
+		bench_fail("spill write failed");
+}
+
+static void bench_spill_write_4(glui32 count) {
+	if (!glkbench_spill_writes(count, 4))
+		bench_fail("spill write failed");
+}
+
+static void bench_spill_pagein_line(glui32 count) {
+	if (!glkbench_spill_pageins(count, 100000, 1))
+		bench_fail("spill page-in failed");
+}
+
+static void bench_spill_pagein_page(glui32 count) {
+	if (!glkbench_spill_pageins(count, 100000, 50))
+		bench_fail("spill page-in failed");
+}
+
+/* Step through the stream list, starting over at the end. Each op is one glk_stream_iterate() call, so with a large population this shows whether iteration is linear overall. */
+static void bench_stream_iterate(glui32 count) {
+	glui32 ix;
+	strid_t str = NULL;
+	for (ix=0; ix<count; ix++)
+		str = glk_stream_iterate(str, NULL);
+}
+
+/* Look up open streams by tag, as the library does when restoring or delivering events. This is in glkbench_objc.m, because tags aren't visible through the C API. Run it with different populations to see whether the cost depends on the number of open objects. */
+extern int glkbench_stream_tag_lookups(glui32 count);
+
+static void bench_stream_tag_lookup(glui32 count) {
+	if (!glkbench_stream_tag_lookups(count))
+		bench_fail("stream tag lookup failed");
+}
+
+static bench_t benches[] = {
+	{ "put_char_window", bench_put_char_window, 1000000, 1, 0 },
+	{ "put_string_window", bench_put_string_window, 100000, SAMPLE_STRING_LEN, 0 },
+	{ "put_styled_window", bench_put_styled_window, 50000, 14+SAMPLE_LINE_LEN, 0 },
+	{ "put_buffer_uni_window", bench_put_buffer_uni_window, 50000, SAMPLE_UNI_LEN*4, 0 },
+	{ "put_buffer_grid", bench_put_buffer_grid, 20000, GRID_ROWS*(GRID_COLS+1), 0 },
+	{ "put_char_memory", bench_put_char_memory, 2000000, 1, 0 },
+	{ "put_string_memory", bench_put_string_memory, 200000, SAMPLE_STRING_LEN, 0 },
+	{ "stream_open_close_memory", bench_stream_open_close_memory, 100000, 0, 0 },
+	{ "get_line_stream", bench_get_line_stream, 200000, SAMPLE_LINE_LEN, 0 },
+	{ "get_line_stream_uni", bench_get_line_stream_uni, 200000, SAMPLE_UNI_LEN*4, 0 },
+	{ "file_write_binary", bench_file_write_binary, 200000, SAMPLE_LINE_LEN, 0 },
+	{ "file_write_behind", bench_file_write_behind, 200000, SAMPLE_LINE_LEN, 0 },
+	{ "file_write_behind_mixed", bench_file_write_behind_mixed, 20000, 0, 0 },
+	{ "file_write_uni", bench_file_write_uni, 100000, SAMPLE_UNI_LEN*4, 0 },
+	{ "file_read_binary", bench_file_read_binary, 200000, SAMPLE_LINE_LEN, 0 },
+	{ "file_write_uni_block", bench_file_write_uni_block, 20000, FILE_UNI_BLOCK*4, 0 },
+	{ "file_read_uni_block", bench_file_read_uni_block, 20000, FILE_UNI_BLOCK*4, 0 },
+	{ "file_write_text", bench_file_write_text, 200000, SAMPLE_LINE_LEN, 0 },
+	{ "file_get_line_text", bench_file_get_line_text, 200000, SAMPLE_LINE_LEN, 0 },
+	{ "file_seek_read", bench_file_seek_read, 500000, 64, 0 },
+	{ "file_seek_patch", bench_file_seek_patch, 200000, 8+SAMPLE_LINE_LEN, 0 },
+	{ "file_seek_local", bench_file_seek_local, 500000, 16, 0 },
+	{ "file_get_line", bench_file_get_line, 200000, SAMPLE_LINE_LEN, 0 },
+	{ "file_get_line_10mb", bench_file_get_line_10mb, BIGFILE_LEN/SAMPLE_LINE_LEN, SAMPLE_LINE_LEN, 0 },
+	{ "window_open_close", bench_window_open_close, 10000, 0, 0 },
+	{ "dispatch_put_char", bench_dispatch_put_char, 2000000, 1, 0 },
+	{ "dispatch_gestalt", bench_dispatch_gestalt, 2000000, 0, 0 },
+	{ "dispatch_lookup", bench_dispatch_lookup, 2000000, 0, 0 },
+	{ "dispatch_glulx_mix", bench_dispatch_glulx_mix, 2000000, 0, 0 },
+	{ "dispatch_proto_string", bench_dispatch_proto_string, 1000000, 0, 0 },
+	{ "dispatch_proto_desc", bench_dispatch_proto_desc, 1000000, 0, 0 },
+	{ "buffer_clone_turn_10", bench_buffer_clone_turn_10, 20000, 0, 0 },
+	{ "buffer_clone_turn_190", bench_buffer_clone_turn_190, 20000, 0, 0 },
+	{ "grid_status_unchanged", bench_grid_status_unchanged, 50000, 0, 0 },
+	{ "grid_status_changing", bench_grid_status_changing, 50000, 0, 0 },
+	{ "grid_status_busy", bench_grid_status_busy, 50000, 0, 0 },
+	{ "spill_write_100", bench_spill_write_100, 200000, 0, 0 },
+	{ "spill_write_4", bench_spill_write_4, 100000, 0, 0 },
+	{ "spill_pagein_line", bench_spill_pagein_line, 100000, 0, 0 },
+	{ "spill_pagein_page", bench_spill_pagein_page, 20000, 0, 0 },
+	{ "stream_tag_lookup_10", bench_stream_tag_lookup, 1000000, 0, 10 },
+	{ "stream_tag_lookup_1000", bench_stream_tag_lookup, 1000000, 0, 1000 },
+	{ "stream_tag_lookup_10000", bench_stream_tag_lookup, 1000000, 0, 10000 },
+	{ "stream_iterate_10", bench_stream_iterate, 1000000, 0, 10 },
+	{ "stream_iterate_10000", bench_stream_iterate, 1000000, 0, 10000 },
+	{ NULL, NULL, 0, 0, 0 }
+};
+
+void iosglk_startup_code() {
+}
+
+void glk_main() {
+	double scale = 1.0;
+	int reps = 5;
+	char *filter = NULL;
+	char *val;
+	int ix, rx;
+	glui32 px;
+	int first = 1;
+	int anyfailed = 0;
+
+	val = getenv("GLKBENCH_SCALE");
+	if (val && atof(val) > 0)
+		scale = atof(val);
+	val = getenv("GLKBENCH_REPS");
+	if (val && atoi(val) > 0)
+		reps = atoi(val);
+	filter = getenv("GLKBENCH_FILTER");
+
+	mainwin = glk_window_open(NULL, 0, 0, wintype_TextBuffer, 1);
+	if (!mainwin) {
+		fprintf(stderr, "glkbench: unable to open main window\n");
+		return;
+	}
+	glk_set_window(mainwin);
+	memstr = glk_stream_open_memory(membuf, MEMBUF_LEN, filemode_ReadWrite, 2);
+
+	for (ix=0; ix<SAMPLE_UNI_LEN-1; ix++)
+		sample_uni[ix] = 0x3B1 + (ix % 24); /* Greek lowercase */
+	sample_uni[SAMPLE_UNI_LEN-1] = '\n';
+
+	linebuf_used = 0;
+	while (linebuf_used + SAMPLE_LINE_LEN <= MEMBUF_LEN) {
+		memcpy(linebuf+linebuf_used, sample_line, SAMPLE_LINE_LEN);
+		linebuf_used += SAMPLE_LINE_LEN;
+	}
+	ulinebuf_used = 0;
+	while (ulinebuf_used + SAMPLE_UNI_LEN <= MEMBUF_LEN/4) {
+		memcpy(ulinebuf+ulinebuf_used, sample_uni, SAMPLE_UNI_LEN*sizeof(glui32));
+		ulinebuf_used += SAMPLE_UNI_LEN;
+	}
+
+	double *samples = malloc(sizeof(double) * reps);
+
+	printf("{\n  \"suite\": \"glkbench\",\n  \"scale\": %g,\n  \"reps\": %d,\n  \"results\": [", scale, reps);
+
+	for (ix=0; benches[ix].name; ix++) {
+		bench_t *bench = &benches[ix];
+		if (filter && !strstr(bench->name, filter))
+			continue;
+
+		glui32 count = (glui32)(bench->count * scale);
+		if (count < 1)
+			count = 1;
+
+		strid_t *population = NULL;
+		if (bench->population) {
+			population = malloc(sizeof(strid_t) * bench->population);
+			for (px=0; px<bench->population; px++)
+				population[px] = glk_stream_open_memory(NULL, 0, filemode_Write, 0);
+		}
+
+		bench_ok = 1;
+		bench_flushcount = -1;
+		bench_refillcount = -1;
+		unsigned long long allocs = 0;
+		for (rx=0; rx<reps; rx++) {
+			reset_state();
+			unsigned long long allocstart = ALLOC_COUNT();
+			double start = monotonic_ns();
+			bench->func(count);
+			double end = monotonic_ns();
+			unsigned long long allocend = ALLOC_COUNT();
+			samples[rx] = (end - start) / (double)count;
+			if (rx == 0 || allocend - allocstart < allocs)
+				allocs = allocend - allocstart;
+		}
+
+		if (population) {
+			for (px=0; px<bench->population; px++)
+				glk_stream_close(population[px], NULL);
+			free(population);
+		}
+
+		qsort(samples, reps, sizeof(double), compare_doubles);
+		double best = samples[0];
+		double median = samples[reps/2];
+
+		printf("%s\n    { \"name\": \"%s\", \"ops\": %u, \"ns_per_op\": %.2f, \"ns_per_op_best\": %.2f",
+			(first ? "" : ","), bench->name, count, median, best);
+		if (bench->bytesperop)
+			printf(", \"bytes_per_sec\": %.0f", (double)bench->bytesperop * 1.0e9 / median);
+		else
+			printf(", \"bytes_per_sec\": null");
+		if (HAS_ALLOC_COUNT)
+			printf(", \"allocs_per_op\": %.3f", (double)allocs / (double)count);
+		else
+			printf(", \"allocs_per_op\": null");
+		if (bench_flushcount >= 0)
+			printf(", \"flushcount\": %lld, \"refillcount\": %lld", bench_flushcount, bench_refillcount);
+		printf(", \"ok\": %s", (bench_ok ? "true" : "false"));
+		if (!bench_ok)
+			anyfailed = 1;
+		printf(" }");
+		fflush(stdout);
+		first = 0;
+	}
+
+	printf("\n  ]\n}\n");
+	fflush(stdout);
+
+	free(samples);
+	glkbench_spill_cleanup();
+	delete_bench_bigfile();
+	glk_stream_close(memstr, NULL);
+	memstr = NULL;
+
+	if (anyfailed) {
+		fprintf(stderr, "glkbench: some cases failed\n");
+		exit(1);
+	}
+}
@@ -0,0 +1,229 @@
+/* glkbench_objc.m: Microbenchmark cases which need the library's classes
+	for IosGlk, the iOS implementation of the Glk API.
+	Designed by Andrew Plotkin <erkyrath@eblong.com>
+	http://eblong.com/zarf/glk/
+*/
+
+/*	Some hot paths (tag lookups, for example) aren't reachable through the C API. The cases for those live here and are called from glkbench.c.
+*/
+
+#import "GlkLibrary.h"
+#import "GlkStream.h"
+#import "GlkLibraryState.h"
+#import "GlkWindowState.h"
+#import "GlkUtilTypes.h"
+#import "GlkScrollbackSpill.h"
+#include "glk.h"
+
+/* Look up open streams by tag, alternating between the GlkTag and glui32 forms. The streams are visited in a scattered order, so that we're not just measuring the front of a list. Returns 0 if any lookup comes back wrong. */
+int glkbench_stream_tag_lookups(glui32 count) {
+	GlkLibrary *library = [GlkLibrary singleton];
+	NSArray *streams = library.streams;
+	NSUInteger num = streams.count;
+	if (!num)
+		return 0;
+
+	for (glui32 ix=0; ix<count; ix++) {
+		GlkStream *str = [streams objectAtIndex:((NSUInteger)ix * 7919) % num];
+		GlkStream *found;
+		if (ix & 1)
+			found = [library streamForIntTag:(glui32)str.tag];
+		else
+			found = [library streamForTag:str.tag];
+		if (found != str)
+			return 0;
+	}
+
+	return 1;
+}
+
+/* Simulate turns in a buffer window which already has scrollback lines of text: each op prints a line and then clones the library state, as glk_select() does. Returns 0 if the window isn't a buffer window. */
+int glkbench_buffer_clone_turns(winid_t win, glui32 count, glui32 scrollback) {
+	GlkLibrary *library = [GlkLibrary singleton];
+	if (glk_window_get_type(win) != wintype_TextBuffer)
+		return 0;
+	strid_t str = glk_window_get_stream(win);
+
+	glk_window_clear(win);
+	for (glui32 ix=0; ix<scrollback; ix++)
+		glk_put_string_stream(str, "Some earlier text which has already been shown.\n");
+	[library cloneState];
+
+	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+	for (glui32 ix=0; ix<count; ix++) {
+		glk_put_string_stream(str, "You are standing in an open field west of a white house.\n");
+		[library cloneState];
+		if ((ix & 255) == 255) {
+			[pool drain];
+			pool = [[NSAutoreleasePool alloc] init];
+		}
+	}
+	[pool drain];
+
+	return 1;
+}
+
+/* Simulate turns with a status window above the given window: each op clears the status window, redraws it, and then clones the library state. The first row is a room name and score; a busy three-row window adds a row of labelled stats and a row of exits, with the labels in a different style, so that each row has several style runs. If changing is set, the move count goes up every turn (so the first row really changes); otherwise the same text is drawn every time. Returns 0 if the status window couldn't be opened, or if an unchanged line was sent to the view anyway. */
+int glkbench_grid_status_turns(winid_t win, glui32 count, glui32 rows, int changing) {
+	GlkLibrary *library = [GlkLibrary singleton];
+	winid_t statuswin = glk_window_open(win, winmethod_Above|winmethod_Fixed, rows, wintype_TextGrid, 0);
+	if (!statuswin)
+		return 0;
+	strid_t str = glk_window_get_stream(statuswin);
+	char buf[64];
+	int res = 1;
+
+	[library cloneState];
+
+	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+	for (glui32 ix=0; ix<count; ix++) {
+		glk_window_clear(statuswin);
+		glk_window_move_cursor(statuswin, 1, 0);
+		glk_set_style_stream(str, style_Subheader);
+		glk_put_string_stream(str, "West of House");
+		glk_set_style_stream(str, style_Normal);
+		glk_window_move_cursor(statuswin, 20, 0);
+		snprintf(buf, sizeof(buf), "Score: 0  Moves: %lu", (unsigned long)(changing ? ix : 0));
+		glk_put_string_stream(str, buf);
+		if (rows >= 3) {
+			glk_window_move_cursor(statuswin, 1, 1);
+			glk_set_style_stream(str, style_Emphasized);
+			glk_put_string_stream(str, "HP ");
+			glk_set_style_stream(str, style_Normal);
+			glk_put_string_stream(str, "12/20 ");
+			glk_set_style_stream(str, style_Emphasized);
+			glk_put_string_stream(str, "MP ");
+			glk_set_style_stream(str, style_Normal);
+			glk_put_string_stream(str, "3/8 ");
+			glk_set_style_stream(str, style_Emphasized);
+			glk_put_string_stream(str, "Gold ");
+			glk_set_style_stream(str, style_Normal);
+			glk_put_string_stream(str, "47");
+			glk_window_move_cursor(statuswin, 1, 2);
+			glk_set_style_stream(str, style_Emphasized);
+			glk_put_string_stream(str, "Exits: ");
+			glk_set_style_stream(str, style_Normal);
+			glk_put_string_stream(str, "north south east");
+		}
+
+		GlkLibraryState *state = [library cloneState];
+		if (!changing) {
+			for (GlkWindowState *winstate in state.windows) {
+				if (winstate.type == wintype_TextGrid && ((GlkWindowGridState *)winstate).lines.count)
+					res = 0;
+			}
+		}
+		if ((ix & 255) == 255) {
+			[pool drain];
+			pool = [[NSAutoreleasePool alloc] init];
+		}
+	}
+	[pool drain];
+
+	glk_window_close(statuswin, NULL);
+	return res;
+}
+
+/* A typical line of scrollback: a sentence with one emphasized word, so that it has three runs. */
+static GlkStyledLine *spill_sample_line(int index) {
+	static glui32 text[60];
+	for (int ix=0; ix<60; ix++)
+		text[ix] = "You are standing in an open field west of a white house.   "[ix];
+	GlkStyledLine *sln = [[[GlkStyledLine alloc] initWithIndex:index status:linestat_NewLine] autorelease];
+	[sln appendChars:text len:33 style:style_Normal];
+	[sln appendChars:text+33 len:5 style:style_Emphasized];
+	[sln appendChars:text+38 len:22 style:style_Normal];
+	return sln;
+}
+
+/* Spill lines to disk the way a buffer window's cloneState does: each op spills one line, and every perflush lines are written out together. (With the default budget, a window trims 100 lines at a time; a byte budget can make it trim a few lines every turn.) Returns 0 if the spill files can't be created. */
+int glkbench_spill_writes(glui32 count, glui32 perflush) {
+	GlkScrollbackSpill *spill = [[GlkScrollbackSpill alloc] initWithDirectory:NSTemporaryDirectory() name:@"glkbench-spill-write"];
+	if (!spill)
+		return 0;
+
+	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+	GlkStyledLine *sln = spill_sample_line(0);
+	for (glui32 ix=0; ix<count; ix++) {
+		sln.index = ix;
+		[spill appendLine:sln];
+		if ((ix % perflush) == perflush-1)
+			[spill flush];
+	}
+	[spill flush];
+	[pool drain];
+
+	[spill discard];
+	[spill release];
+	return 1;
+}
+
+/* A spill holding a long history, for the page-in cases. It's built on first use (so the first repetition pays for that) and discarded by glkbench_spill_cleanup(). */
+static GlkScrollbackSpill *pageinspill = nil;
+
+/* Page lines back in from a spill of the given history length: each op reads pagelen consecutive lines from a scattered position, as the UI would when the player scrolls up into the spilled region. Returns 0 if the spill can't be built or a read comes back short. */
+int glkbench_spill_pageins(glui32 count, glui32 history, glui32 pagelen) {
+	if (pageinspill && pageinspill.count != history) {
+		[pageinspill discard];
+		[pageinspill release];
+		pageinspill = nil;
+	}
+	if (!pageinspill) {
+		pageinspill = [[GlkScrollbackSpill alloc] initWithDirectory:NSTemporaryDirectory() name:@"glkbench-spill-pagein"]; // retained
+		if (!pageinspill)
+			return 0;
+		NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+		GlkStyledLine *sln = spill_sample_line(0);
+		for (glui32 ix=0; ix<history; ix++) {
+			sln.index = ix;
+			[pageinspill appendLine:sln];
+			if ((ix & 1023) == 1023)
+				[pageinspill flush];
+		}
+		[pageinspill flush];
+		[pool drain];
+	}
+
+	int res = 1;
+	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+	for (glui32 ix=0; ix<count; ix++) {
+		int start = (int)(((unsigned long long)ix * 7919) % (history - pagelen + 1));
+		NSArray *arr = [pageinspill linesFrom:start count:pagelen];
+		if (arr.count != pagelen)
+			res = 0;
+		if ((ix & 255) == 255) {
+			[pool drain];
+			pool = [[NSAutoreleasePool alloc] init];
+		}
+	}
+	[pool drain];
+
+	return res;
+}
+
+void glkbench_spill_cleanup() {
+	if (pageinspill) {
+		[pageinspill discard];
+		[pageinspill release];
+		pageinspill = nil;
+	}
+}
+
+/* Turn on write-behind for a file stream, as if the library delegate had asked for it. */
+void glkbench_set_write_behind(strid_t str) {
+	if (![str isKindOfClass:[GlkStreamFile class]])
+		return;
+	GlkStreamFile *filestr = (GlkStreamFile *)str;
+	filestr.writebehind = YES;
+}
+
+/* Report how many times a file stream has flushed its buffer and refilled it from the file. */
+void glkbench_file_stream_counts(strid_t str, glui32 *flushesref, glui32 *refillsref) {
+	*flushesref = 0;
+	*refillsref = 0;
+	if (![str isKindOfClass:[GlkStreamFile class]])
+		return;
+	GlkStreamFile *filestr = (GlkStreamFile *)str;
+	*flushesref = filestr.flushcount;
+	*refillsref = filestr.refillcount;
+}
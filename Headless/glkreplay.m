@@ -0,0 +1,115 @@
+/* glkreplay.m: Replay a recorded dispatch trace against the headless library
+	for IosGlk, the iOS implementation of the Glk API.
+	Designed by Andrew Plotkin <erkyrath@eblong.com>
+	http://eblong.com/zarf/glk/
+*/
+
+/*	This is the Glk program for the iosglk-replay tool. Rather than running a game, glk_main() reads a trace (recorded with gitrace_start(); see gi_trace.h) and replays it, making the same dispatch calls in the same order. Recorded input events are queued through [GlkAppWrapper acceptEvent:], so each glk_select() goes through the normal headless select path, including cloneState.
+
+	The trace is replayed several times, each time against a freshly-cleared library, and the timings are written to stdout as JSON.
+
+	These environment variables control the run:
+		GLKREPLAY_FILE: the trace file (required)
+		GLKREPLAY_REPS: how many times to replay it (default 5)
+
+	Run this with stdin at EOF (</dev/null). If a recorded event is not acceptable to the library (which means the replay has diverged), the headless wrapper falls back to reading stdin, and EOF stops the replay.
+*/
+
+#import "GlkLibrary.h"
+#import "GlkWindow.h"
+#import "GlkAppWrapper.h"
+#include <time.h>
+#include "glk.h"
+#include "gi_dispa.h"
+#include "gi_trace.h"
+#include "iosglk_startup.h"
+
+static double monotonic_ns() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1.0e9 + (double)ts.tv_nsec;
+}
+
+/* Turn a recorded event into a GlkEventState and queue it, as the UI would. Arrange and redraw events can't be synthesized; the select is skipped. */
+static int queue_event(event_t *ev, void *linebuf, glui32 linelen, int unicode) {
+	GlkAppWrapper *appwrap = [GlkAppWrapper singleton];
+	GlkWindow *win = (GlkWindow *)ev->win;
+	NSString *str;
+
+	switch (ev->type) {
+		case evtype_LineInput:
+			if (!win)
+				return 0;
+			if (!unicode)
+				str = [[NSString alloc] initWithBytes:linebuf length:linelen encoding:NSISOLatin1StringEncoding];
+			else
+				str = [[NSString alloc] initWithBytes:linebuf length:linelen*sizeof(glui32) encoding:NSUTF32LittleEndianStringEncoding];
+			[appwrap acceptEvent:[GlkEventState lineEvent:str inWindow:win.tag]];
+			[str release];
+			return 1;
+		case evtype_CharInput:
+			if (!win)
+				return 0;
+			[appwrap acceptEvent:[GlkEventState charEvent:ev->val1 inWindow:win.tag]];
+			return 1;
+		case evtype_Timer:
+			[appwrap acceptEvent:[GlkEventState timerEvent]];
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+void iosglk_startup_code() {
+}
+
+void glk_main() {
+	char *pathname = getenv("GLKREPLAY_FILE");
+	int reps = 5;
+	char *val = getenv("GLKREPLAY_REPS");
+	if (val && atoi(val) > 0)
+		reps = atoi(val);
+
+	if (!pathname) {
+		fprintf(stderr, "glkreplay: set GLKREPLAY_FILE to the trace to replay\n");
+		return;
+	}
+
+	GlkLibrary *library = [GlkLibrary singleton];
+
+	printf("{\n  \"suite\": \"glkreplay\",\n  \"trace\": \"%s\",\n  \"results\": [", pathname);
+
+	for (int rx=0; rx<reps; rx++) {
+		FILE *fl = fopen(pathname, "rb");
+		if (!fl) {
+			fprintf(stderr, "glkreplay: unable to open %s\n", pathname);
+			break;
+		}
+
+		glui32 callcount = 0;
+		int res = 0;
+		double start = monotonic_ns();
+		@try {
+			res = gitrace_replay(fl, queue_event, &callcount);
+		} @catch (GlkExitException *ex) {
+			fprintf(stderr, "glkreplay: replay diverged (glk_exit) on rep %d\n", rx);
+		}
+		double end = monotonic_ns();
+		fclose(fl);
+
+		/* Close everything the trace left open, then free the buffers those objects were using. */
+		[library clearForRestart];
+		gitrace_replay_free();
+
+		printf("%s\n    { \"rep\": %d, \"ok\": %s, \"calls\": %u, \"ms\": %.3f, \"ns_per_call\": %.1f }",
+			(rx ? "," : ""), rx, (res ? "true" : "false"), callcount, (end-start) / 1.0e6,
+			(callcount ? (end-start) / callcount : 0.0));
+		fflush(stdout);
+
+		if (!res)
+			break;
+	}
+
+	printf("\n  ]\n}\n");
+	fflush(stdout);
+}
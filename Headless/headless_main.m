@@ -0,0 +1,67 @@
+/* headless_main.m: Top main() function for the headless build
+	for IosGlk, the iOS implementation of the Glk API.
+	Designed by Andrew Plotkin <erkyrath@eblong.com>
+	http://eblong.com/zarf/glk/
+*/
+
+/*	Sets up a GlkLibrary with the null delegate and a fixed-size frame, then runs glk_main() on the main thread. Input lines are read from stdin; see HeadlessAppWrapper.m.
+
+	Usage: iosglk-headless [width height]
+	(The frame size is in points; the default is 320x480.)
+
+	If GLKTRACE_RECORD is set in the environment, every dispatch call the program makes is recorded to that file (see gi_trace.h). That's only useful for Glk programs which go through the dispatch layer, such as interpreters. The iosglk-replay tool plays a trace back.
+
+	If the library was built with IOSGLK_TURN_TIMING, the per-turn timing report (see GlkTurnTiming.h) is written to stderr at exit.
+
+	If GLKHEADLESS_SCROLLBACK_REPORT is set, the scrollback memory used by each buffer window is written to stderr at exit. GLKHEADLESS_SCROLLBACK_LINES and GLKHEADLESS_SCROLLBACK_BYTES set the scrollback budget, and GLKHEADLESS_SCROLLBACK_SPILL turns on spilling (see HeadlessLibDelegate.m).
+
+	If GLKHEADLESS_WRITE_BEHIND is set, file streams opened for writing hand their full buffers to a background thread (see GlkStreamFileWriter in GlkStream.m).
+*/
+
+#import "GlkLibrary.h"
+#import "GlkAppWrapper.h"
+#import "HeadlessLibDelegate.h"
+#import "GlkTurnTiming.h"
+#include "gi_trace.h"
+
+int main(int argc, char *argv[]) {
+	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+
+	CGRect box = CGRectMake(0, 0, 320, 480);
+	if (argc >= 3) {
+		box.size.width = atof(argv[1]);
+		box.size.height = atof(argv[2]);
+	}
+
+	GlkLibrary *library = [[GlkLibrary alloc] init]; // retained
+	library.glkdelegate = [HeadlessGlkLibDelegate singleton];
+	[library setMetricsChanged:YES bounds:&box];
+
+	FILE *tracefl = NULL;
+	char *tracepath = getenv("GLKTRACE_RECORD");
+	if (tracepath) {
+		tracefl = fopen(tracepath, "wb");
+		if (!tracefl || !gitrace_start(tracefl))
+			NSLog(@"unable to record trace to %s", tracepath);
+	}
+
+	GlkAppWrapper *appwrap = [[GlkAppWrapper alloc] init]; // retained
+	[appwrap appThreadMain:nil];
+
+#ifdef IOSGLK_TURN_TIMING
+	fprintf(stderr, "%s", [GlkTurnTimeReport() UTF8String]);
+#endif // IOSGLK_TURN_TIMING
+
+	if (getenv("GLKHEADLESS_SCROLLBACK_REPORT"))
+		fprintf(stderr, "%s", [[library scrollbackReport] UTF8String]);
+
+	if (tracefl) {
+		gitrace_stop();
+		fclose(tracefl);
+	}
+
+	[appwrap release];
+	[library release];
+	[pool release];
+	return 0;
+}
@@ -23,6 +23,7 @@ void glk_select(event_t *event) {
 	event_t dummy;
 	if (!event)
 		event = &dummy;
+	[[GlkLibrary singleton] flushStagedOutput];
 	[appwrap selectEvent:event special:nil]; 
 }
 
@@ -34,6 +35,7 @@ void glk_select_poll(event_t *event) {
 	event_t dummy;
 	if (!event)
 		event = &dummy;
+	[[GlkLibrary singleton] flushStagedOutput];
 	[appwrap selectPollEvent:event]; 
 }
 
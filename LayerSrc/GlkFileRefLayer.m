@@ -136,23 +136,15 @@ frefid_t glk_fileref_iterate(frefid_t fref, glui32 *rock)
 	GlkLibrary *library = [GlkLibrary singleton];
 
 	if (!fref) {
-		if (library.filerefs.count)
-			fref = [library.filerefs objectAtIndex:0];
-		else
-			fref = nil;
+		fref = library.firstfileref;
 	}
 	else {
-		NSUInteger pos = [library.filerefs indexOfObject:fref];
-		if (pos == NSNotFound) {
+		if (![library hasFileRef:fref]) {
 			fref = nil;
 			[GlkLibrary strictWarning:@"glk_fileref_iterate: unknown fileref ref"];
 		}
 		else {
-			pos++;
-			if (pos >= library.filerefs.count)
-				fref = nil;
-			else 
-				fref = [library.filerefs objectAtIndex:pos];
+			fref = fref.libnext;
 		}
 	}
 	
@@ -88,23 +88,15 @@ strid_t glk_stream_iterate(strid_t str, glui32 *rock)
 	GlkLibrary *library = [GlkLibrary singleton];
 
 	if (!str) {
-		if (library.streams.count)
-			str = [library.streams objectAtIndex:0];
-		else
-			str = nil;
+		str = library.firststream;
 	}
 	else {
-		NSUInteger pos = [library.streams indexOfObject:str];
-		if (pos == NSNotFound) {
+		if (![library hasStream:str]) {
 			str = nil;
 			[GlkLibrary strictWarning:@"glk_stream_iterate: unknown stream ref"];
 		}
 		else {
-			pos++;
-			if (pos >= library.streams.count)
-				str = nil;
-			else 
-				str = [library.streams objectAtIndex:pos];
+			str = str.libnext;
 		}
 	}
 	
@@ -133,6 +125,7 @@ glui32 glk_stream_get_rock(strid_t str)
 void glk_stream_set_current(strid_t str)
 {
 	GlkLibrary *library = [GlkLibrary singleton];
+	[library flushStagedOutput];
 	library.currentstr = str;
 }
 
@@ -60,6 +60,8 @@ winid_t glk_window_open(winid_t splitwin, glui32 method, glui32 size, glui32 win
 
 	}
 
+	/* Splitting can resize a grid window, so get staged text into it first. */
+	[library flushStagedOutput];
 	newwin = [GlkWindow windowWithType:wintype rock:rock];
 	library.geometrychanged = YES;
 	
@@ -111,6 +113,7 @@ void glk_window_close(winid_t win, stream_result_t *result)
 	}
 	
 	GlkLibrary *library = win.library;
+	[library flushStagedOutput];
 	library.geometrychanged = YES;
 
 	if (win == library.rootwin || win.parent == nil) {
@@ -148,7 +151,7 @@ void glk_window_close(winid_t win, stream_result_t *result)
 		if (!grandparwin) {
 			library.rootwin = sibwin;
 			sibwin.parent = nil;
-			sibwin.parenttag = nil;
+			sibwin.parenttag = 0;
 		}
 		else {
 			if (grandparwin.child1 == pairwin)
@@ -266,6 +269,7 @@ void glk_window_set_arrangement(winid_t win, glui32 method, glui32 size, winid_t
 	GlkWindowPair *dwin = (GlkWindowPair *)win;
 	Geometry *geometry = dwin.geometry;
 	CGRect box = dwin.bbox;
+	[win.library flushStagedOutput];
 	
 	glui32 newdir = method & winmethod_DirMask;
 	BOOL newvertical = (newdir == winmethod_Left || newdir == winmethod_Right);
@@ -311,23 +315,15 @@ winid_t glk_window_iterate(winid_t win, glui32 *rock)
 	GlkLibrary *library = [GlkLibrary singleton];
 
 	if (!win) {
-		if (library.windows.count)
-			win = [library.windows objectAtIndex:0];
-		else
-			win = nil;
+		win = library.firstwindow;
 	}
 	else {
-		NSUInteger pos = [library.windows indexOfObject:win];
-		if (pos == NSNotFound) {
+		if (![library hasWindow:win]) {
 			win = nil;
 			[GlkLibrary strictWarning:@"glk_window_iterate: unknown window ref"];
 		}
 		else {
-			pos++;
-			if (pos >= library.windows.count)
-				win = nil;
-			else 
-				win = [library.windows objectAtIndex:pos];
+			win = win.libnext;
 		}
 	}
 	
@@ -437,6 +433,7 @@ void glk_window_set_echo_stream(winid_t win, strid_t str)
 		return;
 	}
 
+	[win.library flushStagedOutput];
 	win.echostream = str;
 	win.echostreamtag = str.tag;
 }
@@ -444,6 +441,7 @@ void glk_window_set_echo_stream(winid_t win, strid_t str)
 void glk_set_window(winid_t win)
 {
 	GlkLibrary *library = [GlkLibrary singleton];
+	[library flushStagedOutput];
 	if (!win) {
 		library.currentstr = nil;
 	}
@@ -462,6 +460,7 @@ void glk_window_clear(winid_t win)
 		[GlkLibrary strictWarning:@"window_clear: window has pending line request"];
 		return;
 	}
+	[win.library flushStagedOutput];
 	[win clearWindow];
 }
 
@@ -476,6 +475,7 @@ void glk_window_move_cursor(winid_t win, glui32 xpos, glui32 ypos)
 		return;
 	}
 	GlkWindowGrid *gridwin = (GlkWindowGrid *)win;
+	[win.library flushStagedOutput];
 	[gridwin moveCursorToX:xpos Y:ypos];
 }
 
@@ -494,6 +494,7 @@ void glk_request_line_event(winid_t win, char *buf, glui32 maxlen, glui32 initle
 		[GlkLibrary strictWarning:@"request_line_event: invalid ref"];
 		return;
 	}
+	[win.library flushStagedOutput];
 	[win beginLineInput:buf unicode:NO maxlen:maxlen initlen:initlen];
 }
 
@@ -512,6 +513,7 @@ void glk_request_line_event_uni(winid_t win, glui32 *buf, glui32 maxlen, glui32
 		[GlkLibrary strictWarning:@"request_line_event_uni: invalid ref"];
 		return;
 	}
+	[win.library flushStagedOutput];
 	[win beginLineInput:buf unicode:YES maxlen:maxlen initlen:initlen];
 }
 
@@ -536,6 +538,7 @@ void glk_cancel_line_event(winid_t win, event_t *event)
 		event = &dummyev;
 	}
 
+	[win.library flushStagedOutput];
 	[win cancelLineInput:event];
 }
 
@@ -5,6 +5,7 @@
 */
 
 #import <Foundation/Foundation.h>
+#import "GlkTagTable.h"
 #include "glk.h"
 
 @class StyleSet;
@@ -13,26 +14,26 @@
 	glui32 dir;
 	glui32 division;
 	BOOL hasborder;
-	NSNumber *keytag;
+	GlkTag keytag;
 	StyleSet *keystyleset;
 	glui32 size;
 	BOOL vertical;
 	BOOL backward;
 	
-	NSNumber *child1tag;
-	NSNumber *child2tag;
+	GlkTag child1tag;
+	GlkTag child2tag;
 }
 
 @property (nonatomic) glui32 dir;
 @property (nonatomic) glui32 division;
 @property (nonatomic) BOOL hasborder;
-@property (nonatomic, retain) NSNumber *keytag;
+@property (nonatomic) GlkTag keytag;
 @property (nonatomic, retain) StyleSet *keystyleset; // not serialized; styleset of key window
 @property (nonatomic) glui32 size;
 @property (nonatomic) BOOL vertical;
 @property (nonatomic) BOOL backward;
-@property (nonatomic, retain) NSNumber *child1tag;
-@property (nonatomic, retain) NSNumber *child2tag;
+@property (nonatomic) GlkTag child1tag;
+@property (nonatomic) GlkTag child2tag;
 
 - (void) computeDivision:(CGRect)box for1:(CGRect *)boxref1 for2:(CGRect *)boxref2;
 
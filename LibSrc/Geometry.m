@@ -34,10 +34,10 @@
 	self = [super init];
 	
 	if (self) {
-		keytag = nil;
+		keytag = 0;
 		keystyleset = nil;
-		child1tag = nil;
-		child2tag = nil;
+		child1tag = 0;
+		child2tag = 0;
 	}
 	
 	return self;
@@ -48,21 +48,18 @@
 	division = [decoder decodeInt32ForKey:@"division"];
 	hasborder = [decoder decodeBoolForKey:@"hasborder"];
 				 
-	self.keytag = [decoder decodeObjectForKey:@"keytag"];
+	self.keytag = GlkTagDecode(decoder, @"keytag");
 	// self.keystyleset will have to be filled in later, once all the windows are loaded
 
 	size = [decoder decodeInt32ForKey:@"size"];
-	self.child1tag = [decoder decodeObjectForKey:@"child1tag"];
-	self.child2tag = [decoder decodeObjectForKey:@"child2tag"];
+	self.child1tag = GlkTagDecode(decoder, @"child1tag");
+	self.child2tag = GlkTagDecode(decoder, @"child2tag");
 	
 	return self;
 }
 
 - (void) dealloc {
-	self.keytag = nil;
 	self.keystyleset = nil;
-	self.child1tag = nil;
-	self.child2tag = nil;
 	[super dealloc];
 }
 
@@ -85,12 +82,12 @@
 	[encoder encodeInt32:division forKey:@"division"];
 	[encoder encodeBool:hasborder forKey:@"hasborder"];
 	
-	[encoder encodeObject:keytag forKey:@"keytag"];
+	GlkTagEncode(encoder, keytag, @"keytag");
 	// skip keystyleset
 	
 	[encoder encodeInt32:size forKey:@"size"];
-	[encoder encodeObject:child1tag forKey:@"child1tag"];
-	[encoder encodeObject:child2tag forKey:@"child2tag"];
+	GlkTagEncode(encoder, child1tag, @"child1tag");
+	GlkTagEncode(encoder, child2tag, @"child2tag");
 }
 
 /* getter method */
@@ -0,0 +1,17 @@
+/* GlkByteOrder.h: Conversions between host characters and big-endian 32-bit streams
+	for IosGlk, the iOS implementation of the Glk API.
+	Designed by Andrew Plotkin <erkyrath@eblong.com>
+	http://eblong.com/zarf/glk/
+*/
+
+#include <stddef.h>
+#include "glk.h"
+
+/* A binary Unicode file stream is a sequence of big-endian 32-bit words. These convert count characters at a time, in either direction. The byte pointers need not be aligned. Source and destination must not overlap, except that packing and unpacking may be done in place (with the same pointer for both). */
+
+extern void GlkPackBigEndian32(unsigned char *dest, const glui32 *src, size_t count);
+extern void GlkPackBigEndian32FromBytes(unsigned char *dest, const unsigned char *src, size_t count);
+extern void GlkUnpackBigEndian32(glui32 *dest, const unsigned char *src, size_t count);
+
+/* Find the first of count 32-bit words which equals val, and return its index (or count, if there isn't one). The words are compared as they sit in memory, so src need not be aligned; to search a big-endian stream, pack val first. */
+extern size_t GlkFindWord32(const void *src, size_t count, glui32 val);
@@ -0,0 +1,155 @@
+/* GlkByteOrder.m: Conversions between host characters and big-endian 32-bit streams
+	for IosGlk, the iOS implementation of the Glk API.
+	Designed by Andrew Plotkin <erkyrath@eblong.com>
+	http://eblong.com/zarf/glk/
+*/
+
+/*	These are plain C. Each has a vector loop, sixteen bytes at a time, and a scalar loop for the leftovers (and for compilers with neither vector unit). NEON covers iOS devices; SSE2 covers the simulator and the headless build on x86. SSE2 has no byte shuffle, so the swap is done as a swap of 16-bit halves followed by a swap of the bytes in each half.
+
+	On a big-endian host, packing and unpacking are just copies.
+
+	GlkFindWord32 lives here too, since it's the same sort of loop. The line readers use it on unicode memory buffers and (with a packed newline) on big-endian file buffers.
+*/
+
+#include <string.h>
+#include "GlkByteOrder.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define BYTEORDER_NEON (1)
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define BYTEORDER_SSE2 (1)
+#endif
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define BYTEORDER_HOST_BIG (1)
+#endif
+
+#ifndef BYTEORDER_HOST_BIG
+
+#if defined(BYTEORDER_SSE2)
+/* Reverse the bytes of each 32-bit lane. */
+static inline __m128i swap32_sse2(__m128i val) {
+	val = _mm_shufflelo_epi16(val, _MM_SHUFFLE(2, 3, 0, 1));
+	val = _mm_shufflehi_epi16(val, _MM_SHUFFLE(2, 3, 0, 1));
+	return _mm_or_si128(_mm_slli_epi16(val, 8), _mm_srli_epi16(val, 8));
+}
+#endif // BYTEORDER_SSE2
+
+#endif // BYTEORDER_HOST_BIG
+
+/* Host characters to big-endian words. */
+void GlkPackBigEndian32(unsigned char *dest, const glui32 *src, size_t count) {
+#ifdef BYTEORDER_HOST_BIG
+	memcpy(dest, src, count * sizeof(glui32));
+#else // BYTEORDER_HOST_BIG
+	size_t ix = 0;
+#if defined(BYTEORDER_NEON)
+	for (; ix+4 <= count; ix += 4) {
+		uint8x16_t val = vld1q_u8((const uint8_t *)(src+ix));
+		vst1q_u8(dest+4*ix, vrev32q_u8(val));
+	}
+#elif defined(BYTEORDER_SSE2)
+	for (; ix+4 <= count; ix += 4) {
+		__m128i val = _mm_loadu_si128((const __m128i *)(src+ix));
+		_mm_storeu_si128((__m128i *)(dest+4*ix), swap32_sse2(val));
+	}
+#endif
+	for (; ix<count; ix++) {
+		glui32 ch = src[ix];
+		dest[4*ix+0] = (ch >> 24) & 0xFF;
+		dest[4*ix+1] = (ch >> 16) & 0xFF;
+		dest[4*ix+2] = (ch >> 8) & 0xFF;
+		dest[4*ix+3] = ch & 0xFF;
+	}
+#endif // BYTEORDER_HOST_BIG
+}
+
+/* Latin-1 bytes to big-endian words. (Each word is three zero bytes and then the character, whatever the host's byte order.) */
+void GlkPackBigEndian32FromBytes(unsigned char *dest, const unsigned char *src, size_t count) {
+	size_t ix = 0;
+#if defined(BYTEORDER_NEON)
+	uint8x16_t zero8 = vdupq_n_u8(0);
+	uint16x8_t zero16 = vdupq_n_u16(0);
+	for (; ix+16 <= count; ix += 16) {
+		uint8x16_t val = vld1q_u8(src+ix);
+		uint8x16x2_t halves = vzipq_u8(zero8, val); /* 0,c0,0,c1,... */
+		uint16x8x2_t lo = vzipq_u16(zero16, vreinterpretq_u16_u8(halves.val[0])); /* 0,0,0,c0,... */
+		uint16x8x2_t hi = vzipq_u16(zero16, vreinterpretq_u16_u8(halves.val[1]));
+		vst1q_u8(dest+4*ix, vreinterpretq_u8_u16(lo.val[0]));
+		vst1q_u8(dest+4*ix+16, vreinterpretq_u8_u16(lo.val[1]));
+		vst1q_u8(dest+4*ix+32, vreinterpretq_u8_u16(hi.val[0]));
+		vst1q_u8(dest+4*ix+48, vreinterpretq_u8_u16(hi.val[1]));
+	}
+#elif defined(BYTEORDER_SSE2)
+	__m128i zero = _mm_setzero_si128();
+	for (; ix+16 <= count; ix += 16) {
+		__m128i val = _mm_loadu_si128((const __m128i *)(src+ix));
+		__m128i lo = _mm_unpacklo_epi8(zero, val); /* 0,c0,0,c1,... */
+		__m128i hi = _mm_unpackhi_epi8(zero, val);
+		_mm_storeu_si128((__m128i *)(dest+4*ix), _mm_unpacklo_epi16(zero, lo)); /* 0,0,0,c0,... */
+		_mm_storeu_si128((__m128i *)(dest+4*ix+16), _mm_unpackhi_epi16(zero, lo));
+		_mm_storeu_si128((__m128i *)(dest+4*ix+32), _mm_unpacklo_epi16(zero, hi));
+		_mm_storeu_si128((__m128i *)(dest+4*ix+48), _mm_unpackhi_epi16(zero, hi));
+	}
+#endif
+	for (; ix<count; ix++) {
+		dest[4*ix+0] = 0;
+		dest[4*ix+1] = 0;
+		dest[4*ix+2] = 0;
+		dest[4*ix+3] = src[ix];
+	}
+}
+
+size_t GlkFindWord32(const void *src, size_t count, glui32 val) {
+	const unsigned char *bsrc = src;
+	size_t ix = 0;
+#if defined(BYTEORDER_NEON) && defined(__aarch64__)
+	uint32x4_t pat = vdupq_n_u32(val);
+	for (; ix+4 <= count; ix += 4) {
+		uint32x4_t words = vreinterpretq_u32_u8(vld1q_u8(bsrc+4*ix));
+		if (vmaxvq_u32(vceqq_u32(words, pat)))
+			break;
+	}
+#elif defined(BYTEORDER_SSE2)
+	__m128i pat = _mm_set1_epi32(val);
+	for (; ix+4 <= count; ix += 4) {
+		__m128i words = _mm_loadu_si128((const __m128i *)(bsrc+4*ix));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(words, pat)))
+			break;
+	}
+#endif
+	/* Either the vector loop found a block with a match in it, or we're into the leftovers. */
+	for (; ix<count; ix++) {
+		glui32 word;
+		memcpy(&word, bsrc+4*ix, sizeof(glui32));
+		if (word == val)
+			return ix;
+	}
+	return count;
+}
+
+/* Big-endian words to host characters. */
+void GlkUnpackBigEndian32(glui32 *dest, const unsigned char *src, size_t count) {
+#ifdef BYTEORDER_HOST_BIG
+	memcpy(dest, src, count * sizeof(glui32));
+#else // BYTEORDER_HOST_BIG
+	size_t ix = 0;
+#if defined(BYTEORDER_NEON)
+	for (; ix+4 <= count; ix += 4) {
+		uint8x16_t val = vld1q_u8(src+4*ix);
+		vst1q_u8((uint8_t *)(dest+ix), vrev32q_u8(val));
+	}
+#elif defined(BYTEORDER_SSE2)
+	for (; ix+4 <= count; ix += 4) {
+		__m128i val = _mm_loadu_si128((const __m128i *)(src+4*ix));
+		_mm_storeu_si128((__m128i *)(dest+ix), swap32_sse2(val));
+	}
+#endif
+	for (; ix<count; ix++) {
+		const unsigned char *buf = src+4*ix;
+		dest[ix] = ((glui32)buf[0] << 24) | ((glui32)buf[1] << 16) | ((glui32)buf[2] << 8) | ((glui32)buf[3]);
+	}
+#endif // BYTEORDER_HOST_BIG
+}
@@ -5,6 +5,7 @@
 */
 
 #import <Foundation/Foundation.h>
+#import "GlkTagTable.h"
 #include "glk.h"
 #include "gi_dispa.h"
 
@@ -14,8 +15,10 @@
 @interface GlkFileRef : NSObject {
 	GlkLibrary *library;
 	BOOL inlibrary;
+	GlkFileRef *libprev; /* neighbors in the library's list, in creation order; not retained */
+	GlkFileRef *libnext;
 	
-	NSNumber *tag;
+	GlkTag tag;
 	gidispatch_rock_t disprock;
 
 	glui32 rock;
@@ -29,7 +32,9 @@
 }
 
 @property (nonatomic, retain) GlkLibrary *library;
-@property (nonatomic, retain) NSNumber *tag;
+@property (nonatomic, assign) GlkFileRef *libprev;
+@property (nonatomic, assign) GlkFileRef *libnext;
+@property (nonatomic) GlkTag tag;
 @property (nonatomic) gidispatch_rock_t disprock;
 @property (nonatomic, retain) NSString *filename;
 @property (nonatomic, retain) NSString *basedir;
@@ -17,6 +17,8 @@
 @implementation GlkFileRef
 
 @synthesize library;
+@synthesize libprev;
+@synthesize libnext;
 @synthesize tag;
 @synthesize disprock;
 @synthesize pathname;
@@ -131,7 +133,7 @@
 		self.pathname = [dirname stringByAppendingPathComponent:filename];
 		//NSLog(@"created fileref with pathname %@", pathname);
 		
-		[library.filerefs addObject:self];
+		[library addFileRef:self];
 		
 		if (library.dispatch_register_obj)
 			disprock = (*library.dispatch_register_obj)(self, gidisp_Class_Fileref);
@@ -141,7 +143,7 @@
 }
 
 - (id) initWithCoder:(NSCoder *)decoder {
-	self.tag = [decoder decodeObjectForKey:@"tag"];
+	self.tag = GlkTagDecode(decoder, @"tag");
 	inlibrary = YES;
 	// self.library will be set later
 
@@ -169,7 +171,6 @@
 	self.filename = nil;
 	if (!tag)
 		[NSException raise:@"GlkException" format:@"GlkFileRef reached dealloc with tag unset"];
-	self.tag = nil;
 	
 	self.library = nil;
 
@@ -177,11 +178,11 @@
 }
 
 - (NSString *) description {
-	return [NSString stringWithFormat:@"<%@ (tag %@, rock %d): 0x%lx>", self.class, self.tag, self.rock, (long)self];
+	return [NSString stringWithFormat:@"<%@ (tag %ld, rock %d): 0x%lx>", self.class, (long)self.tag, self.rock, (long)self];
 }
 
 - (void) encodeWithCoder:(NSCoder *)encoder {
-	[encoder encodeObject:tag forKey:@"tag"];
+	GlkTagEncode(encoder, tag, @"tag");
 	
 	[encoder encodeInt32:rock forKey:@"rock"];
 	// disprock is handled by the app
@@ -202,9 +203,7 @@
 	if (library.dispatch_unregister_obj)
 		(*library.dispatch_unregister_obj)(self, gidisp_Class_Fileref, disprock);
 		
-	if (![library.filerefs containsObject:self])
-		[NSException raise:@"GlkException" format:@"GlkFileRef was not in library filerefs list"];
-	[library.filerefs removeObject:self];
+	[library removeFileRef:self];
 	inlibrary = NO;
 }
 
@@ -7,9 +7,12 @@
 #import <Foundation/Foundation.h>
 #include "glk.h"
 #include "gi_dispa.h"
+#import "GlkTagTable.h"
 
 @class GlkWindow;
 @class GlkStream;
+@class GlkStreamWindow;
+@class GlkFileRef;
 @class GlkLibraryState;
 @protocol IosGlkLibDelegate;
 
@@ -19,10 +22,23 @@
 	NSMutableArray *windows; /* GlkWindow objects */
 	NSMutableArray *streams; /* GlkStream objects */
 	NSMutableArray *filerefs; /* GlkFileRef objects */
+	/* Tag lookup tables for the three lists above. Don't add or remove objects from the lists directly; use addWindow:, removeWindow:, etc, which keep these in sync. */
+	GlkTagTable windowtable;
+	GlkTagTable streamtable;
+	GlkTagTable filereftable;
+	/* The same objects again, keyed by pointer (see GlkPointerKey), for validating references from the game. */
+	GlkTagTable windowptrs;
+	GlkTagTable streamptrs;
+	GlkTagTable filerefptrs;
+	/* The same objects again, as linked lists (through each object's libprev/libnext), so that the Glk iterate calls don't have to search the arrays. Not retained. */
+	GlkWindow *firstwindow, *lastwindow;
+	GlkStream *firststream, *laststream;
+	GlkFileRef *firstfileref, *lastfileref;
 	
 	BOOL vmexited;
 	GlkWindow *rootwin;
 	GlkStream *currentstr;
+	GlkStreamWindow *stagedstr; /* the window stream with staged putChar output, if any; not retained */
 	glui32 timerinterval; // milliseconds
 	CGRect bounds;
 	BOOL geometrychanged;
@@ -35,7 +51,7 @@
 	NSCalendar *utccalendar; // ditto; allocated as-needed
 	NSCalendar *localcalendar; // ditto; allocated as-needed
 	
-	NSInteger tagCounter;
+	GlkTag tagCounter;
 	gidispatch_rock_t (*dispatch_register_obj)(void *obj, glui32 objclass);
 	void (*dispatch_unregister_obj)(void *obj, glui32 objclass, gidispatch_rock_t objrock);
 	gidispatch_rock_t (*dispatch_register_arr)(void *array, glui32 len, char *typecode);
@@ -48,9 +64,13 @@
 @property (nonatomic, retain) NSMutableArray *windows;
 @property (nonatomic, retain) NSMutableArray *streams;
 @property (nonatomic, retain) NSMutableArray *filerefs;
+@property (nonatomic, readonly) GlkWindow *firstwindow;
+@property (nonatomic, readonly) GlkStream *firststream;
+@property (nonatomic, readonly) GlkFileRef *firstfileref;
 @property (nonatomic) BOOL vmexited;
 @property (nonatomic, retain) GlkWindow *rootwin;
 @property (nonatomic, retain) GlkStream *currentstr;
+@property (nonatomic, assign) GlkStreamWindow *stagedstr;
 @property (nonatomic) glui32 timerinterval;
 @property (nonatomic, readonly) CGRect bounds;
 @property (nonatomic) BOOL geometrychanged;
@@ -59,7 +79,7 @@
 @property (nonatomic, retain) NSFileManager *filemanager;
 @property (nonatomic, readonly) NSCalendar *utccalendar;
 @property (nonatomic, readonly) NSCalendar *localcalendar;
-@property (nonatomic, readonly) NSInteger tagCounter;
+@property (nonatomic, readonly) GlkTag tagCounter;
 @property (nonatomic, retain) id specialrequest;
 @property (nonatomic) gidispatch_rock_t (*dispatch_register_obj)(void *obj, glui32 objclass);
 @property (nonatomic) void (*dispatch_unregister_obj)(void *obj, glui32 objclass, gidispatch_rock_t objrock);
@@ -75,17 +95,28 @@
 + (void) setExtraUnarchiveHook:(void (*)(NSCoder *))hook;
 
 - (NSString *) gameId;
-- (NSNumber *) generateTag;
+- (GlkTag) generateTag;
 - (void) setVMExited;
 - (void) clearForRestart;
 - (BOOL) setMetricsChanged:(BOOL)metricschanged bounds:(CGRect *)box;
-- (GlkWindow *) windowForTag:(NSNumber *)tag;
+- (void) addWindow:(GlkWindow *)win;
+- (void) removeWindow:(GlkWindow *)win;
+- (void) addStream:(GlkStream *)str;
+- (void) removeStream:(GlkStream *)str;
+- (void) addFileRef:(GlkFileRef *)fref;
+- (void) removeFileRef:(GlkFileRef *)fref;
+- (GlkWindow *) windowForTag:(GlkTag)tag;
 - (GlkWindow *) windowForIntTag:(glui32)tag;
-- (GlkStream *) streamForTag:(NSNumber *)tag;
+- (GlkStream *) streamForTag:(GlkTag)tag;
 - (GlkStream *) streamForIntTag:(glui32)tag;
-- (GlkFileRef *) filerefForTag:(NSNumber *)tag;
+- (GlkFileRef *) filerefForTag:(GlkTag)tag;
 - (GlkFileRef *) filerefForIntTag:(glui32)tag;
+- (BOOL) hasWindow:(GlkWindow *)win;
+- (BOOL) hasStream:(GlkStream *)str;
+- (BOOL) hasFileRef:(GlkFileRef *)fref;
 - (void) dirtyAllData;
+- (void) flushStagedOutput;
+- (NSString *) scrollbackReport;
 
 - (void) sanityCheck;
 - (GlkLibraryState *) cloneState;
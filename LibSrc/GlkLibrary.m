@@ -19,6 +19,7 @@
 #import "GlkUtilities.h"
 #import "Geometry.h"
 #import "StyleSet.h"
+#import "GlkTurnTiming.h"
 #include "glk.h"
 
 @implementation GlkLibrary
@@ -29,9 +30,13 @@
 @synthesize windows;
 @synthesize streams;
 @synthesize filerefs;
+@synthesize firstwindow;
+@synthesize firststream;
+@synthesize firstfileref;
 @synthesize vmexited;
 @synthesize rootwin;
 @synthesize currentstr;
+@synthesize stagedstr;
 @synthesize timerinterval;
 @synthesize bounds;
 @synthesize geometrychanged;
@@ -74,8 +79,15 @@ static void (*extra_unarchive_hook)(NSCoder *) = nil;
 		self.windows = [NSMutableArray arrayWithCapacity:8];
 		self.streams = [NSMutableArray arrayWithCapacity:8];
 		self.filerefs = [NSMutableArray arrayWithCapacity:8];
+		GlkTagTableInit(&windowtable);
+		GlkTagTableInit(&streamtable);
+		GlkTagTableInit(&filereftable);
+		GlkTagTableInit(&windowptrs);
+		GlkTagTableInit(&streamptrs);
+		GlkTagTableInit(&filerefptrs);
 		self.rootwin = nil;
 		self.currentstr = nil;
+		stagedstr = nil;
 		timerinterval = 0;
 		geometrychanged = YES;
 		metricschanged = YES;
@@ -107,40 +119,50 @@ static void (*extra_unarchive_hook)(NSCoder *) = nil;
 	metricschanged = YES;
 	everythingchanged = YES;
 	
-	self.windows = [decoder decodeObjectForKey:@"windows"];
-	self.streams = [decoder decodeObjectForKey:@"streams"];
-	self.filerefs = [decoder decodeObjectForKey:@"filerefs"];
+	NSArray *decwindows = [decoder decodeObjectForKey:@"windows"];
+	NSArray *decstreams = [decoder decodeObjectForKey:@"streams"];
+	NSArray *decfilerefs = [decoder decodeObjectForKey:@"filerefs"];
+	self.windows = [NSMutableArray arrayWithCapacity:decwindows.count];
+	self.streams = [NSMutableArray arrayWithCapacity:decstreams.count];
+	self.filerefs = [NSMutableArray arrayWithCapacity:decfilerefs.count];
+	
+	GlkTagTableInit(&windowtable);
+	GlkTagTableInit(&streamtable);
+	GlkTagTableInit(&filereftable);
+	GlkTagTableInit(&windowptrs);
+	GlkTagTableInit(&streamptrs);
+	GlkTagTableInit(&filerefptrs);
 	
 	// will be zero if no timerinterval was saved
 	timerinterval = [decoder decodeInt32ForKey:@"timerinterval"];
 	
 	// skip the calendar and filemanager fields; they're not needed
 
-	NSNumber *rootwintag = [decoder decodeObjectForKey:@"rootwintag"];
-	NSNumber *currentstrtag = [decoder decodeObjectForKey:@"currentstrtag"];
+	GlkTag rootwintag = GlkTagDecode(decoder, @"rootwintag");
+	GlkTag currentstrtag = GlkTagDecode(decoder, @"currentstrtag");
 	
 	tagCounter = 0;
-	for (GlkWindow *win in windows) {
+	for (GlkWindow *win in decwindows) {
 		win.library = self;
-		glui32 tag = win.tag.intValue;
-		if (tag > tagCounter)
-			tagCounter = tag;
-		if (rootwintag && [win.tag isEqualToNumber:rootwintag])
+		if (win.tag > tagCounter)
+			tagCounter = win.tag;
+		[self addWindow:win];
+		if (rootwintag && win.tag == rootwintag)
 			self.rootwin = win;
 	}
-	for (GlkStream *str in streams) {
+	for (GlkStream *str in decstreams) {
 		str.library = self;
-		glui32 tag = str.tag.intValue;
-		if (tag > tagCounter)
-			tagCounter = tag;
-		if (currentstrtag && [str.tag isEqualToNumber:currentstrtag])
+		if (str.tag > tagCounter)
+			tagCounter = str.tag;
+		[self addStream:str];
+		if (currentstrtag && str.tag == currentstrtag)
 			self.currentstr = str;
 	}
-	for (GlkFileRef *fref in filerefs) {
+	for (GlkFileRef *fref in decfilerefs) {
 		fref.library = self;
-		glui32 tag = fref.tag.intValue;
-		if (tag > tagCounter)
-			tagCounter = tag;
+		if (fref.tag > tagCounter)
+			tagCounter = fref.tag;
+		[self addFileRef:fref];
 	}
 
 	for (GlkWindow *win in windows) {
@@ -185,6 +207,12 @@ static void (*extra_unarchive_hook)(NSCoder *) = nil;
 	self.windows = nil;
 	self.streams = nil;
 	self.filerefs = nil;
+	GlkTagTableFree(&windowtable);
+	GlkTagTableFree(&streamtable);
+	GlkTagTableFree(&filereftable);
+	GlkTagTableFree(&windowptrs);
+	GlkTagTableFree(&streamptrs);
+	GlkTagTableFree(&filerefptrs);
 	self.rootwin = nil;
 	self.currentstr = nil;
 	self.specialrequest = nil;
@@ -216,9 +244,9 @@ static void (*extra_unarchive_hook)(NSCoder *) = nil;
 		[encoder encodeInt32:timerinterval forKey:@"timerinterval"];
 
 	if (rootwin)
-		[encoder encodeObject:rootwin.tag forKey:@"rootwintag"];
+		GlkTagEncode(encoder, rootwin.tag, @"rootwintag");
 	if (currentstr)
-		[encoder encodeObject:currentstr.tag forKey:@"currentstrtag"];
+		GlkTagEncode(encoder, currentstr.tag, @"currentstrtag");
 
 	// Save any interpreter-specific data.
 	if (extra_archive_hook)
@@ -236,12 +264,12 @@ static void (*extra_unarchive_hook)(NSCoder *) = nil;
 	return @"GameID";
 }
 
-/* Every Glk object (windows, streams, etc) needs a hashable tag. (The objects themselves don't make good hash keys.) The easiest solution is to pass out unique NSNumbers. 
+/* Every Glk object (windows, streams, etc) needs a hashable tag. (The objects themselves don't make good hash keys, and they can't cross over to the UI thread.) We pass out unique positive integers.
 	Note that these are *not* the glui32 ids seen by the Glulx VM. Those are generated separately, in the gi_dispa layer.
 */
-- (NSNumber *) generateTag {
+- (GlkTag) generateTag {
 	tagCounter++;
-	return [NSNumber numberWithInteger:tagCounter];
+	return tagCounter;
 }
 
 /* Set the library state flag that indicates that glk_exit() has been called. (Or glk_main() returned normally.)
@@ -325,82 +353,167 @@ static void (*extra_unarchive_hook)(NSCoder *) = nil;
 	return YES;
 }
 
-/* Locate the window matching a given tag. (Or nil, if no window matches or the tag is nil.) This isn't efficient, but it's not heavily used.
+/* Add an object to the library's list (and tag table and linked list). The object's tag must already be set. These are called by the object's init method (or when restoring).
 */
-- (GlkWindow *) windowForTag:(NSNumber *)tag {
-	if (!tag)
-		return nil;
-	
-	for (GlkWindow *win in windows) {
-		if ([win.tag isEqualToNumber:tag])
-			return win;
-	}
-	
-	return nil;
+- (void) addWindow:(GlkWindow *)win {
+	[windows addObject:win];
+	GlkTagTableSet(&windowtable, win.tag, win);
+	GlkTagTableSet(&windowptrs, GlkPointerKey(win), win);
+	win.libprev = lastwindow;
+	win.libnext = nil;
+	if (lastwindow)
+		lastwindow.libnext = win;
+	else
+		firstwindow = win;
+	lastwindow = win;
+}
+
+- (void) addStream:(GlkStream *)str {
+	[streams addObject:str];
+	GlkTagTableSet(&streamtable, str.tag, str);
+	GlkTagTableSet(&streamptrs, GlkPointerKey(str), str);
+	str.libprev = laststream;
+	str.libnext = nil;
+	if (laststream)
+		laststream.libnext = str;
+	else
+		firststream = str;
+	laststream = str;
+}
+
+- (void) addFileRef:(GlkFileRef *)fref {
+	[filerefs addObject:fref];
+	GlkTagTableSet(&filereftable, fref.tag, fref);
+	GlkTagTableSet(&filerefptrs, GlkPointerKey(fref), fref);
+	fref.libprev = lastfileref;
+	fref.libnext = nil;
+	if (lastfileref)
+		lastfileref.libnext = fref;
+	else
+		firstfileref = fref;
+	lastfileref = fref;
+}
+
+/* Remove an object from the library's list (and tag table and linked list). It's an error if the object isn't there.
+ 
+	Objects are usually closed in roughly the reverse of the order they were opened (think of a temporary memory stream), so we check the end of the array before searching it.
+*/
+- (void) removeWindow:(GlkWindow *)win {
+	GlkTag tag = win.tag;
+	if (GlkTagTableGet(&windowtable, tag) != win)
+		[NSException raise:@"GlkException" format:@"GlkWindow was not in library windows list"];
+	GlkTagTableRemove(&windowtable, tag);
+	GlkTagTableRemove(&windowptrs, GlkPointerKey(win));
+	
+	if (win.libprev)
+		win.libprev.libnext = win.libnext;
+	else
+		firstwindow = win.libnext;
+	if (win.libnext)
+		win.libnext.libprev = win.libprev;
+	else
+		lastwindow = win.libprev;
+	win.libprev = nil;
+	win.libnext = nil;
+	
+	if (windows.lastObject == win)
+		[windows removeLastObject];
+	else
+		[windows removeObjectIdenticalTo:win];
+}
+
+- (void) removeStream:(GlkStream *)str {
+	GlkTag tag = str.tag;
+	if (GlkTagTableGet(&streamtable, tag) != str)
+		[NSException raise:@"GlkException" format:@"GlkStream was not in library streams list"];
+	GlkTagTableRemove(&streamtable, tag);
+	GlkTagTableRemove(&streamptrs, GlkPointerKey(str));
+	
+	if (str.libprev)
+		str.libprev.libnext = str.libnext;
+	else
+		firststream = str.libnext;
+	if (str.libnext)
+		str.libnext.libprev = str.libprev;
+	else
+		laststream = str.libprev;
+	str.libprev = nil;
+	str.libnext = nil;
+	
+	if (streams.lastObject == str)
+		[streams removeLastObject];
+	else
+		[streams removeObjectIdenticalTo:str];
+}
+
+- (void) removeFileRef:(GlkFileRef *)fref {
+	GlkTag tag = fref.tag;
+	if (GlkTagTableGet(&filereftable, tag) != fref)
+		[NSException raise:@"GlkException" format:@"GlkFileRef was not in library filerefs list"];
+	GlkTagTableRemove(&filereftable, tag);
+	GlkTagTableRemove(&filerefptrs, GlkPointerKey(fref));
+	
+	if (fref.libprev)
+		fref.libprev.libnext = fref.libnext;
+	else
+		firstfileref = fref.libnext;
+	if (fref.libnext)
+		fref.libnext.libprev = fref.libprev;
+	else
+		lastfileref = fref.libprev;
+	fref.libprev = nil;
+	fref.libnext = nil;
+	
+	if (filerefs.lastObject == fref)
+		[filerefs removeLastObject];
+	else
+		[filerefs removeObjectIdenticalTo:fref];
+}
+
+/* Locate the window matching a given tag. (Or nil, if no window matches or the tag is zero.)
+ 
+	The IntTag variants are the same thing; they're left over from when tags were NSNumbers.
+*/
+- (GlkWindow *) windowForTag:(GlkTag)tag {
+	return (GlkWindow *)GlkTagTableGet(&windowtable, tag);
 }
 
 - (GlkWindow *) windowForIntTag:(glui32)tag {
-	if (!tag)
-		return nil;
-	
-	for (GlkWindow *win in windows) {
-		if ([win.tag intValue] == tag)
-			return win;
-	}
-	
-	return nil;
+	return (GlkWindow *)GlkTagTableGet(&windowtable, tag);
 }
 
-/* Locate the stream matching a given tag. (Or nil, if no stream matches or the tag is nil.) This isn't efficient, but it's not heavily used.
+/* Locate the stream matching a given tag. (Or nil, if no stream matches or the tag is zero.)
  */
-- (GlkStream *) streamForTag:(NSNumber *)tag {
-	if (!tag)
-		return nil;
-	
-	for (GlkStream *str in streams) {
-		if ([str.tag isEqualToNumber:tag])
-			return str;
-	}
-	
-	return nil;
+- (GlkStream *) streamForTag:(GlkTag)tag {
+	return (GlkStream *)GlkTagTableGet(&streamtable, tag);
 }
 
 - (GlkStream *) streamForIntTag:(glui32)tag {
-	if (!tag)
-		return nil;
-	
-	for (GlkStream *str in streams) {
-		if ([str.tag intValue] == tag)
-			return str;
-	}
-	
-	return nil;
+	return (GlkStream *)GlkTagTableGet(&streamtable, tag);
 }
 
-/* Locate the fileref matching a given tag. (Or nil, if no fileref matches or the tag is nil.) This isn't efficient, but it's not heavily used.
+/* Locate the fileref matching a given tag. (Or nil, if no fileref matches or the tag is zero.)
  */
-- (GlkFileRef *) filerefForTag:(NSNumber *)tag {
-	if (!tag)
-		return nil;
-	
-	for (GlkFileRef *fref in filerefs) {
-		if ([fref.tag isEqualToNumber:tag])
-			return fref;
-	}
-	
-	return nil;
+- (GlkFileRef *) filerefForTag:(GlkTag)tag {
+	return (GlkFileRef *)GlkTagTableGet(&filereftable, tag);
 }
 
 - (GlkFileRef *) filerefForIntTag:(glui32)tag {
-	if (!tag)
-		return nil;
-	
-	for (GlkFileRef *fref in filerefs) {
-		if ([fref.tag intValue] == tag)
-			return fref;
-	}
-	
-	return nil;
+	return (GlkFileRef *)GlkTagTableGet(&filereftable, tag);
+}
+
+/* Check whether a pointer is one of the library's live windows (streams, filerefs). This only compares pointers, so it's safe to call with a stale or bogus reference from the game; don't message the object until this says yes.
+ */
+- (BOOL) hasWindow:(GlkWindow *)win {
+	return (win && GlkTagTableGet(&windowptrs, GlkPointerKey(win)) == win);
+}
+
+- (BOOL) hasStream:(GlkStream *)str {
+	return (str && GlkTagTableGet(&streamptrs, GlkPointerKey(str)) == str);
+}
+
+- (BOOL) hasFileRef:(GlkFileRef *)fref {
+	return (fref && GlkTagTableGet(&filerefptrs, GlkPointerKey(fref)) == fref);
 }
 
 /* Mark all the window data as "changed", so that the next update clones everything. (We call this when the window views need to discard all of their knowledge of the displayed state.
@@ -414,6 +527,26 @@ static void (*extra_unarchive_hook)(NSCoder *) = nil;
 	}
 }
 
+/* Pass any staged character output (see GlkStreamWindow) to its window. This is cheap when there's nothing staged, so call it freely before anything that looks at window contents.
+ */
+- (void) flushStagedOutput {
+	if (stagedstr)
+		[stagedstr flushStaged];
+}
+
+/* Describe the memory used by each buffer window's scrollback, one window per line. This is for choosing the scrollback budget (see [IosGlkLibDelegate scrollbackLimitsForWindowRock:...]) from real numbers. (Spilled lines are on disk, and aren't counted.)
+ */
+- (NSString *) scrollbackReport {
+	NSMutableString *res = [NSMutableString stringWithCapacity:128];
+	for (GlkWindow *win in windows) {
+		if (win.type != wintype_TextBuffer)
+			continue;
+		GlkWindowBuffer *bufwin = (GlkWindowBuffer *)win;
+		[res appendFormat:@"window %ld (rock %u): %d lines, %lu bytes (limit %d lines, %lu bytes)\n", (long)bufwin.tag, bufwin.rock, bufwin.linecount, (unsigned long)bufwin.linesbytes, bufwin.maxlines, (unsigned long)bufwin.maxbytes];
+	}
+	return res;
+}
+
 /* Clone the library display state for a UI update. (This doesn't produce a GlkLibrary object; rather, it builds a subset which contains only what the UI cares about.)
  
 	Despite the name "clone", this returns an autoreleased object, not a retained one.
@@ -421,6 +554,8 @@ static void (*extra_unarchive_hook)(NSCoder *) = nil;
 	This runs in the VM thread; the cloned GlkLibraryState is then thrown across to the UI thread, which owns it thereafter.
  */
 - (GlkLibraryState *) cloneState {
+	TURNTIME_MARK(clonestart);
+	[self flushStagedOutput];
 	GlkLibraryState *state = [[[GlkLibraryState alloc] init] autorelease];
 	[self sanityCheck];
 	
@@ -446,6 +581,11 @@ static void (*extra_unarchive_hook)(NSCoder *) = nil;
 	state.everythingchanged = everythingchanged;
 	everythingchanged = NO;
 	
+	TURNTIME_RECORD(turnphase_Clone, clonestart);
+#ifdef IOSGLK_TURN_TIMING
+	state.turnstamp = GlkTurnTimeNow();
+#endif // IOSGLK_TURN_TIMING
+	
 	return state;
 }
 
@@ -469,21 +609,24 @@ static void (*extra_unarchive_hook)(NSCoder *) = nil;
 	
 	for (GlkWindow *win in otherlib.windows) {
 		win.library = self;
-		[windows addObject:win];
+		[self addWindow:win];
 	}
 	for (GlkStream *str in otherlib.streams) {
 		str.library = self;
-		[streams addObject:str];
+		[self addStream:str];
 	}
 	for (GlkFileRef *fref in otherlib.filerefs) {
 		fref.library = self;
-		[filerefs addObject:fref];
+		[self addFileRef:fref];
 	}
 	
 	for (GlkWindow *win in windows) {
 		if (win.type == wintype_TextGrid || win.type == wintype_TextBuffer) {
 			win.styleset = [StyleSet buildForWindowType:win.type rock:win.rock];
 		}
+		if (win.type == wintype_TextBuffer) {
+			[(GlkWindowBuffer *)win updateScrollbackLimits];
+		}
 		[win updateRegisterArray];
 	}
 	for (GlkWindow *win in windows) {
@@ -543,6 +686,19 @@ static void (*extra_unarchive_hook)(NSCoder *) = nil;
 	
 	if (currentstr && [streams indexOfObject:currentstr] == NSNotFound)
 		NSLog(@"SANITY: current stream not listed");
+	
+	if (windowtable.count != windows.count || streamtable.count != streams.count || filereftable.count != filerefs.count)
+		NSLog(@"SANITY: tag tables do not match object lists");
+	
+	NSUInteger linkcount = 0;
+	for (GlkWindow *win = firstwindow; win; win = win.libnext)
+		linkcount++;
+	for (GlkStream *str = firststream; str; str = str.libnext)
+		linkcount++;
+	for (GlkFileRef *fref = firstfileref; fref; fref = fref.libnext)
+		linkcount++;
+	if (linkcount != windows.count + streams.count + filerefs.count)
+		NSLog(@"SANITY: linked lists do not match object lists");
 
 	for (GlkWindow *win in windows) {
 		if (!win.type)
@@ -553,18 +709,18 @@ static void (*extra_unarchive_hook)(NSCoder *) = nil;
 				NSLog(@"SANITY: window has no parent but is not rootwin");
 		}
 		else {
-			if (!NumberMatch(win.parenttag, win.parent.tag))
+			if (win.parenttag != win.parent.tag)
 				NSLog(@"SANITY: window parent tag mismatch");
 			if (win.parent.type != wintype_Pair)
 				NSLog(@"SANITY: window parent is not pair");
 		}
 		if (!win.stream)
 			NSLog(@"SANITY: window lacks stream");
-		if (!NumberMatch(win.stream.tag, win.streamtag))
+		if (win.stream.tag != win.streamtag)
 			NSLog(@"SANITY: window stream tag mismatch");
 		if (win.stream.type != strtype_Window)
 			NSLog(@"SANITY: window stream is wrong type");
-		if (!NumberMatch(win.echostream.tag, win.echostreamtag))
+		if (win.echostream.tag != win.echostreamtag)
 			NSLog(@"SANITY: window echo stream tag mismatch");
 		
 		if (win.type != wintype_Pair && !win.styleset) 
@@ -579,9 +735,9 @@ static void (*extra_unarchive_hook)(NSCoder *) = nil;
 					NSLog(@"SANITY: pair win has no child2");
 				if (!pairwin.geometry)
 					NSLog(@"SANITY: pair win has no geometry");
-				if (!NumberMatch(pairwin.child1.tag, pairwin.geometry.child1tag))
+				if (pairwin.child1.tag != pairwin.geometry.child1tag)
 					NSLog(@"SANITY: pair child1 tag mismatch");
-				if (!NumberMatch(pairwin.child2.tag, pairwin.geometry.child2tag))
+				if (pairwin.child2.tag != pairwin.geometry.child2tag)
 					NSLog(@"SANITY: pair child2 tag mismatch");
 				if (pairwin.styleset)
 					NSLog(@"SANITY: pair window has styleset");
@@ -592,8 +748,8 @@ static void (*extra_unarchive_hook)(NSCoder *) = nil;
 				
 			case wintype_TextBuffer: {
 				GlkWindowBuffer *bufwin = (GlkWindowBuffer *)win;
-				if (!bufwin.lines)
-					NSLog(@"SANITY: buffer window has no lines");
+				if (bufwin.linecount && [bufwin lineAtIndex:bufwin.linestart].index != bufwin.linestart)
+					NSLog(@"SANITY: buffer window lines are misnumbered");
 			}
 			break;
 				
@@ -615,7 +771,7 @@ static void (*extra_unarchive_hook)(NSCoder *) = nil;
 		switch (str.type) {
 			case strtype_Window: {
 				GlkStreamWindow *winstr = (GlkStreamWindow *)str;
-				if (!NumberMatch(winstr.win.tag, winstr.wintag))
+				if (winstr.win.tag != winstr.wintag)
 					NSLog(@"SANITY: window stream tag mismatch");
 				if (winstr.win.stream != winstr)
 					NSLog(@"SANITY: window stream does not match stream of window");
@@ -626,8 +782,8 @@ static void (*extra_unarchive_hook)(NSCoder *) = nil;
 				GlkStreamFile *filestr = (GlkStreamFile *)str;
 				if (!filestr.pathname)
 					NSLog(@"SANITY: file stream lacks pathname");
-				if (!filestr.handle)
-					NSLog(@"SANITY: file stream lacks file handle");
+				if (filestr.fd < 0)
+					NSLog(@"SANITY: file stream lacks file descriptor");
 			}
 			break;
 				
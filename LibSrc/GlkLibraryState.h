@@ -5,26 +5,34 @@
  */
 
 #import <Foundation/Foundation.h>
+#import "GlkTagTable.h"
 
 @interface GlkLibraryState : NSObject {
 	NSArray *windows; /* GlkWindowState objects */
 	
 	BOOL vmexited;
-	NSNumber *rootwintag;
+	GlkTag rootwintag;
 	id specialrequest;
 	
 	BOOL geometrychanged;
 	BOOL metricschanged;
 	BOOL everythingchanged;
+	
+#ifdef IOSGLK_TURN_TIMING
+	uint64_t turnstamp; /* when cloneState finished; see GlkTurnTiming.h */
+#endif // IOSGLK_TURN_TIMING
 }
 
 @property (nonatomic, retain) NSArray *windows;
 @property (nonatomic) BOOL vmexited;
-@property (nonatomic, retain) NSNumber *rootwintag;
+@property (nonatomic) GlkTag rootwintag;
 @property (nonatomic, retain) id specialrequest;
 @property (nonatomic) BOOL geometrychanged;
 @property (nonatomic) BOOL metricschanged;
 @property (nonatomic) BOOL everythingchanged;
+#ifdef IOSGLK_TURN_TIMING
+@property (nonatomic) uint64_t turnstamp;
+#endif // IOSGLK_TURN_TIMING
 
 @end
 
@@ -15,10 +15,12 @@
 @synthesize geometrychanged;
 @synthesize metricschanged;
 @synthesize everythingchanged;
+#ifdef IOSGLK_TURN_TIMING
+@synthesize turnstamp;
+#endif // IOSGLK_TURN_TIMING
 
 - (void) dealloc {
 	self.windows = nil;
-	self.rootwintag = nil;
 	self.specialrequest = nil;
 	[super dealloc];
 }
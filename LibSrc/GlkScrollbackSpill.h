@@ -0,0 +1,39 @@
+/* GlkScrollbackSpill.h: On-disk store for scrollback trimmed from a buffer window
+	for IosGlk, the iOS implementation of the Glk API.
+	Designed by Andrew Plotkin <erkyrath@eblong.com>
+	http://eblong.com/zarf/glk/
+*/
+
+#import <Foundation/Foundation.h>
+
+@class GlkStyledLine;
+
+@interface GlkScrollbackSpill : NSObject {
+	NSString *datapath; /* line records, end to end */
+	NSString *indexpath; /* one uint64_t offset into the data file per line */
+	int datafd;
+	int indexfd;
+
+	NSLock *lock; /* guards everything below, because the UI thread reads while the VM thread appends */
+	int firstindex; /* index of the first spilled line */
+	int count; /* number of lines written out (not counting pending ones) */
+	uint64_t dataend; /* length of the data file */
+
+	/* Lines appended since the last flush. Only touched by the VM thread. */
+	NSMutableData *pendingdata;
+	NSMutableData *pendingindex;
+	int pendingcount;
+}
+
+@property (nonatomic, readonly) int firstindex;
+@property (nonatomic, readonly) int count;
+
+- (id) initWithDirectory:(NSString *)dirname name:(NSString *)name;
+- (void) appendLine:(GlkStyledLine *)sln;
+- (void) flush;
+- (void) reset;
+- (void) discard;
+- (GlkStyledLine *) lineAtIndex:(int)index;
+- (NSArray *) linesFrom:(int)index count:(int)count;
+
+@end
@@ -0,0 +1,277 @@
+/* GlkScrollbackSpill.m: On-disk store for scrollback trimmed from a buffer window
+	for IosGlk, the iOS implementation of the Glk API.
+	Designed by Andrew Plotkin <erkyrath@eblong.com>
+	http://eblong.com/zarf/glk/
+*/
+
+/*	When a GlkWindowBuffer has spilling turned on, the lines it trims off the top of its scrollback are appended here instead of being thrown away. The UI can then page them back in, a few at a time, as the player scrolls up. Nothing is held in memory except the lines waiting for the next flush.
+
+	There are two append-only files. The data file holds the line records end to end. Each record is four glui32s (index, status, number of chars, number of runs), then the chars, then the runs (three glui32s each: style, start, length). The index file holds one uint64_t per line: the offset of its record in the data file. So finding line N costs one read of the index file and one read of the data file.
+
+	The files use native byte order. They're a cache for the current session, not an interchange format; they're truncated whenever the spill is created, and deleted when it's discarded.
+
+	Spilled lines are always consecutive: the window trims from the top, in order. A clearWindow resets the spill, since the view throws away everything before a clear anyway.
+
+	Appending and flushing happen on the VM thread. Reading can happen on any thread, and sees only lines which have been flushed.
+*/
+
+#import "GlkScrollbackSpill.h"
+#import "GlkLibrary.h"
+#import "GlkUtilTypes.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+#define RECORD_HEADER_LEN (4)
+
+@implementation GlkScrollbackSpill
+
+- (id) initWithDirectory:(NSString *)dirname name:(NSString *)name {
+	self = [super init];
+
+	if (self) {
+		NSFileManager *filemanager = [GlkLibrary singleton].filemanager;
+		if (!filemanager)
+			filemanager = [NSFileManager defaultManager];
+		if (![filemanager fileExistsAtPath:dirname isDirectory:nil])
+			[filemanager createDirectoryAtPath:dirname withIntermediateDirectories:YES attributes:nil error:nil];
+
+		datapath = [[dirname stringByAppendingPathComponent:[name stringByAppendingPathExtension:@"lines"]] retain];
+		indexpath = [[dirname stringByAppendingPathComponent:[name stringByAppendingPathExtension:@"index"]] retain];
+		datafd = open([datapath fileSystemRepresentation], O_RDWR|O_CREAT|O_TRUNC, 0644);
+		indexfd = open([indexpath fileSystemRepresentation], O_RDWR|O_CREAT|O_TRUNC, 0644);
+		if (datafd < 0 || indexfd < 0) {
+			NSLog(@"GlkScrollbackSpill: unable to create %@", datapath);
+			[self release];
+			return nil;
+		}
+
+		lock = [[NSLock alloc] init];
+		firstindex = 0;
+		count = 0;
+		dataend = 0;
+		pendingdata = [[NSMutableData alloc] initWithCapacity:4096];
+		pendingindex = [[NSMutableData alloc] initWithCapacity:256];
+		pendingcount = 0;
+	}
+
+	return self;
+}
+
+- (void) dealloc {
+	[self discard];
+	[datapath release];
+	datapath = nil;
+	[indexpath release];
+	indexpath = nil;
+	[pendingdata release];
+	pendingdata = nil;
+	[pendingindex release];
+	pendingindex = nil;
+	[lock release];
+	lock = nil;
+	[super dealloc];
+}
+
+- (int) firstindex {
+	[lock lock];
+	int res = firstindex;
+	[lock unlock];
+	return res;
+}
+
+- (int) count {
+	[lock lock];
+	int res = count;
+	[lock unlock];
+	return res;
+}
+
+/* Add a line to the pending batch. It won't be visible to readers until the next flush. The line must follow the last one appended; if it doesn't, the spill starts over from this line. */
+- (void) appendLine:(GlkStyledLine *)sln {
+	if (datafd < 0)
+		return;
+
+	if (count+pendingcount && sln.index != firstindex+count+pendingcount) {
+		[GlkLibrary strictWarning:@"GlkScrollbackSpill: line appended out of order"];
+		[self reset];
+	}
+	if (count+pendingcount == 0) {
+		[lock lock];
+		firstindex = sln.index;
+		[lock unlock];
+	}
+
+	uint64_t offset = dataend + pendingdata.length;
+	[pendingindex appendBytes:&offset length:sizeof(uint64_t)];
+
+	int charslen = sln.charslen;
+	int runcount = sln.runcount;
+	glui32 header[RECORD_HEADER_LEN];
+	header[0] = sln.index;
+	header[1] = sln.status;
+	header[2] = charslen;
+	header[3] = runcount;
+	[pendingdata appendBytes:header length:sizeof(header)];
+	if (charslen)
+		[pendingdata appendBytes:sln.chars length:charslen*sizeof(glui32)];
+	GlkStyledRun *runs = sln.runs;
+	for (int ix=0; ix<runcount; ix++) {
+		glui32 run[3];
+		run[0] = runs[ix].style;
+		run[1] = runs[ix].start;
+		run[2] = runs[ix].length;
+		[pendingdata appendBytes:run length:sizeof(run)];
+	}
+
+	pendingcount++;
+}
+
+/* Write the pending batch to disk and make it visible to readers. If the write fails, spilling stops (and what was spilled is kept). */
+- (void) flush {
+	if (!pendingcount)
+		return;
+
+	if (datafd >= 0) {
+		ssize_t datalen = pendingdata.length;
+		ssize_t indexlen = pendingindex.length;
+		if (pwrite(datafd, pendingdata.bytes, datalen, dataend) != datalen
+			|| pwrite(indexfd, pendingindex.bytes, indexlen, (off_t)count * sizeof(uint64_t)) != indexlen) {
+			NSLog(@"GlkScrollbackSpill: unable to write %@; no longer spilling", datapath);
+			[lock lock];
+			close(datafd);
+			close(indexfd);
+			datafd = -1;
+			indexfd = -1;
+			[lock unlock];
+		}
+		else {
+			[lock lock];
+			dataend += datalen;
+			count += pendingcount;
+			[lock unlock];
+		}
+	}
+
+	pendingdata.length = 0;
+	pendingindex.length = 0;
+	pendingcount = 0;
+}
+
+/* Throw away all the spilled lines, but keep the files open for more. */
+- (void) reset {
+	[lock lock];
+	if (datafd >= 0) {
+		ftruncate(datafd, 0);
+		ftruncate(indexfd, 0);
+	}
+	firstindex = 0;
+	count = 0;
+	dataend = 0;
+	[lock unlock];
+
+	pendingdata.length = 0;
+	pendingindex.length = 0;
+	pendingcount = 0;
+}
+
+/* Close and delete the files. Nothing more can be spilled or read. */
+- (void) discard {
+	[lock lock];
+	if (datafd >= 0) {
+		close(datafd);
+		close(indexfd);
+		datafd = -1;
+		indexfd = -1;
+		unlink([datapath fileSystemRepresentation]);
+		unlink([indexpath fileSystemRepresentation]);
+	}
+	count = 0;
+	dataend = 0;
+	[lock unlock];
+
+	pendingdata.length = 0;
+	pendingindex.length = 0;
+	pendingcount = 0;
+}
+
+/* Read back one spilled line, as a new (autoreleased) GlkStyledLine. Returns nil if the line isn't in the spill. */
+- (GlkStyledLine *) lineAtIndex:(int)index {
+	NSArray *arr = [self linesFrom:index count:1];
+	if (!arr.count)
+		return nil;
+	return [arr objectAtIndex:0];
+}
+
+/* Read back up to num consecutive spilled lines, starting at the given index. This takes one read from each file, however many lines are wanted. The result is clipped to the lines in the spill (so it may be empty). */
+- (NSArray *) linesFrom:(int)index count:(int)num {
+	NSMutableArray *arr = [NSMutableArray arrayWithCapacity:(num > 0 ? num : 0)];
+	uint64_t *offsets = NULL;
+	glui32 *data = NULL;
+	ssize_t indexlen, datalen;
+
+	[lock lock];
+
+	int pos = index - firstindex;
+	if (pos < 0) {
+		num += pos;
+		pos = 0;
+	}
+	if (pos+num > count)
+		num = count - pos;
+	if (datafd < 0 || num <= 0) {
+		[lock unlock];
+		return arr;
+	}
+
+	/* The offsets of the wanted lines, plus the end of the last one. */
+	offsets = (uint64_t *)malloc((num+1) * sizeof(uint64_t));
+	int numoffsets = (pos+num < count) ? num+1 : num;
+	indexlen = numoffsets * sizeof(uint64_t);
+	if (pread(indexfd, offsets, indexlen, (off_t)pos * sizeof(uint64_t)) != indexlen)
+		goto readfailed;
+	if (numoffsets == num)
+		offsets[num] = dataend;
+
+	datalen = offsets[num] - offsets[0];
+	data = (glui32 *)malloc(datalen);
+	if (pread(datafd, data, datalen, offsets[0]) != datalen)
+		goto readfailed;
+
+	[lock unlock];
+
+	for (int ix=0; ix<num; ix++) {
+		glui32 *rec = data + (offsets[ix] - offsets[0]) / sizeof(glui32);
+		glui32 reclen = (offsets[ix+1] - offsets[ix]) / sizeof(glui32);
+		if (reclen < RECORD_HEADER_LEN)
+			break;
+		glui32 charslen = rec[2];
+		glui32 runcount = rec[3];
+		if (RECORD_HEADER_LEN + charslen + 3*runcount != reclen)
+			break;
+
+		GlkStyledLine *sln = [[GlkStyledLine alloc] initWithIndex:rec[0] status:rec[1]];
+		glui32 *chars = rec + RECORD_HEADER_LEN;
+		glui32 *run = chars + charslen;
+		for (glui32 jx=0; jx<runcount; jx++, run+=3) {
+			if (run[1] > charslen || run[2] > charslen - run[1])
+				break;
+			[sln appendChars:chars+run[1] len:run[2] style:run[0]];
+		}
+		[sln freeze];
+		[arr addObject:sln];
+		[sln release];
+	}
+
+	free(offsets);
+	free(data);
+	return arr;
+
+readfailed:
+	[lock unlock];
+	NSLog(@"GlkScrollbackSpill: unable to read %@", datapath);
+	free(offsets);
+	free(data);
+	return arr;
+}
+
+@end
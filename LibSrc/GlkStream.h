@@ -5,11 +5,13 @@
 */
 
 #import <Foundation/Foundation.h>
+#import "GlkTagTable.h"
 #include "glk.h"
 #include "gi_dispa.h"
 
 @class GlkLibrary;
 @class GlkWindow;
+@class GlkStreamFileWriter;
 
 typedef enum GlkStreamType_enum {
 	strtype_None=0,
@@ -21,8 +23,10 @@ typedef enum GlkStreamType_enum {
 @interface GlkStream : NSObject {
 	GlkLibrary *library;
 	BOOL inlibrary;
+	GlkStream *libprev; /* neighbors in the library's list, in creation order; not retained */
+	GlkStream *libnext;
 	
-	NSNumber *tag;
+	GlkTag tag;
 	gidispatch_rock_t disprock;
 
 	GlkStreamType type; /* file, window, or memory stream */
@@ -34,7 +38,9 @@ typedef enum GlkStreamType_enum {
 }
 
 @property (nonatomic, retain) GlkLibrary *library;
-@property (nonatomic, retain) NSNumber *tag;
+@property (nonatomic, assign) GlkStream *libprev;
+@property (nonatomic, assign) GlkStream *libnext;
+@property (nonatomic) GlkTag tag;
 @property (nonatomic) gidispatch_rock_t disprock;
 @property (nonatomic, readonly) GlkStreamType type;
 @property (nonatomic, readonly) glui32 rock;
@@ -61,15 +67,22 @@ typedef enum GlkStreamType_enum {
 @end
 
 
+#define STAGE_BUFFER_SIZE (256)
+
 @interface GlkStreamWindow : GlkStream {
 	GlkWindow *win;
-	NSNumber *wintag;
+	GlkTag wintag;
+	
+	/* Characters from putChar/putUChar that haven't been passed to the window yet. At most one stream (library.stagedstr) has any. */
+	glui32 stagebuf[STAGE_BUFFER_SIZE];
+	int stagelen;
 }
 
 @property (nonatomic, retain) GlkWindow *win;
-@property (nonatomic, retain) NSNumber *wintag;
+@property (nonatomic) GlkTag wintag;
 
 - (id) initWithWindow:(GlkWindow *)win;
+- (void) flushStaged;
 
 @end
 
@@ -104,29 +117,40 @@ typedef enum GlkStreamType_enum {
 @end
 
 @interface GlkStreamFile : GlkStream {
-	NSFileHandle *handle;
+	int fd; // the open file descriptor, or -1
 	NSString *pathname; // only needed for serialization
 	glui32 fmode;
 	BOOL textmode;
 	
+	unsigned long long filepos; // the stream's mark, when the buffer isn't live (we use pread/pwrite, so the descriptor has no mark of its own)
+	
 	int maxbuffersize; // how much data to buffer at a time (ideally)
-	NSData *readbuffer; // if !writable
-	NSMutableData *writebuffer; // if writable
+	char *buffer; // malloced (maxbuffersize bytes) on first use, and reused thereafter
+	BOOL bufferlive; // whether the buffer holds part of the file
 	unsigned long long bufferpos; // position within the file where the buffer begins
 	// the following are all relative to bufferpos:
+	int bufferlen; // number of valid bytes in the buffer
 	int buffermark; // offset within the buffer where the mark sits
-	int buffertruepos; // offset within the buffer where the filehandle's mark sits
-	int bufferdirtystart; // buffersize if nothing dirty
+	int bufferdirtystart; // maxbuffersize if nothing dirty
 	int bufferdirtyend; // 0 if nothing dirty
 	
+	BOOL mapped; // if set, the whole file is memory-mapped, and buffer points at the mapping (read-only streams only)
+	
+	BOOL writebehind; // if set, flushes hand the dirty buffer to a background thread instead of writing it (writable streams only)
+	GlkStreamFileWriter *writer; // the background thread; created on the first write-behind flush
+	
+	glui32 flushcount; // number of times dirty data has been written out (or handed to the writer)
+	glui32 refillcount; // number of times the buffer has been loaded from the file
+	
 	unsigned long long offsetinfile; // (in bytes) only used during deserialization; zero normally
 }
 
-@property (nonatomic, retain) NSFileHandle *handle;
+@property (nonatomic, readonly) int fd;
 @property (nonatomic, retain) NSString *pathname;
-@property (nonatomic, retain) NSData *readbuffer;
-@property (nonatomic, retain) NSMutableData *writebuffer;
 @property (nonatomic) unsigned long long offsetinfile;
+@property (nonatomic) BOOL writebehind;
+@property (nonatomic, readonly) glui32 flushcount;
+@property (nonatomic, readonly) glui32 refillcount;
 
 - (id) initWithMode:(glui32)fmode rock:(glui32)rockval unicode:(BOOL)unicode fileref:(GlkFileRef *)fref;
 - (id) initWithMode:(glui32)fmode rock:(glui32)rockval unicode:(BOOL)isunicode textmode:(BOOL)istextmode dirname:(NSString *)dirname pathname:(NSString *)pathname;
@@ -134,9 +158,33 @@ typedef enum GlkStreamType_enum {
 - (void) flush;
 - (BOOL) reopenInternal;
 - (int) readByte;
-- (glui32) readBytes:(void **)byteref len:(glui32)len;
+- (glui32) readBytesInto:(void *)dest len:(glui32)len;
 - (void) writeByte:(char)ch;
 - (void) writeBytes:(void *)bytes len:(glui32)len;
+- (void) writeWords:(void *)src len:(glui32)len wide:(BOOL)wide;
+- (glui32) readWords:(glui32 *)dest len:(glui32)len;
+- (void) writeUTF8:(void *)src len:(glui32)len wide:(BOOL)wide;
+- (glui32) readUTF8:(void *)dest len:(glui32)len wide:(BOOL)wide line:(BOOL)stopatnewline;
 
 @end
 
+@interface GlkStreamFileWriter : NSObject {
+	int fd; // borrowed from the stream, which closes it after stopping us
+	NSString *pathname; // for error messages
+	
+	NSCondition *cond; // guards everything below
+	BOOL pending; // a write is in flight
+	BOOL stopping;
+	char *jobbuf; // the buffer being written (or the last one written, if not pending); we own it
+	int jobstart;
+	int joblen;
+	unsigned long long joboffset;
+}
+
+- (id) initWithFD:(int)fd pathname:(NSString *)pathname;
+- (char *) writeBuffer:(char *)buf from:(int)start len:(int)len offset:(unsigned long long)offset;
+- (void) waitForWrites;
+- (void) waitForWritesOverlapping:(unsigned long long)offset len:(unsigned long long)len;
+- (void) stop;
+
+@end
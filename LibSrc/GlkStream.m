@@ -13,10 +13,20 @@
 #import "GlkWindow.h"
 #import "GlkFileRef.h"
 #import "GlkLibrary.h"
+#import "IosGlkLibDelegate.h"
+#include "GlkByteOrder.h"
+#include "GlkUTF8.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 
 @implementation GlkStream
 
 @synthesize library;
+@synthesize libprev;
+@synthesize libnext;
 @synthesize tag;
 @synthesize disprock;
 @synthesize type;
@@ -42,7 +52,7 @@
 		writecount = 0;
 		unicode = NO;
 				
-		[library.streams addObject:self];
+		[library addStream:self];
 		
 		if (library.dispatch_register_obj)
 			disprock = (*library.dispatch_register_obj)(self, gidisp_Class_Stream);
@@ -52,7 +62,7 @@
 }
 
 - (id) initWithCoder:(NSCoder *)decoder {
-	self.tag = [decoder decodeObjectForKey:@"tag"];
+	self.tag = GlkTagDecode(decoder, @"tag");
 	inlibrary = YES;
 	// self.library will be set later
 	
@@ -78,7 +88,6 @@
 	type = strtype_None;
 	if (!tag)
 		[NSException raise:@"GlkException" format:@"GlkStream reached dealloc with tag unset"];
-	self.tag = nil;
 	
 	self.library = nil;
 
@@ -86,11 +95,11 @@
 }
 
 - (NSString *) description {
-	return [NSString stringWithFormat:@"<%@ (mode %s%s, tag %@, rock %d): 0x%lx>", self.class, (readable?"r":""), (writable?"w":""), self.tag, self.rock, (long)self];
+	return [NSString stringWithFormat:@"<%@ (mode %s%s, tag %ld, rock %d): 0x%lx>", self.class, (readable?"r":""), (writable?"w":""), (long)self.tag, self.rock, (long)self];
 }
 
 - (void) encodeWithCoder:(NSCoder *)encoder {
-	[encoder encodeObject:tag forKey:@"tag"];
+	GlkTagEncode(encoder, tag, @"tag");
 	
 	[encoder encodeInt32:type forKey:@"type"];
 	[encoder encodeInt32:rock forKey:@"rock"];
@@ -116,9 +125,7 @@
 	if (library.dispatch_unregister_obj)
 		(*library.dispatch_unregister_obj)(self, gidisp_Class_Stream, disprock);
 		
-	if (![library.streams containsObject:self])
-		[NSException raise:@"GlkException" format:@"GlkStream was not in library streams list"];
-	[library.streams removeObject:self];
+	[library removeStream:self];
 	inlibrary = NO;
 }
 
@@ -202,6 +209,7 @@
 	if (self) {
 		self.win = winref;
 		self.wintag = winref.tag;
+		stagelen = 0;
 	}
 	
 	return self;
@@ -211,8 +219,9 @@
 	self = [super initWithCoder:decoder];
 	
 	if (self) {
-		self.wintag = [decoder decodeObjectForKey:@"wintag"];
+		self.wintag = GlkTagDecode(decoder, @"wintag");
 		// win will be set later.
+		stagelen = 0;
 	}
 	
 	return self;
@@ -220,7 +229,6 @@
 
 - (void) dealloc {
 	self.win = nil;
-	self.wintag = nil;
 	[super dealloc];
 }
 
@@ -228,12 +236,16 @@
 	[super encodeWithCoder:encoder];
 	
 	if (win)
-		[encoder encodeObject:win.tag forKey:@"wintag"];
+		GlkTagEncode(encoder, win.tag, @"wintag");
 }
 
 - (void) streamDelete {
+	/* The window has already flushed us, if it was going to. Whatever's left is discarded. */
+	stagelen = 0;
+	if (library.stagedstr == self)
+		library.stagedstr = nil;
 	self.win = nil;
-	self.wintag = nil;
+	self.wintag = 0;
 	[super streamDelete];
 }
 
@@ -245,9 +257,62 @@
 	return 0;
 }
 
+/*	Character-at-a-time output is staged: putChar and putUChar append to stagebuf, and the whole run goes to the window in one putUBuffer call. The run is flushed by any other output to this stream, a style change, or the buffer filling up; and, through [GlkLibrary flushStagedOutput], by glk_select, a window switch, or any window call that could care about the window's contents.
+ 
+	Only one stream stages at a time. (So switching windows in the middle of a run flushes it.) A window with an echo stream, or a pending line request, doesn't stage at all; those cases go through putBuffer as before. Neither can change without a flush, so it's enough to check them at the start of a run.
+*/
+- (void) putChar:(unsigned char)ch {
+	if (!stagelen) {
+		if (win.line_request || win.echostream) {
+			[super putChar:ch];
+			return;
+		}
+		[library flushStagedOutput];
+		library.stagedstr = self;
+	}
+	else if (stagelen >= STAGE_BUFFER_SIZE) {
+		[self flushStaged];
+		library.stagedstr = self;
+	}
+	
+	stagebuf[stagelen++] = ch;
+	writecount++;
+}
+
+- (void) putUChar:(glui32)ch {
+	if (!stagelen) {
+		if (win.line_request || win.echostream) {
+			[super putUChar:ch];
+			return;
+		}
+		[library flushStagedOutput];
+		library.stagedstr = self;
+	}
+	else if (stagelen >= STAGE_BUFFER_SIZE) {
+		[self flushStaged];
+		library.stagedstr = self;
+	}
+	
+	stagebuf[stagelen++] = ch;
+	writecount++;
+}
+
+/* Pass the staged characters to the window. (They were counted in writecount when they were staged.) */
+- (void) flushStaged {
+	if (library.stagedstr == self)
+		library.stagedstr = nil;
+	if (!stagelen)
+		return;
+	int len = stagelen;
+	stagelen = 0;
+	[win putUBuffer:stagebuf len:len];
+}
+
 - (void) putBuffer:(char *)buf len:(glui32)len {
 	if (!len)
 		return;
+	if (stagelen)
+		[self flushStaged];
 	writecount += len;
 	
 	if (win.line_request) {
@@ -264,6 +329,8 @@
 - (void) putUBuffer:(glui32 *)buf len:(glui32)len {
 	if (!len)
 		return;
+	if (stagelen)
+		[self flushStaged];
 	writecount += len;
 	
 	if (win.line_request) {
@@ -278,6 +345,8 @@
 }
 
 - (void) setStyle:(glui32)styl {
+	if (stagelen)
+		[self flushStaged];
 	win.style = styl;
 	
 	if (win.echostream)
@@ -748,7 +817,6 @@
 	getlen -= 1; /* for the terminal null */
 	
 	glui32 lx;
-	int gotnewline = FALSE;
 	
 	if (!unicode) {
 		if (bufptr >= bufend) {
@@ -763,21 +831,20 @@
 					getlen = 0;
 			}
 		}
-		gotnewline = FALSE;
+		/* Find the newline first, and then copy the whole line in one go. */
+		lx = getlen;
+		unsigned char *nl = memchr(bufptr, '\n', getlen);
+		if (nl)
+			lx = (nl - bufptr) + 1;
 		if (!wantunicode) {
 			unsigned char *cgetbuf = getbuf;
-			for (lx=0; lx<getlen && !gotnewline; lx++) {
-				cgetbuf[lx] = bufptr[lx];
-				gotnewline = (cgetbuf[lx] == '\n');
-			}
+			memcpy(cgetbuf, bufptr, lx);
 			cgetbuf[lx] = '\0';
 		}
 		else {
 			glui32 *ugetbuf = getbuf;
-			for (lx=0; lx<getlen && !gotnewline; lx++) {
-				ugetbuf[lx] = (unsigned char)(bufptr[lx]);
-				gotnewline = (ugetbuf[lx] == '\n');
-			}
+			for (glui32 ix=0; ix<lx; ix++)
+				ugetbuf[ix] = bufptr[ix];
 			ugetbuf[lx] = '\0';
 		}
 		bufptr += lx;
@@ -795,27 +862,21 @@
 					getlen = 0;
 			}
 		}
-		gotnewline = FALSE;
+		/* As above, but the search is over words. */
+		lx = GlkFindWord32(ubufptr, getlen, '\n');
+		if (lx < getlen)
+			lx++;
 		if (!wantunicode) {
 			unsigned char *cgetbuf = getbuf;
-			for (lx=0; lx<getlen && !gotnewline; lx++) {
-				glui32 ch;
-				ch = ubufptr[lx];
-				if (ch >= 0x100)
-					ch = '?';
-				cgetbuf[lx] = ch;
-				gotnewline = (ch == '\n');
+			for (glui32 ix=0; ix<lx; ix++) {
+				glui32 ch = ubufptr[ix];
+				cgetbuf[ix] = (ch >= 0x100) ? '?' : ch;
 			}
 			cgetbuf[lx] = '\0';
 		}
 		else {
 			glui32 *ugetbuf = getbuf;
-			for (lx=0; lx<getlen && !gotnewline; lx++) {
-				glui32 ch;
-				ch = ubufptr[lx];
-				ugetbuf[lx] = ch;
-				gotnewline = (ch == '\n');
-			}
+			memcpy(ugetbuf, ubufptr, lx*sizeof(glui32));
 			ugetbuf[lx] = '\0';
 		}
 		ubufptr += lx;
@@ -828,6 +889,12 @@
 @end
 
 
+/* Conversions to and from the file's byte format go through a stack buffer of this many characters at a time, rather than a malloc per call. */
+#define FILE_CHUNK_LEN (256)
+
+/* Write-behind streams use a bigger buffer, so that handing one to the writer thread happens less often. */
+#define FILE_WRITEBEHIND_BUFFER_LEN (65536)
+
 @implementation GlkStreamFile
 
 /*	We handle disk files differently depending on whether they're Unicode or not, and whether they're text-mode or not. (Remember that the Unicode flag depends on whether the call comes from glk_stream_open_file_uni(); the text-mode flag comes from the fileref.)
@@ -837,18 +904,76 @@
 	A Unicode, binary-mode file is a stream of big-endian 32-bit integers. (The get/set_position calls are counted in characters, so they count 32-bit chunks.)
 	
 	A text-mode file is UTF-8 encoded. The Unicode flag is ignored for text-mode files; they're all just UTF-8. The get/set_position calls count in bytes, and are therefore hard to use. Seeking to beginning/end of file is safe, but jumping around inside the file may land you in the middle of a UTF-8 character.
+ 
+	A file opened with filemode_Read is memory-mapped, if possible. (Story files and Blorb archives are the common case; they're big, and read at scattered positions.) See mapFile.
+ 
+	A writable file may be in write-behind mode, if the library delegate asks for it. See flush.
 */
 
-@synthesize handle;
+@synthesize fd;
 @synthesize pathname;
-@synthesize readbuffer;
-@synthesize writebuffer;
 @synthesize offsetinfile;
+@synthesize writebehind;
+@synthesize flushcount;
+@synthesize refillcount;
+
+/* Open the file descriptor for the stream's mode. We don't create anything here; the caller has to do that if it wants to. Returns -1 on failure. */
+static int open_for_mode(NSString *path, glui32 fmode) {
+	int flags;
+	switch (fmode) {
+		case filemode_Read:
+			flags = O_RDONLY;
+			break;
+		case filemode_Write:
+			flags = O_WRONLY;
+			break;
+		case filemode_ReadWrite:
+		case filemode_WriteAppend:
+		default:
+			flags = O_RDWR;
+			break;
+	}
+	return open([path fileSystemRepresentation], flags);
+}
+
+/* pread() until we have len bytes, or hit the end of the file. Returns the number of bytes read. */
+static size_t pread_fully(int fd, void *buf, size_t len, unsigned long long offset) {
+	size_t sofar = 0;
+	while (sofar < len) {
+		ssize_t got = pread(fd, (char *)buf+sofar, len-sofar, offset+sofar);
+		if (got < 0 && errno == EINTR)
+			continue;
+		if (got <= 0)
+			break;
+		sofar += got;
+	}
+	return sofar;
+}
+
+/* pwrite() all len bytes. Returns the number of bytes written, which is less than len only if there was an error. */
+static size_t pwrite_fully(int fd, void *buf, size_t len, unsigned long long offset) {
+	size_t sofar = 0;
+	while (sofar < len) {
+		ssize_t got = pwrite(fd, (char *)buf+sofar, len-sofar, offset+sofar);
+		if (got < 0 && errno == EINTR)
+			continue;
+		if (got <= 0)
+			break;
+		sofar += got;
+	}
+	return sofar;
+}
 
 /* This constructor is used by the regular Glk glk_stream_open_file() call.
 */
 - (id) initWithMode:(glui32)fmodeval rock:(glui32)rockval unicode:(BOOL)isunicode fileref:(GlkFileRef *)fref {
 	self = [self initWithMode:fmodeval rock:rockval unicode:isunicode textmode:fref.textmode dirname:fref.dirname pathname:fref.pathname];
+	if (self && writable) {
+		/* The delegate method is optional; without it, no write-behind. */
+		id <IosGlkLibDelegate> delegate = [GlkLibrary singleton].glkdelegate;
+		if ([delegate respondsToSelector:@selector(writeBehindForFileUsage:)] && [delegate writeBehindForFileUsage:fref.filetype])
+			self.writebehind = YES;
+	}
 	return self;
 }
 
@@ -862,16 +987,23 @@
 	
 	if (self) {
 		fmode = fmodeval;
+		fd = -1;
+		filepos = 0;
 		
-		/* Set up the buffering. */
-		maxbuffersize = 512;
-		readbuffer = nil;
-		writebuffer = nil;
+		/* Set up the buffering. The buffer itself is allocated when it's first needed. */
+		maxbuffersize = 4096;
+		buffer = NULL;
+		bufferlive = NO;
 		bufferpos = 0;
+		bufferlen = 0;
 		buffermark = 0;
-		buffertruepos = 0;
 		bufferdirtystart = maxbuffersize;
 		bufferdirtyend = 0;
+		mapped = NO;
+		writebehind = NO;
+		writer = nil;
+		flushcount = 0;
+		refillcount = 0;
 		
 		/* Set the easy fields. */
 		self.pathname = path;
@@ -881,7 +1013,7 @@
 		if (fmode != filemode_Read) {
 			NSFileManager *filemanager = [GlkLibrary singleton].filemanager;
 			
-			/* Create the directory first, if it doesn't already exist. (If it already exists as a regular file, we won't try the create, the subsequent file-create will fail, and then the filehandle won't open.) */
+			/* Create the directory first, if it doesn't already exist. (If it already exists as a regular file, we won't try the create, the subsequent file-create will fail, and then the file won't open.) */
 			if (![filemanager fileExistsAtPath:dirname isDirectory:nil])
 				[filemanager createDirectoryAtPath:dirname withIntermediateDirectories:YES attributes:nil error:nil];
 			
@@ -890,22 +1022,10 @@
 				[filemanager createFileAtPath:pathname contents:nil attributes:nil];
 		}
 
-		/* Open the file handle. */
-		NSFileHandle *newhandle = nil;
-		switch (fmode) {
-			case filemode_Read:
-				newhandle = [NSFileHandle fileHandleForReadingAtPath:pathname];
-				break;
-			case filemode_Write:
-				newhandle = [NSFileHandle fileHandleForWritingAtPath:pathname];
-				break;
-			case filemode_ReadWrite:
-			case filemode_WriteAppend:
-				newhandle = [NSFileHandle fileHandleForUpdatingAtPath:pathname];
-				break;
-		}
+		/* Open the file descriptor. */
+		fd = open_for_mode(pathname, fmode);
 		
-		if (!newhandle) {
+		if (fd < 0) {
 			/* Failed, probably because the file doesn't exist. */
 			[self streamDelete];
 			[self release];
@@ -913,11 +1033,14 @@
 		}
 		
 		if (fmode == filemode_Write)
-			[newhandle truncateFileAtOffset:0];
-		if (fmode == filemode_WriteAppend)
-			[newhandle seekToEndOfFile];
-	
-		self.handle = newhandle;
+			ftruncate(fd, 0);
+		if (fmode == filemode_WriteAppend) {
+			struct stat st;
+			if (fstat(fd, &st) == 0)
+				filepos = st.st_size;
+		}
+		if (fmode == filemode_Read)
+			[self mapFile];
 	}
 	
 	return self;
@@ -935,25 +1058,43 @@
 		offsetinfile = [decoder decodeInt64ForKey:@"offsetinfile"];
 		
 		// start out with an empty buffer
-		readbuffer = nil;
-		writebuffer = nil;
+		buffer = NULL;
+		bufferlive = NO;
 		bufferpos = 0;
+		bufferlen = 0;
 		buffermark = 0;
-		buffertruepos = 0;
 		bufferdirtystart = maxbuffersize;
 		bufferdirtyend = 0;
+		mapped = NO;
+		writebehind = [decoder decodeBoolForKey:@"writebehind"];
+		writer = nil;
+		flushcount = 0;
+		refillcount = 0;
 		
 		// but we don't open the file itself at this time
+		fd = -1;
+		filepos = 0;
 	}
 	
 	return self;
 }
 
 - (void) dealloc {
-	self.handle = nil;
+	[self unmapFile];
+	if (writer) {
+		[writer stop];
+		[writer release];
+		writer = nil;
+	}
+	if (fd >= 0) {
+		close(fd);
+		fd = -1;
+	}
+	if (buffer) {
+		free(buffer);
+		buffer = NULL;
+	}
 	self.pathname = nil;
-	self.readbuffer = nil;
-	self.writebuffer = nil;
 	[super dealloc];
 }
 
@@ -961,340 +1102,451 @@
 	[super encodeWithCoder:encoder];
 	
 	[self flush];
+	[writer waitForWrites];
 	
 	[encoder encodeObject:[GlkFileRef relativizePath:pathname] forKey:@"pathname"];
 	[encoder encodeInt32:fmode forKey:@"fmode"];
 	[encoder encodeBool:textmode forKey:@"textmode"];
 	[encoder encodeInt:maxbuffersize forKey:@"maxbuffersize"];
+	[encoder encodeBool:writebehind forKey:@"writebehind"];
 	
-	[encoder encodeInt64:[handle offsetInFile] forKey:@"offsetinfile"];
+	[encoder encodeInt64:filepos forKey:@"offsetinfile"];
 
 	// skip the buffer fields, since we flushed it.
 }
 
-/* Open the file handle after a deserialize, and seek to the appropriate point. Called from GlkLibrary.updateFromLibrary. 
+/* Open the file descriptor after a deserialize, and set the mark to the appropriate point. Called from GlkLibrary.updateFromLibrary. 
  
-	We don't try to create the file (or the directory) here -- if the file doesn't exist, we give up. If this returns failure, handle remains nil and the caller should close the stream.
+	We don't try to create the file (or the directory) here -- if the file doesn't exist, we give up. If this returns failure, fd remains -1 and the caller should close the stream.
  */
 - (BOOL) reopenInternal {
-	NSFileHandle *newhandle = nil;
-	switch (fmode) {
-		case filemode_Read:
-			newhandle = [NSFileHandle fileHandleForReadingAtPath:pathname];
-			break;
-		case filemode_Write:
-			newhandle = [NSFileHandle fileHandleForWritingAtPath:pathname];
-			break;
-		case filemode_ReadWrite:
-		case filemode_WriteAppend:
-			newhandle = [NSFileHandle fileHandleForUpdatingAtPath:pathname];
-			break;
-	}
-	
-	if (!newhandle)
+	int newfd = open_for_mode(pathname, fmode);
+	if (newfd < 0)
 		return NO;
 	
-	self.handle = newhandle;
-	[handle seekToFileOffset:offsetinfile];
+	fd = newfd;
+	filepos = offsetinfile;
 	offsetinfile = 0;
+	if (fmode == filemode_Read)
+		[self mapFile];
 	
 	return YES;
 }
 
+/* Map the whole file into memory, and make the mapping the (permanently live) buffer, so that reads and seeks never touch the file again. The mark becomes buffermark; bufferpos is always zero. If the file is empty, too big, or can't be mapped, we quietly stay with pread.
+ 
+	The mapping is private and read-only. On iOS nobody else will change the file underneath us (see below); if they did, we'd see their changes, which is no worse than the buffered case. */
+- (void) mapFile {
+	if (mapped || fd < 0)
+		return;
+	
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+		return;
+	if (st.st_size <= 0 || st.st_size > INT_MAX)
+		return;
+	
+	void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (addr == MAP_FAILED)
+		return;
+	
+	if (buffer) {
+		free(buffer);
+		buffer = NULL;
+	}
+	mapped = YES;
+	buffer = addr;
+	bufferlive = YES;
+	bufferpos = 0;
+	bufferlen = st.st_size;
+	buffermark = (filepos < bufferlen) ? filepos : bufferlen;
+	bufferdirtystart = maxbuffersize;
+	bufferdirtyend = 0;
+}
+
+/* Release the mapping, if there is one. The mark is left in filepos. */
+- (void) unmapFile {
+	if (!mapped)
+		return;
+	
+	filepos = buffermark;
+	munmap(buffer, bufferlen);
+	mapped = NO;
+	buffer = NULL;
+	bufferlive = NO;
+	bufferlen = 0;
+	buffermark = 0;
+}
+
+/* Turn write-behind mode on or off. Turning it on switches to the bigger buffer; turning it off waits for the writer thread to finish. Mapped and read-only streams ignore this. */
+- (void) setWritebehind:(BOOL)flag {
+	if (flag && (!writable || mapped))
+		flag = NO;
+	if (flag == writebehind)
+		return;
+	
+	[self flush];
+	if (writer) {
+		[writer stop];
+		[writer release];
+		writer = nil;
+	}
+	writebehind = flag;
+	if (writebehind && maxbuffersize < FILE_WRITEBEHIND_BUFFER_LEN) {
+		/* The buffer isn't live after a flush, so we can just drop it. */
+		if (buffer) {
+			free(buffer);
+			buffer = NULL;
+		}
+		maxbuffersize = FILE_WRITEBEHIND_BUFFER_LEN;
+		bufferdirtystart = maxbuffersize;
+	}
+}
+
 - (void) streamDelete {
 	[self flush];
-	[handle closeFile];
-	self.handle = nil;
+	if (writer) {
+		/* Close waits for everything to hit the file. */
+		[writer stop];
+		[writer release];
+		writer = nil;
+	}
+	[self unmapFile];
+	if (fd >= 0) {
+		close(fd);
+		fd = -1;
+	}
 	self.pathname = nil;
 	[super streamDelete];
 }
 
-/* Here we implement some low-level read/write functions, which put an internal byte buffer on top of the underlying NSFileHandle.
+/* Here we implement some low-level read/write functions, which put an internal byte buffer on top of the file descriptor.
 
-	If the buffer is live, the filehandle's real mark (seek position) is always bufferpos+buffertruepos.
+	All file access is pread() and pwrite() at an explicit offset, so the descriptor's own seek position doesn't matter. If the buffer is live, the stream's mark is bufferpos+buffermark; otherwise it's filepos.
 
-	For read-only files, the buffer can be an NSData of up to maxbuffersize bytes. The bufferrtruepos will always be at the end (equal to buffer.length). A caller can read until the buffer is used up; the next call will trigger a filehandle read. (Note that if you keep reading repeatedly after EOF, you'll trigger repeated filehandle reads, which is slow. Don't do that.)
+	There is one buffer per stream, malloced on first use and kept until the stream closes. Loading it reads up to maxbuffersize bytes from the mark (if the file is readable). A caller can read until the buffer is used up; the next call will trigger a file read. (Note that if you keep reading repeatedly after EOF, you'll trigger repeated file reads, which is slow. Don't do that.)
 	
-	For writable files, the buffer can be an NSMutableData of up to maxbuffersize bytes. If the caller writes past buffertruepos, the buffer will get longer.
+	For writable files, a caller can write until the buffer is full; bufferlen grows as the writes go past it. The bytes between bufferdirtystart and bufferdirtyend are written back by flush.
 
 	This isn't the greatest buffering implementation in the world; it doesn't really try to cope with the possibility that some other process might diddle the file while we have it open. Fortunately, on iOS, no other process *will* diddle the file while we have it open.
 */
 
+/* Fill the buffer from the file, starting at the mark. The buffer must not be live (call flush first). Afterwards it is live, even if nothing could be read.
+*/
+- (void) loadBuffer {
+	if (!buffer) {
+		buffer = malloc(maxbuffersize);
+		if (!buffer)
+			[NSException raise:@"GlkException" format:@"unable to allocate file stream buffer"];
+	}
+	
+	bufferpos = filepos;
+	bufferlen = 0;
+	if (readable) {
+		[writer waitForWritesOverlapping:bufferpos len:maxbuffersize];
+		bufferlen = pread_fully(fd, buffer, maxbuffersize, bufferpos);
+		refillcount++;
+	}
+	buffermark = 0;
+	bufferdirtystart = maxbuffersize;
+	bufferdirtyend = 0;
+	bufferlive = YES;
+}
+
 /* Return one byte (0-255), or -1 for EOF.
 */
 - (int) readByte {
-	if (writable) {
-		if (!writebuffer || buffermark >= writebuffer.length) {
-			[self flush];
-			bufferpos = [handle offsetInFile];
-			NSData *data = [handle readDataOfLength:maxbuffersize];
-			if (!data || !data.length) {
-				// Must be at the end of the file. Leave the buffer off.
-			}
-			else {
-				self.writebuffer = [NSMutableData dataWithData:data];
-				buffermark = 0;
-				buffertruepos = writebuffer.length;
-				bufferdirtystart = maxbuffersize;
-				bufferdirtyend = 0;
-			}
-		}
-		if (writebuffer && buffermark < writebuffer.length) {
-			return ((char *)writebuffer.mutableBytes)[buffermark++] & 0xFF;
-		}
+	if (mapped) {
+		if (buffermark < bufferlen)
+			return buffer[buffermark++] & 0xFF;
 		return -1;
 	}
-	else {
-		if (!readbuffer || buffermark >= readbuffer.length) {
-			[self flush];
-			bufferpos = [handle offsetInFile];
-			NSData *data = [handle readDataOfLength:maxbuffersize];
-			if (!data || !data.length) {
-				// Must be at the end of the file. Leave the buffer off.
-			}
-			else {
-				self.readbuffer = data;
-				buffermark = 0;
-				buffertruepos = readbuffer.length;
-				bufferdirtystart = maxbuffersize;
-				bufferdirtyend = 0;
-			}
-		}
-		if (readbuffer && buffermark < readbuffer.length) {
-			return ((char *)readbuffer.bytes)[buffermark++] & 0xFF;
-		}
-		return -1;
+	
+	if (!bufferlive || buffermark >= bufferlen) {
+		[self flush];
+		[self loadBuffer];
 	}
+	if (buffermark < bufferlen) {
+		return buffer[buffermark++] & 0xFF;
+	}
+	return -1;
 }
 
-/* Read (up to) len bytes. Returns the number of bytes read. The array returned in byteref will be this many bytes long, and temporary (on autorelease). If at end of file, this returns 0 and byteref should be ignored.
+/* Read (up to) len bytes into dest. Returns the number of bytes read, which is less than len only at the end of the file.
 */
-- (glui32) readBytes:(void **)byteref len:(glui32)len {
-	if (writable) {
-		if (writebuffer && writebuffer.length - buffermark >= len) {
-			*byteref = writebuffer.mutableBytes+buffermark;
-			buffermark += len;
-			return len;
-		}
-		NSMutableData *resultdata = [NSMutableData dataWithLength:len];
-		*byteref = resultdata.mutableBytes;
-		glui32 addlen = 0;
-		if (writebuffer)
-			addlen = writebuffer.length - buffermark;
-		if (addlen) {
-			memcpy(resultdata.mutableBytes, writebuffer.mutableBytes+buffermark, addlen);
-			buffermark += addlen;
-		}
-		glui32 sofar = addlen;
-		[self flush]; // buffers are gone now.
-		if (len-sofar > maxbuffersize) {
-			NSData *data = [handle readDataOfLength:len-sofar];
-			memcpy(resultdata.mutableBytes+sofar, data.bytes, data.length);
-			sofar += data.length;
+- (glui32) readBytesInto:(void *)dest len:(glui32)len {
+	glui32 sofar = 0;
+	if (bufferlive && buffermark < bufferlen) {
+		glui32 addlen = bufferlen - buffermark;
+		if (addlen > len)
+			addlen = len;
+		memcpy(dest, buffer+buffermark, addlen);
+		buffermark += addlen;
+		sofar = addlen;
+		if (sofar == len)
 			return sofar;
-		}
-		bufferpos = [handle offsetInFile];
-		NSData *data = [handle readDataOfLength:maxbuffersize];
-		if (!data || !data.length) {
-			// Must be at the end of the file. Leave the buffer off.
-		}
-		else {
-			self.writebuffer = [NSMutableData dataWithData:data];
-			buffermark = 0;
-			buffertruepos = writebuffer.length;
-			bufferdirtystart = maxbuffersize;
-			bufferdirtyend = 0;
-		}
-		glui32 gotlen = 0;
-		if (writebuffer)
-			gotlen = writebuffer.length;
-		if (gotlen > len-sofar)
-			gotlen = len-sofar;
-		if (gotlen) {
-			// Static analyzer chokes here, because it does not understand that gotlen is only nonzero when data (and thus writebuffer) exist.
-			memcpy(resultdata.mutableBytes+sofar, data.bytes+buffermark, gotlen);
-			buffermark += gotlen;
-		}
-		sofar += gotlen;
-		return sofar;
 	}
-	else {
-		if (readbuffer && readbuffer.length - buffermark >= len) {
-			*byteref = (char *)readbuffer.bytes+buffermark;
-			buffermark += len;
-			return len;
-		}
-		NSMutableData *resultdata = [NSMutableData dataWithLength:len];
-		*byteref = resultdata.mutableBytes;
-		glui32 addlen = 0;
-		if (readbuffer)
-			addlen = readbuffer.length - buffermark;
-		if (addlen) {
-			memcpy(resultdata.mutableBytes, readbuffer.bytes+buffermark, addlen);
-			buffermark += addlen;
-		}
-		glui32 sofar = addlen;
-		[self flush]; // buffers are gone now.
-		if (len-sofar > maxbuffersize) {
-			NSData *data = [handle readDataOfLength:len-sofar];
-			memcpy(resultdata.mutableBytes+sofar, data.bytes, data.length);
-			sofar += data.length;
-			return sofar;
-		}
-		bufferpos = [handle offsetInFile];
-		NSData *data = [handle readDataOfLength:maxbuffersize];
-		if (!data || !data.length) {
-			// Must be at the end of the file. Leave the buffer off.
-		}
-		else {
-			self.readbuffer = [NSMutableData dataWithData:data];
-			buffermark = 0;
-			buffertruepos = readbuffer.length;
-			bufferdirtystart = maxbuffersize;
-			bufferdirtyend = 0;
-		}
-		glui32 gotlen = 0;
-		if (readbuffer)
-			gotlen = readbuffer.length;
-		if (gotlen > len-sofar)
-			gotlen = len-sofar;
-		if (gotlen) {
-			// Static analyzer chokes here, because it does not understand that gotlen is only nonzero when data (and thus readbuffer) exist.
-			memcpy(resultdata.mutableBytes+sofar, data.bytes+buffermark, gotlen);
-			buffermark += gotlen;
-		}
+	if (mapped)
+		return sofar; // end of file
+	
+	[self flush]; // buffer is gone now.
+	if (len-sofar > maxbuffersize) {
+		/* Too big to be worth buffering; read it straight in. */
+		[writer waitForWritesOverlapping:filepos len:len-sofar];
+		glui32 gotlen = pread_fully(fd, (char *)dest+sofar, len-sofar, filepos);
+		filepos += gotlen;
 		sofar += gotlen;
 		return sofar;
 	}
+	
+	[self loadBuffer];
+	glui32 gotlen = bufferlen;
+	if (gotlen > len-sofar)
+		gotlen = len-sofar;
+	if (gotlen) {
+		memcpy((char *)dest+sofar, buffer, gotlen);
+		buffermark += gotlen;
+	}
+	sofar += gotlen;
+	return sofar;
 }
 
 /* Write out one byte.
 */
 - (void) writeByte:(char)ch {
-	if (writable) {
-		if (!writebuffer || buffermark >= maxbuffersize) {
-			[self flush];
-			bufferpos = [handle offsetInFile];
-			NSData *data = nil;
-			if (readable)
-				data = [handle readDataOfLength:maxbuffersize];
-			if (!data || !data.length) {
-				// Must be at the end of the file, or it's a write-only file.
-				self.writebuffer = [NSMutableData dataWithCapacity:maxbuffersize];
-				buffermark = 0;
-				buffertruepos = 0;
-				bufferdirtystart = maxbuffersize;
-				bufferdirtyend = 0;
-			}
-			else {
-				self.writebuffer = [NSMutableData dataWithCapacity:maxbuffersize];
-				[writebuffer setLength:data.length];
-				memcpy(writebuffer.mutableBytes, data.bytes, data.length);
-				buffermark = 0;
-				buffertruepos = writebuffer.length;
-				bufferdirtystart = maxbuffersize;
-				bufferdirtyend = 0;
-			}
-		}
-		if (writebuffer && buffermark < maxbuffersize) {
-			if (buffermark < bufferdirtystart)
-				bufferdirtystart = buffermark;
-			if (buffermark+1 > writebuffer.length)
-				[writebuffer setLength:buffermark+1];
-			((char *)writebuffer.mutableBytes)[buffermark++] = ch;
-			if (buffermark > bufferdirtyend)
-				bufferdirtyend = buffermark;
-		}
+	if (!writable)
+		return;
+	
+	if (!bufferlive || buffermark >= maxbuffersize) {
+		[self flush];
+		[self loadBuffer];
 	}
+	if (buffermark < bufferdirtystart)
+		bufferdirtystart = buffermark;
+	buffer[buffermark++] = ch;
+	if (buffermark > bufferlen)
+		bufferlen = buffermark;
+	if (buffermark > bufferdirtyend)
+		bufferdirtyend = buffermark;
 }
 
 /* Write out len bytes.
 */
 - (void) writeBytes:(void *)bytes len:(glui32)len {
-	if (writable) {
-		if (writebuffer && buffermark < maxbuffersize) {
-			glui32 addlen = maxbuffersize - buffermark;
-			if (addlen > len)
-				addlen = len;
-			if (buffermark < bufferdirtystart)
-				bufferdirtystart = buffermark;
-			if (buffermark+addlen > writebuffer.length)
-				[writebuffer setLength:buffermark+addlen];
-			memcpy(writebuffer.mutableBytes+buffermark, bytes, addlen);
-			buffermark += addlen;
-			if (buffermark > bufferdirtyend)
-				bufferdirtyend = buffermark;
-			bytes += addlen;
-			len -= addlen;
-			if (!len)
-				return;
-		}
-		[self flush];
-		if (len >= maxbuffersize) {
-			NSData *data = [NSData dataWithBytesNoCopy:bytes length:len freeWhenDone:NO];
-			[handle writeData:data];
+	if (!writable)
+		return;
+	
+	if (bufferlive && buffermark < maxbuffersize) {
+		glui32 addlen = maxbuffersize - buffermark;
+		if (addlen > len)
+			addlen = len;
+		if (buffermark < bufferdirtystart)
+			bufferdirtystart = buffermark;
+		memcpy(buffer+buffermark, bytes, addlen);
+		buffermark += addlen;
+		if (buffermark > bufferlen)
+			bufferlen = buffermark;
+		if (buffermark > bufferdirtyend)
+			bufferdirtyend = buffermark;
+		bytes += addlen;
+		len -= addlen;
+		if (!len)
 			return;
+	}
+	
+	[self flush];
+	if (len >= maxbuffersize) {
+		/* Too big to be worth buffering; write it straight out. (Even in write-behind mode. But it mustn't cross an unfinished write.) */
+		[writer waitForWritesOverlapping:filepos len:len];
+		glui32 donelen = pwrite_fully(fd, bytes, len, filepos);
+		if (donelen < len)
+			NSLog(@"GlkStreamFile: unable to write %@", pathname);
+		filepos += donelen;
+		return;
+	}
+	
+	[self loadBuffer];
+	/* Yeah, buffermark will always be zero at this point. I still write the code based on it, for clarity. */
+	if (buffermark < bufferdirtystart)
+		bufferdirtystart = buffermark;
+	memcpy(buffer+buffermark, bytes, len);
+	buffermark += len;
+	if (buffermark > bufferlen)
+		bufferlen = buffermark;
+	if (buffermark > bufferdirtyend)
+		bufferdirtyend = buffermark;
+}
+
+/* Write len characters as big-endian words, packing them straight into the buffer. The source is an array of glui32 if wide is set, or of Latin-1 bytes if not.
+*/
+- (void) writeWords:(void *)src len:(glui32)len wide:(BOOL)wide {
+	if (!writable)
+		return;
+	
+	while (len) {
+		if (bufferlive && buffermark < maxbuffersize && buffermark+4 > maxbuffersize) {
+			/* A word straddles the end of the buffer. Let writeBytes split it. */
+			unsigned char word[4];
+			if (wide)
+				GlkPackBigEndian32(word, src, 1);
+			else
+				GlkPackBigEndian32FromBytes(word, src, 1);
+			[self writeBytes:word len:4];
+			src += (wide ? sizeof(glui32) : 1);
+			len--;
+			continue;
 		}
-		bufferpos = [handle offsetInFile];
-		NSData *data = nil;
-		if (readable)
-			data = [handle readDataOfLength:maxbuffersize];
-		if (!data || !data.length) {
-			// Must be at the end of the file, or it's a write-only file.
-			self.writebuffer = [NSMutableData dataWithCapacity:maxbuffersize];
-			buffermark = 0;
-			buffertruepos = 0;
-			bufferdirtystart = maxbuffersize;
-			bufferdirtyend = 0;
+		if (!bufferlive || buffermark >= maxbuffersize) {
+			[self flush];
+			[self loadBuffer];
 		}
-		else {
-			self.writebuffer = [NSMutableData dataWithCapacity:maxbuffersize];
-			[writebuffer setLength:data.length];
-			memcpy(writebuffer.mutableBytes, data.bytes, data.length);
-			buffermark = 0;
-			buffertruepos = writebuffer.length;
-			bufferdirtystart = maxbuffersize;
-			bufferdirtyend = 0;
-		}
-		/* Yeah, buffermark will always be zero at this point. I still write the code based on it, for clarity. */
-		if (writebuffer && len <= maxbuffersize - buffermark) {
+		
+		glui32 count = (maxbuffersize - buffermark) / 4;
+		if (count > len)
+			count = len;
+		if (buffermark < bufferdirtystart)
+			bufferdirtystart = buffermark;
+		if (wide)
+			GlkPackBigEndian32((unsigned char *)buffer+buffermark, src, count);
+		else
+			GlkPackBigEndian32FromBytes((unsigned char *)buffer+buffermark, src, count);
+		buffermark += 4*count;
+		if (buffermark > bufferlen)
+			bufferlen = buffermark;
+		if (buffermark > bufferdirtyend)
+			bufferdirtyend = buffermark;
+		src += (wide ? count*sizeof(glui32) : count);
+		len -= count;
+	}
+}
+
+/* Read (up to) len big-endian words into dest, unpacking them straight out of the buffer. Returns the number of words read, which is less than len only at the end of the file.
+*/
+- (glui32) readWords:(glui32 *)dest len:(glui32)len {
+	glui32 got = 0;
+	while (got < len) {
+		if (bufferlive && buffermark+4 <= bufferlen) {
+			glui32 count = (bufferlen - buffermark) / 4;
+			if (count > len-got)
+				count = len-got;
+			GlkUnpackBigEndian32(dest+got, (unsigned char *)buffer+buffermark, count);
+			buffermark += 4*count;
+			got += count;
+			continue;
+		}
+		if (!mapped && !(bufferlive && buffermark < bufferlen) && 4*(len-got) > maxbuffersize) {
+			/* Too big to be worth buffering; read it straight in, and convert it in place. */
+			[self flush];
+			[writer waitForWritesOverlapping:filepos len:4*(len-got)];
+			glui32 readlen = pread_fully(fd, dest+got, 4*(len-got), filepos);
+			filepos += readlen;
+			GlkUnpackBigEndian32(dest+got, (unsigned char *)(dest+got), readlen/4);
+			got += readlen/4;
+			break;
+		}
+		/* A word straddles the end of the buffer, or the buffer needs loading. Let readBytesInto sort it out. */
+		unsigned char word[4];
+		if ([self readBytesInto:word len:4] < 4)
+			break;
+		GlkUnpackBigEndian32(dest+got, word, 1);
+		got++;
+	}
+	return got;
+}
+
+/* Write len characters as UTF-8, encoding them straight into the buffer. The source is an array of glui32 if wide is set, or of Latin-1 bytes if not.
+*/
+- (void) writeUTF8:(void *)src len:(glui32)len wide:(BOOL)wide {
+	if (!writable)
+		return;
+	
+	while (len) {
+		/* Make sure there's room for the longest sequence, so that a character is never split. */
+		if (!bufferlive || buffermark+4 > maxbuffersize) {
+			[self flush];
+			[self loadBuffer];
+		}
+		
+		size_t consumed;
+		size_t outlen = GlkUTF8Encode((unsigned char *)buffer+buffermark, maxbuffersize-buffermark, src, len, wide, &consumed);
+		if (outlen) {
 			if (buffermark < bufferdirtystart)
 				bufferdirtystart = buffermark;
-			if (buffermark+len > writebuffer.length)
-				[writebuffer setLength:buffermark+len];
-			memcpy(writebuffer.mutableBytes+buffermark, bytes, len);
-			buffermark += len;
+			buffermark += outlen;
+			if (buffermark > bufferlen)
+				bufferlen = buffermark;
 			if (buffermark > bufferdirtyend)
 				bufferdirtyend = buffermark;
 		}
+		src += (wide ? consumed*sizeof(glui32) : consumed);
+		len -= consumed;
 	}
 }
 
+/* Read (up to) len characters of UTF-8 into dest (glui32s if wide is set, Latin-1 bytes if not), decoding them straight out of the buffer. If line is set, stop after a newline. Returns the number of characters read, and counts them in readcount.
+ 
+	A character which is split across the end of the buffer (or an empty buffer, or a bad byte) goes through getChar, which reads a byte at a time and refills as it goes.
+*/
+- (glui32) readUTF8:(void *)dest len:(glui32)len wide:(BOOL)wide line:(BOOL)stopatnewline {
+	glui32 got = 0;
+	while (got < len) {
+		if (bufferlive && buffermark < bufferlen) {
+			size_t consumed;
+			int gotnewline;
+			void *destpos = (wide ? (void *)((glui32 *)dest+got) : (void *)((char *)dest+got));
+			size_t count = GlkUTF8Decode(destpos, len-got, (unsigned char *)buffer+buffermark, bufferlen-buffermark, wide, stopatnewline, &consumed, &gotnewline);
+			buffermark += consumed;
+			got += count;
+			readcount += count;
+			if (gotnewline)
+				break;
+			if (count)
+				continue;
+		}
+		
+		glsi32 ch = [self getChar:wide];
+		if (ch < 0)
+			break;
+		if (wide)
+			((glui32 *)dest)[got++] = ch;
+		else
+			((char *)dest)[got++] = ch;
+		if (stopatnewline && ch == '\n')
+			break;
+	}
+	return got;
+}
 
-/* Flush and clear the internal buffer. */
+
+/* Write back the dirty part of the buffer, and take the buffer out of use. (The memory is kept for the next load.) Afterwards, filepos is the mark. */
 - (void) flush {
-	if (!(readbuffer || writebuffer))
+	if (mapped) {
+		/* The mapping stays live. Just keep filepos up to date. */
+		filepos = buffermark;
+		return;
+	}
+	if (!bufferlive)
 		return;
 		
-	if (writable && writebuffer && bufferdirtystart < bufferdirtyend) {
+	if (writable && bufferdirtystart < bufferdirtyend) {
 		/* Write out the dirty part of the buffer. */
-		[handle seekToFileOffset:bufferpos+bufferdirtystart];
 		glui32 len = bufferdirtyend - bufferdirtystart;
-		void *bytes = ((char *)writebuffer.bytes) + bufferdirtystart;
-		NSData *data = [NSData dataWithBytesNoCopy:bytes length:len freeWhenDone:NO];
-		[handle writeData:data];
-		/* Adjust buffertruepos, which we will need in a moment to be correct. */
-		buffertruepos = bufferdirtyend;
-	}
-	if (buffermark != buffertruepos) {
-		/* Seek the filehandle pos to where the buffer thinks it ought to be. (We need this to be correct, because we might be doing a relative seek next.) */
-		[handle seekToFileOffset:bufferpos+buffermark];
-	}
-	self.writebuffer = nil;
-	self.readbuffer = nil;
+		flushcount++;
+		if (writebehind) {
+			/* Or rather, hand the whole buffer to the writer thread, and carry on with the one it finished writing last time (or a fresh one, the first time). We only wait if the previous write is still going. */
+			if (!writer)
+				writer = [[GlkStreamFileWriter alloc] initWithFD:fd pathname:pathname];
+			buffer = [writer writeBuffer:buffer from:bufferdirtystart len:len offset:bufferpos];
+		}
+		else if (pwrite_fully(fd, buffer+bufferdirtystart, len, bufferpos+bufferdirtystart) < len) {
+			NSLog(@"GlkStreamFile: unable to write %@", pathname);
+		}
+	}
+	filepos = bufferpos+buffermark;
+	bufferlive = NO;
 	bufferpos = 0;
+	bufferlen = 0;
 	buffermark = 0;
-	buffertruepos = 0;
 	bufferdirtystart = maxbuffersize;
 	bufferdirtyend = 0;
 }
@@ -1317,21 +1569,12 @@
 		}
 		else {
 			/* cheap big-endian stream */
-			char *ubuf = malloc(4*len);
-			bzero(ubuf, 4*len);
-			for (int ix=0; ix<len; ix++)
-				ubuf[4*ix+3] = buf[ix];
-			[self writeBytes:ubuf len:4*len];
-			free(ubuf);
+			[self writeWords:buf len:len wide:NO];
 		}
 	}
 	else {
 		/* UTF8 stream (whether the unicode flag is set or not) */
-		/* Turn the buffer into an NSString. We'll release this at the end of the function. */
-		NSString *str = [[NSString alloc] initWithBytes:buf length:len encoding:NSISOLatin1StringEncoding];
-		NSData *data = [str dataUsingEncoding:NSUTF8StringEncoding];
-		[self writeBytes:(void *)data.bytes len:data.length];
-		[str release];
+		[self writeUTF8:buf len:len wide:NO];
 	}
 }
 
@@ -1342,37 +1585,27 @@
 
 	if (!textmode) {
 		if (!unicode) {
-			/* byte stream */
-			char *ubuf = malloc(len);
-			for (int ix=0; ix<len; ix++) {
-				glui32 ch = buf[ix];
-				ubuf[ix] = (ch < 0x100) ? ch : '?';
+			/* byte stream, converted a chunk at a time */
+			char ubuf[FILE_CHUNK_LEN];
+			while (len) {
+				glui32 chunklen = (len < FILE_CHUNK_LEN) ? len : FILE_CHUNK_LEN;
+				for (int ix=0; ix<chunklen; ix++) {
+					glui32 ch = buf[ix];
+					ubuf[ix] = (ch < 0x100) ? ch : '?';
+				}
+				[self writeBytes:ubuf len:chunklen];
+				buf += chunklen;
+				len -= chunklen;
 			}
-			[self writeBytes:ubuf len:len];
-			free(ubuf);
 		}
 		else {
 			/* cheap big-endian stream */
-			char *ubuf = malloc(4*len);
-			for (int ix=0; ix<len; ix++) {
-				glui32 ch = buf[ix];
-				ubuf[4*ix+0] = (ch >> 24) & 0xFF;
-				ubuf[4*ix+1] = (ch >> 16) & 0xFF;
-				ubuf[4*ix+2] = (ch >> 8) & 0xFF;
-				ubuf[4*ix+3] = ch & 0xFF;
-			}
-			[self writeBytes:ubuf len:4*len];
-			free(ubuf);
+			[self writeWords:buf len:len wide:YES];
 		}
 	}
 	else {
 		/* UTF8 stream (whether the unicode flag is set or not) */
-		/* Turn the buffer into an NSString. We'll release this at the end of the function. 
-			This is an endianness dependency; we're telling NSString that our array of 32-bit words in stored little-endian. (True for all iOS, as I write this.) */
-		NSString *str = [[NSString alloc] initWithBytes:buf length:len*sizeof(glui32) encoding:NSUTF32LittleEndianStringEncoding];
-		NSData *data = [str dataUsingEncoding:NSUTF8StringEncoding];
-		[self writeBytes:(void *)data.bytes len:data.length];
-		[str release];
+		[self writeUTF8:buf len:len wide:YES];
 	}
 }
 
@@ -1391,13 +1624,10 @@
 		}
 		else {
 			/* cheap big-endian stream */
-			void *bytes;
-			glui32 readlen = [self readBytes:&bytes len:4];
-			if (readlen < 4)
+			glui32 ch;
+			if ([self readWords:&ch len:1] < 1)
 				return -1;
 			readcount++;
-			char *buf = (char *)bytes;
-			glui32 ch = ((buf[0] & 0xFF) << 24) | ((buf[1] & 0xFF) << 16) | ((buf[2] & 0xFF) << 8) | ((buf[3] & 0xFF));
 			if (!wantunicode && ch >= 0x100)
 				return '?';
 			return ch;
@@ -1405,7 +1635,7 @@
 	}
 	else {
 		/* UTF8 stream (whether the unicode flag is set or not) */
-		/* We have to do our own UTF8 decoding here. There's no NSFileHandle method to read a variable-length UTF8 character. I'm very sorry. */
+		/* Decode one character a byte at a time. This copes with a character split across a buffer refill, which is why readUTF8 falls back on it. (It accepts the same sequences as GlkUTF8Decode.) */
 		int ch = [self readByte];
 		if (ch < 0)
 			return -1;
@@ -1478,83 +1708,121 @@
 	
 	getlen -= 1; /* for the terminal null */
 	
-	BOOL gotnewline = NO;
-		
 	if (!textmode) {
 		if (!unicode) {
 			/* byte stream */
-			int ix;
-			for (ix=0; !gotnewline && ix<getlen; ix++) {
-				int ch = [self readByte];
-				if (ch < 0)
+			/* Scan what's in the buffer for a newline, copy the run up to it, and only go back to the file when the buffer runs dry. (A mapped stream never runs dry until EOF.) */
+			glui32 got = 0;
+			while (got < getlen) {
+				if (!bufferlive || buffermark >= bufferlen) {
+					if (mapped)
+						break;
+					[self flush];
+					[self loadBuffer];
+					if (bufferlen == 0)
+						break;
+				}
+				glui32 linelen = bufferlen - buffermark;
+				if (linelen > getlen - got)
+					linelen = getlen - got;
+				unsigned char *start = (unsigned char *)buffer+buffermark;
+				unsigned char *nl = memchr(start, '\n', linelen);
+				if (nl)
+					linelen = (nl - start) + 1;
+				if (!wantunicode) {
+					memcpy((char *)getbuf+got, start, linelen);
+				}
+				else {
+					glui32 *ugetbuf = (glui32 *)getbuf + got;
+					for (int ix=0; ix<linelen; ix++)
+						ugetbuf[ix] = start[ix];
+				}
+				buffermark += linelen;
+				got += linelen;
+				if (nl)
 					break;
-				readcount++;
-				if (!wantunicode)
-					((char *)getbuf)[ix] = ch;
-				else
-					((glui32 *)getbuf)[ix] = ch;
-				if (ch == '\n')
-					gotnewline = YES;
 			}
 			if (!wantunicode)
-				((char *)getbuf)[ix] = '\0';
+				((char *)getbuf)[got] = '\0';
 			else
-				((glui32 *)getbuf)[ix] = '\0';
-			return ix;
+				((glui32 *)getbuf)[got] = '\0';
+			readcount += got;
+			return got;
 		}
 		else {
 			/* cheap big-endian stream */
-			int ix;
-			for (ix=0; !gotnewline && ix<getlen; ix++) {
-				void *bytes;
-				glui32 readlen = [self readBytes:&bytes len:4];
-				if (readlen < 4)
+			/* The same idea, searching the buffer for the newline as it's encoded in the file. A word that straddles the end of the buffer (or an empty buffer) goes through readWords one word at a time, which refills it. */
+			glui32 newline = '\n';
+			glui32 pattern;
+			GlkPackBigEndian32((unsigned char *)&pattern, &newline, 1);
+			glui32 ubuf[FILE_CHUNK_LEN];
+			glui32 got = 0;
+			BOOL gotnewline = NO;
+			while (!gotnewline && got < getlen) {
+				glui32 count = 0;
+				BOOL slowword = NO;
+				if (bufferlive && buffermark+4 <= bufferlen)
+					count = (bufferlen - buffermark) / 4;
+				if (count > getlen - got)
+					count = getlen - got;
+				if (count) {
+					glui32 pos = GlkFindWord32(buffer+buffermark, count, pattern);
+					if (pos < count) {
+						count = pos+1;
+						gotnewline = YES;
+					}
+				}
+				else {
+					count = 1;
+					slowword = YES;
+				}
+				
+				glui32 readlen;
+				if (wantunicode) {
+					readlen = [self readWords:(glui32 *)getbuf+got len:count];
+				}
+				else {
+					char *cgetbuf = (char *)getbuf + got;
+					readlen = 0;
+					while (readlen < count) {
+						glui32 chunklen = count - readlen;
+						if (chunklen > FILE_CHUNK_LEN)
+							chunklen = FILE_CHUNK_LEN;
+						glui32 chunkgot = [self readWords:ubuf len:chunklen];
+						for (int ix=0; ix<chunkgot; ix++) {
+							glui32 ch = ubuf[ix];
+							cgetbuf[readlen+ix] = (ch >= 0x100) ? '?' : ch;
+						}
+						readlen += chunkgot;
+						if (chunkgot < chunklen)
+							break;
+					}
+				}
+				if (slowword && readlen == 1) {
+					/* We didn't get to search this one. */
+					glui32 ch = wantunicode ? ((glui32 *)getbuf)[got] : (unsigned char)((char *)getbuf)[got];
+					if (ch == '\n')
+						gotnewline = YES;
+				}
+				got += readlen;
+				if (readlen < count)
 					break;
-				readcount++;
-				char *buf = (char *)bytes;
-				glui32 ch = ((buf[0] & 0xFF) << 24) | ((buf[1] & 0xFF) << 16) | ((buf[2] & 0xFF) << 8) | ((buf[3] & 0xFF));
-				if (!wantunicode)
-					((char *)getbuf)[ix] = (ch >= 0x100) ? '?' : ch;
-				else
-					((glui32 *)getbuf)[ix] = ch;
-				if (ch == '\n')
-					gotnewline = YES;
 			}
 			if (!wantunicode)
-				((char *)getbuf)[ix] = '\0';
+				((char *)getbuf)[got] = '\0';
 			else
-				((glui32 *)getbuf)[ix] = '\0';
-			return ix;
+				((glui32 *)getbuf)[got] = '\0';
+			readcount += got;
+			return got;
 		}		
 	}
 	else {
 		/* UTF8 stream (whether the unicode flag is set or not) */
-		/* Here we shamelessly rely on getChar to do our UTF-8 decoding. */
-		glui32 count = 0;
-		if (wantunicode) {
-			glui32 *ugetbuf = getbuf;
-			while (count < getlen) {
-				glsi32 ch = [self getChar:YES];
-				if (ch < 0)
-					break;
-				ugetbuf[count++] = ch;
-				if (ch == '\n')
-					break;
-			}
-			ugetbuf[count] = '\0';
-		}
-		else {
-			char *cgetbuf = getbuf;
-			while (count < getlen) {
-				glsi32 ch = [self getChar:NO];
-				if (ch < 0)
-					break;
-				cgetbuf[count++] = ch;
-				if (ch == '\n')
-					break;
-			}
-			cgetbuf[count] = '\0';
-		}
+		glui32 count = [self readUTF8:getbuf len:getlen wide:wantunicode line:YES];
+		if (wantunicode)
+			((glui32 *)getbuf)[count] = '\0';
+		else
+			((char *)getbuf)[count] = '\0';
 		return count;
 	}
 }
@@ -1566,75 +1834,55 @@
 	if (!textmode) {
 		if (!unicode) {
 			/* byte stream */
-			void *bytes;
-			glui32 readlen = [self readBytes:&bytes len:getlen];
-			if (!readlen)
-				return 0;
-			glui32 gotlen = readlen;
-			readcount += gotlen;
-			char *buf = (char *)bytes;
-			if (wantunicode) {
-				glui32 *ugetbuf = getbuf;
-				for (int ix=0; ix<gotlen; ix++) {
-					ugetbuf[ix] = (buf[ix] & 0xFF);
-				}
+			if (!wantunicode) {
+				glui32 gotlen = [self readBytesInto:getbuf len:getlen];
+				readcount += gotlen;
+				return gotlen;
 			}
-			else {
-				memcpy(getbuf, buf, gotlen);
+			/* Read the bytes into the top quarter of the caller's buffer, and then widen them in place. Each glui32 is written at or below the byte it comes from, so the bytes are read before they're overwritten. */
+			glui32 *ugetbuf = getbuf;
+			unsigned char *buf = (unsigned char *)getbuf + 3*getlen;
+			glui32 gotlen = [self readBytesInto:buf len:getlen];
+			readcount += gotlen;
+			for (int ix=0; ix<gotlen; ix++) {
+				ugetbuf[ix] = buf[ix];
 			}
 			return gotlen;
 		}
 		else {
 			/* cheap big-endian stream */
-			void *bytes;
-			glui32 readlen = [self readBytes:&bytes len:4*getlen];
-			if (!readlen)
-				return 0;
-			glui32 gotlen = readlen / 4;
-			readcount += gotlen;
-			char *buf = (char *)bytes;
 			if (wantunicode) {
-				glui32 *ugetbuf = getbuf;
-				for (int ix=0; ix<gotlen; ix++) {
-					ugetbuf[ix] = ((buf[4*ix+0] & 0xFF) << 24) | ((buf[4*ix+1] & 0xFF) << 16) | ((buf[4*ix+2] & 0xFF) << 8) | ((buf[4*ix+3] & 0xFF));
-				}
+				glui32 gotlen = [self readWords:getbuf len:getlen];
+				readcount += gotlen;
+				return gotlen;
 			}
-			else {
-				char *cgetbuf = getbuf;
-				for (int ix=0; ix<gotlen; ix++) {
-					glui32 ch = ((buf[4*ix+0] & 0xFF) << 24) | ((buf[4*ix+1] & 0xFF) << 16) | ((buf[4*ix+2] & 0xFF) << 8) | ((buf[4*ix+3] & 0xFF));
+			/* Narrowing to Latin-1, so go through a stack buffer a chunk at a time. */
+			char *cgetbuf = getbuf;
+			glui32 ubuf[FILE_CHUNK_LEN];
+			glui32 gotlen = 0;
+			while (gotlen < getlen) {
+				glui32 chunklen = getlen - gotlen;
+				if (chunklen > FILE_CHUNK_LEN)
+					chunklen = FILE_CHUNK_LEN;
+				glui32 readlen = [self readWords:ubuf len:chunklen];
+				for (int ix=0; ix<readlen; ix++) {
+					glui32 ch = ubuf[ix];
 					if (ch >= 0x100)
-						cgetbuf[ix] = '?';
+						cgetbuf[gotlen+ix] = '?';
 					else
-						cgetbuf[ix] = ch;
+						cgetbuf[gotlen+ix] = ch;
 				}
+				gotlen += readlen;
+				if (readlen < chunklen)
+					break;
 			}
+			readcount += gotlen;
 			return gotlen;
 		}		
 	}
 	else {
 		/* UTF8 stream (whether the unicode flag is set or not) */
-		/* Here we shamelessly rely on getChar to do our UTF-8 decoding. */
-		glui32 count = 0;
-		if (wantunicode) {
-			glui32 *ugetbuf = getbuf;
-			while (count < getlen) {
-				glsi32 ch = [self getChar:YES];
-				if (ch < 0)
-					break;
-				ugetbuf[count++] = ch;
-			}
-		}
-		else {
-			char *cgetbuf = getbuf;
-			while (count < getlen) {
-				glsi32 ch = [self getChar:NO];
-				if (ch < 0)
-					break;
-				cgetbuf[count++] = ch;
-			}
-		}
-		return count;
+		return [self readUTF8:getbuf len:getlen wide:wantunicode line:NO];
 	}
 }
 
@@ -1644,32 +1892,60 @@
 		pos *= 4;
 	}
 	
-	/* We don't try to handle seeks efficiently within the buffered data. We just flush and seek on the underlying handle. */
-	[self flush];
-	
+	/* Work out the new mark. The current mark and the end of the file both have to take the live buffer into account, since it may hold data that hasn't been written out. */
+	long long newpos = pos;
 	switch (seekmode) {
 		case seekmode_Start:
-			[handle seekToFileOffset:pos];
 			break;
 		case seekmode_Current:
-			pos += [handle offsetInFile];
-			[handle seekToFileOffset:pos];
+			if (bufferlive)
+				newpos += bufferpos+buffermark;
+			else
+				newpos += filepos;
 			break;
-		case seekmode_End:
-			[handle seekToEndOfFile];
-			pos += [handle offsetInFile];
-			[handle seekToFileOffset:pos];
+		case seekmode_End: {
+			/* The file isn't its full length until the writer thread catches up. */
+			[writer waitForWrites];
+			unsigned long long fileend = 0;
+			struct stat st;
+			if (fstat(fd, &st) == 0)
+				fileend = st.st_size;
+			if (bufferlive && bufferpos+bufferlen > fileend)
+				fileend = bufferpos+bufferlen;
+			newpos += fileend;
+			}
 			break;
 	}
+	if (newpos < 0)
+		newpos = 0;
+	
+	if (mapped) {
+		/* The mark is just an offset into the mapping. It may sit past the end (as a file mark can); reads there return EOF. */
+		filepos = newpos;
+		if (newpos > INT_MAX)
+			newpos = INT_MAX;
+		buffermark = newpos;
+		return;
+	}
+	
+	if (bufferlive && newpos >= bufferpos && newpos <= bufferpos+bufferlen) {
+		/* The new mark is within the buffered data (or just at its end), so we can just move buffermark. The dirty range stays as it is. */
+		buffermark = newpos - bufferpos;
+		return;
+	}
+	
+	/* Otherwise, flush and move the mark. The buffer will be reloaded from there when it's next needed. */
+	[self flush];
+	filepos = newpos;
 }
 
 - (glui32) getPosition {
 	unsigned long long pos;
-	if (readbuffer || writebuffer) {
+	if (bufferlive) {
 		pos = bufferpos+buffermark;
 	}
 	else {
-		pos = [handle offsetInFile];
+		pos = filepos;
 	}
 	
 	if (!textmode && unicode) {
@@ -1682,3 +1958,108 @@
 
 @end
 
+
+/* The background half of a write-behind GlkStreamFile. It runs one thread, which writes one buffer at a time; the stream hands over a full buffer and gets back the one written before it, so there are never more than two. The VM thread only waits when it fills a buffer before the previous write is done, or when it wants to read (or overwrite directly) a part of the file that's still in flight.
+*/
+@implementation GlkStreamFileWriter
+
+- (id) initWithFD:(int)fdval pathname:(NSString *)path {
+	self = [super init];
+	
+	if (self) {
+		fd = fdval;
+		pathname = [path retain];
+		cond = [[NSCondition alloc] init];
+		pending = NO;
+		stopping = NO;
+		jobbuf = NULL;
+		jobstart = 0;
+		joblen = 0;
+		joboffset = 0;
+		
+		/* The thread retains us until it exits. */
+		[NSThread detachNewThreadSelector:@selector(writerThreadMain:) toTarget:self withObject:nil];
+	}
+	
+	return self;
+}
+
+- (void) dealloc {
+	if (jobbuf) {
+		free(jobbuf);
+		jobbuf = NULL;
+	}
+	[cond release];
+	cond = nil;
+	[pathname release];
+	pathname = nil;
+	[super dealloc];
+}
+
+- (void) writerThreadMain:(id)rock {
+	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+	
+	[cond lock];
+	while (YES) {
+		while (!pending && !stopping)
+			[cond wait];
+		if (!pending)
+			break;
+		
+		/* The stream won't touch jobbuf or the job fields while pending is set, so we can let go of the lock. */
+		[cond unlock];
+		if (pwrite_fully(fd, jobbuf+jobstart, joblen, joboffset+jobstart) < (size_t)joblen)
+			NSLog(@"GlkStreamFile: unable to write %@", pathname);
+		[cond lock];
+		
+		pending = NO;
+		[cond broadcast];
+	}
+	[cond unlock];
+	
+	[pool drain];
+}
+
+/* Start writing len bytes of buf, from start, to the file. (buf[0] belongs at offset.) We take ownership of buf. Returns the buffer from the previous write, waiting for that to finish if necessary; or NULL if there wasn't one. */
+- (char *) writeBuffer:(char *)buf from:(int)start len:(int)len offset:(unsigned long long)offset {
+	[cond lock];
+	while (pending)
+		[cond wait];
+	char *spare = jobbuf;
+	jobbuf = buf;
+	jobstart = start;
+	joblen = len;
+	joboffset = offset;
+	pending = YES;
+	[cond broadcast];
+	[cond unlock];
+	return spare;
+}
+
+/* Wait until everything handed over has been written. */
+- (void) waitForWrites {
+	[cond lock];
+	while (pending)
+		[cond wait];
+	[cond unlock];
+}
+
+/* Wait until no write in flight touches the given range of the file. */
+- (void) waitForWritesOverlapping:(unsigned long long)offset len:(unsigned long long)len {
+	[cond lock];
+	while (pending && offset < joboffset+jobstart+joblen && joboffset+jobstart < offset+len)
+		[cond wait];
+	[cond unlock];
+}
+
+/* Finish the last write and end the thread. Nothing more may be handed over. */
+- (void) stop {
+	[cond lock];
+	while (pending)
+		[cond wait];
+	stopping = YES;
+	[cond broadcast];
+	[cond unlock];
+}
+
+@end
@@ -0,0 +1,34 @@
+/* GlkTagTable.h: Object tags, and a hash table from tags to Glk objects
+	for IosGlk, the iOS implementation of the Glk API.
+	Designed by Andrew Plotkin <erkyrath@eblong.com>
+	http://eblong.com/zarf/glk/
+*/
+
+#import <Foundation/Foundation.h>
+
+/* Every Glk object (window, stream, fileref) has a tag, which identifies it across threads and across serialization. Tags are positive integers, handed out by [GlkLibrary generateTag]; zero means "no object". */
+typedef NSInteger GlkTag;
+
+/* Tags are archived as NSNumber objects (a zero tag is not archived at all), so that older saved states remain readable. */
+extern void GlkTagEncode(NSCoder *encoder, GlkTag tag, NSString *key);
+extern GlkTag GlkTagDecode(NSCoder *decoder, NSString *key);
+
+/* An open-addressed table mapping integer tags to objects. Objects are not retained; the owner's array does that. Tag zero is reserved (it marks an empty slot), which is fine, because generateTag never returns it. */
+typedef struct GlkTagTable_struct {
+	GlkTag *keys;
+	void **vals;
+	NSUInteger size; /* always a power of two, or zero before the first insert */
+	NSUInteger count;
+} GlkTagTable;
+
+extern void GlkTagTableInit(GlkTagTable *table);
+extern void GlkTagTableFree(GlkTagTable *table);
+extern void *GlkTagTableGet(GlkTagTable *table, GlkTag tag);
+extern void GlkTagTableSet(GlkTagTable *table, GlkTag tag, void *obj);
+extern void GlkTagTableRemove(GlkTagTable *table, GlkTag tag);
+
+/* A table can also be keyed by object pointer, so that a reference passed in by the game can be checked without sending it a message (it might have been freed). This turns a pointer into a key. It's one-to-one, so no two objects share a key, and it's nonzero for any non-NULL pointer. It also folds the high bits into the low ones, because aligned pointers would otherwise crowd into a few slots. */
+static inline GlkTag GlkPointerKey(void *ptr) {
+	uintptr_t val = (uintptr_t)ptr;
+	return (GlkTag)(val ^ (val >> 9));
+}
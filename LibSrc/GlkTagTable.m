@@ -0,0 +1,141 @@
+/* GlkTagTable.m: Object tags, and a hash table from tags to Glk objects
+	for IosGlk, the iOS implementation of the Glk API.
+	Designed by Andrew Plotkin <erkyrath@eblong.com>
+	http://eblong.com/zarf/glk/
+*/
+
+/*	GlkLibrary keeps one of these for each of its object lists (windows, streams, filerefs), so that looking up an object by tag doesn't mean walking the list. Linear probing; the table doubles when it gets three-quarters full, and deletion shifts later entries back rather than leaving tombstones. This is plain C so that it costs nothing but the probe.
+*/
+
+#import "GlkTagTable.h"
+
+#define INITIAL_SIZE (16)
+
+void GlkTagEncode(NSCoder *encoder, GlkTag tag, NSString *key) {
+	if (tag)
+		[encoder encodeObject:[NSNumber numberWithInteger:tag] forKey:key];
+}
+
+GlkTag GlkTagDecode(NSCoder *decoder, NSString *key) {
+	NSNumber *num = [decoder decodeObjectForKey:key];
+	if (!num)
+		return 0;
+	return num.integerValue;
+}
+
+/* Tags are handed out sequentially, so a multiplicative hash spreads them nicely. */
+static inline NSUInteger tag_hash(GlkTag tag, NSUInteger mask) {
+	return ((NSUInteger)tag * 2654435761U) & mask;
+}
+
+void GlkTagTableInit(GlkTagTable *table) {
+	table->keys = NULL;
+	table->vals = NULL;
+	table->size = 0;
+	table->count = 0;
+}
+
+void GlkTagTableFree(GlkTagTable *table) {
+	if (table->keys) {
+		free(table->keys);
+		table->keys = NULL;
+	}
+	if (table->vals) {
+		free(table->vals);
+		table->vals = NULL;
+	}
+	table->size = 0;
+	table->count = 0;
+}
+
+static void resize_table(GlkTagTable *table, NSUInteger newsize) {
+	GlkTag *oldkeys = table->keys;
+	void **oldvals = table->vals;
+	NSUInteger oldsize = table->size;
+	
+	table->keys = (GlkTag *)calloc(newsize, sizeof(GlkTag));
+	table->vals = (void **)calloc(newsize, sizeof(void *));
+	table->size = newsize;
+	
+	NSUInteger mask = newsize-1;
+	for (NSUInteger ix=0; ix<oldsize; ix++) {
+		if (!oldkeys[ix])
+			continue;
+		NSUInteger pos = tag_hash(oldkeys[ix], mask);
+		while (table->keys[pos])
+			pos = (pos+1) & mask;
+		table->keys[pos] = oldkeys[ix];
+		table->vals[pos] = oldvals[ix];
+	}
+	
+	if (oldkeys)
+		free(oldkeys);
+	if (oldvals)
+		free(oldvals);
+}
+
+/* Returns NULL if the tag is not present. */
+void *GlkTagTableGet(GlkTagTable *table, GlkTag tag) {
+	if (!tag || !table->count)
+		return NULL;
+	
+	NSUInteger mask = table->size-1;
+	NSUInteger pos = tag_hash(tag, mask);
+	while (table->keys[pos]) {
+		if (table->keys[pos] == tag)
+			return table->vals[pos];
+		pos = (pos+1) & mask;
+	}
+	return NULL;
+}
+
+/* Add or replace an entry. */
+void GlkTagTableSet(GlkTagTable *table, GlkTag tag, void *obj) {
+	if (!tag)
+		return;
+	
+	if ((table->count+1) * 4 > table->size * 3)
+		resize_table(table, (table->size ? table->size*2 : INITIAL_SIZE));
+	
+	NSUInteger mask = table->size-1;
+	NSUInteger pos = tag_hash(tag, mask);
+	while (table->keys[pos]) {
+		if (table->keys[pos] == tag) {
+			table->vals[pos] = obj;
+			return;
+		}
+		pos = (pos+1) & mask;
+	}
+	table->keys[pos] = tag;
+	table->vals[pos] = obj;
+	table->count++;
+}
+
+void GlkTagTableRemove(GlkTagTable *table, GlkTag tag) {
+	if (!tag || !table->count)
+		return;
+	
+	NSUInteger mask = table->size-1;
+	NSUInteger pos = tag_hash(tag, mask);
+	while (table->keys[pos] != tag) {
+		if (!table->keys[pos])
+			return;
+		pos = (pos+1) & mask;
+	}
+	
+	/* Close the gap: pull back any later entry in this cluster whose home slot is at or before the hole. */
+	NSUInteger hole = pos;
+	pos = (pos+1) & mask;
+	while (table->keys[pos]) {
+		NSUInteger home = tag_hash(table->keys[pos], mask);
+		if (((pos - home) & mask) >= ((pos - hole) & mask)) {
+			table->keys[hole] = table->keys[pos];
+			table->vals[hole] = table->vals[pos];
+			hole = pos;
+		}
+		pos = (pos+1) & mask;
+	}
+	table->keys[hole] = 0;
+	table->vals[hole] = NULL;
+	table->count--;
+}
@@ -0,0 +1,36 @@
+/* GlkTurnTiming.h: Per-turn latency instrumentation
+	for IosGlk, the iOS implementation of the Glk API.
+	Designed by Andrew Plotkin <erkyrath@eblong.com>
+	http://eblong.com/zarf/glk/
+*/
+
+#import <Foundation/Foundation.h>
+
+/* This is all compiled out unless IOSGLK_TURN_TIMING is defined (add it to the target's preprocessor macros, or build the headless tools with TURN_TIMING=yes). When it's off, the TURNTIME macros expand to nothing and GlkTurnTiming.m is empty. */
+
+/* The phases of a turn, in order. */
+typedef enum GlkTurnPhase_enum {
+	turnphase_VM = 0, /* VM thread running: glk_select() returns until the next glk_select() */
+	turnphase_Clone = 1, /* [GlkLibrary cloneState] */
+	turnphase_Handoff = 2, /* cloned state waiting for the main thread to pick it up */
+	turnphase_Update = 3, /* [IosGlkViewController updateFromLibraryState:] */
+	turnphase_Render = 4, /* after the update, until the UI's layout and drawing are committed */
+	turnphase_NUM = 5
+} GlkTurnPhase;
+
+#ifdef IOSGLK_TURN_TIMING
+
+#define TURNTIME_MARK(var) uint64_t var = GlkTurnTimeNow()
+#define TURNTIME_RECORD(phase, var) GlkTurnTimeRecord((phase), (var))
+
+extern uint64_t GlkTurnTimeNow(void);
+extern void GlkTurnTimeRecord(GlkTurnPhase phase, uint64_t start);
+extern void GlkTurnTimeReset(void);
+extern NSString *GlkTurnTimeReport(void);
+
+#else // IOSGLK_TURN_TIMING
+
+#define TURNTIME_MARK(var) do {} while (0)
+#define TURNTIME_RECORD(phase, var) do {} while (0)
+
+#endif // IOSGLK_TURN_TIMING
@@ -0,0 +1,126 @@
+/* GlkTurnTiming.m: Per-turn latency instrumentation
+	for IosGlk, the iOS implementation of the Glk API.
+	Designed by Andrew Plotkin <erkyrath@eblong.com>
+	http://eblong.com/zarf/glk/
+*/
+
+/*	Each phase of a turn (see GlkTurnPhase) gets a ring buffer holding the durations of its most recent TURNTIME_RING_SIZE occurrences, in nanoseconds. Recording a sample is a clock read and an array store; nothing is allocated and nothing is locked. That's safe because each phase is only ever recorded from one thread (VM and Clone on the VM thread, the rest on the main thread). GlkTurnTimeReport() can be called from any thread; if it races a writer, it may see one stale sample, which doesn't matter for percentiles.
+ 
+	Build with IOSGLK_TURN_TIMING defined to turn this on. Call GlkTurnTimeReport() (from the debugger, or wherever you like) to get a summary: count, p50/p95/p99/max for each phase, plus a log-scale histogram.
+*/
+
+#import "GlkTurnTiming.h"
+
+#ifdef IOSGLK_TURN_TIMING
+
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#else // __APPLE__
+#include <time.h>
+#endif // __APPLE__
+
+#define TURNTIME_RING_SIZE (1024)
+#define TURNTIME_NUM_BUCKETS (10)
+
+typedef struct TurnTimeRing_struct {
+	uint64_t samples[TURNTIME_RING_SIZE];
+	uint32_t count; /* total samples ever recorded; the ring holds the last TURNTIME_RING_SIZE */
+} TurnTimeRing;
+
+static TurnTimeRing rings[turnphase_NUM];
+
+static char *phasenames[turnphase_NUM] = {
+	"vm", "clone", "handoff", "update", "render"
+};
+
+/* Return a monotonic timestamp, in nanoseconds. */
+uint64_t GlkTurnTimeNow() {
+#ifdef __APPLE__
+	static mach_timebase_info_data_t timebase;
+	if (timebase.denom == 0)
+		mach_timebase_info(&timebase);
+	return mach_absolute_time() * timebase.numer / timebase.denom;
+#else // __APPLE__
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif // __APPLE__
+}
+
+/* Record the time since start (a GlkTurnTimeNow() value) as one sample of the given phase. A zero start means "no mark was taken"; it's ignored. */
+void GlkTurnTimeRecord(GlkTurnPhase phase, uint64_t start) {
+	if (!start || phase >= turnphase_NUM)
+		return;
+	uint64_t now = GlkTurnTimeNow();
+	TurnTimeRing *ring = &rings[phase];
+	ring->samples[ring->count % TURNTIME_RING_SIZE] = (now > start) ? (now - start) : 0;
+	ring->count++;
+}
+
+void GlkTurnTimeReset() {
+	memset(rings, 0, sizeof(rings));
+}
+
+static int compare_samples(const void *p1, const void *p2) {
+	uint64_t v1 = *(const uint64_t *)p1;
+	uint64_t v2 = *(const uint64_t *)p2;
+	if (v1 < v2)
+		return -1;
+	if (v1 > v2)
+		return 1;
+	return 0;
+}
+
+/* Nearest-rank percentile of a sorted array. */
+static double percentile_ms(uint64_t *sorted, int count, int pct) {
+	int ix = (count * pct + 99) / 100 - 1;
+	if (ix < 0)
+		ix = 0;
+	if (ix >= count)
+		ix = count-1;
+	return (double)sorted[ix] / 1.0e6;
+}
+
+/* Summarize every phase. Histogram buckets are powers of two, starting below 0.25 ms; the last bucket is everything from 64 ms up. */
+NSString *GlkTurnTimeReport() {
+	NSMutableString *res = [NSMutableString stringWithCapacity:1024];
+	uint64_t *sorted = (uint64_t *)malloc(TURNTIME_RING_SIZE * sizeof(uint64_t));
+	
+	[res appendString:@"phase     count     p50ms     p95ms     p99ms     maxms  histogram (<0.25,0.5,1,2,4,8,16,32,64,more ms)\n"];
+	for (int phase=0; phase<turnphase_NUM; phase++) {
+		TurnTimeRing *ring = &rings[phase];
+		uint32_t total = ring->count;
+		int count = (total < TURNTIME_RING_SIZE) ? total : TURNTIME_RING_SIZE;
+		if (count == 0) {
+			[res appendFormat:@"%-8s %6d\n", phasenames[phase], 0];
+			continue;
+		}
+		
+		memcpy(sorted, ring->samples, count * sizeof(uint64_t));
+		qsort(sorted, count, sizeof(uint64_t), compare_samples);
+		
+		int buckets[TURNTIME_NUM_BUCKETS];
+		memset(buckets, 0, sizeof(buckets));
+		for (int ix=0; ix<count; ix++) {
+			uint64_t limit = 250000; // 0.25 ms
+			int bx = 0;
+			while (bx < TURNTIME_NUM_BUCKETS-1 && sorted[ix] >= limit) {
+				limit *= 2;
+				bx++;
+			}
+			buckets[bx]++;
+		}
+		
+		[res appendFormat:@"%-8s %6u %9.3f %9.3f %9.3f %9.3f ", phasenames[phase], total,
+			percentile_ms(sorted, count, 50), percentile_ms(sorted, count, 95), percentile_ms(sorted, count, 99),
+			(double)sorted[count-1] / 1.0e6];
+		for (int bx=0; bx<TURNTIME_NUM_BUCKETS; bx++)
+			[res appendFormat:@" %d", buckets[bx]];
+		[res appendString:@"\n"];
+	}
+	
+	free(sorted);
+	return res;
+}
+
+#endif // IOSGLK_TURN_TIMING
@@ -0,0 +1,18 @@
+/* GlkUTF8.h: Incremental UTF-8 encoding and decoding for text-mode file streams
+	for IosGlk, the iOS implementation of the Glk API.
+	Designed by Andrew Plotkin <erkyrath@eblong.com>
+	http://eblong.com/zarf/glk/
+*/
+
+#include <stddef.h>
+#include "glk.h"
+
+/* Characters are glui32s if wide is set, or Latin-1 bytes if not. All of these work a buffer at a time, and stop short (rather than splitting a character) when the destination or source runs out; the consumed count says how far they got. */
+
+/* Encode up to srclen characters into at most destlen bytes. Returns the number of bytes written; *consumedref is set to the number of characters encoded. Characters above 0x1FFFFF are written as "?". */
+extern size_t GlkUTF8Encode(unsigned char *dest, size_t destlen, const void *src, size_t srclen, int wide, size_t *consumedref);
+
+/* Decode up to destlen characters from at most srclen bytes. Returns the number of characters written; *consumedref is set to the number of bytes used. If narrowing (!wide), characters above 0xFF become "?".
+ 
+	Decoding stops before a sequence which runs past the end of the source, or which doesn't start with a valid lead byte; the caller has to deal with those. If stopatnewline is set, decoding also stops just after a newline, and *gotnewlineref is set. */
+extern size_t GlkUTF8Decode(void *dest, size_t destlen, const unsigned char *src, size_t srclen, int wide, int stopatnewline, size_t *consumedref, int *gotnewlineref);
@@ -0,0 +1,248 @@
+/* GlkUTF8.m: Incremental UTF-8 encoding and decoding for text-mode file streams
+	for IosGlk, the iOS implementation of the Glk API.
+	Designed by Andrew Plotkin <erkyrath@eblong.com>
+	http://eblong.com/zarf/glk/
+*/
+
+/*	Plain C, like GlkByteOrder.m. Transcripts and command scripts are nearly all ASCII, so both directions check sixteen characters at a time (with SSE2 on x86, NEON on 64-bit ARM) and copy them straight across if they're all below 0x80. Anything else goes through the scalar loop.
+
+	The decoder accepts exactly what GlkStreamFile's byte-at-a-time getChar accepts: the lead byte decides the length, and continuation bytes are masked rather than checked. That way it doesn't matter which of the two decodes a given character.
+*/
+
+#include <string.h>
+#include "GlkUTF8.h"
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define UTF8_NEON (1)
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define UTF8_SSE2 (1)
+#endif
+
+/* Are these sixteen bytes all ASCII? If newlines is set, a newline among them also counts as a no. */
+static inline int ascii_block(const unsigned char *src, int newlines) {
+#if defined(UTF8_NEON)
+	uint8x16_t val = vld1q_u8(src);
+	if (vmaxvq_u8(val) >= 0x80)
+		return 0;
+	if (newlines && vmaxvq_u8(vceqq_u8(val, vdupq_n_u8('\n'))))
+		return 0;
+	return 1;
+#elif defined(UTF8_SSE2)
+	__m128i val = _mm_loadu_si128((const __m128i *)src);
+	if (_mm_movemask_epi8(val))
+		return 0;
+	if (newlines && _mm_movemask_epi8(_mm_cmpeq_epi8(val, _mm_set1_epi8('\n'))))
+		return 0;
+	return 1;
+#else
+	for (int ix=0; ix<16; ix++) {
+		if (src[ix] >= 0x80 || (newlines && src[ix] == '\n'))
+			return 0;
+	}
+	return 1;
+#endif
+}
+
+/* Narrow sixteen glui32s to bytes, if they're all ASCII. Returns 0 (having stored nothing) if they're not. */
+static inline int ascii_block_wide(unsigned char *dest, const glui32 *src) {
+#if defined(UTF8_NEON)
+	uint32x4_t v0 = vld1q_u32(src);
+	uint32x4_t v1 = vld1q_u32(src+4);
+	uint32x4_t v2 = vld1q_u32(src+8);
+	uint32x4_t v3 = vld1q_u32(src+12);
+	uint32x4_t all = vorrq_u32(vorrq_u32(v0, v1), vorrq_u32(v2, v3));
+	if (vmaxvq_u32(all) >= 0x80)
+		return 0;
+	uint16x8_t lo = vcombine_u16(vmovn_u32(v0), vmovn_u32(v1));
+	uint16x8_t hi = vcombine_u16(vmovn_u32(v2), vmovn_u32(v3));
+	vst1q_u8(dest, vcombine_u8(vmovn_u16(lo), vmovn_u16(hi)));
+	return 1;
+#elif defined(UTF8_SSE2)
+	__m128i v0 = _mm_loadu_si128((const __m128i *)src);
+	__m128i v1 = _mm_loadu_si128((const __m128i *)(src+4));
+	__m128i v2 = _mm_loadu_si128((const __m128i *)(src+8));
+	__m128i v3 = _mm_loadu_si128((const __m128i *)(src+12));
+	__m128i all = _mm_or_si128(_mm_or_si128(v0, v1), _mm_or_si128(v2, v3));
+	__m128i high = _mm_andnot_si128(_mm_set1_epi32(0x7F), all);
+	if (_mm_movemask_epi8(_mm_cmpeq_epi32(high, _mm_setzero_si128())) != 0xFFFF)
+		return 0;
+	/* Everything is below 0x80, so the saturating packs are exact. */
+	__m128i lo = _mm_packs_epi32(v0, v1);
+	__m128i hi = _mm_packs_epi32(v2, v3);
+	_mm_storeu_si128((__m128i *)dest, _mm_packus_epi16(lo, hi));
+	return 1;
+#else
+	for (int ix=0; ix<16; ix++) {
+		if (src[ix] >= 0x80)
+			return 0;
+	}
+	for (int ix=0; ix<16; ix++)
+		dest[ix] = src[ix];
+	return 1;
+#endif
+}
+
+/* Widen sixteen ASCII bytes to glui32s. */
+static inline void widen_block(glui32 *dest, const unsigned char *src) {
+#if defined(UTF8_NEON)
+	uint8x16_t val = vld1q_u8(src);
+	uint16x8_t lo = vmovl_u8(vget_low_u8(val));
+	uint16x8_t hi = vmovl_u8(vget_high_u8(val));
+	vst1q_u32(dest, vmovl_u16(vget_low_u16(lo)));
+	vst1q_u32(dest+4, vmovl_u16(vget_high_u16(lo)));
+	vst1q_u32(dest+8, vmovl_u16(vget_low_u16(hi)));
+	vst1q_u32(dest+12, vmovl_u16(vget_high_u16(hi)));
+#elif defined(UTF8_SSE2)
+	__m128i zero = _mm_setzero_si128();
+	__m128i val = _mm_loadu_si128((const __m128i *)src);
+	__m128i lo = _mm_unpacklo_epi8(val, zero);
+	__m128i hi = _mm_unpackhi_epi8(val, zero);
+	_mm_storeu_si128((__m128i *)dest, _mm_unpacklo_epi16(lo, zero));
+	_mm_storeu_si128((__m128i *)(dest+4), _mm_unpackhi_epi16(lo, zero));
+	_mm_storeu_si128((__m128i *)(dest+8), _mm_unpacklo_epi16(hi, zero));
+	_mm_storeu_si128((__m128i *)(dest+12), _mm_unpackhi_epi16(hi, zero));
+#else
+	for (int ix=0; ix<16; ix++)
+		dest[ix] = src[ix];
+#endif
+}
+
+size_t GlkUTF8Encode(unsigned char *dest, size_t destlen, const void *src, size_t srclen, int wide, size_t *consumedref) {
+	const unsigned char *bsrc = src;
+	const glui32 *usrc = src;
+	size_t ix = 0; /* characters consumed */
+	size_t pos = 0; /* bytes written */
+	
+	while (ix < srclen) {
+		if (srclen - ix >= 16 && destlen - pos >= 16) {
+			if (wide) {
+				if (ascii_block_wide(dest+pos, usrc+ix)) {
+					ix += 16;
+					pos += 16;
+					continue;
+				}
+			}
+			else {
+				if (ascii_block(bsrc+ix, 0)) {
+					memcpy(dest+pos, bsrc+ix, 16);
+					ix += 16;
+					pos += 16;
+					continue;
+				}
+			}
+		}
+		
+		glui32 ch = (wide ? usrc[ix] : bsrc[ix]);
+		if (ch < 0x80) {
+			if (pos+1 > destlen)
+				break;
+			dest[pos++] = ch;
+		}
+		else if (ch < 0x800) {
+			if (pos+2 > destlen)
+				break;
+			dest[pos++] = (0xC0 | ((ch & 0x7C0) >> 6));
+			dest[pos++] = (0x80 |  (ch & 0x03F)     );
+		}
+		else if (ch < 0x10000) {
+			if (pos+3 > destlen)
+				break;
+			dest[pos++] = (0xE0 | ((ch & 0xF000) >> 12));
+			dest[pos++] = (0x80 | ((ch & 0x0FC0) >>  6));
+			dest[pos++] = (0x80 |  (ch & 0x003F)      );
+		}
+		else if (ch < 0x200000) {
+			if (pos+4 > destlen)
+				break;
+			dest[pos++] = (0xF0 | ((ch & 0x1C0000) >> 18));
+			dest[pos++] = (0x80 | ((ch & 0x03F000) >> 12));
+			dest[pos++] = (0x80 | ((ch & 0x000FC0) >>  6));
+			dest[pos++] = (0x80 |  (ch & 0x00003F)       );
+		}
+		else {
+			if (pos+1 > destlen)
+				break;
+			dest[pos++] = '?';
+		}
+		ix++;
+	}
+	
+	*consumedref = ix;
+	return pos;
+}
+
+size_t GlkUTF8Decode(void *dest, size_t destlen, const unsigned char *src, size_t srclen, int wide, int stopatnewline, size_t *consumedref, int *gotnewlineref) {
+	unsigned char *bdest = dest;
+	glui32 *udest = dest;
+	size_t ix = 0; /* bytes consumed */
+	size_t count = 0; /* characters written */
+	
+	if (gotnewlineref)
+		*gotnewlineref = 0;
+	
+	while (count < destlen && ix < srclen) {
+		if (srclen - ix >= 16 && destlen - count >= 16 && ascii_block(src+ix, stopatnewline)) {
+			if (wide)
+				widen_block(udest+count, src+ix);
+			else
+				memcpy(bdest+count, src+ix, 16);
+			ix += 16;
+			count += 16;
+			continue;
+		}
+		
+		glui32 val0 = src[ix];
+		glui32 res;
+		size_t seqlen;
+		if (val0 < 0x80) {
+			res = val0;
+			seqlen = 1;
+		}
+		else if ((val0 & 0xE0) == 0xC0) {
+			seqlen = 2;
+			if (ix+seqlen > srclen)
+				break;
+			res = (val0 & 0x1f) << 6;
+			res |= (src[ix+1] & 0x3f);
+		}
+		else if ((val0 & 0xF0) == 0xE0) {
+			seqlen = 3;
+			if (ix+seqlen > srclen)
+				break;
+			res = (((val0 & 0xf)<<12)  & 0x0000f000);
+			res |= (((src[ix+1] & 0x3f)<<6) & 0x00000fc0);
+			res |= (((src[ix+2] & 0x3f))    & 0x0000003f);
+		}
+		else if ((val0 & 0xF0) == 0xF0) {
+			seqlen = 4;
+			if (ix+seqlen > srclen)
+				break;
+			res = (((val0 & 0x7)<<18)   & 0x1c0000);
+			res |= (((src[ix+1] & 0x3f)<<12) & 0x03f000);
+			res |= (((src[ix+2] & 0x3f)<<6)  & 0x000fc0);
+			res |= (((src[ix+3] & 0x3f))     & 0x00003f);
+		}
+		else {
+			/* not a lead byte */
+			break;
+		}
+		
+		if (wide)
+			udest[count] = res;
+		else
+			bdest[count] = (res >= 0x100) ? '?' : res;
+		count++;
+		ix += seqlen;
+		
+		if (stopatnewline && res == '\n') {
+			if (gotnewlineref)
+				*gotnewlineref = 1;
+			break;
+		}
+	}
+	
+	*consumedref = ix;
+	return count;
+}
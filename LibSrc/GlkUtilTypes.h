@@ -5,6 +5,7 @@
 */
 
 #import <Foundation/Foundation.h>
+#import "GlkTagTable.h"
 #include "glk.h"
 
 #ifdef DEBUG
@@ -25,11 +26,25 @@ typedef enum GlkStyledLineStatus_enum {
 	linestat_ClearPage=2
 } GlkStyledLineStatus;
 
+typedef struct GlkStyledRun_struct {
+	glui32 style;
+	int start; /* offset into the line's chars (which, in a grid window, is also the column) */
+	int length;
+} GlkStyledRun;
+
 @interface GlkStyledLine : NSObject {
 	int index; /* index in the window's lines array (but not necessarily zero-based) */
 	GlkStyledLineStatus status;
-	NSMutableArray *arr; /* array of GlkStyledString */
-
+	
+	glui32 *chars; /* the text of all the runs, end to end (malloced, or NULL) */
+	int charslen;
+	int charssize;
+	GlkStyledRun *runs; /* malloced, or NULL */
+	int runcount;
+	int runssize;
+	BOOL frozen; /* no more text may be appended (see freeze) */
+
+	NSArray *arr; /* array of GlkStyledString, one per run (cached value) */
 	NSString *concatline; /* the line contents, smushed together with no style information (cached value) */
 
 	GlkAccStyledLine *accessel; /* the accessibility element (cached, or nil) */
@@ -37,12 +52,21 @@ typedef enum GlkStyledLineStatus_enum {
 
 @property (nonatomic) int index;
 @property (nonatomic) GlkStyledLineStatus status;
-@property (nonatomic, retain) NSMutableArray *arr;
+@property (nonatomic, readonly) glui32 *chars;
+@property (nonatomic, readonly) int charslen;
+@property (nonatomic, readonly) GlkStyledRun *runs;
+@property (nonatomic, readonly) int runcount;
+@property (nonatomic, readonly) BOOL frozen;
 @property (nonatomic, retain) NSString *concatline;
 @property (nonatomic, retain) GlkAccStyledLine *accessel;
 
 - (id) initWithIndex:(int)index;
 - (id) initWithIndex:(int)index status:(GlkStyledLineStatus) status;
+- (id) initWithIndex:(int)index chars:(glui32 *)buf styles:(glui32 *)styles len:(int)len;
+- (void) appendChars:(glui32 *)buf len:(int)len style:(glui32)style;
+- (void) freeze;
+- (NSUInteger) memoryUsage;
+- (NSArray *) arr;
 - (NSString *) concatLine;
 - (NSString *) wordAtPos:(CGFloat)xpos styles:(StyleSet *)styleset;
 - (NSString *) wordAtPos:(CGFloat)xpos styles:(StyleSet *)styleset inBox:(CGRect *)boxref;
@@ -52,8 +76,7 @@ typedef enum GlkStyledLineStatus_enum {
 
 
 @interface GlkStyledString : NSObject {
-	NSString *str; /* may be NSMutableString */
-	BOOL ismutable;
+	NSString *str;
 	glui32 style;
 	int pos;
 }
@@ -63,8 +86,6 @@ typedef enum GlkStyledLineStatus_enum {
 @property (nonatomic) int pos;
 
 - (id) initWithText:(NSString *)str style:(glui32)style;
-- (void) appendString:(NSString *)newstr;
-- (void) freeze;
 
 @end
 
@@ -121,11 +142,17 @@ typedef enum GlkStyledLineStatus_enum {
 
 
 @interface GlkGridLine : NSObject {
-	BOOL dirty;
+	BOOL dirty; /* touched since the last clone (but maybe not changed) */
 	int width;
 	glui32 *chars; // malloced array (size maxwidth)
 	glui32 *styles; // malloced array (size maxwidth)
 	int maxwidth;
+	
+	/* The contents as of the last clone, so that a line which was rewritten with the same text doesn't have to be sent again. */
+	glui32 *sentchars; // malloced array (size sentmax), or NULL
+	glui32 *sentstyles; // ditto
+	int sentmax;
+	int sentwidth; // -1 if nothing has been sent (or the view has forgotten it)
 }
 
 @property (nonatomic) BOOL dirty;
@@ -134,18 +161,23 @@ typedef enum GlkStyledLineStatus_enum {
 @property (nonatomic) glui32 *styles;
 
 - (void) clear;
+- (void) putChars:(char *)buf len:(int)len at:(int)pos style:(glui32)style;
+- (void) putUChars:(glui32 *)buf len:(int)len at:(int)pos style:(glui32)style;
+- (BOOL) differsFromSent;
+- (void) markSent;
+- (void) forgetSent;
 
 @end
 
 
 @interface GlkTagString : NSObject {
-	NSNumber *tag;
+	GlkTag tag;
 	NSString *str;
 }
 
-- (id) initWithTag:(NSNumber *)tag text:(NSString *)str;
+- (id) initWithTag:(GlkTag)tag text:(NSString *)str;
 
-@property (nonatomic, retain) NSNumber *tag;
+@property (nonatomic) GlkTag tag;
 @property (nonatomic, retain) NSString *str;
 
 @end
@@ -10,16 +10,25 @@
 #import "GlkUtilTypes.h"
 #import "GlkAccessTypes.h"
 #import "StyleSet.h"
+#include <objc/runtime.h>
 
 @implementation GlkStyledLine
 /* GlkStyledLine: Represents a line of text. (Used in a few different places.)
  
-	It's just an array of GlkStyledStrings, with an additional optional flag saying "This starts a new line" or "This starts a new page." (Consider either to be a newline at the *beginning* of the GlkStyledLine, possibly with page-breaking behavior.)
+	The text is stored as one buffer of UTF-32 characters, plus an array of runs which divide it up by style. There's an additional optional flag saying "This starts a new line" or "This starts a new page." (Consider either to be a newline at the *beginning* of the GlkStyledLine, possibly with page-breaking behavior.)
+ 
+	The window classes build lines with appendChars:. The views want NSStrings, so they call arr, which returns GlkStyledString objects for the runs (built on first request and cached).
+ 
+	Once a line is finished, the window calls freeze, and its text never changes again. A frozen line can be shared between the VM and UI threads without copying -- copy just retains it. (The VM thread only reads the text of a frozen line; the UI thread builds the cached values. Those are different fields, so no lock is needed.) Copying an unfrozen line makes a real copy, which is frozen.
 */
 
 @synthesize index;
 @synthesize status;
-@synthesize arr;
+@synthesize chars;
+@synthesize charslen;
+@synthesize runs;
+@synthesize runcount;
+@synthesize frozen;
 @synthesize concatline;
 @synthesize accessel;
 
@@ -33,30 +42,135 @@
 	if (self) {
 		index = indexval;
 		status = statusval;
-		self.arr = [NSMutableArray arrayWithCapacity:16];
+		chars = NULL;
+		charslen = 0;
+		charssize = 0;
+		runs = NULL;
+		runcount = 0;
+		runssize = 0;
+		frozen = NO;
+	}
+	
+	return self;
+}
+
+/* Build a finished (frozen) line from a row of characters with one style per character, such as a grid window row. The runs are counted first, so the text and run arrays are each allocated once, at their exact size. */
+- (id) initWithIndex:(int)indexval chars:(glui32 *)buf styles:(glui32 *)stylebuf len:(int)len {
+	self = [self initWithIndex:indexval status:linestat_Continue];
+	
+	if (self && len > 0) {
+		int count = 1;
+		for (int ix=1; ix<len; ix++) {
+			if (stylebuf[ix] != stylebuf[ix-1])
+				count++;
+		}
+		
+		chars = malloc(len * sizeof(glui32));
+		runs = malloc(count * sizeof(GlkStyledRun));
+		if (!chars || !runs)
+			[NSException raise:@"GlkException" format:@"unable to allocate chars or runs for styled line"];
+		memcpy(chars, buf, len * sizeof(glui32));
+		charslen = len;
+		charssize = len;
+		runssize = count;
+		
+		int pos = 0;
+		while (pos < len) {
+			int ix = pos+1;
+			while (ix < len && stylebuf[ix] == stylebuf[pos])
+				ix++;
+			runs[runcount].style = stylebuf[pos];
+			runs[runcount].start = pos;
+			runs[runcount].length = ix - pos;
+			runcount++;
+			pos = ix;
+		}
 	}
 	
+	if (self)
+		frozen = YES;
 	return self;
 }
 
 - (id) initWithCoder:(NSCoder *)decoder {
 	index = [decoder decodeIntForKey:@"index"];
 	status = [decoder decodeIntForKey:@"status"];
-	self.arr = [decoder decodeObjectForKey:@"arr"];
+	
+	if ([decoder containsValueForKey:@"arr"]) {
+		/* An older archive, with an array of GlkStyledStrings. */
+		NSArray *oldarr = [decoder decodeObjectForKey:@"arr"];
+		for (GlkStyledString *sstr in oldarr) {
+			NSData *data = [sstr.str dataUsingEncoding:NSUTF32LittleEndianStringEncoding];
+			[self appendChars:(glui32 *)data.bytes len:data.length/sizeof(glui32) style:sstr.style];
+		}
+		return self;
+	}
+	
+	NSUInteger len = 0;
+	const uint8_t *bytes = [decoder decodeBytesForKey:@"chars" returnedLength:&len];
+	if (bytes && len) {
+		charslen = len / sizeof(glui32);
+		charssize = charslen;
+		chars = malloc(charssize * sizeof(glui32));
+		memcpy(chars, bytes, charslen * sizeof(glui32));
+	}
+	
+	len = 0;
+	bytes = [decoder decodeBytesForKey:@"runs" returnedLength:&len];
+	if (bytes && len) {
+		/* Each run is three glui32s: style, start, length. */
+		const glui32 *vals = (const glui32 *)bytes;
+		runcount = len / (3*sizeof(glui32));
+		runssize = runcount;
+		runs = malloc(runssize * sizeof(GlkStyledRun));
+		for (int ix=0; ix<runcount; ix++) {
+			runs[ix].style = vals[3*ix];
+			runs[ix].start = vals[3*ix+1];
+			runs[ix].length = vals[3*ix+2];
+			if (runs[ix].start < 0 || runs[ix].length < 0 || runs[ix].start+runs[ix].length > charslen) {
+				/* Corrupt; drop the text rather than read out of bounds. */
+				runcount = 0;
+				break;
+			}
+		}
+	}
+	
 	return self;
 }
 
-/* Standard copy method. Returns a retained object which is a (shallow) copy. (Skip the cached elements.) */
+/* Standard copy method. Returns a retained object which is a copy. A frozen line can't change, so it is its own copy. Otherwise the text and runs are copied, so the original can go on growing without affecting the copy. (Skip the cached elements.) */
 - (id) copyWithZone:(NSZone *)zone {
-	GlkStyledLine *copy = [[GlkStyledLine allocWithZone:zone] init];
-	copy.index = index;
-	copy.status = status;
-	copy.arr = arr;
+	if (frozen)
+		return [self retain];
+	
+	GlkStyledLine *copy = [[GlkStyledLine allocWithZone:zone] initWithIndex:index status:status];
+	copy->frozen = YES;
+	if (charslen) {
+		copy->charslen = charslen;
+		copy->charssize = charslen;
+		copy->chars = malloc(charslen * sizeof(glui32));
+		memcpy(copy->chars, chars, charslen * sizeof(glui32));
+	}
+	if (runcount) {
+		copy->runcount = runcount;
+		copy->runssize = runcount;
+		copy->runs = malloc(runcount * sizeof(GlkStyledRun));
+		memcpy(copy->runs, runs, runcount * sizeof(GlkStyledRun));
+	}
 	return copy;
 }
 
 - (void) dealloc {
-	self.arr = nil;
+	if (chars) {
+		free(chars);
+		chars = NULL;
+	}
+	if (runs) {
+		free(runs);
+		runs = NULL;
+	}
+	[arr release];
+	arr = nil;
 	self.concatline = nil;
 	if (accessel) {
 		accessel.line = nil; /* clear the weak parent link */
@@ -69,7 +183,18 @@
 	[encoder encodeInt:index forKey:@"index"];
 	if (status)
 		[encoder encodeInt:status forKey:@"status"];
-	[encoder encodeObject:arr forKey:@"arr"];
+	if (charslen)
+		[encoder encodeBytes:(const uint8_t *)chars length:charslen*sizeof(glui32) forKey:@"chars"];
+	if (runcount) {
+		glui32 *vals = malloc(runcount * 3*sizeof(glui32));
+		for (int ix=0; ix<runcount; ix++) {
+			vals[3*ix] = runs[ix].style;
+			vals[3*ix+1] = runs[ix].start;
+			vals[3*ix+2] = runs[ix].length;
+		}
+		[encoder encodeBytes:(const uint8_t *)vals length:runcount*3*sizeof(glui32) forKey:@"runs"];
+		free(vals);
+	}
 }
 
 - (NSString *) description {
@@ -92,13 +217,81 @@
 	return [NSString stringWithFormat:@"<GlkStyledLine (%d/%@) '%@'>", index, statstr, self.concatLine];
 }
 
+/* Add text in the given style to the end of the line. If the last run has the same style, it's extended; otherwise a new run begins. */
+- (void) appendChars:(glui32 *)buf len:(int)len style:(glui32)style {
+	if (frozen)
+		[NSException raise:@"GlkException" format:@"appendChars: line is frozen"];
+	if (len <= 0)
+		return;
+	
+	if (charslen + len > charssize) {
+		int newsize = (charssize ? charssize*2 : 64);
+		while (newsize < charslen + len)
+			newsize *= 2;
+		chars = realloc(chars, newsize * sizeof(glui32));
+		charssize = newsize;
+	}
+	memcpy(chars+charslen, buf, len * sizeof(glui32));
+	
+	GlkStyledRun *lastrun = (runcount ? &runs[runcount-1] : NULL);
+	if (lastrun && lastrun->style == style && lastrun->start+lastrun->length == charslen) {
+		lastrun->length += len;
+	}
+	else {
+		if (runcount >= runssize) {
+			runssize = (runssize ? runssize*2 : 4);
+			runs = realloc(runs, runssize * sizeof(GlkStyledRun));
+		}
+		runs[runcount].style = style;
+		runs[runcount].start = charslen;
+		runs[runcount].length = len;
+		runcount++;
+	}
+	charslen += len;
+	
+	if (arr) {
+		[arr release];
+		arr = nil;
+	}
+	self.concatline = nil;
+}
+
+/* Mark the line as finished. After this, appendChars: is an error, and copies are free. */
+- (void) freeze {
+	frozen = YES;
+}
+
+/* The approximate number of bytes this line occupies: the object and its two buffers. (Not malloc overhead, and not the cached values, which only the UI's copies build.) */
+- (NSUInteger) memoryUsage {
+	static size_t instancesize = 0;
+	if (!instancesize)
+		instancesize = class_getInstanceSize([GlkStyledLine class]);
+	return instancesize + charssize*sizeof(glui32) + runssize*sizeof(GlkStyledRun);
+}
+
+- (NSArray *) arr {
+	if (!arr) {
+		NSMutableArray *tmparr = [NSMutableArray arrayWithCapacity:runcount];
+		for (int ix=0; ix<runcount; ix++) {
+			GlkStyledRun *run = &runs[ix];
+			NSString *str = [[NSString alloc] initWithBytes:chars+run->start length:run->length*sizeof(glui32) encoding:NSUTF32LittleEndianStringEncoding]; // release soon
+			GlkStyledString *span = [[GlkStyledString alloc] initWithText:(str ? str : @"") style:run->style]; // release soon
+			span.pos = run->start;
+			[tmparr addObject:span];
+			[span release];
+			[str release];
+		}
+		arr = [tmparr retain];
+	}
+	return arr;
+}
+
 - (NSString *) concatLine {
 	if (!concatline) {
-		NSMutableString *tmpstr = [NSMutableString stringWithCapacity:80];
-		for (GlkStyledString *sstr in arr) {
-			[tmpstr appendString:sstr.str];
-		}
-		self.concatline = [NSString stringWithString:tmpstr];
+		NSString *str = nil;
+		if (charslen)
+			str = [[[NSString alloc] initWithBytes:chars length:charslen*sizeof(glui32) encoding:NSUTF32LittleEndianStringEncoding] autorelease];
+		self.concatline = (str ? str : @"");
 	}
 	return concatline;
 }
@@ -161,9 +354,7 @@
 
 
 @implementation GlkStyledString
-/* GlkStyledString: Represents a span of text in a given style.
-
-	This has extra methods to let you append more text to it (making it mutable if necessary), and then "freeze" it back to an immutable string. This fits the usage pattern of GlkWindowBuffer.
+/* GlkStyledString: Represents a span of text in a given style. The views see a GlkStyledLine as an array of these.
 	
 	The pos field is not directly used by this class (or the GlkStyledLine class). The user may stash position information there.
 */
@@ -178,7 +369,6 @@
 	if (self) {
 		self.str = initstr;
 		style = initstyle;
-		ismutable = NO;
 		pos = 0;
 	}
 	
@@ -189,7 +379,6 @@
 	self.str = [decoder decodeObjectForKey:@"str"];
 	style = [decoder decodeInt32ForKey:@"style"];
 	pos = [decoder decodeIntForKey:@"pos"];
-	ismutable = NO;
 	return self;
 }
 
@@ -199,8 +388,6 @@
 }
 
 - (void) encodeWithCoder:(NSCoder *)encoder {
-	if (ismutable)
-		[self freeze];
 	[encoder encodeObject:str forKey:@"str"];
 	if (style != 0)
 		[encoder encodeInt32:style forKey:@"style"];
@@ -208,21 +395,6 @@
 		[encoder encodeInt:pos forKey:@"pos"];
 }
 
-- (void) appendString:(NSString *)newstr {
-	if (!ismutable) {
-		self.str = [NSMutableString stringWithString:str];
-		ismutable = YES;
-	}
-	[(NSMutableString*)str appendString:newstr];
-}
-
-- (void) freeze {
-	if (ismutable) {
-		self.str = [NSString stringWithString:str];
-		ismutable = NO;
-	}
-}
-
 @end
 
 
@@ -418,7 +590,9 @@
 @implementation GlkGridLine
 /* GlkGridLine: Represents one line of a text grid. (This is used in the GlkWindowGrid object, not in the view.) 
  
-	This contains nasty C arrays, because they're easier. */
+	This contains nasty C arrays, because they're easier.
+ 
+	The dirty flag is set by anything which writes to the line. But games commonly clear a status window and rewrite the same text every turn, so cloneState also checks differsFromSent, which compares the line to what was last sent to the view. */
 
 @synthesize dirty;
 @synthesize chars;
@@ -435,6 +609,10 @@
 		styles = (glui32 *)malloc(maxwidth * sizeof(glui32));
 		if (!chars || !styles)
 			[NSException raise:@"GlkException" format:@"unable to allocate chars or styles for grid line"];
+		sentchars = NULL;
+		sentstyles = NULL;
+		sentmax = 0;
+		sentwidth = -1;
 	}
 	
 	return self;
@@ -442,6 +620,10 @@
 
 - (id) initWithCoder:(NSCoder *)decoder {
 	dirty = YES; // when loaded, all dirty
+	sentchars = NULL;
+	sentstyles = NULL;
+	sentmax = 0;
+	sentwidth = -1;
 	width = [decoder decodeIntForKey:@"width"];
 	maxwidth = [decoder decodeIntForKey:@"maxwidth"];
 
@@ -479,6 +661,14 @@
 		free(styles);
 		styles = NULL;
 	}
+	if (sentchars) {
+		free(sentchars);
+		sentchars = NULL;
+	}
+	if (sentstyles) {
+		free(sentstyles);
+		sentstyles = NULL;
+	}
 	[super dealloc];
 }
 
@@ -527,6 +717,66 @@
 	dirty = YES;
 }
 
+/* Fill len entries of the styles array with one style. This is a plain loop so that the compiler can vectorize it. */
+static void fill_styles(glui32 *dest, glui32 style, int len) {
+	for (int ix=0; ix<len; ix++)
+		dest[ix] = style;
+}
+
+/* Write a span of Latin-1 characters, all in one style, starting at position pos. The caller must ensure the span fits (pos+len <= width) and contains no newlines. */
+- (void) putChars:(char *)buf len:(int)len at:(int)pos style:(glui32)style {
+	DEBUG_PARANOID_ASSERT(pos >= 0 && pos+len <= width, @"grid putChars overflow");
+	glui32 *dest = chars + pos;
+	for (int ix=0; ix<len; ix++)
+		dest[ix] = (unsigned char)(buf[ix]);
+	fill_styles(styles+pos, style, len);
+	dirty = YES;
+}
+
+/* The same, for a span of Unicode characters. */
+- (void) putUChars:(glui32 *)buf len:(int)len at:(int)pos style:(glui32)style {
+	DEBUG_PARANOID_ASSERT(pos >= 0 && pos+len <= width, @"grid putUChars overflow");
+	memcpy(chars+pos, buf, len * sizeof(glui32));
+	fill_styles(styles+pos, style, len);
+	dirty = YES;
+}
+
+/* Does the line differ (in width, text, or style) from what was last sent? */
+- (BOOL) differsFromSent {
+	if (sentwidth != width)
+		return YES;
+	if (!width)
+		return NO;
+	if (memcmp(chars, sentchars, width * sizeof(glui32)))
+		return YES;
+	if (memcmp(styles, sentstyles, width * sizeof(glui32)))
+		return YES;
+	return NO;
+}
+
+/* Remember the current contents as sent, and clear the dirty flag. */
+- (void) markSent {
+	if (width > sentmax) {
+		sentmax = maxwidth;
+		sentchars = (glui32 *)reallocf(sentchars, sentmax * sizeof(glui32));
+		sentstyles = (glui32 *)reallocf(sentstyles, sentmax * sizeof(glui32));
+		if (!sentchars || !sentstyles)
+			[NSException raise:@"GlkException" format:@"unable to allocate chars or styles for grid line"];
+	}
+	if (width) {
+		memcpy(sentchars, chars, width * sizeof(glui32));
+		memcpy(sentstyles, styles, width * sizeof(glui32));
+	}
+	sentwidth = width;
+	dirty = NO;
+}
+
+/* The view has lost track of this line, so it must be sent next time whether it changed or not. */
+- (void) forgetSent {
+	sentwidth = -1;
+	dirty = YES;
+}
+
 @end
 
 @implementation GlkTagString
@@ -534,7 +784,7 @@
 @synthesize tag;
 @synthesize str;
 
-- (id) initWithTag:(NSNumber *)tagval text:(NSString *)strval {
+- (id) initWithTag:(GlkTag)tagval text:(NSString *)strval {
 	self = [super init];
 	
 	if (self) {
@@ -546,7 +796,6 @@
 }
 
 - (void) dealloc {
-	self.tag = nil;
 	self.str = nil;
 	[super dealloc];
 }
@@ -5,6 +5,7 @@
 */
 
 #import <Foundation/Foundation.h>
+#import "GlkTagTable.h"
 #include "glk.h"
 #include "gi_dispa.h"
 
@@ -14,18 +15,22 @@
 @class GlkWindowState;
 @class StyleSet;
 @class Geometry;
+@class GlkStyledLine;
+@class GlkScrollbackSpill;
 
 @interface GlkWindow : NSObject {
 	GlkLibrary *library;
 	BOOL inlibrary;
+	GlkWindow *libprev; /* neighbors in the library's list, in creation order; not retained */
+	GlkWindow *libnext;
 	
-	NSNumber *tag;
+	GlkTag tag;
 	gidispatch_rock_t disprock;
 	glui32 type;
 	glui32 rock;
 	
 	GlkWindowPair *parent;
-	NSNumber *parenttag;
+	GlkTag parenttag;
 	int input_request_id;
 	void *line_buffer;
 	gidispatch_rock_t inarrayrock;
@@ -41,9 +46,9 @@
 	glui32 style;
 	
 	GlkStream *stream;
-	NSNumber *streamtag;
+	GlkTag streamtag;
 	GlkStream *echostream;
-	NSNumber *echostreamtag;
+	GlkTag echostreamtag;
 	
 	StyleSet *styleset; // not serialized
 	CGRect bbox;
@@ -55,12 +60,14 @@
 }
 
 @property (nonatomic, retain) GlkLibrary *library;
-@property (nonatomic, retain) NSNumber *tag;
+@property (nonatomic, assign) GlkWindow *libprev;
+@property (nonatomic, assign) GlkWindow *libnext;
+@property (nonatomic) GlkTag tag;
 @property (nonatomic) gidispatch_rock_t disprock;
 @property (nonatomic, readonly) glui32 type;
 @property (nonatomic, readonly) glui32 rock;
 @property (nonatomic, retain) GlkWindowPair *parent;
-@property (nonatomic, retain) NSNumber *parenttag;
+@property (nonatomic) GlkTag parenttag;
 @property (nonatomic, retain) NSString *line_request_initial;
 @property (nonatomic, readonly) int input_request_id;
 @property (nonatomic, readonly) BOOL char_request;
@@ -68,9 +75,9 @@
 @property (nonatomic) BOOL echo_line_input;
 @property (nonatomic) glui32 style;
 @property (nonatomic, retain) GlkStream *stream;
-@property (nonatomic, retain) NSNumber *streamtag;
+@property (nonatomic) GlkTag streamtag;
 @property (nonatomic, retain) GlkStream *echostream;
-@property (nonatomic, retain) NSNumber *echostreamtag;
+@property (nonatomic) GlkTag echostreamtag;
 @property (nonatomic, retain) StyleSet *styleset;
 @property (nonatomic, readonly) CGRect bbox;
 
@@ -103,14 +110,33 @@
 @interface GlkWindowBuffer : GlkWindow {
 	int clearcount; /* incremented whenever the buffer is cleared */
 	int linesdirtyfrom; /* index of first new (or changed) line */
-	NSMutableArray *lines; /* array of GlkStyledLine */
+	
+	/* The scrollback: a ring buffer of retained GlkStyledLines, oldest first. The lines are numbered consecutively from linestart; use lineAtIndex: to find one. */
+	GlkStyledLine **lines;
+	int linessize; /* allocated length of lines (a power of two) */
+	int linesfirst; /* position in lines of the oldest line */
+	int linecount;
+	int linestart;
+	NSUInteger linesbytes; /* approximate memory used by the lines (see [GlkStyledLine memoryUsage]) */
+	
+	/* The scrollback budget, from the library delegate. Zero means no limit. */
+	int maxlines;
+	NSUInteger maxbytes;
+	GlkScrollbackSpill *spill; /* where trimmed lines go, if the delegate asked for that (or nil) */
 }
 
 @property (nonatomic) int clearcount;
 @property (nonatomic) int linesdirtyfrom;
-@property (nonatomic, retain) NSMutableArray *lines;
+@property (nonatomic, readonly) int linecount;
+@property (nonatomic, readonly) int linestart;
+@property (nonatomic, readonly) NSUInteger linesbytes;
+@property (nonatomic, readonly) int maxlines;
+@property (nonatomic, readonly) NSUInteger maxbytes;
+@property (nonatomic, readonly) GlkScrollbackSpill *spill;
 
 - (void) putString:(NSString *)str;
+- (GlkStyledLine *) lineAtIndex:(int)index;
+- (void) updateScrollbackLimits;
 
 @end
 
@@ -129,6 +155,7 @@
 @property (nonatomic, readonly) int cury;
 
 - (void) moveCursorToX:(glui32)xpos Y:(glui32)ypos;
+- (BOOL) canonicalizeCursor;
 - (void) putUChar:(glui32)ch;
 
 @end
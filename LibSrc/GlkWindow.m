@@ -20,11 +20,15 @@
 #import "StyleSet.h"
 #import "Geometry.h"
 #import "GlkUtilTypes.h"
+#import "GlkScrollbackSpill.h"
+#import "GlkFileRef.h"
 
 @implementation GlkWindow
 /* GlkWindow: the base class. */
 
 @synthesize library;
+@synthesize libprev;
+@synthesize libnext;
 @synthesize tag;
 @synthesize disprock;
 @synthesize type;
@@ -44,8 +48,6 @@
 @synthesize styleset;
 @synthesize bbox;
 
-NSCharacterSet *_GlkWindow_newlineCharSet; /* retained forever */
-
 /* Create a window with a given type. (But not Pair windows -- those use a different path.) This is invoked by glk_window_open().
 */
 + (GlkWindow *) windowWithType:(glui32)type rock:(glui32)rock {
@@ -76,11 +78,6 @@ NSCharacterSet *_GlkWindow_newlineCharSet; /* retained forever */
 - (id) initWithType:(glui32)wintype rock:(glui32)winrock {
 	self = [super init];
 	
-	if (!_GlkWindow_newlineCharSet) {
-		/* We need this for breaking up printing strings, so we set it up at init time. I think this shows up as a memory leak in Apple's tools -- sorry about that. */
-		_GlkWindow_newlineCharSet = [[NSCharacterSet characterSetWithCharactersInString:@"\n"] retain];
-	}
-	
 	if (self) {
 		self.library = [GlkLibrary singleton];
 		inlibrary = YES;
@@ -90,7 +87,7 @@ NSCharacterSet *_GlkWindow_newlineCharSet; /* retained forever */
 		rock = winrock;
 		
 		self.parent = nil;
-		self.parenttag = nil;
+		self.parenttag = 0;
 		input_request_id = 0;
 		line_request_initial = nil;
 		line_buffer = nil;
@@ -106,10 +103,10 @@ NSCharacterSet *_GlkWindow_newlineCharSet; /* retained forever */
 		self.stream = [[[GlkStreamWindow alloc] initWithWindow:self] autorelease];
 		self.streamtag = self.stream.tag;
 		self.echostream = nil;
-		self.echostreamtag = nil;
+		self.echostreamtag = 0;
 		
 		self.styleset = nil;
-		[library.windows addObject:self];
+		[library addWindow:self];
 		
 		if (library.dispatch_register_obj)
 			disprock = (*library.dispatch_register_obj)(self, gidisp_Class_Window);
@@ -119,12 +116,7 @@ NSCharacterSet *_GlkWindow_newlineCharSet; /* retained forever */
 }
 
 - (id) initWithCoder:(NSCoder *)decoder {
-	if (!_GlkWindow_newlineCharSet) {
-		/* We need this for breaking up printing strings, so we set it up at init time. I think this shows up as a memory leak in Apple's tools -- sorry about that. */
-		_GlkWindow_newlineCharSet = [[NSCharacterSet characterSetWithCharactersInString:@"\n"] retain];
-	}
-	
-	self.tag = [decoder decodeObjectForKey:@"tag"];
+	self.tag = GlkTagDecode(decoder, @"tag");
 	inlibrary = YES;
 	// self.library will be set later
 	
@@ -132,7 +124,7 @@ NSCharacterSet *_GlkWindow_newlineCharSet; /* retained forever */
 	rock = [decoder decodeInt32ForKey:@"rock"];
 	// disprock is handled by the app
 
-	self.parenttag = [decoder decodeObjectForKey:@"parenttag"];
+	self.parenttag = GlkTagDecode(decoder, @"parenttag");
 	// parent will be set later
 	
 	input_request_id = [decoder decodeIntForKey:@"input_request_id"];
@@ -174,9 +166,9 @@ NSCharacterSet *_GlkWindow_newlineCharSet; /* retained forever */
 	echo_line_input = [decoder decodeBoolForKey:@"echo_line_input"];
 	style = [decoder decodeInt32ForKey:@"style"];
 
-	self.streamtag = [decoder decodeObjectForKey:@"streamtag"];
+	self.streamtag = GlkTagDecode(decoder, @"streamtag");
 	// streamtag will be set later
-	self.echostreamtag = [decoder decodeObjectForKey:@"echostreamtag"];
+	self.echostreamtag = GlkTagDecode(decoder, @"echostreamtag");
 	// echostreamtag will be set later
 
 	bbox = [decoder decodeCGRectForKey:@"bbox"];
@@ -229,16 +221,12 @@ NSCharacterSet *_GlkWindow_newlineCharSet; /* retained forever */
 	type = 0;
 	if (!tag)
 		[NSException raise:@"GlkException" format:@"GlkWindow reached dealloc with tag unset"];
-	self.tag = nil;
 	
 	self.line_request_initial = nil;
 	
 	self.stream = nil;
-	self.streamtag = nil;
 	self.echostream = nil;
-	self.echostreamtag = nil;
 	self.parent = nil;
-	self.parenttag = nil;
 	
 	self.styleset = nil;
 	self.library = nil;
@@ -247,13 +235,13 @@ NSCharacterSet *_GlkWindow_newlineCharSet; /* retained forever */
 }
 
 - (void) encodeWithCoder:(NSCoder *)encoder {
-	[encoder encodeObject:tag forKey:@"tag"];
+	GlkTagEncode(encoder, tag, @"tag");
 	
 	[encoder encodeInt32:type forKey:@"type"];
 	[encoder encodeInt32:rock forKey:@"rock"];
 	// disprock is handled by the app
 	
-	[encoder encodeObject:parenttag forKey:@"parenttag"];
+	GlkTagEncode(encoder, parenttag, @"parenttag");
 
 	[encoder encodeInt:input_request_id forKey:@"input_request_id"];
 
@@ -291,8 +279,8 @@ NSCharacterSet *_GlkWindow_newlineCharSet; /* retained forever */
 	[encoder encodeBool:echo_line_input forKey:@"echo_line_input"];
 	[encoder encodeInt32:style forKey:@"style"];
 
-	[encoder encodeObject:streamtag forKey:@"streamtag"];
-	[encoder encodeObject:echostreamtag forKey:@"echostreamtag"];
+	GlkTagEncode(encoder, streamtag, @"streamtag");
+	GlkTagEncode(encoder, echostreamtag, @"echostreamtag");
 
 	[encoder encodeCGRect:bbox forKey:@"bbox"];
 }
@@ -312,8 +300,8 @@ NSCharacterSet *_GlkWindow_newlineCharSet; /* retained forever */
 	
 	for (GlkWindowPair *wx=self.parent; wx; wx=wx.parent) {
 		if (wx.type == wintype_Pair) {
-			if ([wx.geometry.keytag isEqualToNumber:self.tag]) {
-				wx.geometry.keytag = nil;
+			if (wx.geometry.keytag == self.tag) {
+				wx.geometry.keytag = 0;
 				wx.geometry.keystyleset = nil;
 				wx.keydamage = YES;
 			}
@@ -334,16 +322,14 @@ NSCharacterSet *_GlkWindow_newlineCharSet; /* retained forever */
 	if (stream) {
 		[stream streamDelete];
 		self.stream = nil;
-		self.streamtag = nil;
+		self.streamtag = 0;
 	}
 	self.echostream = nil;
-	self.echostreamtag = nil;
+	self.echostreamtag = 0;
 	self.parent = nil;
-	self.parenttag = nil;
+	self.parenttag = 0;
 	
-	if (![library.windows containsObject:self])
-		[NSException raise:@"GlkException" format:@"GlkWindow was not in library windows list"];
-	[library.windows removeObject:self];
+	[library removeWindow:self];
 	inlibrary = NO;
 }
 
@@ -383,7 +369,7 @@ NSCharacterSet *_GlkWindow_newlineCharSet; /* retained forever */
 	for (GlkWindow *win in library.windows) {
 		if (win.echostream == str) {
 			win.echostream = nil;
-			win.echostreamtag = nil;
+			win.echostreamtag = 0;
 		}
 	}
 }
@@ -585,12 +571,18 @@ NSCharacterSet *_GlkWindow_newlineCharSet; /* retained forever */
 @implementation GlkWindowBuffer
 /* GlkWindowBuffer: a textbuffer window. */
 
-#define TRIM_LINES_MAX (200)
-#define TRIM_LINES_MIN (100)
+/* The default scrollback budget. When the window gets this far over either limit, old lines are trimmed until it's back under half of each. */
+#define TRIM_LINES_DEFAULT (200)
+#define TRIM_BYTES_DEFAULT (0)
 
 @synthesize clearcount;
 @synthesize linesdirtyfrom;
-@synthesize lines;
+@synthesize linecount;
+@synthesize linestart;
+@synthesize linesbytes;
+@synthesize maxlines;
+@synthesize maxbytes;
+@synthesize spill;
 
 - (id) initWithType:(glui32)wintype rock:(glui32)winrock {
 	self = [super initWithType:wintype rock:winrock];
@@ -598,7 +590,14 @@ NSCharacterSet *_GlkWindow_newlineCharSet; /* retained forever */
 	if (self) {
 		clearcount = 1; // contents start out clear
 		linesdirtyfrom = 0;
-		self.lines = [NSMutableArray arrayWithCapacity:32];
+		linessize = 32;
+		lines = (GlkStyledLine **)malloc(linessize * sizeof(GlkStyledLine *));
+		linesfirst = 0;
+		linecount = 0;
+		linestart = 0;
+		linesbytes = 0;
+		spill = nil;
+		[self updateScrollbackLimits];
 	}
 	
 	return self;
@@ -609,7 +608,32 @@ NSCharacterSet *_GlkWindow_newlineCharSet; /* retained forever */
 	
 	if (self) {
 		clearcount = [decoder decodeIntForKey:@"clearcount"];
-		self.lines = [decoder decodeObjectForKey:@"lines"];
+		
+		NSArray *arr = [decoder decodeObjectForKey:@"lines"];
+		linessize = 32;
+		while (linessize < arr.count)
+			linessize *= 2;
+		lines = (GlkStyledLine **)malloc(linessize * sizeof(GlkStyledLine *));
+		linesfirst = 0;
+		linecount = 0;
+		linestart = 0;
+		linesbytes = 0;
+		if (arr.count) {
+			GlkStyledLine *firstsln = [arr objectAtIndex:0];
+			linestart = firstsln.index;
+		}
+		for (GlkStyledLine *sln in arr) {
+			/* Every line but the last is finished. */
+			if (linecount)
+				[lines[linecount-1] freeze];
+			lines[linecount++] = [sln retain];
+			linesbytes += sln.memoryUsage;
+		}
+		
+		/* The library delegate isn't available yet; updateFromLibrary will call updateScrollbackLimits. */
+		maxlines = TRIM_LINES_DEFAULT;
+		maxbytes = TRIM_BYTES_DEFAULT;
+		spill = nil;
 		[self dirtyAllData];
 	}
 	
@@ -617,7 +641,17 @@ NSCharacterSet *_GlkWindow_newlineCharSet; /* retained forever */
 }
 
 - (void) dealloc {
-	self.lines = nil;
+	if (lines) {
+		for (int ix=0; ix<linecount; ix++)
+			[lines[(linesfirst+ix) & (linessize-1)] release];
+		free(lines);
+		lines = nil;
+	}
+	if (spill) {
+		[spill discard];
+		[spill release];
+		spill = nil;
+	}
 	[super dealloc];
 }
 
@@ -625,41 +659,127 @@ NSCharacterSet *_GlkWindow_newlineCharSet; /* retained forever */
 	[super encodeWithCoder:encoder];
 	
 	[encoder encodeInt:clearcount forKey:@"clearcount"];
-	[encoder encodeObject:lines forKey:@"lines"];
+	/* Archived as a plain array, as it always was. */
+	NSMutableArray *arr = [NSMutableArray arrayWithCapacity:linecount];
+	for (int ix=0; ix<linecount; ix++)
+		[arr addObject:lines[(linesfirst+ix) & (linessize-1)]];
+	[encoder encodeObject:arr forKey:@"lines"];
 	// linesdirtyfrom is always 0 at deserialize time
 	
 	//### should we cap the number of lines written out?
 }
 
+/* Ask the library delegate how much scrollback this window should keep, and whether to spill the rest to disk. */
+- (void) updateScrollbackLimits {
+	BOOL wantspill = NO;
+	maxlines = TRIM_LINES_DEFAULT;
+	maxbytes = TRIM_BYTES_DEFAULT;
+	/* The delegate method is optional; a delegate that doesn't implement it gets the defaults and no spill. */
+	id <IosGlkLibDelegate> delegate = library.glkdelegate;
+	if ([delegate respondsToSelector:@selector(scrollbackLimitsForWindowRock:lines:bytes:spill:)])
+		[delegate scrollbackLimitsForWindowRock:rock lines:&maxlines bytes:&maxbytes spill:&wantspill];
+	
+	if (wantspill && !spill) {
+		/* The spill files go in a per-game directory, named by window tag. Creating the spill truncates any leftovers from an earlier session. */
+		NSString *dirname = [[GlkFileRef documentsDirectory] stringByAppendingPathComponent:[NSString stringWithFormat:@"GlkScrollback_%@", library.gameId]];
+		NSString *name = [NSString stringWithFormat:@"win%ld", (long)tag];
+		spill = [[GlkScrollbackSpill alloc] initWithDirectory:dirname name:name]; // retained; may be nil
+	}
+	else if (!wantspill && spill) {
+		[spill discard];
+		[spill release];
+		spill = nil;
+	}
+}
+
+- (void) windowCloseRecurse:(BOOL)recurse {
+	if (spill) {
+		[spill discard];
+		[spill release];
+		spill = nil;
+	}
+	[super windowCloseRecurse:recurse];
+}
+
+/* Return the line with the given index, or nil if it's been trimmed (or not yet printed). */
+- (GlkStyledLine *) lineAtIndex:(int)index {
+	int pos = index - linestart;
+	if (pos < 0 || pos >= linecount)
+		return nil;
+	return lines[(linesfirst+pos) & (linessize-1)];
+}
+
+/* Add a line to the end of the ring, growing it if necessary. The line is numbered to follow the last one, which is now finished, so it's frozen. */
+- (GlkStyledLine *) addLineWithStatus:(GlkStyledLineStatus)status {
+	if (linecount)
+		[lines[(linesfirst+linecount-1) & (linessize-1)] freeze];
+	
+	if (linecount == linessize) {
+		/* Unroll the ring into a buffer twice the size. */
+		int newsize = linessize * 2;
+		GlkStyledLine **newlines = (GlkStyledLine **)malloc(newsize * sizeof(GlkStyledLine *));
+		for (int ix=0; ix<linecount; ix++)
+			newlines[ix] = lines[(linesfirst+ix) & (linessize-1)];
+		free(lines);
+		lines = newlines;
+		linessize = newsize;
+		linesfirst = 0;
+	}
+	
+	GlkStyledLine *sln = [[GlkStyledLine alloc] initWithIndex:linestart+linecount status:status]; // retained by the ring
+	lines[(linesfirst+linecount) & (linessize-1)] = sln;
+	linecount++;
+	linesbytes += sln.memoryUsage;
+	return sln;
+}
+
+/* Discard the oldest line. */
+- (void) removeFirstLine {
+	GlkStyledLine *sln = lines[linesfirst];
+	linesbytes -= sln.memoryUsage;
+	[sln release];
+	lines[linesfirst] = nil;
+	linesfirst = (linesfirst+1) & (linessize-1);
+	linecount--;
+	linestart++;
+}
+
 - (GlkWindowState *) cloneState {
 	GlkWindowBufferState *state = (GlkWindowBufferState *)[super cloneState];
 	
-	/* First, trim lines from the top if linesdirtyfrom is too large. We use linesdirtyfrom as the measure because that's the number of lines the player has seen -- at least, the number that have been cloned off to the view previously. (We also measure lines.count, for double-safety.) */
+	/* First, trim lines from the top if the scrollback is over budget. Only lines before linesdirtyfrom are trimmed, because those are the lines the player has seen -- at least, the ones that have been cloned off to the view previously. We trim down to half the budget, so that this doesn't happen every turn. The last line is always kept, so that the numbering carries on. Line indexes are not renumbered, so linesdirtyfrom stays where it is.
+	 
+		If we have a spill, the trimmed lines go there, in one write per trim. */
 	
-	if (linesdirtyfrom >= TRIM_LINES_MAX && lines.count >= TRIM_LINES_MAX) {
-		NSRange range;
-		range.location = 0;
-		range.length = TRIM_LINES_MAX - TRIM_LINES_MIN;
-		[lines removeObjectsInRange:range];
-		
-		linesdirtyfrom -= range.length;
+	if ((maxlines && linecount >= maxlines) || (maxbytes && linesbytes >= maxbytes)) {
+		while (linecount > 1 && linestart < linesdirtyfrom
+			&& ((maxlines && linecount > maxlines/2) || (maxbytes && linesbytes > maxbytes/2))) {
+			if (spill)
+				[spill appendLine:lines[linesfirst]];
+			[self removeFirstLine];
+		}
+		[spill flush];
 	}
 
-	int dirtyto = 0;
-	if (lines.count) {
-		GlkStyledLine *sln = [lines lastObject];
-		dirtyto = sln.index+1;
-	}
-	
-	NSMutableArray *arr = [NSMutableArray arrayWithCapacity:lines.count];
-	for (GlkStyledLine *sln in lines) {
-		GlkStyledLine *newsln = [sln copy];
+	int dirtyto = linestart + linecount; /* (zero if there are no lines, because linestart is too) */
+	
+	/* Only the lines from linesdirtyfrom on have changed since the last clone. The view already has the earlier ones (or, after a clear or dirtyAllData, linesdirtyfrom is the first line anyway), so we only pass along the dirty tail. Lines before linesdirtyfrom are never modified again, only trimmed.
+	 
+		Every line but the last is frozen, so copy just retains it; the view shares the same object. Only the last line, which may still grow, is really copied. So this costs one line copy plus a retain per new line, however much the turn printed. */
+	int firstdirty = linesdirtyfrom - linestart;
+	if (firstdirty < 0)
+		firstdirty = 0;
+	NSMutableArray *arr = [NSMutableArray arrayWithCapacity:(linecount > firstdirty ? linecount-firstdirty : 0)];
+	for (int ix=firstdirty; ix<linecount; ix++) {
+		GlkStyledLine *newsln = [lines[(linesfirst+ix) & (linessize-1)] copy];
 		[arr addObject:newsln];
 		[newsln release];
 	}
 	state.lines = arr;
 	
 	state.clearcount = clearcount;
+	state.linesstart = linestart;
+	state.spill = spill;
 	state.linesdirtyfrom = linesdirtyfrom;
 	state.linesdirtyto = dirtyto;
 	state.line_request_initial = line_request_initial;
@@ -680,93 +800,78 @@ NSCharacterSet *_GlkWindow_newlineCharSet; /* retained forever */
 	//### count on-screen lines, maybe
 }
 
+/* Widen the Latin-1 text, a chunk at a time, and pass it along. */
 - (void) putBuffer:(char *)buf len:(glui32)len {
-	if (!len)
-		return;
-	
-	/* Turn the buffer into an NSString. We'll release this at the end of the function. */
-	NSString *str = [[NSString alloc] initWithBytes:buf length:len encoding:NSISOLatin1StringEncoding];
-	[self putString:str];	
-	[str release];
-}
-
-- (void) putUBuffer:(glui32 *)buf len:(glui32)len {
-	if (!len)
-		return;
-	
-	/* Turn the buffer into an NSString. We'll release this at the end of the function. 
-		This is an endianness dependency; we're telling NSString that our array of 32-bit words in stored little-endian. (True for all iOS, as I write this.) */
-	NSString *str = [[NSString alloc] initWithBytes:buf length:len*sizeof(glui32) encoding:NSUTF32LittleEndianStringEncoding];
-	[self putString:str];	
-	[str release];
+	glui32 ubuf[256];
+	
+	while (len) {
+		glui32 count = MIN(len, 256);
+		for (glui32 ix=0; ix<count; ix++)
+			ubuf[ix] = (unsigned char)(buf[ix]);
+		[self putUBuffer:ubuf len:count];
+		buf += count;
+		len -= count;
+	}
 }
 
-/* Break the string up into GlkStyledLines. When the GlkWinBufferView updates, it will pluck these out and make use of them.
+/* Break the text up into GlkStyledLines. When the GlkWinBufferView updates, it will pluck these out and make use of them.
 */
-- (void) putString:(NSString *)str {
-	NSArray *linearr = [str componentsSeparatedByCharactersInSet:_GlkWindow_newlineCharSet];
-	BOOL isfirst = YES;
-	
-	int linestart = 0;
-	if (lines.count) {
-		GlkStyledLine *firstln = [lines objectAtIndex:0];
-		linestart = firstln.index;
-	}
-	
-	for (NSString *ln in linearr) {
-		if (isfirst) {
-			/* The first line is always a paragraph continuation. (Perhaps an empty one.) */
-			isfirst = NO;
-		}
-		else {
-			/* This is a succeeding line, so it's the start of a new paragraph. */
-			GlkStyledLine *sln = [[[GlkStyledLine alloc] initWithIndex:linestart+lines.count status:linestat_NewLine] autorelease];
-			[lines addObject:sln];
-		}
+- (void) putUBuffer:(glui32 *)buf len:(glui32)len {
+	GlkStyledLine *lastsln = nil;
+	if (linecount)
+		lastsln = lines[(linesfirst+linecount-1) & (linessize-1)];
+	glui32 pos = 0;
+	
+	while (pos < len) {
+		glui32 end = pos;
+		while (end < len && buf[end] != '\n')
+			end++;
 		
-		if (ln.length == 0) {
-			/* This line has no content. (We've already added the new paragraph.) */
-			continue;
+		if (end > pos) {
+			/* Text with no newline is a paragraph continuation. */
+			if (!lastsln)
+				lastsln = [self addLineWithStatus:linestat_Continue];
+			if (linesdirtyfrom > lastsln.index)
+				linesdirtyfrom = lastsln.index;
+			linesbytes -= lastsln.memoryUsage;
+			[lastsln appendChars:buf+pos len:end-pos style:style];
+			linesbytes += lastsln.memoryUsage;
 		}
 		
-		GlkStyledLine *lastsln = [lines lastObject];
-		if (!lastsln) {
-			lastsln = [[[GlkStyledLine alloc] initWithIndex:linestart+lines.count status:linestat_Continue] autorelease];
-			[lines addObject:lastsln];
+		if (end < len) {
+			/* A newline: this is the start of a new paragraph. */
+			lastsln = [self addLineWithStatus:linestat_NewLine];
+			end++;
 		}
-		if (linesdirtyfrom > lastsln.index)
-			linesdirtyfrom = lastsln.index;
 		
-		GlkStyledString *laststr = [lastsln.arr lastObject];
-		if (laststr && laststr.style == style) {
-			[laststr appendString:ln];
-		}
-		else {
-			GlkStyledString *newstr = [[[GlkStyledString alloc] initWithText:ln style:style] autorelease];
-			[lastsln.arr addObject:newstr];
-		}
+		pos = end;
 	}
 }
 
+- (void) putString:(NSString *)str {
+	NSData *data = [str dataUsingEncoding:NSUTF32LittleEndianStringEncoding];
+	[self putUBuffer:(glui32 *)data.bytes len:data.length/sizeof(glui32)];
+}
+
 - (BOOL) supportsInput {
 	return YES;
 }
 
 - (void) dirtyAllData {
-	linesdirtyfrom = 0;
-	if (lines.count) {
-		GlkStyledLine *firstln = [lines objectAtIndex:0];
-		linesdirtyfrom = firstln.index;
-	}
+	linesdirtyfrom = linestart;
 }
 
 - (void) clearWindow {
-	[lines removeAllObjects];
+	while (linecount)
+		[self removeFirstLine];
+	linesfirst = 0;
+	linestart = 0;
+	linesbytes = 0;
 	linesdirtyfrom = 0;
 	clearcount++;
+	[spill reset];
 	
-	GlkStyledLine *sln = [[[GlkStyledLine alloc] initWithIndex:0 status:linestat_ClearPage] autorelease];
-	[lines addObject:sln];
+	[self addLineWithStatus:linestat_ClearPage];
 }
 
 @end
@@ -847,31 +952,21 @@ NSCharacterSet *_GlkWindow_newlineCharSet; /* retained forever */
 	
 	NSMutableArray *linearr = [NSMutableArray arrayWithCapacity:lines.count];
 
+	/* Only send lines which really changed. A line that was cleared and rewritten with the same text (a typical status line) is dirty, but not different. */
 	for (int jx=0; jx<lines.count; jx++) {
 		GlkGridLine *ln = [lines objectAtIndex:jx];
 		if (!ln.dirty)
 			continue;
-		ln.dirty = NO;
+		if (![ln differsFromSent]) {
+			ln.dirty = NO;
+			continue;
+		}
+		[ln markSent];
 		
-		GlkStyledLine *sln = [[GlkStyledLine alloc] initWithIndex:jx]; // release soon
+		/* The snapshot is the row's raw characters plus its style runs, which cover the whole row (so each run's start is its column). The view makes NSStrings only when it draws. */
+		GlkStyledLine *sln = [[GlkStyledLine alloc] initWithIndex:jx chars:ln.chars styles:ln.styles len:ln.width]; // release soon
 		[linearr addObject:sln];
 		[sln release];
-		
-		NSMutableArray *arr = sln.arr;
-		glui32 cursty;
-		int ix = 0;
-		while (ix < ln.width) {
-			int pos = ix;
-			cursty = ln.styles[pos];
-			while (ix < ln.width && ln.styles[ix] == cursty)
-				ix++;
-			NSString *str = [[NSString alloc] initWithBytes:&ln.chars[pos] length:(ix-pos)*sizeof(glui32) encoding:NSUTF32LittleEndianStringEncoding]; // release soon
-			GlkStyledString *span = [[GlkStyledString alloc] initWithText:str style:cursty]; // release soon
-			span.pos = pos;
-			[arr addObject:span];
-			[span release];
-			[str release];
-		}
 	}
 	
 	state.lines = linearr;
@@ -914,7 +1009,7 @@ NSCharacterSet *_GlkWindow_newlineCharSet; /* retained forever */
 
 - (void) dirtyAllData {
 	for (GlkGridLine *ln in lines) {
-		ln.dirty = YES;
+		[ln forgetSent];
 	}
 }
 
@@ -935,18 +1030,8 @@ NSCharacterSet *_GlkWindow_newlineCharSet; /* retained forever */
 	}
 }
 
-- (void) putBuffer:(char *)buf len:(glui32)len {
-	for (int ix=0; ix<len; ix++)
-		[self putUChar:(unsigned char)(buf[ix])];
-}
-
-- (void) putUBuffer:(glui32 *)buf len:(glui32)len {
-	for (int ix=0; ix<len; ix++)
-		[self putUChar:buf[ix]];
-}
-
-- (void) putUChar:(glui32)ch {
-	/* Canonicalize the cursor position. That is, the cursor may have been left outside the window area, or may be too close to the edge to print the next character. Wrap it if necessary. */
+/* Canonicalize the cursor position. That is, the cursor may have been left outside the window area, or may be too close to the edge to print the next character. Wrap it if necessary. Returns NO if the cursor is below the window, in which case nothing can be printed. */
+- (BOOL) canonicalizeCursor {
 	if (curx < 0)
 		curx = 0;
 	else if (curx >= width) {
@@ -956,7 +1041,72 @@ NSCharacterSet *_GlkWindow_newlineCharSet; /* retained forever */
 	if (cury < 0)
 		cury = 0;
 	else if (cury >= height)
-		return; /* outside the window */
+		return NO; /* outside the window */
+	return YES;
+}
+
+/* The buffer is written in spans: each span runs to the next newline or the end of the row, whichever comes first, and is copied into the row in one go. */
+- (void) putBuffer:(char *)buf len:(glui32)len {
+	glui32 ix = 0;
+	while (ix < len) {
+		if (![self canonicalizeCursor])
+			return;
+		if (buf[ix] == '\n') {
+			/* a newline just moves the cursor. */
+			cury++;
+			curx = 0;
+			ix++;
+			continue;
+		}
+		
+		glui32 spanlen = width - curx;
+		if (spanlen > len - ix)
+			spanlen = len - ix;
+		char *nl = memchr(buf+ix, '\n', spanlen);
+		if (nl)
+			spanlen = nl - (buf+ix);
+		
+		GlkGridLine *ln = [lines objectAtIndex:cury];
+		[ln putChars:buf+ix len:spanlen at:curx style:style];
+		curx += spanlen;
+		ix += spanlen;
+	}
+	
+	/* We can leave the cursor outside the window, since it will be canonicalized next time a character is printed. */
+}
+
+- (void) putUBuffer:(glui32 *)buf len:(glui32)len {
+	glui32 ix = 0;
+	while (ix < len) {
+		if (![self canonicalizeCursor])
+			return;
+		if (buf[ix] == '\n') {
+			cury++;
+			curx = 0;
+			ix++;
+			continue;
+		}
+		
+		glui32 spanlen = width - curx;
+		if (spanlen > len - ix)
+			spanlen = len - ix;
+		for (glui32 jx=1; jx<spanlen; jx++) {
+			if (buf[ix+jx] == '\n') {
+				spanlen = jx;
+				break;
+			}
+		}
+		
+		GlkGridLine *ln = [lines objectAtIndex:cury];
+		[ln putUChars:buf+ix len:spanlen at:curx style:style];
+		curx += spanlen;
+		ix += spanlen;
+	}
+}
+
+- (void) putUChar:(glui32)ch {
+	if (![self canonicalizeCursor])
+		return;
 
 	if (ch == '\n') {
 		/* a newline just moves the cursor. */
@@ -1054,7 +1204,7 @@ NSCharacterSet *_GlkWindow_newlineCharSet; /* retained forever */
 		geometry.child1tag = newwin.tag;
 	}
 	else {
-		geometry.child1tag = nil;
+		geometry.child1tag = 0;
 	}
 	[child1 release];
 	child1 = newwin;
@@ -1066,7 +1216,7 @@ NSCharacterSet *_GlkWindow_newlineCharSet; /* retained forever */
 		geometry.child2tag = newwin.tag;
 	}
 	else {
-		geometry.child2tag = nil;
+		geometry.child2tag = 0;
 	}
 	[child2 release];
 	child2 = newwin;
@@ -5,16 +5,18 @@
  */
 
 #import <Foundation/Foundation.h>
+#import "GlkTagTable.h"
 #include "glk.h"
 
 @class GlkLibraryState;
 @class StyleSet;
 @class Geometry;
+@class GlkScrollbackSpill;
 
 @interface GlkWindowState : NSObject {
 	GlkLibraryState *library; // weak parent link (unretained)
 	
-	NSNumber *tag;
+	GlkTag tag;
 	glui32 type;
 	glui32 rock;
 	
@@ -27,7 +29,7 @@
 }
 
 @property (nonatomic, assign) GlkLibraryState *library; // unretained
-@property (nonatomic, retain) NSNumber *tag;
+@property (nonatomic) GlkTag tag;
 @property (nonatomic) glui32 type;
 @property (nonatomic) glui32 rock;
 @property (nonatomic, retain) StyleSet *styleset;
@@ -44,15 +46,19 @@
 
 @interface GlkWindowBufferState : GlkWindowState {
 	int clearcount; /* incremented whenever the buffer is cleared */
+	int linesstart; /* index of the first line the window still holds; anything before this has been trimmed */
 	int linesdirtyfrom; /* index of first new (or changed) line */
 	int linesdirtyto; /* the index of the last line, plus one (or zero if there are no lines */
-	NSArray *lines; /* array of GlkStyledLine (indexes do not necessarily start at zero!) */
+	NSArray *lines; /* array of GlkStyledLine, only from linesdirtyfrom to linesdirtyto -- the view already has the earlier ones */
+	GlkScrollbackSpill *spill; /* lines trimmed before linesstart, if the window spills them to disk (or nil). The view may page these in at any time. */
 }
 
 @property (nonatomic) int clearcount;
+@property (nonatomic) int linesstart;
 @property (nonatomic) int linesdirtyfrom;
 @property (nonatomic) int linesdirtyto;
 @property (nonatomic, retain) NSArray *lines;
+@property (nonatomic, retain) GlkScrollbackSpill *spill;
 
 @end
 
@@ -53,7 +53,6 @@
 
 - (void) dealloc {
 	self.library = nil;
-	self.tag = nil;
 	self.styleset = nil;
 	self.line_request_initial = nil;
 	[super dealloc];
@@ -82,12 +81,15 @@
 @implementation GlkWindowBufferState
 
 @synthesize lines;
+@synthesize linesstart;
 @synthesize linesdirtyfrom;
 @synthesize linesdirtyto;
 @synthesize clearcount;
+@synthesize spill;
 
 - (void) dealloc {
 	self.lines = nil;
+	self.spill = nil;
 	[super dealloc];
 }
 